@@ -5,6 +5,7 @@
 #include <fcntl.h>
 #include <unistd.h>
 
+#include <limits>
 #include <memory>
 #include <utility>
 
@@ -19,12 +20,14 @@
 #include "lib/fxl/log_settings_command_line.h"
 #include "lib/fxl/logging.h"
 #include "lib/fxl/macros.h"
+#include "lib/fxl/strings/string_number_conversions.h"
 #include "lib/fxl/time/time_delta.h"
 #include "lib/fxl/time/time_point.h"
 #include "peridot/bin/ledger/app/ledger_repository_factory_impl.h"
 #include "peridot/bin/ledger/cobalt/cobalt.h"
 #include "peridot/bin/ledger/environment/environment.h"
 #include "peridot/bin/ledger/fidl/internal.fidl.h"
+#include "peridot/bin/ledger/storage/impl/leveldb_options.h"
 #include "peridot/lib/backoff/exponential_backoff.h"
 
 namespace ledger {
@@ -37,9 +40,30 @@ constexpr fxl::TimeDelta kMaxPollingDelay = fxl::TimeDelta::FromSeconds(10);
 constexpr fxl::StringView kNoMinFsFlag = "no_minfs_wait";
 constexpr fxl::StringView kNoStatisticsReporting =
     "no_statistics_reporting_for_testing";
+constexpr fxl::StringView kImplicitCommitWindowMs = "implicit_commit_window_ms";
+constexpr fxl::StringView kCompressPieces = "compress_pieces";
+constexpr fxl::StringView kSharedPageDb = "shared_page_db";
+constexpr fxl::StringView kBlobStore = "blob_store";
+constexpr fxl::StringView kStorageCacheSizeMb = "storage_cache_size_mb";
+constexpr fxl::StringView kStorageBloomFilterBits = "storage_bloom_filter_bits";
+constexpr fxl::StringView kStorageWriteBufferSizeKb =
+    "storage_write_buffer_size_kb";
+constexpr fxl::StringView kStorageNoCompression = "storage_no_compression";
+constexpr fxl::StringView kStorageGroupCommitWindowMs =
+    "storage_group_commit_window_ms";
+// Bloom filters gain little from more bits per key: 10 bits already give a
+// false positive rate of about 1%.
+constexpr int64_t kMaxBloomFilterBits = 64;
+// Writes wait for the group commit window: longer windows only add latency.
+constexpr int64_t kMaxGroupCommitWindowMs = 1000;
 
 struct AppParams {
   bool disable_statistics = false;
+  fxl::TimeDelta implicit_commit_window;
+  bool compress_pieces = false;
+  bool shared_page_db = false;
+  bool blob_store = false;
+  storage::StorageProfile storage_profile;
 };
 
 fxl::AutoCall<fxl::Closure> SetupCobalt(
@@ -52,6 +76,28 @@ fxl::AutoCall<fxl::Closure> SetupCobalt(
   return InitializeCobalt(std::move(task_runner), application_context);
 };
 
+// Reads the value of the numeric flag |flag|, if present, and stores it,
+// multiplied by |unit|, in |value|. Returns false if the value is negative or
+// if the result is larger than |max_value|.
+bool ReadNumericFlag(const fxl::CommandLine& command_line,
+                     fxl::StringView flag,
+                     int64_t unit,
+                     int64_t max_value,
+                     int64_t* value) {
+  std::string flag_value;
+  if (!command_line.GetOptionValue(flag.ToString(), &flag_value)) {
+    return true;
+  }
+  int64_t result;
+  if (!fxl::StringToNumberWithError(flag_value, &result) || result < 0 ||
+      result > max_value / unit) {
+    FXL_LOG(ERROR) << "Invalid value for --" << flag << ": " << flag_value;
+    return false;
+  }
+  *value = result * unit;
+  return true;
+}
+
 // App is the main entry point of the Ledger application.
 //
 // It is responsible for setting up the LedgerRepositoryFactory, which connects
@@ -75,9 +121,14 @@ class App : public LedgerController {
 
   bool Start() {
     environment_ = std::make_unique<Environment>(loop_.task_runner());
+    environment_->set_implicit_commit_window(
+        app_params_.implicit_commit_window);
+    environment_->set_compress_pieces(app_params_.compress_pieces);
+    environment_->set_shared_page_db(app_params_.shared_page_db);
+    environment_->set_blob_store(app_params_.blob_store);
 
-    factory_impl_ =
-        std::make_unique<LedgerRepositoryFactoryImpl>(environment_.get());
+    factory_impl_ = std::make_unique<LedgerRepositoryFactoryImpl>(
+        environment_.get(), app_params_.storage_profile);
 
     application_context_->outgoing_services()
         ->AddService<LedgerRepositoryFactory>(
@@ -146,6 +197,55 @@ int main(int argc, const char** argv) {
   ledger::AppParams app_params;
   app_params.disable_statistics =
       command_line.HasOption(ledger::kNoStatisticsReporting);
+  std::string implicit_commit_window_ms;
+  if (command_line.GetOptionValue(ledger::kImplicitCommitWindowMs.ToString(),
+                                  &implicit_commit_window_ms)) {
+    int64_t window_ms;
+    if (!fxl::StringToNumberWithError(implicit_commit_window_ms, &window_ms) ||
+        window_ms < 0) {
+      FXL_LOG(ERROR) << "Invalid value for --"
+                     << ledger::kImplicitCommitWindowMs << ": "
+                     << implicit_commit_window_ms;
+      return 1;
+    }
+    app_params.implicit_commit_window =
+        fxl::TimeDelta::FromMilliseconds(window_ms);
+  }
+
+  app_params.compress_pieces =
+      command_line.HasOption(ledger::kCompressPieces.ToString());
+  app_params.shared_page_db =
+      command_line.HasOption(ledger::kSharedPageDb.ToString());
+  app_params.blob_store = command_line.HasOption(ledger::kBlobStore.ToString());
+
+  storage::StorageProfile& storage_profile = app_params.storage_profile;
+  int64_t cache_size = 0;
+  int64_t bloom_filter_bits = 0;
+  int64_t write_buffer_size = 0;
+  int64_t group_commit_window_ms =
+      storage_profile.shared_db_group_commit_window.ToMilliseconds();
+  if (!ledger::ReadNumericFlag(command_line, ledger::kStorageCacheSizeMb,
+                               1024 * 1024, std::numeric_limits<int32_t>::max(),
+                               &cache_size) ||
+      !ledger::ReadNumericFlag(command_line, ledger::kStorageBloomFilterBits, 1,
+                               ledger::kMaxBloomFilterBits,
+                               &bloom_filter_bits) ||
+      !ledger::ReadNumericFlag(command_line, ledger::kStorageWriteBufferSizeKb,
+                               1024, std::numeric_limits<int32_t>::max(),
+                               &write_buffer_size) ||
+      !ledger::ReadNumericFlag(command_line,
+                               ledger::kStorageGroupCommitWindowMs, 1,
+                               ledger::kMaxGroupCommitWindowMs,
+                               &group_commit_window_ms)) {
+    return 1;
+  }
+  storage_profile.block_cache_size = cache_size;
+  storage_profile.bloom_filter_bits_per_key = bloom_filter_bits;
+  storage_profile.write_buffer_size = write_buffer_size;
+  storage_profile.compression =
+      !command_line.HasOption(ledger::kStorageNoCompression.ToString());
+  storage_profile.shared_db_group_commit_window =
+      fxl::TimeDelta::FromMilliseconds(group_commit_window_ms);
 
   if (!command_line.HasOption(ledger::kNoMinFsFlag.ToString())) {
     // Poll until /data is persistent. This is need to retrieve the Ledger
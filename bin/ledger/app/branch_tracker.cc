@@ -6,30 +6,147 @@
 
 #include <vector>
 
+#include "lib/fsl/vmo/sized_vmo.h"
 #include "lib/fxl/functional/auto_call.h"
 #include "lib/fxl/functional/make_copyable.h"
+#include "lib/fxl/memory/ref_counted.h"
 #include "peridot/bin/ledger/app/diff_utils.h"
 #include "peridot/bin/ledger/app/fidl/serialization_size.h"
 #include "peridot/bin/ledger/app/page_manager.h"
 #include "peridot/bin/ledger/app/page_utils.h"
 #include "peridot/lib/callback/scoped_callback.h"
 #include "peridot/lib/callback/waiter.h"
+#include "peridot/lib/convert/convert.h"
+#include "zx/vmo.h"
 
 namespace ledger {
+namespace {
+// Returns a copy of |entry|, with its own handle to the value, if any.
+EntryPtr CloneEntry(const EntryPtr& entry) {
+  EntryPtr clone = Entry::New();
+  clone->key = entry->key.Clone();
+  clone->priority = entry->priority;
+  if (entry->value) {
+    zx::vmo vmo;
+    zx_status_t zx_status = entry->value->vmo.duplicate(
+        ZX_RIGHTS_BASIC | ZX_RIGHT_READ | ZX_RIGHT_MAP, &vmo);
+    if (zx_status != ZX_OK) {
+      FXL_LOG(ERROR) << "Unable to duplicate a vmo. Status: " << zx_status;
+      return nullptr;
+    }
+    clone->value = fsl::SizedVmo(std::move(vmo), entry->value->size)
+                       .ToTransport();
+  }
+  return clone;
+}
+}  // namespace
+
+// The change between two commits, computed once and shared by all the watchers
+// of the page. The diff callback and the watchers requesting the change can
+// come in any order.
+class BranchTracker::SharedPageChange
+    : public fxl::RefCountedThreadSafe<SharedPageChange> {
+ public:
+  SharedPageChange(std::unique_ptr<const storage::Commit> base,
+                   std::unique_ptr<const storage::Commit> target,
+                   std::string key_prefix)
+      : base_(std::move(base)),
+        target_(std::move(target)),
+        key_prefix_(std::move(key_prefix)) {}
+
+  const storage::Commit& base() const { return *base_; }
+  const storage::Commit& target() const { return *target_; }
+  const std::string& key_prefix() const { return key_prefix_; }
+
+  void SetResult(Status status, PageChangePtr page_change) {
+    FXL_DCHECK(!ready_);
+    ready_ = true;
+    status_ = status;
+    page_change_ = std::move(page_change);
+    auto pending_requests = std::move(pending_requests_);
+    for (auto& request : pending_requests) {
+      GetPageChange(request.first, std::move(request.second));
+    }
+  }
+
+  // Calls |callback| with the part of the change concerning the keys starting
+  // with |key_prefix|, once it is available. |key_prefix| must start with the
+  // prefix this change was computed for.
+  void GetPageChange(std::string key_prefix,
+                     std::function<void(Status, PageChangePtr)> callback) {
+    FXL_DCHECK(PageUtils::MatchesPrefix(key_prefix, key_prefix_));
+    if (!ready_) {
+      pending_requests_.emplace_back(std::move(key_prefix),
+                                     std::move(callback));
+      return;
+    }
+    if (status_ != Status::OK) {
+      callback(status_, nullptr);
+      return;
+    }
+    if (!page_change_) {
+      callback(Status::OK, nullptr);
+      return;
+    }
+
+    PageChangePtr filtered_change = PageChange::New();
+    filtered_change->timestamp = page_change_->timestamp;
+    filtered_change->changes = fidl::Array<EntryPtr>::New(0);
+    filtered_change->deleted_keys = fidl::Array<fidl::Array<uint8_t>>::New(0);
+    for (const auto& entry : page_change_->changes) {
+      if (!PageUtils::MatchesPrefix(convert::ToString(entry->key),
+                                    key_prefix)) {
+        continue;
+      }
+      EntryPtr clone = CloneEntry(entry);
+      if (!clone) {
+        callback(Status::INTERNAL_ERROR, nullptr);
+        return;
+      }
+      filtered_change->changes.push_back(std::move(clone));
+    }
+    for (const auto& deleted_key : page_change_->deleted_keys) {
+      if (PageUtils::MatchesPrefix(convert::ToString(deleted_key),
+                                   key_prefix)) {
+        filtered_change->deleted_keys.push_back(deleted_key.Clone());
+      }
+    }
+    if (filtered_change->changes.empty() &&
+        filtered_change->deleted_keys.empty()) {
+      callback(Status::OK, nullptr);
+      return;
+    }
+    callback(Status::OK, std::move(filtered_change));
+  }
+
+ private:
+  std::unique_ptr<const storage::Commit> base_;
+  std::unique_ptr<const storage::Commit> target_;
+  const std::string key_prefix_;
+
+  bool ready_ = false;
+  Status status_ = Status::OK;
+  PageChangePtr page_change_;
+  std::vector<
+      std::pair<std::string, std::function<void(Status, PageChangePtr)>>>
+      pending_requests_;
+};
+
 class BranchTracker::PageWatcherContainer {
  public:
   PageWatcherContainer(coroutine::CoroutineService* coroutine_service,
                        PageWatcherPtr watcher,
                        PageManager* page_manager,
-                       storage::PageStorage* storage,
+                       BranchTracker* tracker,
                        std::unique_ptr<const storage::Commit> base_commit,
                        std::string key_prefix)
       : change_in_flight_(false),
         last_commit_(std::move(base_commit)),
+        last_commit_pin_(tracker->storage_->PinCommit(last_commit_->GetId())),
         coroutine_service_(coroutine_service),
         key_prefix_(std::move(key_prefix)),
         manager_(page_manager),
-        storage_(storage),
+        tracker_(tracker),
         interface_(std::move(watcher)),
         weak_factory_(this) {
     interface_.set_connection_error_handler([this] {
@@ -57,7 +174,10 @@ class BranchTracker::PageWatcherContainer {
     on_empty_callback_ = std::move(on_empty_callback);
   }
 
+  const std::string& key_prefix() const { return key_prefix_; }
+
   void UpdateCommit(std::unique_ptr<const storage::Commit> commit) {
+    current_commit_pin_ = tracker_->storage_->PinCommit(commit->GetId());
     current_commit_ = std::move(commit);
     SendCommit();
   }
@@ -84,6 +204,11 @@ class BranchTracker::PageWatcherContainer {
   }
 
  private:
+  void SetLastCommit(std::unique_ptr<const storage::Commit> commit) {
+    last_commit_pin_ = tracker_->storage_->PinCommit(commit->GetId());
+    last_commit_ = std::move(commit);
+  }
+
   // Returns true if all changes have been sent to the watcher client, false
   // otherwise.
   bool Drained() {
@@ -156,7 +281,7 @@ class BranchTracker::PageWatcherContainer {
                 return;
               }
               change_in_flight_ = false;
-              last_commit_.swap(new_commit);
+              SetLastCommit(std::move(new_commit));
               // SendCommit will start handling the following commit, so we need
               // to make sure on_done() is called before that.
               on_done();
@@ -181,15 +306,14 @@ class BranchTracker::PageWatcherContainer {
     change_in_flight_ = true;
 
     // TODO(etiennej): See LE-74: clean object ownership
-    diff_utils::ComputePageChange(
-        storage_, *last_commit_, *current_commit_, key_prefix_, key_prefix_,
-        diff_utils::PaginationBehavior::NO_PAGINATION,
+    tracker_->GetPageChange(
+        *last_commit_, *current_commit_, key_prefix_,
         callback::MakeScoped(
             weak_factory_.GetWeakPtr(),
-            fxl::MakeCopyable([this, new_commit = std::move(current_commit_)](
+            fxl::MakeCopyable([this, new_commit = std::move(current_commit_),
+                               new_commit_pin = std::move(current_commit_pin_)](
                                   Status status,
-                                  std::pair<PageChangePtr, std::string>
-                                      page_change_ptr) mutable {
+                                  PageChangePtr page_change) mutable {
               if (status != Status::OK) {
                 // This change notification is abandonned. At the next commit,
                 // we will try again (but not before). The next notification
@@ -200,14 +324,14 @@ class BranchTracker::PageWatcherContainer {
                 return;
               }
 
-              if (!page_change_ptr.first) {
+              if (!page_change) {
                 change_in_flight_ = false;
-                last_commit_.swap(new_commit);
+                SetLastCommit(std::move(new_commit));
                 SendCommit();
                 return;
               }
               std::vector<PageChangePtr> paginated_changes =
-                  PaginateChanges(std::move(page_change_ptr.first));
+                  PaginateChanges(std::move(page_change));
               if (paginated_changes.size() == 1) {
                 SendChange(std::move(paginated_changes[0]),
                            ResultState::COMPLETED, std::move(new_commit),
@@ -253,12 +377,16 @@ class BranchTracker::PageWatcherContainer {
   fxl::Closure on_empty_callback_ = nullptr;
   bool change_in_flight_;
   std::unique_ptr<const storage::Commit> last_commit_;
+  // Keep the contents of |last_commit_| and |current_commit_| from being
+  // garbage collected while the change between them is computed.
+  std::unique_ptr<storage::PageStorage::CommitPin> last_commit_pin_;
   std::unique_ptr<const storage::Commit> current_commit_;
+  std::unique_ptr<storage::PageStorage::CommitPin> current_commit_pin_;
   coroutine::CoroutineService* coroutine_service_;
   coroutine::CoroutineHandler* handler_ = nullptr;
   const std::string key_prefix_;
   PageManager* manager_;
-  storage::PageStorage* storage_;
+  BranchTracker* tracker_;
   PageWatcherPtr interface_;
 
   // This must be the last member of the class.
@@ -330,7 +458,9 @@ void BranchTracker::OnNewCommits(
     new_current_commit = &commit;
   }
   if (changed) {
+    current_commit_pin_ = storage_->PinCommit(current_commit_id_);
     current_commit_ = (*new_current_commit)->Clone();
+    PruneSharedPageChanges();
   }
 
   if (!changed || transaction_in_progress_) {
@@ -362,7 +492,9 @@ void BranchTracker::StopTransaction(
 
   if (commit) {
     current_commit_id_ = commit->GetId();
+    current_commit_pin_ = storage_->PinCommit(current_commit_id_);
     current_commit_ = std::move(commit);
+    PruneSharedPageChanges();
   }
 
   if (!current_commit_) {
@@ -383,7 +515,7 @@ void BranchTracker::RegisterPageWatcher(
     std::unique_ptr<const storage::Commit> base_commit,
     std::string key_prefix) {
   watchers_.emplace(coroutine_service_, std::move(page_watcher_ptr), manager_,
-                    storage_, std::move(base_commit), std::move(key_prefix));
+                    this, std::move(base_commit), std::move(key_prefix));
 }
 
 bool BranchTracker::IsEmpty() {
@@ -403,4 +535,62 @@ void BranchTracker::CheckEmpty() {
     on_empty_callback_();
 }
 
+void BranchTracker::GetPageChange(
+    const storage::Commit& base,
+    const storage::Commit& target,
+    const std::string& key_prefix,
+    std::function<void(Status, PageChangePtr)> callback) {
+  std::vector<fxl::RefPtr<SharedPageChange>>& shared_page_changes =
+      shared_page_changes_[std::make_pair(base.GetId(), target.GetId())];
+  for (const auto& shared_page_change : shared_page_changes) {
+    if (PageUtils::MatchesPrefix(key_prefix,
+                                 shared_page_change->key_prefix())) {
+      shared_page_change->GetPageChange(key_prefix, std::move(callback));
+      return;
+    }
+  }
+
+  // Either no watcher of this range requested this change yet, or the change
+  // was computed before a watcher with a shorter prefix registered. Computes
+  // the change for all the current watchers of the range.
+  auto shared_page_change = fxl::AdoptRef(new SharedPageChange(
+      base.Clone(), target.Clone(), GetWatchedPrefix(key_prefix)));
+  shared_page_changes.push_back(shared_page_change);
+  shared_page_change->GetPageChange(key_prefix, std::move(callback));
+  diff_utils::ComputePageChange(
+      storage_, shared_page_change->base(), shared_page_change->target(),
+      shared_page_change->key_prefix(), shared_page_change->key_prefix(),
+      diff_utils::PaginationBehavior::NO_PAGINATION,
+      [shared_page_change](
+          Status status, std::pair<PageChangePtr, std::string> page_change) {
+        shared_page_change->SetResult(status, std::move(page_change.first));
+      });
+}
+
+std::string BranchTracker::GetWatchedPrefix(const std::string& key_prefix) {
+  // Two key prefixes are either disjoint, or one of them starts with the
+  // other: the shortest watched prefix matching |key_prefix| covers all the
+  // watchers whose range overlaps with it.
+  std::string prefix = key_prefix;
+  for (const auto& watcher : watchers_) {
+    const std::string& watched_prefix = watcher.key_prefix();
+    if (watched_prefix.size() < prefix.size() &&
+        PageUtils::MatchesPrefix(key_prefix, watched_prefix)) {
+      prefix = watched_prefix;
+    }
+  }
+  return prefix;
+}
+
+void BranchTracker::PruneSharedPageChanges() {
+  for (auto it = shared_page_changes_.begin();
+       it != shared_page_changes_.end();) {
+    if (it->first.second == current_commit_id_) {
+      ++it;
+    } else {
+      it = shared_page_changes_.erase(it);
+    }
+  }
+}
+
 }  // namespace ledger
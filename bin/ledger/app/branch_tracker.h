@@ -5,8 +5,13 @@
 #ifndef PERIDOT_BIN_LEDGER_APP_BRANCH_TRACKER_H_
 #define PERIDOT_BIN_LEDGER_APP_BRANCH_TRACKER_H_
 
+#include <map>
 #include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 
+#include "lib/fxl/memory/ref_ptr.h"
 #include "lib/fxl/memory/weak_ptr.h"
 #include "lib/ledger/fidl/ledger.fidl.h"
 #include "peridot/bin/ledger/app/page_snapshot_impl.h"
@@ -61,6 +66,7 @@ class BranchTracker : public storage::CommitWatcher {
 
  private:
   class PageWatcherContainer;
+  class SharedPageChange;
 
   // storage::CommitWatcher:
   void OnNewCommits(
@@ -71,6 +77,24 @@ class BranchTracker : public storage::CommitWatcher {
 
   void CheckEmpty();
 
+  // Computes the change between |base| and |target| for the keys starting
+  // with |key_prefix|. The diff is computed once for all the watchers whose
+  // prefix ranges overlap, on the range covering them, and then filtered for
+  // each caller. Watchers of disjoint ranges don't share a diff.
+  // The PageChangePtr passed to |callback| is nullptr if the filtered change
+  // is empty.
+  void GetPageChange(const storage::Commit& base,
+                     const storage::Commit& target,
+                     const std::string& key_prefix,
+                     std::function<void(Status, PageChangePtr)> callback);
+
+  // Returns the shortest key prefix of a watcher that |key_prefix| starts
+  // with, or |key_prefix| itself if there is none.
+  std::string GetWatchedPrefix(const std::string& key_prefix);
+
+  // Drops the shared changes that do not lead to the tracked commit anymore.
+  void PruneSharedPageChanges();
+
   coroutine::CoroutineService* coroutine_service_;
   PageManager* manager_;
   storage::PageStorage* storage_;
@@ -88,8 +112,18 @@ class BranchTracker : public storage::CommitWatcher {
   // after updating the tracked commit, the value of the |current_commit_| at
   // initialization (which is set to nullptr) is not necessary.
   std::unique_ptr<const storage::Commit> current_commit_;
+  // Keeps the contents of |current_commit_| from being garbage collected while
+  // the watchers are notified.
+  std::unique_ptr<storage::PageStorage::CommitPin> current_commit_pin_;
   storage::CommitId current_commit_id_;
 
+  // Changes computed for the watchers, indexed by the ids of their base and
+  // target commits. The changes of a pair of commits are computed on disjoint
+  // prefix ranges, unless a watcher with a shorter prefix registered later.
+  std::map<std::pair<storage::CommitId, storage::CommitId>,
+           std::vector<fxl::RefPtr<SharedPageChange>>>
+      shared_page_changes_;
+
   // This must be the last member of the class.
   fxl::WeakPtrFactory<BranchTracker> weak_factory_;
 
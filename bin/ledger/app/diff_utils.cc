@@ -97,14 +97,15 @@ void ComputePageChange(
   if (min_key < prefix_key) {
     min_key = prefix_key;
   }
+  // The diff is bounded to the keys matching |prefix_key|, so that storage
+  // doesn't read the parts of the trees past the prefix.
+  std::string max_key = PageUtils::GetPrefixEnd(prefix_key);
 
   // |on_next| is called for each change on the diff
   auto on_next = [storage, waiter, prefix_key = std::move(prefix_key),
                   context = context.get(),
                   pagination_behavior](storage::EntryChange change) {
-    if (!PageUtils::MatchesPrefix(change.entry.key, prefix_key)) {
-      return false;
-    }
+    FXL_DCHECK(PageUtils::MatchesPrefix(change.entry.key, prefix_key));
     size_t entry_size =
         change.deleted
             ? fidl_serialization::GetByteArraySize(change.entry.key.size())
@@ -188,7 +189,8 @@ void ComputePageChange(
     waiter->Finalize(std::move(result_callback));
   });
   storage->GetCommitContentsDiff(base, other, std::move(min_key),
-                                 std::move(on_next), std::move(on_done));
+                                 std::move(max_key), std::move(on_next),
+                                 std::move(on_done));
 }
 
 void ComputeThreeWayDiff(
@@ -0,0 +1,111 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "peridot/bin/ledger/app/fidl/packed_entries.h"
+
+#include <string.h>
+
+#include "lib/fxl/logging.h"
+
+namespace ledger {
+namespace packed_entries {
+namespace {
+// Returns whether [offset, offset + size) is within a buffer of the given
+// size.
+bool IsInBuffer(uint64_t offset, uint64_t size, size_t buffer_size) {
+  return offset <= buffer_size && size <= buffer_size - offset;
+}
+}  // namespace
+
+Builder::Builder() {}
+
+Builder::~Builder() {}
+
+void Builder::Add(fxl::StringView key,
+                  fxl::StringView value,
+                  Priority priority) {
+  FXL_DCHECK(index_.empty() ||
+             fxl::StringView(data_).substr(index_.back().key_offset,
+                                           index_.back().key_size) < key);
+  IndexRecord record;
+  record.key_offset = data_.size();
+  record.key_size = key.size();
+  data_.append(key.data(), key.size());
+  record.value_offset = data_.size();
+  record.value_size = value.size();
+  data_.append(value.data(), value.size());
+  record.priority = static_cast<uint32_t>(priority);
+  record.flags = 0u;
+  index_.push_back(record);
+}
+
+void Builder::AddWithMissingValue(fxl::StringView key, Priority priority) {
+  Add(key, "", priority);
+  index_.back().value_offset = 0u;
+  index_.back().flags = kValueMissing;
+}
+
+size_t Builder::GetSizeWith(size_t key_size, size_t value_size) const {
+  return kHeaderSize + (index_.size() + 1) * sizeof(IndexRecord) +
+         data_.size() + key_size + value_size;
+}
+
+std::string Builder::Build() {
+  size_t data_offset = kHeaderSize + index_.size() * sizeof(IndexRecord);
+  std::string buffer;
+  buffer.reserve(data_offset + data_.size());
+
+  uint64_t entry_count = index_.size();
+  buffer.append(reinterpret_cast<const char*>(&entry_count), kHeaderSize);
+  for (IndexRecord& record : index_) {
+    record.key_offset += data_offset;
+    if (!(record.flags & kValueMissing)) {
+      record.value_offset += data_offset;
+    }
+    buffer.append(reinterpret_cast<const char*>(&record), sizeof(record));
+  }
+  buffer.append(data_);
+
+  index_.clear();
+  data_.clear();
+  return buffer;
+}
+
+bool Parse(fxl::StringView buffer, std::vector<PackedEntry>* entries) {
+  if (buffer.size() < kHeaderSize) {
+    return false;
+  }
+  uint64_t entry_count;
+  memcpy(&entry_count, buffer.data(), kHeaderSize);
+  if (entry_count > (buffer.size() - kHeaderSize) / sizeof(IndexRecord)) {
+    return false;
+  }
+
+  std::vector<PackedEntry> result;
+  result.reserve(entry_count);
+  for (uint64_t i = 0; i < entry_count; ++i) {
+    IndexRecord record;
+    memcpy(&record, buffer.data() + kHeaderSize + i * sizeof(IndexRecord),
+           sizeof(record));
+    if (!IsInBuffer(record.key_offset, record.key_size, buffer.size()) ||
+        !IsInBuffer(record.value_offset, record.value_size, buffer.size())) {
+      return false;
+    }
+    if (record.priority != static_cast<uint32_t>(Priority::EAGER) &&
+        record.priority != static_cast<uint32_t>(Priority::LAZY)) {
+      return false;
+    }
+    PackedEntry entry;
+    entry.key = buffer.substr(record.key_offset, record.key_size);
+    entry.value = buffer.substr(record.value_offset, record.value_size);
+    entry.priority = static_cast<Priority>(record.priority);
+    entry.value_missing = (record.flags & kValueMissing) != 0;
+    result.push_back(entry);
+  }
+  entries->swap(result);
+  return true;
+}
+
+}  // namespace packed_entries
+}  // namespace ledger
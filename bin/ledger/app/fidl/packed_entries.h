@@ -0,0 +1,83 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef PERIDOT_BIN_LEDGER_APP_FIDL_PACKED_ENTRIES_H_
+#define PERIDOT_BIN_LEDGER_APP_FIDL_PACKED_ENTRIES_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "lib/fxl/macros.h"
+#include "lib/fxl/strings/string_view.h"
+#include "lib/ledger/fidl/ledger.fidl.h"
+
+namespace ledger {
+namespace packed_entries {
+
+// Layout of the buffers returned by PageSnapshot.GetEntriesPacked. See
+// ledger.fidl for the description of the format.
+struct IndexRecord {
+  uint64_t key_offset;
+  uint64_t key_size;
+  uint64_t value_offset;
+  uint64_t value_size;
+  uint32_t priority;
+  uint32_t flags;
+};
+
+// Size of the entry count preceding the index records.
+constexpr size_t kHeaderSize = sizeof(uint64_t);
+
+// Flag set in |IndexRecord::flags| when the value is not present on the device.
+constexpr uint32_t kValueMissing = 1u;
+
+// An entry read from a packed buffer. |key| and |value| point into the buffer.
+struct PackedEntry {
+  fxl::StringView key;
+  fxl::StringView value;
+  Priority priority;
+  bool value_missing;
+};
+
+// Builds a packed buffer from entries added in key order.
+class Builder {
+ public:
+  Builder();
+  ~Builder();
+
+  // Adds an entry with the given value.
+  void Add(fxl::StringView key, fxl::StringView value, Priority priority);
+
+  // Adds an entry whose value is not present on the device.
+  void AddWithMissingValue(fxl::StringView key, Priority priority);
+
+  // Returns the size the packed buffer would have after adding an entry with
+  // the given key and value sizes.
+  size_t GetSizeWith(size_t key_size, size_t value_size) const;
+
+  size_t entry_count() const { return index_.size(); }
+
+  // Returns the packed buffer. The builder must not be used afterwards.
+  std::string Build();
+
+ private:
+  std::vector<IndexRecord> index_;
+  // The keys and values, with offsets in |index_| relative to the start of
+  // |data_|.
+  std::string data_;
+
+  FXL_DISALLOW_COPY_AND_ASSIGN(Builder);
+};
+
+// Parses a packed buffer into |entries|. Returns false if |buffer| is not a
+// valid packed buffer.
+bool Parse(fxl::StringView buffer, std::vector<PackedEntry>* entries);
+
+}  // namespace packed_entries
+}  // namespace ledger
+
+#endif  // PERIDOT_BIN_LEDGER_APP_FIDL_PACKED_ENTRIES_H_
@@ -0,0 +1,75 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "peridot/bin/ledger/app/fidl/packed_entries.h"
+
+#include "gtest/gtest.h"
+
+namespace ledger {
+namespace packed_entries {
+namespace {
+
+TEST(PackedEntriesTest, BuildAndParse) {
+  Builder builder;
+  builder.Add("key1", "value1", Priority::EAGER);
+  builder.AddWithMissingValue("key2", Priority::LAZY);
+  builder.Add("key3", "", Priority::LAZY);
+  EXPECT_EQ(3u, builder.entry_count());
+  size_t expected_size = builder.GetSizeWith(4, 6);
+  builder.Add("key4", "value4", Priority::EAGER);
+  std::string buffer = builder.Build();
+  EXPECT_EQ(expected_size, buffer.size());
+
+  std::vector<PackedEntry> entries;
+  ASSERT_TRUE(Parse(buffer, &entries));
+  ASSERT_EQ(4u, entries.size());
+  EXPECT_EQ("key1", entries[0].key);
+  EXPECT_EQ("value1", entries[0].value);
+  EXPECT_EQ(Priority::EAGER, entries[0].priority);
+  EXPECT_FALSE(entries[0].value_missing);
+  EXPECT_EQ("key2", entries[1].key);
+  EXPECT_EQ("", entries[1].value);
+  EXPECT_EQ(Priority::LAZY, entries[1].priority);
+  EXPECT_TRUE(entries[1].value_missing);
+  EXPECT_EQ("key3", entries[2].key);
+  EXPECT_EQ("", entries[2].value);
+  EXPECT_FALSE(entries[2].value_missing);
+  EXPECT_EQ("key4", entries[3].key);
+  EXPECT_EQ("value4", entries[3].value);
+}
+
+TEST(PackedEntriesTest, Empty) {
+  Builder builder;
+  std::string buffer = builder.Build();
+  EXPECT_EQ(kHeaderSize, buffer.size());
+
+  std::vector<PackedEntry> entries;
+  ASSERT_TRUE(Parse(buffer, &entries));
+  EXPECT_TRUE(entries.empty());
+}
+
+TEST(PackedEntriesTest, ParseInvalid) {
+  Builder builder;
+  builder.Add("key", "value", Priority::EAGER);
+  std::string buffer = builder.Build();
+
+  std::vector<PackedEntry> entries;
+  // Truncated header.
+  EXPECT_FALSE(Parse(fxl::StringView(buffer).substr(0, kHeaderSize - 1),
+                     &entries));
+  // Truncated index.
+  EXPECT_FALSE(Parse(fxl::StringView(buffer).substr(0, kHeaderSize + 1),
+                     &entries));
+  // Truncated value.
+  EXPECT_FALSE(
+      Parse(fxl::StringView(buffer).substr(0, buffer.size() - 1), &entries));
+  // Wrong entry count.
+  std::string wrong_count = buffer;
+  wrong_count[0] = 2;
+  EXPECT_FALSE(Parse(wrong_count, &entries));
+}
+
+}  // namespace
+}  // namespace packed_entries
+}  // namespace ledger
@@ -4,6 +4,8 @@
 
 #include "peridot/bin/ledger/app/ledger_manager.h"
 
+#include <algorithm>
+#include <list>
 #include <string>
 #include <utility>
 #include <vector>
@@ -18,6 +20,14 @@
 
 namespace ledger {
 
+namespace {
+
+// Maximal number of pages closed while idle that are remembered, so that
+// opening them again is counted as a reopen.
+constexpr size_t kMaxEvictedPages = 1024;
+
+}  // namespace
+
 // Container for a PageManager that keeps tracks of in-flight page requests and
 // callbacks and fires them when the PageManager is available.
 class LedgerManager::PageManagerContainer {
@@ -35,10 +45,17 @@ class LedgerManager::PageManagerContainer {
   void set_on_empty(const fxl::Closure& on_empty_callback) {
     on_empty_callback_ = on_empty_callback;
     if (page_manager_) {
-      page_manager_->set_on_empty(on_empty_callback);
+      page_manager_->set_on_empty([this] { OnPageManagerEmpty(); });
     }
   };
 
+  // Sets the callback to be called instead of the |on_empty| one when the
+  // PageManager has no client anymore. The |on_empty| callback is still called
+  // if the PageManager cannot be created.
+  void set_on_idle(const fxl::Closure& on_idle_callback) {
+    on_idle_callback_ = on_idle_callback;
+  }
+
   // Keeps track of |page| and |callback|. Binds |page| and fires |callback|
   // when a PageManager is available or an error occurs.
   void BindPage(fidl::InterfaceRequest<Page> page_request,
@@ -97,7 +114,7 @@ class LedgerManager::PageManagerContainer {
     debug_requests_.clear();
     if (on_empty_callback_) {
       if (page_manager_) {
-        page_manager_->set_on_empty(on_empty_callback_);
+        page_manager_->set_on_empty([this] { OnPageManagerEmpty(); });
       } else {
         on_empty_callback_();
       }
@@ -105,6 +122,14 @@ class LedgerManager::PageManagerContainer {
   }
 
  private:
+  void OnPageManagerEmpty() {
+    if (on_idle_callback_) {
+      on_idle_callback_();
+    } else {
+      on_empty_callback_();
+    }
+  }
+
   std::unique_ptr<PageManager> page_manager_;
   Status status_ = Status::OK;
   std::vector<
@@ -114,18 +139,24 @@ class LedgerManager::PageManagerContainer {
       std::pair<fidl::InterfaceRequest<PageDebug>, std::function<void(Status)>>>
       debug_requests_;
   fxl::Closure on_empty_callback_;
+  fxl::Closure on_idle_callback_;
 
   FXL_DISALLOW_COPY_AND_ASSIGN(PageManagerContainer);
 };
 
 LedgerManager::LedgerManager(Environment* environment,
                              std::unique_ptr<storage::LedgerStorage> storage,
-                             std::unique_ptr<cloud_sync::LedgerSync> sync)
+                             std::unique_ptr<cloud_sync::LedgerSync> sync,
+                             size_t max_idle_pages,
+                             fxl::TimeDelta idle_page_timeout)
     : environment_(environment),
       storage_(std::move(storage)),
       sync_(std::move(sync)),
       ledger_impl_(this),
-      merge_manager_(environment_) {
+      merge_manager_(environment_),
+      max_idle_pages_(max_idle_pages),
+      idle_page_timeout_(idle_page_timeout),
+      task_runner_(environment_->main_runner()) {
   bindings_.set_on_empty_set_handler([this] { CheckEmpty(); });
   page_managers_.set_on_empty([this] { CheckEmpty(); });
   ledger_debug_bindings_.set_on_empty_set_handler([this] { CheckEmpty(); });
@@ -143,6 +174,7 @@ void LedgerManager::GetPage(convert::ExtendedStringView page_id,
   // If we have the page manager ready, just ask for a new page impl.
   auto it = page_managers_.find(page_id);
   if (it != page_managers_.end()) {
+    OnPageUsed(page_id);
     it->second.BindPage(std::move(page_request), std::move(callback));
     return;
   }
@@ -150,9 +182,17 @@ void LedgerManager::GetPage(convert::ExtendedStringView page_id,
   PageManagerContainer* container = AddPageManagerContainer(page_id);
   container->BindPage(std::move(page_request), std::move(callback));
 
+  // Whether the page is opened again after having been closed while idle.
+  auto evicted_page =
+      std::find(evicted_pages_.begin(), evicted_pages_.end(), page_id);
+  bool reopen = evicted_page != evicted_pages_.end();
+  if (reopen) {
+    evicted_pages_.erase(evicted_page);
+  }
+  fxl::TimePoint start = fxl::TimePoint::Now();
   storage_->GetPageStorage(
       page_id.ToString(),
-      [this, page_id = page_id.ToString(), container](
+      [this, page_id = page_id.ToString(), container, reopen, start](
           storage::Status storage_status,
           std::unique_ptr<storage::PageStorage> page_storage) mutable {
         Status status = PageUtils::ConvertStatus(storage_status, Status::OK);
@@ -163,6 +203,12 @@ void LedgerManager::GetPage(convert::ExtendedStringView page_id,
 
         // If the page was found locally, just use it and return.
         if (page_storage) {
+          if (reopen) {
+            ++page_lifecycle_stats_.reopens;
+            page_lifecycle_stats_.total_reopen_latency =
+                page_lifecycle_stats_.total_reopen_latency +
+                (fxl::TimePoint::Now() - start);
+          }
           container->SetPageManager(
               Status::OK,
               NewPageManager(std::move(page_storage),
@@ -177,6 +223,10 @@ void LedgerManager::GetPage(convert::ExtendedStringView page_id,
 }
 
 Status LedgerManager::DeletePage(convert::ExtendedStringView page_id) {
+  idle_pages_.remove_if(
+      [page_id](const auto& idle_page) { return idle_page.first == page_id; });
+  evicted_pages_.remove_if(
+      [page_id](const auto& evicted_page) { return evicted_page == page_id; });
   auto it = page_managers_.find(page_id);
   if (it != page_managers_.end()) {
     page_managers_.erase(it);
@@ -210,6 +260,8 @@ LedgerManager::PageManagerContainer* LedgerManager::AddPageManagerContainer(
                                     std::forward_as_tuple(page_id.ToString()),
                                     std::forward_as_tuple());
   FXL_DCHECK(ret.second);
+  ret.first->second.set_on_idle(
+      [this, page_id = page_id.ToString()] { OnPageIdle(page_id); });
   return &ret.first->second;
 }
 
@@ -228,11 +280,90 @@ std::unique_ptr<PageManager> LedgerManager::NewPageManager(
       merge_manager_.GetMergeResolver(page_storage.get()), state);
 }
 
+void LedgerManager::OnPageIdle(storage::PageIdView page_id) {
+  for (const auto& idle_page : idle_pages_) {
+    if (idle_page.first == page_id) {
+      return;
+    }
+  }
+  // Pages are only kept open for the clients of this ledger.
+  if (max_idle_pages_ == 0 || idle_page_timeout_ <= fxl::TimeDelta::Zero() ||
+      (bindings_.size() == 0 && ledger_debug_bindings_.size() == 0)) {
+    EvictPage(page_id);
+    return;
+  }
+
+  idle_pages_.emplace_back(page_id.ToString(), fxl::TimePoint::Now());
+  while (idle_pages_.size() > max_idle_pages_) {
+    EvictPage(idle_pages_.front().first);
+  }
+  task_runner_.PostDelayedTask([this] { EvictExpiredIdlePages(); },
+                               idle_page_timeout_);
+}
+
+void LedgerManager::OnPageUsed(storage::PageIdView page_id) {
+  auto it = std::find_if(
+      idle_pages_.begin(), idle_pages_.end(),
+      [page_id](const auto& idle_page) { return idle_page.first == page_id; });
+  if (it != idle_pages_.end()) {
+    idle_pages_.erase(it);
+    ++page_lifecycle_stats_.idle_page_hits;
+  }
+}
+
+void LedgerManager::EvictPage(storage::PageId page_id) {
+  idle_pages_.remove_if(
+      [page_id](const auto& idle_page) { return idle_page.first == page_id; });
+  auto it = page_managers_.find(page_id);
+  if (it == page_managers_.end()) {
+    return;
+  }
+  ++page_lifecycle_stats_.evictions;
+  evicted_pages_.push_back(page_id);
+  if (evicted_pages_.size() > kMaxEvictedPages) {
+    evicted_pages_.pop_front();
+  }
+  // Deleting the container closes the page storage and stops its sync. This
+  // can delete the LedgerManager through |CheckEmpty|.
+  page_managers_.erase(it);
+}
+
+void LedgerManager::EvictExpiredIdlePages() {
+  fxl::TimePoint now = fxl::TimePoint::Now();
+  while (!idle_pages_.empty() &&
+         now - idle_pages_.front().second >= idle_page_timeout_) {
+    storage::PageId page_id = idle_pages_.front().first;
+    bool last_page = page_managers_.size() == 1;
+    EvictPage(page_id);
+    if (last_page) {
+      // |this| might have been deleted.
+      return;
+    }
+  }
+}
+
+void LedgerManager::EvictIdlePages() {
+  while (!idle_pages_.empty()) {
+    storage::PageId page_id = idle_pages_.front().first;
+    bool last_page = page_managers_.size() == 1;
+    EvictPage(page_id);
+    if (last_page) {
+      // |this| might have been deleted.
+      return;
+    }
+  }
+}
+
 void LedgerManager::CheckEmpty() {
-  if (!on_empty_callback_)
+  if (bindings_.size() != 0 || ledger_debug_bindings_.size() != 0)
+    return;
+  // Without clients, idle pages are not needed anymore. Closing the last one
+  // calls this method again.
+  if (!idle_pages_.empty()) {
+    EvictIdlePages();
     return;
-  if (bindings_.size() == 0 && page_managers_.empty() &&
-      ledger_debug_bindings_.size() == 0)
+  }
+  if (on_empty_callback_ && page_managers_.empty())
     on_empty_callback_();
 }
 
@@ -246,6 +377,14 @@ void LedgerManager::BindLedgerDebug(
   ledger_debug_bindings_.AddBinding(this, std::move(request));
 }
 
+LedgerManager::PageLifecycleStats LedgerManager::GetPageLifecycleStats()
+    const {
+  PageLifecycleStats stats = page_lifecycle_stats_;
+  stats.open_pages = page_managers_.size();
+  stats.idle_pages = idle_pages_.size();
+  return stats;
+}
+
 // TODO(ayaelattar): See LE-370: Inspect ledgers and pages not currently active.
 void LedgerManager::GetPagesList(const GetPagesListCallback& callback) {
   fidl::Array<fidl::Array<uint8_t>> result =
@@ -261,10 +400,27 @@ void LedgerManager::GetPageDebug(fidl::Array<uint8_t> page_id,
                                  const GetPageDebugCallback& callback) {
   auto it = page_managers_.find(page_id);
   if (it != page_managers_.end()) {
+    OnPageUsed(convert::ToStringView(page_id));
     it->second.BindPageDebug(std::move(page_debug), callback);
   } else {
     callback(Status::PAGE_NOT_FOUND);
   }
 }
 
+void LedgerManager::GetPageLifecycleStats(
+    const GetPageLifecycleStatsCallback& callback) {
+  PageLifecycleStats stats = GetPageLifecycleStats();
+  auto result = ledger::PageLifecycleStats::New();
+  result->open_pages = stats.open_pages;
+  result->idle_pages = stats.idle_pages;
+  result->evictions = stats.evictions;
+  result->idle_page_hits = stats.idle_page_hits;
+  result->reopens = stats.reopens;
+  result->average_reopen_latency =
+      stats.reopens ? stats.total_reopen_latency.ToNanoseconds() /
+                          static_cast<int64_t>(stats.reopens)
+                    : 0;
+  callback(std::move(result));
+}
+
 }  // namespace ledger
@@ -6,13 +6,17 @@
 #define PERIDOT_BIN_LEDGER_APP_LEDGER_MANAGER_H_
 
 #include <functional>
+#include <list>
 #include <map>
 #include <memory>
 #include <type_traits>
+#include <utility>
 
 #include "lib/fidl/cpp/bindings/binding_set.h"
 #include "lib/fxl/macros.h"
 #include "lib/fxl/strings/string_view.h"
+#include "lib/fxl/time/time_delta.h"
+#include "lib/fxl/time/time_point.h"
 #include "peridot/bin/ledger/app/ledger_impl.h"
 #include "peridot/bin/ledger/app/merging/ledger_merge_manager.h"
 #include "peridot/bin/ledger/app/page_manager.h"
@@ -20,6 +24,7 @@
 #include "peridot/bin/ledger/fidl/debug.fidl.h"
 #include "peridot/bin/ledger/storage/public/types.h"
 #include "peridot/lib/callback/auto_cleanable.h"
+#include "peridot/lib/callback/scoped_task_runner.h"
 #include "peridot/lib/convert/convert.h"
 
 namespace ledger {
@@ -30,11 +35,36 @@ namespace ledger {
 // LedgerManager owns all per-ledger-instance objects: LedgerStorage and a FIDL
 // LedgerImpl. It is safe to delete it at any point - this closes all channels,
 // deletes the LedgerImpl and tears down the storage.
+//
+// Pages are opened when first requested. Once a page has no client anymore,
+// it is kept open, idle, so that it can be quickly handed out again: at most
+// |max_idle_pages| pages are kept idle, the least recently used ones being
+// closed first, and idle pages are closed after |idle_page_timeout|. Closing a
+// page releases its storage, sync and merge state; the page is opened again
+// the next time it is requested.
 class LedgerManager : public LedgerImpl::Delegate, public LedgerDebug {
  public:
-  LedgerManager(Environment* environment,
-                std::unique_ptr<storage::LedgerStorage> storage,
-                std::unique_ptr<cloud_sync::LedgerSync> sync);
+  // Counters describing the lifecycle of the pages of this ledger.
+  struct PageLifecycleStats {
+    // Number of pages currently open, and how many of them are idle.
+    uint64_t open_pages = 0u;
+    uint64_t idle_pages = 0u;
+    // Number of idle pages closed.
+    uint64_t evictions = 0u;
+    // Number of page requests served by an idle page.
+    uint64_t idle_page_hits = 0u;
+    // Number of pages opened again after having been closed while idle, and
+    // the total time taken to open them.
+    uint64_t reopens = 0u;
+    fxl::TimeDelta total_reopen_latency;
+  };
+
+  LedgerManager(
+      Environment* environment,
+      std::unique_ptr<storage::LedgerStorage> storage,
+      std::unique_ptr<cloud_sync::LedgerSync> sync,
+      size_t max_idle_pages = 4,
+      fxl::TimeDelta idle_page_timeout = fxl::TimeDelta::FromSeconds(30));
   ~LedgerManager() override;
 
   // Creates a new proxy for the LedgerImpl managed by this LedgerManager.
@@ -55,6 +85,8 @@ class LedgerManager : public LedgerImpl::Delegate, public LedgerDebug {
   // Creates a new proxy for the LedgerDebug implemented by this LedgerManager.
   void BindLedgerDebug(fidl::InterfaceRequest<LedgerDebug> request);
 
+  PageLifecycleStats GetPageLifecycleStats() const;
+
  private:
   class PageManagerContainer;
 
@@ -64,14 +96,31 @@ class LedgerManager : public LedgerImpl::Delegate, public LedgerDebug {
                          PageManagerContainer* container);
 
   // Adds a new PageManagerContainer for |page_id| and configures it so that it
-  // is automatically deleted from |page_managers_| when the last local client
-  // disconnects from the page. Returns the container.
+  // becomes idle when the last local client disconnects from the page, and is
+  // deleted from |page_managers_| if the page fails to open. Returns the
+  // container.
   PageManagerContainer* AddPageManagerContainer(storage::PageIdView page_id);
   // Creates a new page manager for the given storage.
   std::unique_ptr<PageManager> NewPageManager(
       std::unique_ptr<storage::PageStorage> page_storage,
       PageManager::PageStorageState state);
 
+  // Called when the page with the given id has no client anymore. Keeps the
+  // page open if possible, and closes it otherwise.
+  void OnPageIdle(storage::PageIdView page_id);
+
+  // Marks the page with the given id as used again, if it is idle.
+  void OnPageUsed(storage::PageIdView page_id);
+
+  // Closes the page with the given id.
+  void EvictPage(storage::PageId page_id);
+
+  // Closes the pages that have been idle for longer than |idle_page_timeout_|.
+  void EvictExpiredIdlePages();
+
+  // Closes all the idle pages.
+  void EvictIdlePages();
+
   void CheckEmpty();
 
   // LedgerDebug:
@@ -81,6 +130,9 @@ class LedgerManager : public LedgerImpl::Delegate, public LedgerDebug {
                     fidl::InterfaceRequest<PageDebug> page_debug,
                     const GetPageDebugCallback& callback) override;
 
+  void GetPageLifecycleStats(
+      const GetPageLifecycleStatsCallback& callback) override;
+
   Environment* const environment_;
   std::unique_ptr<storage::LedgerStorage> storage_;
   std::unique_ptr<cloud_sync::LedgerSync> sync_;
@@ -99,6 +151,19 @@ class LedgerManager : public LedgerImpl::Delegate, public LedgerDebug {
 
   fidl::BindingSet<LedgerDebug> ledger_debug_bindings_;
 
+  const size_t max_idle_pages_;
+  const fxl::TimeDelta idle_page_timeout_;
+  // The idle pages, and the time at which they became idle, from the least to
+  // the most recently used.
+  std::list<std::pair<storage::PageId, fxl::TimePoint>> idle_pages_;
+  // The most recent pages closed while idle, and not opened since, from the
+  // least to the most recently closed. Only used to count the reopens.
+  std::list<storage::PageId> evicted_pages_;
+  PageLifecycleStats page_lifecycle_stats_;
+
+  // Must be the last member field.
+  callback::ScopedTaskRunner task_runner_;
+
   FXL_DISALLOW_COPY_AND_ASSIGN(LedgerManager);
 };
 
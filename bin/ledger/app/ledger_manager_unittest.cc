@@ -118,12 +118,32 @@ class LedgerManagerTest : public gtest::TestWithMessageLoop {
         std::make_unique<FakeLedgerSync>(message_loop_.task_runner());
     sync_ptr = sync.get();
     ledger_manager_ = std::make_unique<LedgerManager>(
-        &environment_, std::move(storage), std::move(sync));
+        &environment_, std::move(storage), std::move(sync), max_idle_pages_,
+        idle_page_timeout_);
     ledger_manager_->BindLedger(ledger_.NewRequest());
     ledger_manager_->BindLedgerDebug(ledger_debug_.NewRequest());
   }
 
  protected:
+  // Gets the page with the given id, and closes it once it is bound.
+  void GetAndClosePage(const storage::PageId& page_id) {
+    PagePtr page;
+    Status status;
+    ledger_->GetPage(convert::ToArray(page_id), page.NewRequest(),
+                     callback::Capture(MakeQuitTask(), &status));
+    EXPECT_FALSE(RunLoopWithTimeout());
+    EXPECT_EQ(Status::OK, status);
+    page.reset();
+    EXPECT_TRUE(RunLoopUntil([this] {
+      LedgerManager::PageLifecycleStats stats =
+          ledger_manager_->GetPageLifecycleStats();
+      return stats.open_pages == stats.idle_pages;
+    }));
+  }
+
+  size_t max_idle_pages_ = 4;
+  fxl::TimeDelta idle_page_timeout_ = fxl::TimeDelta::FromSeconds(30);
+
   ledger::Environment environment_;
   FakeLedgerStorage* storage_ptr;
   FakeLedgerSync* sync_ptr;
@@ -305,5 +325,85 @@ TEST_F(LedgerManagerTest, CallGetPagesList) {
     EXPECT_EQ(ids[i], convert::ToString(actual_pages_list[i]));
 }
 
+// Verifies that a page without client is kept open and handed out again.
+TEST_F(LedgerManagerTest, IdlePageReused) {
+  storage::PageId id = RandomId();
+  GetAndClosePage(id);
+  EXPECT_EQ(1u, ledger_manager_->GetPageLifecycleStats().idle_pages);
+
+  GetAndClosePage(id);
+  EXPECT_EQ(1u, storage_ptr->get_page_calls.size());
+  LedgerManager::PageLifecycleStats stats =
+      ledger_manager_->GetPageLifecycleStats();
+  EXPECT_EQ(1u, stats.open_pages);
+  EXPECT_EQ(1u, stats.idle_page_hits);
+  EXPECT_EQ(0u, stats.evictions);
+  EXPECT_EQ(0u, stats.reopens);
+}
+
+// Verifies that the least recently used idle pages are closed first, and
+// opened again when requested.
+TEST_F(LedgerManagerTest, IdlePagesEvictedWhenOverCapacity) {
+  std::vector<storage::PageId> ids;
+  for (size_t i = 0; i <= max_idle_pages_; ++i) {
+    ids.push_back(RandomId());
+    GetAndClosePage(ids.back());
+  }
+  LedgerManager::PageLifecycleStats stats =
+      ledger_manager_->GetPageLifecycleStats();
+  EXPECT_EQ(max_idle_pages_, stats.open_pages);
+  EXPECT_EQ(max_idle_pages_, stats.idle_pages);
+  EXPECT_EQ(1u, stats.evictions);
+
+  storage_ptr->ClearCalls();
+  GetAndClosePage(ids[0]);
+  ASSERT_EQ(1u, storage_ptr->get_page_calls.size());
+  EXPECT_EQ(ids[0], storage_ptr->get_page_calls[0]);
+  stats = ledger_manager_->GetPageLifecycleStats();
+  EXPECT_EQ(2u, stats.evictions);
+  EXPECT_EQ(1u, stats.reopens);
+}
+
+class LedgerManagerShortIdleTimeoutTest : public LedgerManagerTest {
+ public:
+  LedgerManagerShortIdleTimeoutTest() {
+    idle_page_timeout_ = fxl::TimeDelta::FromMilliseconds(10);
+  }
+
+ private:
+  FXL_DISALLOW_COPY_AND_ASSIGN(LedgerManagerShortIdleTimeoutTest);
+};
+
+// Verifies that idle pages are closed after the idle timeout.
+TEST_F(LedgerManagerShortIdleTimeoutTest, IdlePagesEvictedAfterTimeout) {
+  storage::PageId id = RandomId();
+  GetAndClosePage(id);
+  EXPECT_TRUE(RunLoopUntil([this] {
+    return ledger_manager_->GetPageLifecycleStats().open_pages == 0u;
+  }));
+  EXPECT_EQ(1u, ledger_manager_->GetPageLifecycleStats().evictions);
+
+  storage_ptr->ClearCalls();
+  GetAndClosePage(id);
+  EXPECT_EQ(1u, storage_ptr->get_page_calls.size());
+  EXPECT_EQ(1u, ledger_manager_->GetPageLifecycleStats().reopens);
+}
+
+// Verifies that idle pages are closed when the ledger has no client anymore.
+TEST_F(LedgerManagerTest, IdlePagesEvictedOnEmpty) {
+  GetAndClosePage(RandomId());
+
+  bool on_empty_called = false;
+  ledger_manager_->set_on_empty([&] {
+    on_empty_called = true;
+    message_loop_.PostQuitTask();
+  });
+
+  ledger_.reset();
+  ledger_debug_.reset();
+  EXPECT_FALSE(RunLoopWithTimeout());
+  EXPECT_TRUE(on_empty_called);
+}
+
 }  // namespace
 }  // namespace ledger
@@ -155,8 +155,9 @@ struct LedgerRepositoryFactoryImpl::RepositoryInformation {
 };
 
 LedgerRepositoryFactoryImpl::LedgerRepositoryFactoryImpl(
-    ledger::Environment* environment)
-    : environment_(environment) {}
+    ledger::Environment* environment,
+    storage::StorageProfile storage_profile)
+    : environment_(environment), storage_profile_(storage_profile) {}
 
 LedgerRepositoryFactoryImpl::~LedgerRepositoryFactoryImpl() {}
 
@@ -190,8 +191,9 @@ void LedgerRepositoryFactoryImpl::GetRepository(
     std::unique_ptr<SyncWatcherSet> watchers =
         std::make_unique<SyncWatcherSet>();
     auto repository = std::make_unique<LedgerRepositoryImpl>(
-        repository_information.content_path, environment_, std::move(watchers),
-        nullptr);
+        repository_information.content_path, environment_,
+        std::make_shared<storage::LevelDbOptions>(storage_profile_),
+        std::move(watchers), nullptr);
     container->SetRepository(Status::OK, std::move(repository));
     return;
   }
@@ -234,8 +236,9 @@ void LedgerRepositoryFactoryImpl::CreateRepository(
       std::move(on_version_mismatch));
   user_sync->Start();
   auto repository = std::make_unique<LedgerRepositoryImpl>(
-      repository_information.content_path, environment_, std::move(watchers),
-      std::move(user_sync));
+      repository_information.content_path, environment_,
+      std::make_shared<storage::LevelDbOptions>(storage_profile_),
+      std::move(watchers), std::move(user_sync));
   container->SetRepository(Status::OK, std::move(repository));
 }
 
@@ -14,6 +14,7 @@
 #include "peridot/bin/ledger/cloud_sync/public/user_config.h"
 #include "peridot/bin/ledger/environment/environment.h"
 #include "peridot/bin/ledger/fidl/internal.fidl.h"
+#include "peridot/bin/ledger/storage/impl/leveldb_options.h"
 #include "peridot/lib/callback/auto_cleanable.h"
 #include "peridot/lib/callback/cancellable.h"
 #include "peridot/lib/callback/managed_container.h"
@@ -22,7 +23,12 @@ namespace ledger {
 
 class LedgerRepositoryFactoryImpl : public LedgerRepositoryFactory {
  public:
-  explicit LedgerRepositoryFactoryImpl(ledger::Environment* environment);
+  // |storage_profile| configures the LevelDB databases of the repositories.
+  // Each repository gets its own block cache, of the size given by the
+  // profile, shared by all of its databases.
+  explicit LedgerRepositoryFactoryImpl(
+      ledger::Environment* environment,
+      storage::StorageProfile storage_profile = storage::StorageProfile());
   ~LedgerRepositoryFactoryImpl() override;
 
  private:
@@ -46,6 +52,7 @@ class LedgerRepositoryFactoryImpl : public LedgerRepositoryFactory {
       const RepositoryInformation& repository_information);
 
   ledger::Environment* const environment_;
+  const storage::StorageProfile storage_profile_;
 
   callback::AutoCleanableMap<std::string, LedgerRepositoryContainer>
       repositories_;
@@ -15,10 +15,12 @@ namespace ledger {
 LedgerRepositoryImpl::LedgerRepositoryImpl(
     std::string base_storage_dir,
     Environment* environment,
+    std::shared_ptr<const storage::LevelDbOptions> leveldb_options,
     std::unique_ptr<SyncWatcherSet> watchers,
     std::unique_ptr<cloud_sync::UserSync> user_sync)
     : base_storage_dir_(std::move(base_storage_dir)),
       environment_(environment),
+      leveldb_options_(std::move(leveldb_options)),
       watchers_(std::move(watchers)),
       user_sync_(std::move(user_sync)) {
   bindings_.set_on_empty_set_handler([this] { CheckEmpty(); });
@@ -58,10 +60,20 @@ void LedgerRepositoryImpl::GetLedger(
   auto it = ledger_managers_.find(ledger_name);
   if (it == ledger_managers_.end()) {
     std::string name_as_string = convert::ToString(ledger_name);
-    std::unique_ptr<storage::LedgerStorage> ledger_storage =
-        std::make_unique<storage::LedgerStorageImpl>(
-            environment_->main_runner(), environment_->coroutine_service(),
-            base_storage_dir_, name_as_string);
+    auto ledger_storage = std::make_unique<storage::LedgerStorageImpl>(
+        environment_->main_runner(), environment_->coroutine_service(),
+        base_storage_dir_, name_as_string, environment_->GetIORunner(),
+        environment_->GetDbRunner());
+    if (environment_->compress_pieces()) {
+      ledger_storage->SetPieceCompression(storage::PieceCompression::DEFLATE);
+    }
+    ledger_storage->SetLevelDbOptions(leveldb_options_);
+    if (environment_->shared_page_db()) {
+      ledger_storage->UseSharedPageDb();
+    }
+    if (environment_->blob_store()) {
+      ledger_storage->UseBlobStore();
+    }
     std::unique_ptr<cloud_sync::LedgerSync> ledger_sync;
     if (user_sync_) {
       ledger_sync = user_sync_->CreateLedgerSync(name_as_string);
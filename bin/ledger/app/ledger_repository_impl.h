@@ -16,6 +16,7 @@
 #include "peridot/bin/ledger/environment/environment.h"
 #include "peridot/bin/ledger/fidl/debug.fidl.h"
 #include "peridot/bin/ledger/fidl/internal.fidl.h"
+#include "peridot/bin/ledger/storage/impl/leveldb_options.h"
 #include "peridot/lib/callback/auto_cleanable.h"
 #include "peridot/lib/convert/convert.h"
 
@@ -24,10 +25,14 @@ namespace ledger {
 class LedgerRepositoryImpl : public LedgerRepository,
                              public LedgerRepositoryDebug {
  public:
-  LedgerRepositoryImpl(std::string base_storage_dir,
-                       Environment* environment,
-                       std::unique_ptr<SyncWatcherSet> watchers,
-                       std::unique_ptr<cloud_sync::UserSync> user_sync);
+  // |leveldb_options| are shared by all the databases of the repository. If
+  // null, the default LevelDB options are used.
+  LedgerRepositoryImpl(
+      std::string base_storage_dir,
+      Environment* environment,
+      std::shared_ptr<const storage::LevelDbOptions> leveldb_options,
+      std::unique_ptr<SyncWatcherSet> watchers,
+      std::unique_ptr<cloud_sync::UserSync> user_sync);
   ~LedgerRepositoryImpl() override;
 
   void set_on_empty(const fxl::Closure& on_empty_callback) {
@@ -66,6 +71,7 @@ class LedgerRepositoryImpl : public LedgerRepository,
 
   const std::string base_storage_dir_;
   Environment* const environment_;
+  const std::shared_ptr<const storage::LevelDbOptions> leveldb_options_;
   std::unique_ptr<SyncWatcherSet> watchers_;
   std::unique_ptr<cloud_sync::UserSync> user_sync_;
   callback::AutoCleanableMap<std::string,
@@ -110,8 +110,8 @@ void AutoMergeStrategy::AutoMerger::Start() {
             OnRightChangeReady(status, std::move(changes));
           }));
 
-  storage_->GetCommitContentsDiff(*ancestor_, *right_, "", std::move(on_next),
-                                  std::move(callback));
+  storage_->GetCommitContentsDiff(*ancestor_, *right_, "", "",
+                                  std::move(on_next), std::move(callback));
 }
 
 void AutoMergeStrategy::AutoMerger::OnRightChangeReady(
@@ -178,8 +178,8 @@ void AutoMergeStrategy::AutoMerger::OnRightChangeReady(
             OnComparisonDone(status, std::move(right_change), index->distinct);
           }));
 
-  storage_->GetCommitContentsDiff(*ancestor_, *left_, "", std::move(on_next),
-                                  std::move(callback));
+  storage_->GetCommitContentsDiff(*ancestor_, *left_, "", "",
+                                  std::move(on_next), std::move(callback));
 }
 
 void AutoMergeStrategy::AutoMerger::OnComparisonDone(
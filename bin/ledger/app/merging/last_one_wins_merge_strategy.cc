@@ -159,7 +159,7 @@ void LastOneWinsMergeStrategy::LastOneWinsMerger::BuildAndCommitJournal() {
           });
     });
   };
-  storage_->GetCommitContentsDiff(*(ancestor_), *(right_), "",
+  storage_->GetCommitContentsDiff(*(ancestor_), *(right_), "", "",
                                   std::move(on_next), std::move(on_diff_done));
 }
 
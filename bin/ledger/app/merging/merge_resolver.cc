@@ -150,6 +150,7 @@ void MergeResolver::ResolveConflicts(DelayedStatus delayed_status,
         // |merge_in_progress_| must be reset before calling
         // |on_empty_callback_|.
         merge_in_progress_ = false;
+        merge_pins_.clear();
 
         if (has_next_strategy_) {
           strategy_ = std::move(next_strategy_);
@@ -172,6 +173,7 @@ void MergeResolver::ResolveConflicts(DelayedStatus delayed_status,
       Waiter<storage::Status, std::unique_ptr<const storage::Commit>>::Create(
           storage::Status::OK);
   for (const storage::CommitId& id : heads) {
+    merge_pins_.push_back(storage_->PinCommit(id));
     storage_->GetCommit(id, waiter->NewCallback());
   }
   waiter->Finalize(TRACE_CALLBACK(
@@ -203,6 +205,7 @@ void MergeResolver::ResolveConflicts(DelayedStatus delayed_status,
                         backoff_->GetNext());
                     cleanup.cancel();
                     merge_in_progress_ = false;
+                    merge_pins_.clear();
                     // We don't want to continue merging if nobody is interested
                     // (all clients disconnected).
                     if (on_empty_callback_) {
@@ -307,6 +310,8 @@ void MergeResolver::ResolveConflicts(DelayedStatus delayed_status,
                                            "of head commits.";
                                     return;
                                   }
+                                  merge_pins_.push_back(storage_->PinCommit(
+                                      common_ancestor->GetId()));
                                   auto strategy_callback = fxl::MakeCopyable(
                                       [cleanup = std::move(cleanup),
                                        tracing =
@@ -96,6 +96,9 @@ class MergeResolver : public storage::CommitWatcher {
   // TODO(LE-384): Convert the fields below into a single enum to track the
   // state of this class.
   bool merge_in_progress_ = false;
+  // Keep the contents of the heads and of the common ancestor being merged
+  // from being garbage collected while the merge is in progress.
+  std::vector<std::unique_ptr<storage::PageStorage::CommitPin>> merge_pins_;
   // True between the time we commit a merge and we check if there are more
   // conflicts. It is used to report to conflict callbacks (see
   // |no_conflict_callbacks_|) whether a conflict has been merged while waiting.
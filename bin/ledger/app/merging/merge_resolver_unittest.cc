@@ -142,7 +142,7 @@ class MergeResolverTest : public test::TestWithPageStorage {
       return true;
     };
     page_storage_->GetCommitContents(
-        commit, "", std::move(on_next),
+        commit, "", "", std::move(on_next),
         callback::Capture(MakeQuitTask(), &status));
     EXPECT_FALSE(RunLoopWithTimeout());
 
@@ -22,21 +22,24 @@
 
 namespace ledger {
 
-PageDelegate::PageDelegate(coroutine::CoroutineService* coroutine_service,
+PageDelegate::PageDelegate(Environment* environment,
                            PageManager* manager,
                            storage::PageStorage* storage,
                            MergeResolver* merge_resolver,
                            fidl::InterfaceRequest<Page> request,
                            SyncWatcherSet* watchers)
-    : manager_(manager),
+    : environment_(environment),
+      manager_(manager),
       storage_(storage),
       merge_resolver_(merge_resolver),
       request_(std::move(request)),
       interface_(this),
-      branch_tracker_(coroutine_service, manager, storage),
-      watcher_set_(watchers) {
+      branch_tracker_(environment->coroutine_service(), manager, storage),
+      watcher_set_(watchers),
+      implicit_commit_window_(environment->implicit_commit_window()),
+      weak_factory_(this) {
   interface_.set_on_empty([this] {
-    operation_serializer_.Serialize<Status>(
+    SerializeOperation(
         [](Status status) {},
         [this](std::function<void(Status)> callback) {
           branch_tracker_.StopTransaction(nullptr);
@@ -73,7 +76,7 @@ void PageDelegate::GetSnapshot(
     const Page::GetSnapshotCallback& callback) {
   // TODO(qsr): Update this so that only |GetCurrentCommitId| is done in a the
   // operation serializer.
-  operation_serializer_.Serialize<Status>(
+  SerializeOperation(
       callback,
       fxl::MakeCopyable([this, snapshot_request = std::move(snapshot_request),
                          key_prefix = std::move(key_prefix),
@@ -133,28 +136,30 @@ void PageDelegate::PutWithPriority(
   storage_->AddObjectFromLocal(storage::DataSource::Create(std::move(value)),
                                promise->NewCallback());
 
-  operation_serializer_.Serialize<Status>(
+  SerializeChange(
       callback,
-      fxl::MakeCopyable(
-          [this, promise = std::move(promise), key = std::move(key),
-           priority](Page::PutWithPriorityCallback callback) mutable {
-            promise->Finalize(fxl::MakeCopyable(
-                [this, key = std::move(key), priority,
-                 callback = std::move(callback)](
-                    storage::Status status,
-                    storage::ObjectIdentifier object_identifier) mutable {
-                  if (status != storage::Status::OK) {
-                    callback(PageUtils::ConvertStatus(status));
-                    return;
-                  }
-
-                  PutInCommit(std::move(key), std::move(object_identifier),
-                              priority == Priority::EAGER
-                                  ? storage::KeyPriority::EAGER
-                                  : storage::KeyPriority::LAZY,
-                              std::move(callback));
-                }));
-          }));
+      fxl::MakeCopyable([this, promise = std::move(promise),
+                         key = std::move(key), priority](
+                            StatusCallback callback,
+                            fxl::Closure on_applied) mutable {
+        promise->Finalize(fxl::MakeCopyable(
+            [this, key = std::move(key), priority,
+             callback = std::move(callback),
+             on_applied = std::move(on_applied)](
+                storage::Status status,
+                storage::ObjectIdentifier object_identifier) mutable {
+              if (status != storage::Status::OK) {
+                callback(PageUtils::ConvertStatus(status));
+                return;
+              }
+
+              PutInCommit(std::move(key), std::move(object_identifier),
+                          priority == Priority::EAGER
+                              ? storage::KeyPriority::EAGER
+                              : storage::KeyPriority::LAZY,
+                          std::move(callback), std::move(on_applied));
+            }));
+      }));
 }
 
 // PutReference(array<uint8> key, Reference? reference, Priority priority)
@@ -180,38 +185,41 @@ void PageDelegate::PutReference(fidl::Array<uint8_t> key,
   storage_->GetObject(object_identifier, storage::PageStorage::Location::LOCAL,
                       promise->NewCallback());
 
-  operation_serializer_.Serialize<Status>(
+  SerializeChange(
       callback,
-      fxl::MakeCopyable(
-          [this, promise = std::move(promise), key = std::move(key),
-           object_identifier = std::move(object_identifier),
-           priority](Page::PutReferenceCallback callback) mutable {
-            promise->Finalize(fxl::MakeCopyable(
-                [this, key = std::move(key),
-                 object_identifier = std::move(object_identifier), priority,
-                 callback = std::move(callback)](
-                    storage::Status status,
-                    std::unique_ptr<const storage::Object> object) mutable {
-                  if (status != storage::Status::OK) {
-                    callback(PageUtils::ConvertStatus(
-                        status, Status::REFERENCE_NOT_FOUND));
-                    return;
-                  }
-                  PutInCommit(std::move(key), std::move(object_identifier),
-                              priority == Priority::EAGER
-                                  ? storage::KeyPriority::EAGER
-                                  : storage::KeyPriority::LAZY,
-                              std::move(callback));
-                }));
-          }));
+      fxl::MakeCopyable([this, promise = std::move(promise),
+                         key = std::move(key),
+                         object_identifier = std::move(object_identifier),
+                         priority](StatusCallback callback,
+                                   fxl::Closure on_applied) mutable {
+        promise->Finalize(fxl::MakeCopyable(
+            [this, key = std::move(key),
+             object_identifier = std::move(object_identifier), priority,
+             callback = std::move(callback),
+             on_applied = std::move(on_applied)](
+                storage::Status status,
+                std::unique_ptr<const storage::Object> object) mutable {
+              if (status != storage::Status::OK) {
+                callback(PageUtils::ConvertStatus(status,
+                                                  Status::REFERENCE_NOT_FOUND));
+                return;
+              }
+              PutInCommit(std::move(key), std::move(object_identifier),
+                          priority == Priority::EAGER
+                              ? storage::KeyPriority::EAGER
+                              : storage::KeyPriority::LAZY,
+                          std::move(callback), std::move(on_applied));
+            }));
+      }));
 }
 
 // Delete(array<uint8> key) => (Status status);
 void PageDelegate::Delete(fidl::Array<uint8_t> key,
                           const Page::DeleteCallback& callback) {
-  operation_serializer_.Serialize<Status>(
+  SerializeChange(
       callback, fxl::MakeCopyable([this, key = std::move(key)](
-                                      Page::DeleteCallback callback) mutable {
+                                      StatusCallback callback,
+                                      fxl::Closure on_applied) mutable {
         RunInTransaction(
             fxl::MakeCopyable(
                 [key = std::move(key)](storage::Journal* journal,
@@ -222,7 +230,7 @@ void PageDelegate::Delete(fidl::Array<uint8_t> key,
                                                       Status::KEY_NOT_FOUND));
                   });
                 }),
-            std::move(callback));
+            std::move(callback), std::move(on_applied));
       }));
 }
 
@@ -248,7 +256,7 @@ void PageDelegate::CreateReference(
 // StartTransaction() => (Status status);
 void PageDelegate::StartTransaction(
     const Page::StartTransactionCallback& callback) {
-  operation_serializer_.Serialize<Status>(
+  SerializeOperation(
       callback, [this](StatusCallback callback) {
         if (journal_) {
           callback(Status::TRANSACTION_ALREADY_IN_PROGRESS);
@@ -274,7 +282,7 @@ void PageDelegate::StartTransaction(
 
 // Commit() => (Status status);
 void PageDelegate::Commit(const Page::CommitCallback& callback) {
-  operation_serializer_.Serialize<Status>(
+  SerializeOperation(
       callback, [this](StatusCallback callback) {
         if (!journal_) {
           callback(Status::NO_TRANSACTION_IN_PROGRESS);
@@ -293,7 +301,7 @@ void PageDelegate::Commit(const Page::CommitCallback& callback) {
 
 // Rollback() => (Status status);
 void PageDelegate::Rollback(const Page::RollbackCallback& callback) {
-  operation_serializer_.Serialize<Status>(
+  SerializeOperation(
       callback, [this](StatusCallback callback) {
         if (!journal_) {
           callback(Status::NO_TRANSACTION_IN_PROGRESS);
@@ -335,10 +343,48 @@ const storage::CommitId& PageDelegate::GetCurrentCommitId() {
   return journal_parent_commit_;
 }
 
+void PageDelegate::SerializeOperation(
+    StatusCallback callback,
+    std::function<void(StatusCallback)> operation) {
+  operation_serializer_.Serialize<Status>(
+      std::move(callback),
+      [this, operation = std::move(operation)](StatusCallback callback) {
+        CommitImplicitJournal([operation, callback = std::move(callback)] {
+          operation(callback);
+        });
+      });
+}
+
+void PageDelegate::SerializeChange(
+    StatusCallback callback,
+    std::function<void(StatusCallback, fxl::Closure)> operation) {
+  operation_serializer_.Serialize<>(
+      [] {}, [callback = std::move(callback),
+              operation = std::move(operation)](fxl::Closure done) {
+        // |done| lets the next operation run. It must be called exactly once:
+        // either when the change is applied, or after |callback|.
+        auto pending_done = std::make_shared<fxl::Closure>(std::move(done));
+        auto on_applied = [pending_done] {
+          if (*pending_done) {
+            fxl::Closure done = std::move(*pending_done);
+            *pending_done = nullptr;
+            done();
+          }
+        };
+        operation(
+            [callback, on_applied](Status status) {
+              callback(status);
+              on_applied();
+            },
+            on_applied);
+      });
+}
+
 void PageDelegate::PutInCommit(fidl::Array<uint8_t> key,
                                storage::ObjectIdentifier object_identifier,
                                storage::KeyPriority priority,
-                               std::function<void(Status)> callback) {
+                               StatusCallback callback,
+                               fxl::Closure on_applied) {
   RunInTransaction(
       fxl::MakeCopyable(
           [key = std::move(key),
@@ -351,23 +397,26 @@ void PageDelegate::PutInCommit(fidl::Array<uint8_t> key,
                   callback(PageUtils::ConvertStatus(status));
                 });
           }),
-      std::move(callback));
+      std::move(callback), std::move(on_applied));
 }
 
 void PageDelegate::RunInTransaction(
     std::function<void(storage::Journal*, std::function<void(Status)>)>
         runnable,
-    std::function<void(Status)> callback) {
+    StatusCallback callback,
+    fxl::Closure on_applied) {
   if (journal_) {
     // A transaction is in progress; add this change to it.
     runnable(journal_.get(), std::move(callback));
     return;
   }
+  if (implicit_commit_window_ > fxl::TimeDelta::Zero()) {
+    // Group this change with the others made during the commit window.
+    RunInImplicitJournal(std::move(runnable), std::move(callback),
+                         std::move(on_applied));
+    return;
+  }
   // No transaction is in progress; create one just for this change.
-  // TODO(etiennej): Add a change batching strategy for operations outside
-  // transactions. Currently, we create a commit for every change; we
-  // would like to group changes that happen "close enough" together in
-  // one commit.
   branch_tracker_.StartTransaction([] {});
   storage::CommitId commit_id = branch_tracker_.GetBranchHeadId();
   std::unique_ptr<storage::Journal> journal;
@@ -406,6 +455,98 @@ void PageDelegate::RunInTransaction(
       });
 }
 
+void PageDelegate::RunInImplicitJournal(
+    std::function<void(storage::Journal*, std::function<void(Status)>)>
+        runnable,
+    StatusCallback callback,
+    fxl::Closure on_applied) {
+  auto add_change = [this, runnable = std::move(runnable), callback,
+                     on_applied = std::move(on_applied)] {
+    runnable(implicit_journal_.get(), [this, callback, on_applied](
+                                          Status ledger_status) {
+      if (ledger_status != Status::OK) {
+        // A journal can't be used after a failed operation: the changes
+        // already in it are lost too.
+        std::vector<StatusCallback> callbacks =
+            std::move(implicit_journal_callbacks_);
+        implicit_journal_callbacks_.clear();
+        ++implicit_journal_generation_;
+        storage_->RollbackJournal(std::move(implicit_journal_),
+                                  [](storage::Status /*rollback_status*/) {});
+        branch_tracker_.StopTransaction(nullptr);
+        for (const auto& pending_callback : callbacks) {
+          pending_callback(ledger_status);
+        }
+        callback(ledger_status);
+        return;
+      }
+      implicit_journal_callbacks_.push_back(std::move(callback));
+      on_applied();
+    });
+  };
+
+  if (implicit_journal_) {
+    add_change();
+    return;
+  }
+
+  branch_tracker_.StartTransaction([] {});
+  storage_->StartCommit(
+      branch_tracker_.GetBranchHeadId(), storage::JournalType::IMPLICIT,
+      [this, add_change = std::move(add_change),
+       callback = std::move(callback)](
+          storage::Status status, std::unique_ptr<storage::Journal> journal) {
+        if (status != storage::Status::OK) {
+          callback(PageUtils::ConvertStatus(status));
+          branch_tracker_.StopTransaction(nullptr);
+          return;
+        }
+        implicit_journal_ = std::move(journal);
+        environment_->main_runner()->PostDelayedTask(
+            [weak_this = weak_factory_.GetWeakPtr(),
+             generation = implicit_journal_generation_] {
+              if (!weak_this ||
+                  weak_this->implicit_journal_generation_ != generation) {
+                return;
+              }
+              PageDelegate* page_delegate = weak_this.get();
+              page_delegate->operation_serializer_.Serialize<>(
+                  [] {}, [page_delegate, generation](fxl::Closure done) {
+                    if (page_delegate->implicit_journal_generation_ !=
+                        generation) {
+                      done();
+                      return;
+                    }
+                    page_delegate->CommitImplicitJournal(std::move(done));
+                  });
+            },
+            implicit_commit_window_);
+        add_change();
+      });
+}
+
+void PageDelegate::CommitImplicitJournal(fxl::Closure on_done) {
+  if (!implicit_journal_) {
+    on_done();
+    return;
+  }
+  std::vector<StatusCallback> callbacks =
+      std::move(implicit_journal_callbacks_);
+  implicit_journal_callbacks_.clear();
+  ++implicit_journal_generation_;
+  CommitJournal(
+      std::move(implicit_journal_),
+      [this, callbacks = std::move(callbacks), on_done = std::move(on_done)](
+          Status status, std::unique_ptr<const storage::Commit> commit) {
+        branch_tracker_.StopTransaction(status == Status::OK ? std::move(commit)
+                                                             : nullptr);
+        for (const auto& callback : callbacks) {
+          callback(status);
+        }
+        on_done();
+      });
+}
+
 void PageDelegate::CommitJournal(
     std::unique_ptr<storage::Journal> journal,
     std::function<void(Status, std::unique_ptr<const storage::Commit>)>
@@ -12,11 +12,14 @@
 
 #include "lib/fidl/cpp/bindings/interface_ptr_set.h"
 #include "lib/fxl/macros.h"
+#include "lib/fxl/memory/weak_ptr.h"
+#include "lib/fxl/time/time_delta.h"
 #include "lib/ledger/fidl/ledger.fidl.h"
 #include "peridot/bin/ledger/app/branch_tracker.h"
 #include "peridot/bin/ledger/app/merging/merge_resolver.h"
 #include "peridot/bin/ledger/app/page_impl.h"
 #include "peridot/bin/ledger/app/sync_watcher_set.h"
+#include "peridot/bin/ledger/environment/environment.h"
 #include "peridot/bin/ledger/fidl_helpers/bound_interface.h"
 #include "peridot/bin/ledger/storage/public/data_source.h"
 #include "peridot/bin/ledger/storage/public/journal.h"
@@ -36,7 +39,7 @@ class PageManager;
 // |set_on_empty()|).
 class PageDelegate {
  public:
-  PageDelegate(coroutine::CoroutineService* coroutine_service,
+  PageDelegate(Environment* environment,
                PageManager* manager,
                storage::PageStorage* storage,
                MergeResolver* merge_resolver,
@@ -94,19 +97,50 @@ class PageDelegate {
 
   const storage::CommitId& GetCurrentCommitId();
 
+  // Serializes |operation|, after committing the pending implicit journal if
+  // there is one, so that |operation| observes all the changes made before it.
+  void SerializeOperation(StatusCallback callback,
+                          std::function<void(StatusCallback)> operation);
+
+  // Serializes |operation|, which changes the contents of the page, and calls
+  // |callback| with its result. |operation| receives the callback for its
+  // result and a closure it can call to let the next operations run before
+  // the change is committed.
+  void SerializeChange(
+      StatusCallback callback,
+      std::function<void(StatusCallback, fxl::Closure)> operation);
+
   void PutInCommit(fidl::Array<uint8_t> key,
                    storage::ObjectIdentifier object_identifier,
                    storage::KeyPriority priority,
-                   StatusCallback callback);
+                   StatusCallback callback,
+                   fxl::Closure on_applied);
 
   // Runs |runnable| in a transaction, and notifies |callback| of the result. If
   // a transaction is currently in progress, it reuses it, otherwise creates a
-  // new one and commits it before calling |callback|. This method is not
-  // serialized, and should only be called from a callsite that is serialized.
+  // new one and commits it before calling |callback|. When implicit commits are
+  // coalesced, the change is added to the pending implicit journal instead,
+  // |on_applied| is called as soon as it is, and |callback| is called once
+  // the journal is committed. This method is not serialized, and should only
+  // be called from a callsite that is serialized.
   void RunInTransaction(
       std::function<void(storage::Journal*, std::function<void(Status)>)>
           runnable,
-      StatusCallback callback);
+      StatusCallback callback,
+      fxl::Closure on_applied);
+
+  // Adds the change made by |runnable| to the pending implicit journal,
+  // creating it if needed.
+  void RunInImplicitJournal(
+      std::function<void(storage::Journal*, std::function<void(Status)>)>
+          runnable,
+      StatusCallback callback,
+      fxl::Closure on_applied);
+
+  // Commits the pending implicit journal, if any, notifies the callbacks of
+  // all the changes it contains, and then calls |on_done|. This method is not
+  // serialized, and should only be called from a callsite that is serialized.
+  void CommitImplicitJournal(fxl::Closure on_done);
 
   void CommitJournal(
       std::unique_ptr<storage::Journal> journal,
@@ -115,6 +149,7 @@ class PageDelegate {
 
   void CheckEmpty();
 
+  Environment* const environment_;
   PageManager* manager_;
   storage::PageStorage* storage_;
   MergeResolver* merge_resolver_;
@@ -130,6 +165,18 @@ class PageDelegate {
   callback::OperationSerializer operation_serializer_;
   SyncWatcherSet* watcher_set_;
 
+  // Journal accumulating the changes made outside of transactions during the
+  // implicit commit window, and the callbacks of these changes.
+  const fxl::TimeDelta implicit_commit_window_;
+  std::unique_ptr<storage::Journal> implicit_journal_;
+  std::vector<StatusCallback> implicit_journal_callbacks_;
+  // Incremented each time the implicit journal is committed, so that a
+  // delayed commit doesn't commit a later journal too early.
+  uint64_t implicit_journal_generation_ = 0;
+
+  // This must be the last member of the class.
+  fxl::WeakPtrFactory<PageDelegate> weak_factory_;
+
   FXL_DISALLOW_COPY_AND_ASSIGN(PageDelegate);
 };
 
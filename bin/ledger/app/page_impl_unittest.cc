@@ -333,6 +333,82 @@ TEST_F(PageImplTest, DeleteNoTransaction) {
   EXPECT_FALSE(RunLoopWithTimeout());
 }
 
+TEST_F(PageImplTest, CoalesceImplicitCommits) {
+  environment_.set_implicit_commit_window(fxl::TimeDelta::FromMilliseconds(10));
+  Status status;
+  PagePtr page_ptr;
+  manager_->BindPage(page_ptr.NewRequest(),
+                     callback::Capture(MakeQuitTask(), &status));
+  EXPECT_FALSE(RunLoopWithTimeout());
+  ASSERT_EQ(Status::OK, status);
+
+  size_t callback_count = 0;
+  auto callback = [this, &callback_count](Status status) {
+    EXPECT_EQ(Status::OK, status);
+    if (++callback_count == 3) {
+      message_loop_.PostQuitTask();
+    }
+  };
+  page_ptr->Put(convert::ToArray("key1"), convert::ToArray("value1"),
+                callback);
+  page_ptr->Put(convert::ToArray("key2"), convert::ToArray("value2"),
+                callback);
+  page_ptr->Delete(convert::ToArray("key3"), callback);
+  EXPECT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(3u, callback_count);
+
+  // All the changes are in a single commit.
+  const std::map<std::string,
+                 std::unique_ptr<storage::fake::FakeJournalDelegate>>&
+      journals = fake_storage_->GetJournals();
+  ASSERT_EQ(1u, journals.size());
+  auto it = journals.begin();
+  EXPECT_TRUE(it->second->IsCommitted());
+  EXPECT_EQ(3u, it->second->GetData().size());
+  EXPECT_TRUE(it->second->GetData().at("key3").deleted);
+}
+
+TEST_F(PageImplTest, ImplicitCommitBeforeSnapshot) {
+  environment_.set_implicit_commit_window(fxl::TimeDelta::FromSeconds(3600));
+  Status status;
+  PagePtr page_ptr;
+  manager_->BindPage(page_ptr.NewRequest(),
+                     callback::Capture(MakeQuitTask(), &status));
+  EXPECT_FALSE(RunLoopWithTimeout());
+  ASSERT_EQ(Status::OK, status);
+
+  std::string key("some_key");
+  std::string value("a small value");
+  bool put_called = false;
+  page_ptr->Put(convert::ToArray(key), convert::ToArray(value),
+                [&put_called](Status status) {
+                  EXPECT_EQ(Status::OK, status);
+                  put_called = true;
+                });
+
+  // The snapshot commits the pending change, and sees it.
+  PageSnapshotPtr snapshot;
+  page_ptr->GetSnapshot(snapshot.NewRequest(), nullptr, nullptr,
+                        [this, &put_called](Status status) {
+                          EXPECT_EQ(Status::OK, status);
+                          EXPECT_TRUE(put_called);
+                          message_loop_.PostQuitTask();
+                        });
+  EXPECT_FALSE(RunLoopWithTimeout());
+  EXPECT_TRUE(put_called);
+
+  fsl::SizedVmoTransportPtr actual_value;
+  snapshot->Get(convert::ToArray(key),
+                [this, &actual_value](Status status,
+                                      fsl::SizedVmoTransportPtr value) {
+                  EXPECT_EQ(Status::OK, status);
+                  actual_value = std::move(value);
+                  message_loop_.PostQuitTask();
+                });
+  EXPECT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(value, ToString(actual_value));
+}
+
 TEST_F(PageImplTest, TransactionCommit) {
   std::string key1("some_key1");
   storage::ObjectDigest object_digest1;
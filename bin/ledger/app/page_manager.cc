@@ -69,8 +69,8 @@ void PageManager::BindPage(fidl::InterfaceRequest<Page> page_request,
                            std::function<void(Status)> on_done) {
   if (sync_backlog_downloaded_) {
     pages_
-        .emplace(environment_->coroutine_service(), this, page_storage_.get(),
-                 merge_resolver_.get(), std::move(page_request), &watchers_)
+        .emplace(environment_, this, page_storage_.get(), merge_resolver_.get(),
+                 std::move(page_request), &watchers_)
         .Init(std::move(on_done));
     return;
   }
@@ -168,4 +168,30 @@ void PageManager::GetCommit(fidl::Array<uint8_t> commit_id,
                      std::move(commit_struct));
           }));
 }
+
+void PageManager::GetUploadStats(const GetUploadStatsCallback& callback) {
+  cloud_sync::UploadStats stats;
+  if (page_sync_context_) {
+    stats = page_sync_context_->page_sync->GetUploadStats();
+  }
+  auto result = ledger::UploadStats::New();
+  result->objects_uploaded = stats.objects_uploaded;
+  result->object_bytes_uploaded = stats.object_bytes_uploaded;
+  result->commits_uploaded = stats.commits_uploaded;
+  result->commit_batches_uploaded = stats.commit_batches_uploaded;
+  result->failed_uploads = stats.failed_uploads;
+  result->object_upload_time = stats.object_upload_time.ToNanoseconds();
+  result->average_object_upload_latency =
+      stats.objects_uploaded
+          ? stats.total_object_upload_latency.ToNanoseconds() /
+                static_cast<int64_t>(stats.objects_uploaded)
+          : 0;
+  result->average_commit_upload_latency =
+      stats.commit_batches_uploaded
+          ? stats.total_commit_upload_latency.ToNanoseconds() /
+                static_cast<int64_t>(stats.commit_batches_uploaded)
+          : 0;
+  result->concurrent_uploads_limit = stats.concurrent_uploads_limit;
+  callback(Status::OK, std::move(result));
+}
 }  // namespace ledger
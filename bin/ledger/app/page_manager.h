@@ -86,6 +86,8 @@ class PageManager : public PageDebug {
   void GetCommit(fidl::Array<uint8_t> commit_id,
                  const GetCommitCallback& callback) override;
 
+  void GetUploadStats(const GetUploadStatsCallback& callback) override;
+
   Environment* const environment_;
   std::unique_ptr<storage::PageStorage> page_storage_;
   std::unique_ptr<cloud_sync::PageSyncContext> page_sync_context_;
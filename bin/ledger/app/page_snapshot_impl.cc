@@ -15,6 +15,7 @@
 #include "lib/fxl/memory/ref_counted.h"
 #include "lib/fxl/memory/ref_ptr.h"
 #include "lib/fxl/tasks/task_runner.h"
+#include "peridot/bin/ledger/app/fidl/packed_entries.h"
 #include "peridot/bin/ledger/app/fidl/serialization_size.h"
 #include "peridot/bin/ledger/app/page_utils.h"
 #include "peridot/lib/callback/trace_callback.h"
@@ -24,16 +25,49 @@
 namespace ledger {
 namespace {
 
+// Maximal size of the buffer returned by a single GetEntriesPacked call.
+constexpr size_t kMaxPackedEntriesSize = 16 * 1024 * 1024;
+// Maximal number of entries returned by a single GetEntriesPacked call.
+constexpr size_t kMaxPackedEntriesCount = 64 * 1024;
+// Number of values read at once by GetEntriesPacked. Values are read by
+// windows so that the values of the entries that do not fit in the buffer are
+// not read.
+constexpr size_t kPackedEntriesReadWindow = 256;
+
+Priority ToPriority(storage::KeyPriority priority) {
+  return priority == storage::KeyPriority::EAGER ? Priority::EAGER
+                                                 : Priority::LAZY;
+}
+
 template <typename EntryType>
 fidl::StructPtr<EntryType> CreateEntry(const storage::Entry& entry) {
   fidl::StructPtr<EntryType> entry_ptr = EntryType::New();
   entry_ptr->key = convert::ToArray(entry.key);
-  entry_ptr->priority = entry.priority == storage::KeyPriority::EAGER
-                            ? Priority::EAGER
-                            : Priority::LAZY;
+  entry_ptr->priority = ToPriority(entry.priority);
   return entry_ptr;
 }
 
+// Retrieves the value of |entry| from the local storage. The object passed to
+// |callback| is null if the value is lazy and not present on the device.
+void GetLocalValue(
+    storage::PageStorage* page_storage,
+    const storage::Entry& entry,
+    std::function<void(storage::Status,
+                       std::unique_ptr<const storage::Object>)> callback) {
+  page_storage->GetObject(
+      entry.object_identifier, storage::PageStorage::Location::LOCAL,
+      [priority = entry.priority, callback = std::move(callback)](
+          storage::Status status,
+          std::unique_ptr<const storage::Object> object) {
+        if (status == storage::Status::NOT_FOUND &&
+            priority == storage::KeyPriority::LAZY) {
+          callback(storage::Status::OK, nullptr);
+        } else {
+          callback(status, std::move(object));
+        }
+      });
+}
+
 // Returns the number of handles used by an entry of the given type. Specialized
 // for each entry type.
 template <class EntryType>
@@ -132,9 +166,7 @@ void FillEntries(
   auto on_next = fxl::MakeCopyable([page_storage, &key_prefix,
                                     context = context.get(),
                                     waiter](storage::Entry entry) {
-    if (!PageUtils::MatchesPrefix(entry.key, key_prefix)) {
-      return false;
-    }
+    FXL_DCHECK(PageUtils::MatchesPrefix(entry.key, key_prefix));
     context->size += fidl_serialization::GetEntrySize(entry.key.size());
     context->handle_count += HandleUsed<EntryType>();
     if ((context->size > fidl_serialization::kMaxInlineDataSize ||
@@ -144,18 +176,7 @@ void FillEntries(
       return false;
     }
     context->entries.push_back(CreateEntry<EntryType>(entry));
-    page_storage->GetObject(
-        entry.object_identifier, storage::PageStorage::Location::LOCAL,
-        [priority = entry.priority, waiter_callback = waiter->NewCallback()](
-            storage::Status status,
-            std::unique_ptr<const storage::Object> object) {
-          if (status == storage::Status::NOT_FOUND &&
-              priority == storage::KeyPriority::LAZY) {
-            waiter_callback(storage::Status::OK, nullptr);
-          } else {
-            waiter_callback(status, std::move(object));
-          }
-        });
+    GetLocalValue(page_storage, entry, waiter->NewCallback());
     return true;
   });
 
@@ -232,8 +253,200 @@ void FillEntries(
             });
     waiter->Finalize(result_callback);
   });
-  page_storage->GetCommitContents(*commit, std::move(start), std::move(on_next),
-                                  std::move(on_done));
+  page_storage->GetCommitContents(*commit, std::move(start),
+                                  PageUtils::GetPrefixEnd(key_prefix),
+                                  std::move(on_next), std::move(on_done));
+}
+
+// Entries of a GetEntriesPacked call, and the buffer they are packed in.
+struct PackedEntriesContext {
+  std::vector<storage::Entry> entries;
+  // The total size of the keys in |entries|.
+  size_t keys_size = 0u;
+  // The key of the first entry not returned, if any.
+  std::string next_token;
+  packed_entries::Builder builder;
+};
+
+// Reads the values of the entries of |context| starting at |start|, by windows
+// of |kPackedEntriesReadWindow|, and adds them to its builder. Calls |callback|
+// once all entries are added, or as soon as the buffer is full: the values of
+// the entries that do not fit are not read.
+void AddPackedValues(storage::PageStorage* page_storage,
+                     std::shared_ptr<PackedEntriesContext> context,
+                     size_t start,
+                     std::function<void(Status)> callback) {
+  size_t end =
+      std::min(start + kPackedEntriesReadWindow, context->entries.size());
+  if (start == end) {
+    callback(Status::OK);
+    return;
+  }
+  auto waiter = callback::
+      Waiter<storage::Status, std::unique_ptr<const storage::Object>>::Create(
+          storage::Status::OK);
+  for (size_t i = start; i < end; ++i) {
+    GetLocalValue(page_storage, context->entries[i], waiter->NewCallback());
+  }
+  waiter->Finalize([page_storage, context = std::move(context), start,
+                    callback = std::move(callback)](
+                       storage::Status status,
+                       std::vector<std::unique_ptr<const storage::Object>>
+                           results) mutable {
+    if (status != storage::Status::OK) {
+      FXL_LOG(ERROR) << "Error while reading.";
+      callback(Status::IO_ERROR);
+      return;
+    }
+    for (size_t i = 0; i < results.size(); ++i) {
+      const storage::Entry& entry = context->entries[start + i];
+      fxl::StringView data;
+      if (results[i]) {
+        storage::Status read_status = results[i]->GetData(&data);
+        if (read_status != storage::Status::OK) {
+          callback(PageUtils::ConvertStatus(read_status));
+          return;
+        }
+      }
+      if (context->builder.entry_count() > 0 &&
+          context->builder.GetSizeWith(entry.key.size(), data.size()) >
+              kMaxPackedEntriesSize) {
+        context->next_token = entry.key;
+        callback(Status::OK);
+        return;
+      }
+      if (results[i]) {
+        context->builder.Add(entry.key, data, ToPriority(entry.priority));
+      } else {
+        // The value of a lazy key not present on the device: the client can
+        // retrieve it with Fetch.
+        context->builder.AddWithMissingValue(entry.key,
+                                             ToPriority(entry.priority));
+      }
+    }
+    AddPackedValues(page_storage, std::move(context), start + results.size(),
+                    std::move(callback));
+  });
+}
+
+// Calls |callback| with the entries starting from |key_start| or |token|,
+// packed in a single buffer per GetEntriesPacked semantics. Values are read
+// like in |FillEntries|, by windows, but the result is only limited by
+// |kMaxPackedEntriesSize| and |kMaxPackedEntriesCount|.
+void FillPackedEntries(
+    storage::PageStorage* page_storage,
+    const std::string& key_prefix,
+    const storage::Commit* commit,
+    fidl::Array<uint8_t> key_start,
+    fidl::Array<uint8_t> token,
+    const PageSnapshot::GetEntriesPackedCallback& callback) {
+  auto timed_callback = TRACE_CALLBACK(std::move(callback), "ledger",
+                                       "snapshot_get_entries_packed");
+
+  auto context = std::make_shared<PackedEntriesContext>();
+  // Use |token| for the first key if present.
+  std::string start = token
+                          ? convert::ToString(token)
+                          : std::max(key_prefix, convert::ToString(key_start));
+  auto on_next = [&key_prefix, context](storage::Entry entry) {
+    FXL_DCHECK(PageUtils::MatchesPrefix(entry.key, key_prefix));
+    if ((context->entries.size() >= kMaxPackedEntriesCount ||
+         context->keys_size + entry.key.size() > kMaxPackedEntriesSize) &&
+        !context->entries.empty()) {
+      context->next_token = std::move(entry.key);
+      return false;
+    }
+    context->keys_size += entry.key.size();
+    context->entries.push_back(std::move(entry));
+    return true;
+  };
+
+  auto on_done = [page_storage, context, callback = std::move(timed_callback)](
+                     storage::Status status) {
+    if (status != storage::Status::OK) {
+      FXL_LOG(ERROR) << "Error while reading.";
+      callback(Status::IO_ERROR, nullptr, nullptr);
+      return;
+    }
+    AddPackedValues(
+        page_storage, context, 0,
+        [context, callback = std::move(callback)](Status status) {
+          if (status != Status::OK) {
+            callback(status, nullptr, nullptr);
+            return;
+          }
+          fsl::SizedVmo buffer;
+          if (!fsl::VmoFromString(context->builder.Build(), &buffer)) {
+            callback(Status::IO_ERROR, nullptr, nullptr);
+            return;
+          }
+          if (!context->next_token.empty()) {
+            callback(Status::PARTIAL_RESULT, std::move(buffer).ToTransport(),
+                     convert::ToArray(context->next_token));
+            return;
+          }
+          callback(Status::OK, std::move(buffer).ToTransport(), nullptr);
+        });
+  };
+  page_storage->GetCommitContents(*commit, std::move(start),
+                                  PageUtils::GetPrefixEnd(key_prefix),
+                                  std::move(on_next), std::move(on_done));
+}
+
+// Retrieves the entries of |commit| for the given |keys| and their local
+// values, and calls |callback| with the entries found, sorted by key. Keys
+// that are outside of |key_prefix| are ignored. The object of an entry is
+// null if its value is lazy and not present on the device.
+void GetManyEntries(
+    storage::PageStorage* page_storage,
+    const std::string& key_prefix,
+    const storage::Commit* commit,
+    fidl::Array<fidl::Array<uint8_t>> keys,
+    std::function<void(storage::Status,
+                       std::vector<storage::Entry>,
+                       std::vector<std::unique_ptr<const storage::Object>>)>
+        callback) {
+  std::vector<std::string> sorted_keys;
+  sorted_keys.reserve(keys.size());
+  for (const auto& key : keys) {
+    std::string key_string = convert::ToString(key);
+    if (PageUtils::MatchesPrefix(key_string, key_prefix)) {
+      sorted_keys.push_back(std::move(key_string));
+    }
+  }
+  std::sort(sorted_keys.begin(), sorted_keys.end());
+  sorted_keys.erase(std::unique(sorted_keys.begin(), sorted_keys.end()),
+                    sorted_keys.end());
+  if (sorted_keys.empty()) {
+    callback(storage::Status::OK, std::vector<storage::Entry>(),
+             std::vector<std::unique_ptr<const storage::Object>>());
+    return;
+  }
+
+  page_storage->GetEntriesFromCommit(
+      *commit, std::move(sorted_keys),
+      [page_storage, callback = std::move(callback)](
+          storage::Status status, std::vector<storage::Entry> entries) {
+        if (status != storage::Status::OK) {
+          callback(status, std::vector<storage::Entry>(),
+                   std::vector<std::unique_ptr<const storage::Object>>());
+          return;
+        }
+        auto waiter =
+            callback::Waiter<storage::Status,
+                             std::unique_ptr<const storage::Object>>::
+                Create(storage::Status::OK);
+        for (const auto& entry : entries) {
+          GetLocalValue(page_storage, entry, waiter->NewCallback());
+        }
+        waiter->Finalize(fxl::MakeCopyable(
+            [entries = std::move(entries), callback = std::move(callback)](
+                storage::Status status,
+                std::vector<std::unique_ptr<const storage::Object>>
+                    objects) mutable {
+              callback(status, std::move(entries), std::move(objects));
+            }));
+      });
 }
 }  // namespace
 
@@ -243,6 +456,7 @@ PageSnapshotImpl::PageSnapshotImpl(
     std::string key_prefix)
     : page_storage_(page_storage),
       commit_(std::move(commit)),
+      commit_pin_(page_storage_->PinCommit(commit_->GetId())),
       key_prefix_(std::move(key_prefix)) {}
 
 PageSnapshotImpl::~PageSnapshotImpl() {}
@@ -262,6 +476,94 @@ void PageSnapshotImpl::GetEntriesInline(
                             std::move(key_start), std::move(token), callback);
 }
 
+void PageSnapshotImpl::GetEntriesPacked(
+    fidl::Array<uint8_t> key_start,
+    fidl::Array<uint8_t> token,
+    const GetEntriesPackedCallback& callback) {
+  FillPackedEntries(page_storage_, key_prefix_, commit_.get(),
+                    std::move(key_start), std::move(token), callback);
+}
+
+void PageSnapshotImpl::GetMany(fidl::Array<fidl::Array<uint8_t>> keys,
+                               const GetManyCallback& callback) {
+  auto timed_callback = TRACE_CALLBACK(callback, "ledger", "snapshot_get_many");
+
+  GetManyEntries(
+      page_storage_, key_prefix_, commit_.get(), std::move(keys),
+      [callback = std::move(timed_callback)](
+          storage::Status status, std::vector<storage::Entry> entries,
+          std::vector<std::unique_ptr<const storage::Object>>
+              objects) mutable {
+        if (status != storage::Status::OK) {
+          callback(PageUtils::ConvertStatus(status), nullptr);
+          return;
+        }
+        FXL_DCHECK(entries.size() == objects.size());
+        packed_entries::Builder builder;
+        for (size_t i = 0; i < entries.size(); ++i) {
+          if (!objects[i]) {
+            builder.AddWithMissingValue(entries[i].key,
+                                        ToPriority(entries[i].priority));
+            continue;
+          }
+          fxl::StringView data;
+          storage::Status read_status = objects[i]->GetData(&data);
+          if (read_status != storage::Status::OK) {
+            callback(PageUtils::ConvertStatus(read_status), nullptr);
+            return;
+          }
+          builder.Add(entries[i].key, data, ToPriority(entries[i].priority));
+        }
+        fsl::SizedVmo buffer;
+        if (!fsl::VmoFromString(builder.Build(), &buffer)) {
+          callback(Status::IO_ERROR, nullptr);
+          return;
+        }
+        callback(Status::OK, std::move(buffer).ToTransport());
+      });
+}
+
+void PageSnapshotImpl::GetManyInline(fidl::Array<fidl::Array<uint8_t>> keys,
+                                     const GetManyInlineCallback& callback) {
+  auto timed_callback =
+      TRACE_CALLBACK(callback, "ledger", "snapshot_get_many_inline");
+
+  GetManyEntries(
+      page_storage_, key_prefix_, commit_.get(), std::move(keys),
+      [callback = std::move(timed_callback)](
+          storage::Status status, std::vector<storage::Entry> entries,
+          std::vector<std::unique_ptr<const storage::Object>>
+              objects) mutable {
+        if (status != storage::Status::OK) {
+          callback(PageUtils::ConvertStatus(status), nullptr);
+          return;
+        }
+        FXL_DCHECK(entries.size() == objects.size());
+        auto result = fidl::Array<InlinedEntryPtr>::New(0);
+        // The serialization size of the status and of all entries.
+        size_t size = fidl_serialization::kEnumSize +
+                      fidl_serialization::kArrayHeaderSize;
+        for (size_t i = 0; i < entries.size(); ++i) {
+          InlinedEntryPtr entry = CreateEntry<InlinedEntry>(entries[i]);
+          if (objects[i]) {
+            storage::Status read_status =
+                FillSingleEntry(*objects[i], &entry);
+            if (read_status != storage::Status::OK) {
+              callback(PageUtils::ConvertStatus(read_status), nullptr);
+              return;
+            }
+          }
+          size += ComputeEntrySize(entry);
+          if (size > fidl_serialization::kMaxInlineDataSize) {
+            callback(Status::VALUE_TOO_LARGE, nullptr);
+            return;
+          }
+          result.push_back(std::move(entry));
+        }
+        callback(Status::OK, std::move(result));
+      });
+}
+
 void PageSnapshotImpl::GetKeys(fidl::Array<uint8_t> key_start,
                                fidl::Array<uint8_t> token,
                                const GetKeysCallback& callback) {
@@ -283,9 +585,7 @@ void PageSnapshotImpl::GetKeys(fidl::Array<uint8_t> key_start,
   auto context = std::make_unique<Context>();
   auto on_next =
       fxl::MakeCopyable([this, context = context.get()](storage::Entry entry) {
-        if (!PageUtils::MatchesPrefix(entry.key, key_prefix_)) {
-          return false;
-        }
+        FXL_DCHECK(PageUtils::MatchesPrefix(entry.key, key_prefix_));
         context->size += fidl_serialization::GetByteArraySize(entry.key.size());
         if (context->size > fidl_serialization::kMaxInlineDataSize) {
           context->next_token = entry.key;
@@ -307,11 +607,14 @@ void PageSnapshotImpl::GetKeys(fidl::Array<uint8_t> key_start,
   if (token.is_null()) {
     page_storage_->GetCommitContents(
         *commit_, std::max(convert::ToString(key_start), key_prefix_),
-        std::move(on_next), std::move(on_done));
+        PageUtils::GetPrefixEnd(key_prefix_), std::move(on_next),
+        std::move(on_done));
 
   } else {
-    page_storage_->GetCommitContents(*commit_, convert::ToString(token),
-                                     std::move(on_next), std::move(on_done));
+    page_storage_->GetCommitContents(
+        *commit_, convert::ToString(token),
+        PageUtils::GetPrefixEnd(key_prefix_), std::move(on_next),
+        std::move(on_done));
   }
 }
 
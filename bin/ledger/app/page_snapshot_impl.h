@@ -30,6 +30,13 @@ class PageSnapshotImpl : public PageSnapshot {
   void GetEntriesInline(fidl::Array<uint8_t> key_start,
                         fidl::Array<uint8_t> token,
                         const GetEntriesInlineCallback& callback) override;
+  void GetEntriesPacked(fidl::Array<uint8_t> key_start,
+                        fidl::Array<uint8_t> token,
+                        const GetEntriesPackedCallback& callback) override;
+  void GetMany(fidl::Array<fidl::Array<uint8_t>> keys,
+               const GetManyCallback& callback) override;
+  void GetManyInline(fidl::Array<fidl::Array<uint8_t>> keys,
+                     const GetManyInlineCallback& callback) override;
   void GetKeys(fidl::Array<uint8_t> key_start,
                fidl::Array<uint8_t> token,
                const GetKeysCallback& callback) override;
@@ -44,6 +51,8 @@ class PageSnapshotImpl : public PageSnapshot {
 
   storage::PageStorage* page_storage_;
   std::unique_ptr<const storage::Commit> commit_;
+  // Keeps the values of |commit_| available locally.
+  std::unique_ptr<storage::PageStorage::CommitPin> commit_pin_;
   const std::string key_prefix_;
 };
 
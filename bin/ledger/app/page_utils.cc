@@ -90,14 +90,37 @@ void PageUtils::ResolveObjectIdentifierAsBuffer(
     storage::PageStorage::Location location,
     Status not_found_status,
     std::function<void(Status, fsl::SizedVmo)> callback) {
-  ResolveObjectIdentifierAsStringView(
-      storage, object_identifier, location, not_found_status,
-      [offset, max_size, callback](Status status, fxl::StringView data) {
-        if (status != Status::OK) {
-          callback(status, nullptr);
+  storage->GetObject(
+      object_identifier, location,
+      [offset, max_size, not_found_status, callback](
+          storage::Status status,
+          std::unique_ptr<const storage::Object> object) {
+        if (status != storage::Status::OK) {
+          callback(PageUtils::ConvertStatus(status, not_found_status),
+                   nullptr);
+          return;
+        }
+        fxl::StringView data;
+        status = object->GetData(&data);
+        if (status != storage::Status::OK) {
+          callback(PageUtils::ConvertStatus(status, not_found_status),
+                   nullptr);
           return;
         }
         fsl::SizedVmo buffer;
+        if (offset == 0 &&
+            (max_size < 0 || static_cast<uint64_t>(max_size) >= data.size())) {
+          // The whole object is requested: objects backed by a VMO return it
+          // without copying their content.
+          status = object->GetVmo(&buffer);
+          if (status != storage::Status::OK) {
+            callback(PageUtils::ConvertStatus(status, not_found_status),
+                     nullptr);
+            return;
+          }
+          callback(Status::OK, std::move(buffer));
+          return;
+        }
         Status buffer_status = ToBuffer(data, offset, max_size, &buffer);
         if (buffer_status != Status::OK) {
           callback(buffer_status, nullptr);
@@ -113,4 +136,17 @@ bool PageUtils::MatchesPrefix(const std::string& key,
          convert::ExtendedStringView(prefix);
 }
 
+std::string PageUtils::GetPrefixEnd(const std::string& prefix) {
+  std::string prefix_end = prefix;
+  while (!prefix_end.empty()) {
+    uint8_t last_byte = prefix_end.back();
+    if (last_byte != 0xFF) {
+      prefix_end.back() = static_cast<char>(last_byte + 1);
+      return prefix_end;
+    }
+    prefix_end.pop_back();
+  }
+  return prefix_end;
+}
+
 }  // namespace ledger
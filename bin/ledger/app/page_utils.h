@@ -48,6 +48,11 @@ class PageUtils {
   // Returns true if a key matches the provided prefix, false otherwise.
   static bool MatchesPrefix(const std::string& key, const std::string& prefix);
 
+  // Returns the smallest key greater than all keys matching |prefix|, or an
+  // empty string if there is none, i.e. if |prefix| only contains 0xFF bytes.
+  // Keys matching |prefix| are exactly the keys in [prefix, GetPrefixEnd).
+  static std::string GetPrefixEnd(const std::string& prefix);
+
  private:
   FXL_DISALLOW_COPY_AND_ASSIGN(PageUtils);
 };
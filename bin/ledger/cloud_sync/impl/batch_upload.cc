@@ -25,7 +25,9 @@ BatchUpload::BatchUpload(
     std::vector<std::unique_ptr<const storage::Commit>> commits,
     fxl::Closure on_done,
     std::function<void(ErrorType)> on_error,
-    unsigned int max_concurrent_uploads)
+    unsigned int max_concurrent_uploads,
+    UploadConcurrency* concurrency,
+    UploadStats* stats)
     : storage_(storage),
       encryption_service_(encryption_service),
       page_cloud_(page_cloud),
@@ -33,6 +35,8 @@ BatchUpload::BatchUpload(
       on_done_(std::move(on_done)),
       on_error_(std::move(on_error)),
       max_concurrent_uploads_(max_concurrent_uploads),
+      concurrency_(concurrency),
+      stats_(stats),
       weak_ptr_factory_(this) {
   TRACE_ASYNC_BEGIN("ledger", "batch_upload",
                     reinterpret_cast<uintptr_t>(this));
@@ -44,6 +48,12 @@ BatchUpload::~BatchUpload() {
   TRACE_ASYNC_END("ledger", "batch_upload", reinterpret_cast<uintptr_t>(this));
 }
 
+void BatchUpload::SetOnObjectsUploaded(fxl::Closure on_objects_uploaded) {
+  FXL_DCHECK(!started_);
+  FXL_DCHECK(!on_objects_uploaded_);
+  on_objects_uploaded_ = std::move(on_objects_uploaded);
+}
+
 void BatchUpload::Start() {
   FXL_DCHECK(!started_);
   FXL_DCHECK(!errored_);
@@ -74,11 +84,11 @@ void BatchUpload::StartObjectUpload() {
   FXL_DCHECK(current_uploads_ == 0u);
   // If there are no unsynced objects left, upload the commits.
   if (remaining_object_identifiers_.empty()) {
-    FilterAndUploadCommits();
+    OnObjectsUploaded();
     return;
   }
 
-  while (current_uploads_ < max_concurrent_uploads_ &&
+  while (current_uploads_ < GetMaxConcurrentUploads() &&
          !remaining_object_identifiers_.empty()) {
     UploadNextObject();
   }
@@ -86,8 +96,8 @@ void BatchUpload::StartObjectUpload() {
 
 void BatchUpload::UploadNextObject() {
   FXL_DCHECK(!remaining_object_identifiers_.empty());
-  FXL_DCHECK(current_uploads_ < max_concurrent_uploads_);
-  current_uploads_++;
+  FXL_DCHECK(current_uploads_ < GetMaxConcurrentUploads());
+  OnObjectUploadStarted();
   current_objects_handled_++;
   auto object_identifier_to_send =
       std::move(remaining_object_identifiers_.back());
@@ -108,10 +118,36 @@ void BatchUpload::UploadNextObject() {
 
 void BatchUpload::UploadObject(storage::ObjectIdentifier object_identifier,
                                std::unique_ptr<const storage::Object> object) {
-  fsl::SizedVmo data;
-  auto status = object->GetVmo(&data);
-  // TODO(ppi): LE-225 Handle disk IO errors.
-  FXL_DCHECK(status == storage::Status::OK);
+  encryption_service_->EncryptObjectToVmo(
+      std::move(object),
+      callback::MakeScoped(
+          weak_ptr_factory_.GetWeakPtr(),
+          [this, object_identifier = std::move(object_identifier),
+           start = fxl::TimePoint::Now()](encryption::Status status,
+                                          fsl::SizedVmo data) mutable {
+            if (status != encryption::Status::OK) {
+              OnObjectUploadDone(start, false, 0u);
+              FXL_DCHECK(current_objects_handled_ > 0);
+              current_objects_handled_--;
+              errored_ = true;
+              error_type_ = ErrorType::PERMANENT;
+              remaining_object_identifiers_.push_back(
+                  std::move(object_identifier));
+              if (current_objects_handled_ == 0u) {
+                on_error_(error_type_);
+              }
+              return;
+            }
+            UploadEncryptedObject(std::move(object_identifier),
+                                  std::move(data), start);
+          }));
+}
+
+void BatchUpload::UploadEncryptedObject(
+    storage::ObjectIdentifier object_identifier,
+    fsl::SizedVmo data,
+    fxl::TimePoint start) {
+  size_t size = data.size();
 
   (*page_cloud_)
       ->AddObject(
@@ -119,10 +155,10 @@ void BatchUpload::UploadObject(storage::ObjectIdentifier object_identifier,
           std::move(data).ToTransport(),
           callback::MakeScoped(
               weak_ptr_factory_.GetWeakPtr(),
-              [this, object_identifier = std::move(object_identifier)](
-                  cloud_provider::Status status) mutable {
-                FXL_DCHECK(current_uploads_ > 0);
-                current_uploads_--;
+              [this, object_identifier = std::move(object_identifier), start,
+               size](cloud_provider::Status status) mutable {
+                OnObjectUploadDone(start, status == cloud_provider::Status::OK,
+                                   size);
 
                 if (status != cloud_provider::Status::OK) {
                   FXL_DCHECK(current_objects_handled_ > 0);
@@ -164,19 +200,82 @@ void BatchUpload::UploadObject(storage::ObjectIdentifier object_identifier,
                               remaining_object_identifiers_.empty()) {
                             // All the referenced objects are uploaded and
                             // marked as synced, upload the commits.
-                            FilterAndUploadCommits();
+                            OnObjectsUploaded();
                             return;
                           }
 
-                          if (!errored_ &&
-                              !remaining_object_identifiers_.empty()) {
+                          // Start as many uploads as the current limit
+                          // allows, as it may have grown.
+                          while (!errored_ &&
+                                 !remaining_object_identifiers_.empty() &&
+                                 current_uploads_ < GetMaxConcurrentUploads()) {
                             UploadNextObject();
                           }
                         }));
               }));
 }
 
+unsigned int BatchUpload::GetMaxConcurrentUploads() const {
+  if (!concurrency_) {
+    return max_concurrent_uploads_;
+  }
+  return std::min(max_concurrent_uploads_,
+                  static_cast<unsigned int>(concurrency_->limit()));
+}
+
+void BatchUpload::OnObjectUploadStarted() {
+  if (current_uploads_ == 0u) {
+    busy_start_ = fxl::TimePoint::Now();
+  }
+  current_uploads_++;
+}
+
+void BatchUpload::OnObjectUploadDone(fxl::TimePoint start,
+                                     bool success,
+                                     size_t size) {
+  FXL_DCHECK(current_uploads_ > 0);
+  current_uploads_--;
+  fxl::TimePoint now = fxl::TimePoint::Now();
+  if (concurrency_) {
+    if (success) {
+      concurrency_->OnUploadSucceeded(size, now - start);
+    } else {
+      concurrency_->OnUploadFailed();
+    }
+  }
+  if (!stats_) {
+    return;
+  }
+  if (success) {
+    stats_->objects_uploaded++;
+    stats_->object_bytes_uploaded += size;
+    stats_->total_object_upload_latency =
+        stats_->total_object_upload_latency + (now - start);
+  } else {
+    stats_->failed_uploads++;
+  }
+  if (current_uploads_ == 0u) {
+    stats_->object_upload_time =
+        stats_->object_upload_time + (now - busy_start_);
+  }
+  if (concurrency_) {
+    stats_->concurrent_uploads_limit = concurrency_->limit();
+  }
+}
+
+void BatchUpload::OnObjectsUploaded() {
+  if (on_objects_uploaded_) {
+    on_objects_uploaded_();
+  }
+  FilterAndUploadCommits();
+}
+
 void BatchUpload::FilterAndUploadCommits() {
+  if (commits_.empty()) {
+    // Nothing to upload.
+    on_done_();
+    return;
+  }
   // Remove all commits that have been synced since this upload object was
   // created. This will happen if a merge is executed on multiple devices at the
   // same time.
@@ -249,17 +348,28 @@ void BatchUpload::UploadCommits() {
                 std::move(commit_array),
                 callback::MakeScoped(
                     weak_ptr_factory_.GetWeakPtr(),
-                    [this, commit_ids =
-                               std::move(ids)](cloud_provider::Status status) {
+                    [this, commit_ids = std::move(ids),
+                     start = fxl::TimePoint::Now()](
+                        cloud_provider::Status status) {
                       // UploadCommit() is called as a last step of a
                       // so-far-successful upload attempt, so we couldn't have
                       // failed before.
                       FXL_DCHECK(!errored_);
                       if (status != cloud_provider::Status::OK) {
+                        if (stats_) {
+                          stats_->failed_uploads++;
+                        }
                         errored_ = true;
                         on_error_(ErrorType::TEMPORARY);
                         return;
                       }
+                      if (stats_) {
+                        stats_->commits_uploaded += commit_ids.size();
+                        stats_->commit_batches_uploaded++;
+                        stats_->total_commit_upload_latency =
+                            stats_->total_commit_upload_latency +
+                            (fxl::TimePoint::Now() - start);
+                      }
                       auto waiter =
                           callback::StatusWaiter<storage::Status>::Create(
                               storage::Status::OK);
@@ -10,9 +10,13 @@
 #include <vector>
 
 #include "lib/cloud_provider/fidl/cloud_provider.fidl.h"
+#include "lib/fsl/vmo/sized_vmo.h"
 #include "lib/fxl/functional/closure.h"
 #include "lib/fxl/macros.h"
 #include "lib/fxl/memory/weak_ptr.h"
+#include "lib/fxl/time/time_point.h"
+#include "peridot/bin/ledger/cloud_sync/impl/upload_concurrency.h"
+#include "peridot/bin/ledger/cloud_sync/public/upload_stats.h"
 #include "peridot/bin/ledger/encryption/public/encryption_service.h"
 #include "peridot/bin/ledger/storage/public/commit.h"
 #include "peridot/bin/ledger/storage/public/page_storage.h"
@@ -28,6 +32,11 @@ namespace cloud_sync {
 // The commits in the batch are uploaded in one network request once all objects
 // are uploaded.
 //
+// If |concurrency| is not null, it determines the number of objects uploaded
+// concurrently, bounded by |max_concurrent_uploads|, and is notified of the
+// outcome of each object upload. If |stats| is not null, it is updated as
+// objects and commits are uploaded.
+//
 // Usage: call Start() to kick off the upload. |on_done| is called after the
 // upload is successfully completed. |on_error| will be called at most once
 // after each error. Each time after |on_error| is called the client can
@@ -55,9 +64,16 @@ class BatchUpload {
               std::vector<std::unique_ptr<const storage::Commit>> commits,
               fxl::Closure on_done,
               std::function<void(ErrorType)> on_error,
-              unsigned int max_concurrent_uploads = 10);
+              unsigned int max_concurrent_uploads = 10,
+              UploadConcurrency* concurrency = nullptr,
+              UploadStats* stats = nullptr);
   ~BatchUpload();
 
+  // Sets a callback called each time all the objects of the batch are
+  // uploaded, right before the upload of the commits starts. Can be set at
+  // most once and only before calling Start().
+  void SetOnObjectsUploaded(fxl::Closure on_objects_uploaded);
+
   // Starts a new upload attempt. Results are reported through |on_done|
   // and |on_error| passed in the constructor. Can be called only once.
   void Start();
@@ -71,10 +87,26 @@ class BatchUpload {
 
   void UploadNextObject();
 
-  // Uploads the given object.
+  // Returns the current maximal number of concurrent object uploads.
+  unsigned int GetMaxConcurrentUploads() const;
+
+  // Updates the stats when an object upload starts and finishes.
+  void OnObjectUploadStarted();
+  void OnObjectUploadDone(fxl::TimePoint start, bool success, size_t size);
+
+  // Called when all objects are uploaded.
+  void OnObjectsUploaded();
+
+  // Encrypts and uploads the given object.
   void UploadObject(storage::ObjectIdentifier object_identifier,
                     std::unique_ptr<const storage::Object> object);
 
+  // Uploads the given encrypted object data. |start| is the time at which the
+  // upload of the object started.
+  void UploadEncryptedObject(storage::ObjectIdentifier object_identifier,
+                             fsl::SizedVmo data,
+                             fxl::TimePoint start);
+
   // Filters already synced commits.
   void FilterAndUploadCommits();
 
@@ -88,12 +120,17 @@ class BatchUpload {
   fxl::Closure on_done_;
   std::function<void(ErrorType)> on_error_;
   const unsigned int max_concurrent_uploads_;
+  UploadConcurrency* const concurrency_;
+  UploadStats* const stats_;
+  fxl::Closure on_objects_uploaded_;
 
   // All remaining object ids to be uploaded along with this batch of commits.
   std::vector<storage::ObjectIdentifier> remaining_object_identifiers_;
 
   // Number of object uploads currently in progress.
   unsigned int current_uploads_ = 0u;
+  // Start of the period during which |current_uploads_| has been non-zero.
+  fxl::TimePoint busy_start_;
 
   // Number of object being handled, including those being uploaded and those
   // whose metadata are being updated in storage.
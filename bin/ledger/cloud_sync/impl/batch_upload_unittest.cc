@@ -181,15 +181,20 @@ class BatchUploadTest : public gtest::TestWithMessageLoop {
 
   std::unique_ptr<BatchUpload> MakeBatchUpload(
       std::vector<std::unique_ptr<const storage::Commit>> commits,
-      unsigned int max_concurrent_uploads = 10) {
+      unsigned int max_concurrent_uploads = 10,
+      UploadConcurrency* concurrency = nullptr,
+      UploadStats* stats = nullptr) {
     return MakeBatchUploadWithStorage(&storage_, std::move(commits),
-                                      max_concurrent_uploads);
+                                      max_concurrent_uploads, concurrency,
+                                      stats);
   }
 
   std::unique_ptr<BatchUpload> MakeBatchUploadWithStorage(
       storage::PageStorage* storage,
       std::vector<std::unique_ptr<const storage::Commit>> commits,
-      unsigned int max_concurrent_uploads = 10) {
+      unsigned int max_concurrent_uploads = 10,
+      UploadConcurrency* concurrency = nullptr,
+      UploadStats* stats = nullptr) {
     return std::make_unique<BatchUpload>(
         storage, &encryption_service_, &page_cloud_ptr_, std::move(commits),
         [this] {
@@ -201,7 +206,7 @@ class BatchUploadTest : public gtest::TestWithMessageLoop {
           last_error_type_ = error_type;
           message_loop_.PostQuitTask();
         },
-        max_concurrent_uploads);
+        max_concurrent_uploads, concurrency, stats);
   }
 
  private:
@@ -286,8 +291,10 @@ TEST_F(BatchUploadTest, SingleCommitWithObjects) {
   EXPECT_EQ("content", encryption_service_.DecryptCommitSynchronous(
                            page_cloud_.received_commits.front().data));
   EXPECT_EQ(2u, page_cloud_.received_objects.size());
-  EXPECT_EQ("obj_data1", page_cloud_.received_objects["obj_digest1"]);
-  EXPECT_EQ("obj_data2", page_cloud_.received_objects["obj_digest2"]);
+  EXPECT_EQ("obj_data1", encryption_service_.DecryptObjectSynchronous(
+                             id1, page_cloud_.received_objects["obj_digest1"]));
+  EXPECT_EQ("obj_data2", encryption_service_.DecryptObjectSynchronous(
+                             id2, page_cloud_.received_objects["obj_digest2"]));
 
   // Verify the sync status in storage.
   EXPECT_EQ(1u, storage_.commits_marked_as_synced.size());
@@ -335,9 +342,12 @@ TEST_F(BatchUploadTest, ThrottleConcurrentUploads) {
   EXPECT_EQ(0u, error_calls_);
   EXPECT_EQ(3u, page_cloud_.add_object_calls);
   EXPECT_EQ(3u, page_cloud_.received_objects.size());
-  EXPECT_EQ("obj_data0", page_cloud_.received_objects["obj_digest0"]);
-  EXPECT_EQ("obj_data1", page_cloud_.received_objects["obj_digest1"]);
-  EXPECT_EQ("obj_data2", page_cloud_.received_objects["obj_digest2"]);
+  EXPECT_EQ("obj_data0", encryption_service_.DecryptObjectSynchronous(
+                             id0, page_cloud_.received_objects["obj_digest0"]));
+  EXPECT_EQ("obj_data1", encryption_service_.DecryptObjectSynchronous(
+                             id1, page_cloud_.received_objects["obj_digest1"]));
+  EXPECT_EQ("obj_data2", encryption_service_.DecryptObjectSynchronous(
+                             id2, page_cloud_.received_objects["obj_digest2"]));
 
   // Verify the sync status in storage.
   EXPECT_EQ(3u, storage_.objects_marked_as_synced.size());
@@ -349,6 +359,77 @@ TEST_F(BatchUploadTest, ThrottleConcurrentUploads) {
                     storage::MakeDefaultObjectIdentifier("obj_digest2")));
 }
 
+// Verifies that the number of concurrent object uploads follows the limit of
+// the given UploadConcurrency, and that the stats are updated.
+TEST_F(BatchUploadTest, AdaptiveConcurrencyAndStats) {
+  std::vector<std::unique_ptr<const storage::Commit>> commits;
+  commits.push_back(storage_.NewCommit("id", "content"));
+  storage::ObjectIdentifier id0 =
+      storage::MakeDefaultObjectIdentifier("obj_digest0");
+  storage::ObjectIdentifier id1 =
+      storage::MakeDefaultObjectIdentifier("obj_digest1");
+  storage::ObjectIdentifier id2 =
+      storage::MakeDefaultObjectIdentifier("obj_digest2");
+
+  storage_.unsynced_objects_to_return[id0] =
+      std::make_unique<TestObject>(id0, "obj_data0");
+  storage_.unsynced_objects_to_return[id1] =
+      std::make_unique<TestObject>(id1, "obj_data1");
+  storage_.unsynced_objects_to_return[id2] =
+      std::make_unique<TestObject>(id2, "obj_data2");
+
+  UploadConcurrency concurrency(1, 10, 1);
+  UploadStats stats;
+  auto batch_upload =
+      MakeBatchUpload(std::move(commits), 10, &concurrency, &stats);
+  unsigned int add_commits_calls_when_objects_uploaded = 1u;
+  batch_upload->SetOnObjectsUploaded([&] {
+    add_commits_calls_when_objects_uploaded = page_cloud_.add_commits_calls;
+  });
+
+  page_cloud_.delay_add_object_callbacks = true;
+  batch_upload->Start();
+  EXPECT_TRUE(RunLoopWithTimeout(fxl::TimeDelta::FromMilliseconds(50)));
+  // Verify that only one object upload is in progress.
+  EXPECT_EQ(1u, page_cloud_.add_object_calls);
+
+  page_cloud_.delay_add_object_callbacks = false;
+  page_cloud_.RunPendingCallbacks();
+  ASSERT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(1u, done_calls_);
+  EXPECT_EQ(0u, error_calls_);
+  EXPECT_EQ(3u, page_cloud_.received_objects.size());
+  // The objects are all uploaded before the commits.
+  EXPECT_EQ(0u, add_commits_calls_when_objects_uploaded);
+  EXPECT_EQ(1u, page_cloud_.add_commits_calls);
+
+  EXPECT_EQ(3u, stats.objects_uploaded);
+  // The fake encryption adds two bytes to each object.
+  EXPECT_EQ(33u, stats.object_bytes_uploaded);
+  EXPECT_EQ(1u, stats.commits_uploaded);
+  EXPECT_EQ(1u, stats.commit_batches_uploaded);
+  EXPECT_EQ(0u, stats.failed_uploads);
+  EXPECT_EQ(concurrency.limit(), stats.concurrent_uploads_limit);
+}
+
+// Verifies that a batch without commits only uploads the objects.
+TEST_F(BatchUploadTest, NoCommits) {
+  storage::ObjectIdentifier id =
+      storage::MakeDefaultObjectIdentifier("obj_digest");
+  storage_.unsynced_objects_to_return[id] =
+      std::make_unique<TestObject>(id, "obj_data");
+  auto batch_upload =
+      MakeBatchUpload(std::vector<std::unique_ptr<const storage::Commit>>());
+
+  batch_upload->Start();
+  ASSERT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(1u, done_calls_);
+  EXPECT_EQ(0u, error_calls_);
+  EXPECT_EQ(1u, page_cloud_.received_objects.size());
+  EXPECT_EQ(0u, page_cloud_.add_commits_calls);
+  EXPECT_EQ(1u, storage_.objects_marked_as_synced.size());
+}
+
 // Test an upload that fails on uploading objects.
 TEST_F(BatchUploadTest, FailedObjectUpload) {
   std::vector<std::unique_ptr<const storage::Commit>> commits;
@@ -408,8 +489,10 @@ TEST_F(BatchUploadTest, FailedCommitUpload) {
   // Verify that the objects were uploaded to cloud provider and marked as
   // synced.
   EXPECT_EQ(2u, page_cloud_.received_objects.size());
-  EXPECT_EQ("obj_data1", page_cloud_.received_objects["obj_digest1"]);
-  EXPECT_EQ("obj_data2", page_cloud_.received_objects["obj_digest2"]);
+  EXPECT_EQ("obj_data1", encryption_service_.DecryptObjectSynchronous(
+                             id1, page_cloud_.received_objects["obj_digest1"]));
+  EXPECT_EQ("obj_data2", encryption_service_.DecryptObjectSynchronous(
+                             id2, page_cloud_.received_objects["obj_digest2"]));
   EXPECT_EQ(2u, storage_.objects_marked_as_synced.size());
   EXPECT_EQ(1u, storage_.objects_marked_as_synced.count(
                     storage::MakeDefaultObjectIdentifier("obj_digest1")));
@@ -463,8 +546,10 @@ TEST_F(BatchUploadTest, ErrorAndRetry) {
   EXPECT_EQ("content", encryption_service_.DecryptCommitSynchronous(
                            page_cloud_.received_commits.front().data));
   EXPECT_EQ(2u, page_cloud_.received_objects.size());
-  EXPECT_EQ("obj_data1", page_cloud_.received_objects["obj_digest1"]);
-  EXPECT_EQ("obj_data2", page_cloud_.received_objects["obj_digest2"]);
+  EXPECT_EQ("obj_data1", encryption_service_.DecryptObjectSynchronous(
+                             id1, page_cloud_.received_objects["obj_digest1"]));
+  EXPECT_EQ("obj_data2", encryption_service_.DecryptObjectSynchronous(
+                             id2, page_cloud_.received_objects["obj_digest2"]));
 
   // Verify the sync status in storage.
   EXPECT_EQ(1u, storage_.commits_marked_as_synced.size());
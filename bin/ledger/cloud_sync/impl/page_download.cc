@@ -7,6 +7,7 @@
 #include "lib/fxl/strings/concatenate.h"
 #include "peridot/bin/ledger/cloud_sync/impl/constants.h"
 #include "peridot/bin/ledger/storage/public/data_source.h"
+#include "peridot/bin/ledger/storage/public/make_object_identifier.h"
 
 namespace cloud_sync {
 namespace {
@@ -283,7 +284,10 @@ void PageDownload::GetObject(
             }
 
             callback(storage::Status::OK,
-                     storage::DataSource::Create(std::move(data), size));
+                     encryption_service_->DecryptObjectStream(
+                         storage::MakeDefaultObjectIdentifier(
+                             std::move(object_digest_str)),
+                         storage::DataSource::Create(std::move(data), size)));
             current_get_object_calls_--;
           });
 }
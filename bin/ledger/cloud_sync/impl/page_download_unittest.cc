@@ -323,7 +323,8 @@ TEST_F(PageDownloadTest, DownloadIdleCallback) {
 
 // Verifies that sync correctly fetches objects from the cloud provider.
 TEST_F(PageDownloadTest, GetObject) {
-  page_cloud_.objects_to_return["object_digest"] = "content";
+  page_cloud_.objects_to_return["object_digest"] =
+      encryption_service_.EncryptObjectSynchronous("content");
   page_download_->StartDownload();
 
   bool called;
@@ -355,7 +356,8 @@ TEST_F(PageDownloadTest, RetryGetObject) {
     // Allow the operation to succeed after looping through five attempts.
     if (page_cloud_.get_object_calls == 5u) {
       page_cloud_.status_to_return = cloud_provider::Status::OK;
-      page_cloud_.objects_to_return["object_digest"] = "content";
+      page_cloud_.objects_to_return["object_digest"] =
+      encryption_service_.EncryptObjectSynchronous("content");
     }
   });
   bool called;
@@ -100,6 +100,10 @@ void PageSyncImpl::SetSyncWatcher(SyncStateWatcher* watcher) {
   }
 }
 
+UploadStats PageSyncImpl::GetUploadStats() {
+  return page_upload_->GetStats();
+}
+
 void PageSyncImpl::HandleError() {
   if (error_callback_already_called_) {
     return;
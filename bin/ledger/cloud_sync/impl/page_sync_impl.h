@@ -85,6 +85,8 @@ class PageSyncImpl : public PageSync,
 
   void SetSyncWatcher(SyncStateWatcher* watcher) override;
 
+  UploadStats GetUploadStats() override;
+
  private:
   void HandleError();
 
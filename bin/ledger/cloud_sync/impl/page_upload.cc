@@ -8,6 +8,13 @@
 #include "peridot/lib/callback/scoped_callback.h"
 
 namespace cloud_sync {
+namespace {
+// Bounds and initial value of the number of concurrent object uploads.
+constexpr size_t kMinConcurrentUploads = 2;
+constexpr size_t kMaxConcurrentUploads = 64;
+constexpr size_t kInitialConcurrentUploads = 10;
+}  // namespace
+
 PageUpload::PageUpload(callback::ScopedTaskRunner* task_runner,
                        storage::PageStorage* storage,
                        encryption::EncryptionService* encryption_service,
@@ -22,7 +29,12 @@ PageUpload::PageUpload(callback::ScopedTaskRunner* task_runner,
       log_prefix_("Page " + convert::ToHex(storage->GetId()) +
                   " upload sync: "),
       backoff_(std::move(backoff)),
-      weak_ptr_factory_(this) {}
+      concurrency_(kMinConcurrentUploads,
+                   kMaxConcurrentUploads,
+                   kInitialConcurrentUploads),
+      weak_ptr_factory_(this) {
+  stats_.concurrent_uploads_limit = concurrency_.limit();
+}
 
 PageUpload::~PageUpload() {}
 
@@ -45,6 +57,7 @@ void PageUpload::OnNewCommits(
   }
 
   commits_to_upload_ = true;
+  new_commits_since_batch_ = true;
   if (!delegate_->IsDownloadIdle()) {
     // If a commit batch is currently being downloaded, don't try to start the
     // upload.
@@ -55,6 +68,7 @@ void PageUpload::OnNewCommits(
   } else {
     SetState(UPLOAD_PENDING);
     UploadUnsyncedCommits();
+    MaybeStartObjectUpload();
   }
 }
 
@@ -64,8 +78,9 @@ void PageUpload::UploadUnsyncedCommits() {
     return;
   }
 
-  if (batch_upload_) {
-    // If we are already uploading a commit batch, return early.
+  if (batch_upload_ || object_upload_) {
+    // If we are already uploading a commit batch, return early. The upload
+    // resumes once the pending uploads are done.
     return;
   }
 
@@ -74,6 +89,7 @@ void PageUpload::UploadUnsyncedCommits() {
   // TODO(ppi): either switch to a paginating API or (better?) ensure that long
   // backlogs of local commits are squashed in storage, as otherwise the list of
   // commits can be possibly very big.
+  new_commits_since_batch_ = false;
   storage_->GetUnsyncedCommits(callback::MakeScoped(
       weak_ptr_factory_.GetWeakPtr(),
       [this](storage::Status status,
@@ -111,7 +127,7 @@ void PageUpload::VerifyUnsyncedCommits(
           HandleError("Failed to retrieve the current heads");
           return;
         }
-        if (batch_upload_) {
+        if (batch_upload_ || object_upload_) {
           // If we are already uploading a commit batch, return early.
           return;
         }
@@ -146,9 +162,13 @@ void PageUpload::HandleUnsyncedCommits(
         // Upload succeeded, reset the backoff delay.
         backoff_->Reset();
         batch_upload_.reset();
+        batch_uploading_commits_ = false;
         UploadUnsyncedCommits();
       },
       [this](BatchUpload::ErrorType error_type) {
+        // Objects uploaded ahead of their commits are uploaded again with
+        // the next batch if needed.
+        object_upload_.reset();
         switch (error_type) {
           case BatchUpload::ErrorType::TEMPORARY: {
             FXL_LOG(WARNING)
@@ -156,6 +176,7 @@ void PageUpload::HandleUnsyncedCommits(
                 << "commit upload failed due to a connection error, retrying.";
             SetState(UPLOAD_TEMPORARY_ERROR);
             batch_upload_.reset();
+            batch_uploading_commits_ = false;
             RetryWithBackoff([this] { UploadUnsyncedCommits(); });
           } break;
           case BatchUpload::ErrorType::PERMANENT: {
@@ -164,10 +185,58 @@ void PageUpload::HandleUnsyncedCommits(
             SetState(UPLOAD_PERMANENT_ERROR);
           } break;
         }
-      });
+      },
+      kMaxConcurrentUploads, &concurrency_, &stats_);
+  batch_upload_->SetOnObjectsUploaded([this] {
+    batch_uploading_commits_ = true;
+    MaybeStartObjectUpload();
+  });
   batch_upload_->Start();
 }
 
+void PageUpload::MaybeStartObjectUpload() {
+  if (!batch_upload_ || !batch_uploading_commits_ || object_upload_ ||
+      !new_commits_since_batch_) {
+    return;
+  }
+  // The objects of the new commits do not depend on the commits being
+  // uploaded, and can be uploaded right away. Their commits are uploaded with
+  // the next batch, once the current one is done.
+  new_commits_since_batch_ = false;
+  object_upload_ = std::make_unique<BatchUpload>(
+      storage_, encryption_service_, page_cloud_,
+      std::vector<std::unique_ptr<const storage::Commit>>(),
+      [this] {
+        object_upload_.reset();
+        OnObjectUploadDone();
+      },
+      [this](BatchUpload::ErrorType error_type) {
+        object_upload_.reset();
+        switch (error_type) {
+          case BatchUpload::ErrorType::TEMPORARY: {
+            // The remaining objects are uploaded with the next batch.
+            OnObjectUploadDone();
+          } break;
+          case BatchUpload::ErrorType::PERMANENT: {
+            FXL_LOG(WARNING) << log_prefix_
+                             << "object upload failed with a permanent error.";
+            SetState(UPLOAD_PERMANENT_ERROR);
+          } break;
+        }
+      },
+      kMaxConcurrentUploads, &concurrency_, &stats_);
+  object_upload_->Start();
+}
+
+void PageUpload::OnObjectUploadDone() {
+  if (batch_upload_) {
+    // The current batch is still uploading its commits.
+    MaybeStartObjectUpload();
+    return;
+  }
+  UploadUnsyncedCommits();
+}
+
 void PageUpload::HandleError(const char error_description[]) {
   FXL_LOG(ERROR) << log_prefix_ << error_description << " Stopping sync.";
   if (state_ > UPLOAD_SETUP) {
@@ -194,6 +263,10 @@ void PageUpload::SetState(UploadSyncState new_state) {
   delegate_->SetUploadState(state_);
 }
 
+UploadStats PageUpload::GetStats() const {
+  return stats_;
+}
+
 bool PageUpload::IsIdle() {
   switch (state_) {
     case UPLOAD_STOPPED:
@@ -11,7 +11,9 @@
 #include "lib/cloud_provider/fidl/cloud_provider.fidl.h"
 #include "lib/fxl/memory/weak_ptr.h"
 #include "peridot/bin/ledger/cloud_sync/impl/batch_upload.h"
+#include "peridot/bin/ledger/cloud_sync/impl/upload_concurrency.h"
 #include "peridot/bin/ledger/cloud_sync/public/sync_state_watcher.h"
+#include "peridot/bin/ledger/cloud_sync/public/upload_stats.h"
 #include "peridot/bin/ledger/encryption/public/encryption_service.h"
 #include "peridot/bin/ledger/storage/public/commit.h"
 #include "peridot/bin/ledger/storage/public/commit_watcher.h"
@@ -21,6 +23,11 @@
 
 namespace cloud_sync {
 // PageUpload handles all the upload operations for a page.
+//
+// Commit batches are uploaded one at a time, to preserve the order of commits
+// in the cloud. While the commits of a batch are being uploaded, the objects
+// of the commits created since the batch started are uploaded in parallel, so
+// that the next batch only has its commits left to upload.
 class PageUpload : public storage::CommitWatcher {
  public:
   // Delegate ensuring coordination between PageUpload and the class that owns
@@ -50,6 +57,9 @@ class PageUpload : public storage::CommitWatcher {
   // Returns true if PageUpload is idle.
   bool IsIdle();
 
+  // Returns the upload statistics of the page.
+  UploadStats GetStats() const;
+
  private:
   // storage::CommitWatcher:
   void OnNewCommits(
@@ -62,6 +72,11 @@ class PageUpload : public storage::CommitWatcher {
   void HandleUnsyncedCommits(
       std::vector<std::unique_ptr<const storage::Commit>> commits);
 
+  // Starts uploading the objects of the new local commits if the current batch
+  // is uploading its commits.
+  void MaybeStartObjectUpload();
+  void OnObjectUploadDone();
+
   // Sets the internal state.
   void SetState(UploadSyncState new_state);
 
@@ -79,11 +94,22 @@ class PageUpload : public storage::CommitWatcher {
 
   std::unique_ptr<backoff::Backoff> backoff_;
 
+  UploadConcurrency concurrency_;
+  UploadStats stats_;
+
   // Work queue:
   // Current batch of local commits being uploaded.
   std::unique_ptr<BatchUpload> batch_upload_;
+  // Set to true once all objects of |batch_upload_| are uploaded.
+  bool batch_uploading_commits_ = false;
+  // Upload of the objects of commits created after |batch_upload_| started,
+  // without their commits.
+  std::unique_ptr<BatchUpload> object_upload_;
   // Set to true when there are new commits to upload.
   bool commits_to_upload_ = false;
+  // Set to true when new commits have been created since the last time the
+  // list of unsynced commits or objects was retrieved.
+  bool new_commits_since_batch_ = false;
 
   // Internal state.
   UploadSyncState state_ = UPLOAD_STOPPED;
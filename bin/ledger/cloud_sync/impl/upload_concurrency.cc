@@ -0,0 +1,75 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "peridot/bin/ledger/cloud_sync/impl/upload_concurrency.h"
+
+#include <algorithm>
+
+#include "lib/fxl/logging.h"
+
+namespace cloud_sync {
+
+namespace {
+// Number of uploads of a size class after which its smallest latency is
+// measured again.
+constexpr size_t kLatencyWindowSize = 64;
+
+size_t GetSizeClass(size_t size) {
+  size_t size_class = 0u;
+  while (size >>= 1) {
+    ++size_class;
+  }
+  return size_class;
+}
+}  // namespace
+
+UploadConcurrency::UploadConcurrency(size_t min_limit,
+                                     size_t max_limit,
+                                     size_t initial_limit)
+    : min_limit_(min_limit), max_limit_(max_limit), limit_(initial_limit) {
+  FXL_DCHECK(min_limit > 0u);
+  FXL_DCHECK(min_limit <= initial_limit);
+  FXL_DCHECK(initial_limit <= max_limit);
+}
+
+UploadConcurrency::~UploadConcurrency() {}
+
+size_t UploadConcurrency::limit() const {
+  return limit_;
+}
+
+void UploadConcurrency::OnUploadSucceeded(size_t size,
+                                          fxl::TimeDelta latency) {
+  fxl::TimeDelta min_latency =
+      UpdateMinLatency(&min_latencies_[GetSizeClass(size)], latency);
+  if (latency > min_latency * 2) {
+    // Uploads are queuing up: the link is already in use.
+    return;
+  }
+  if (++successes_ < limit_) {
+    return;
+  }
+  successes_ = 0u;
+  limit_ = std::min(max_limit_, limit_ + 1);
+}
+
+void UploadConcurrency::OnUploadFailed() {
+  successes_ = 0u;
+  limit_ = std::max(min_limit_, limit_ / 2);
+}
+
+fxl::TimeDelta UploadConcurrency::UpdateMinLatency(LatencyFilter* filter,
+                                                   fxl::TimeDelta latency) {
+  filter->window_min = std::min(filter->window_min, latency);
+  fxl::TimeDelta min_latency =
+      std::min(filter->window_min, filter->previous_window_min);
+  if (++filter->window_samples == kLatencyWindowSize) {
+    filter->previous_window_min = filter->window_min;
+    filter->window_min = fxl::TimeDelta::Max();
+    filter->window_samples = 0u;
+  }
+  return min_latency;
+}
+
+}  // namespace cloud_sync
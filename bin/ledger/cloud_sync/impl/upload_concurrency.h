@@ -0,0 +1,68 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef PERIDOT_BIN_LEDGER_CLOUD_SYNC_IMPL_UPLOAD_CONCURRENCY_H_
+#define PERIDOT_BIN_LEDGER_CLOUD_SYNC_IMPL_UPLOAD_CONCURRENCY_H_
+
+#include <stddef.h>
+
+#include <map>
+
+#include "lib/fxl/macros.h"
+#include "lib/fxl/time/time_delta.h"
+
+namespace cloud_sync {
+
+// Adapts the number of object uploads that can run concurrently to the
+// observed network conditions.
+//
+// The limit follows an additive increase, multiplicative decrease scheme: it
+// increases by one after |limit| successful uploads whose latency stays below
+// twice the smallest recent latency of uploads of similar size, and each
+// failed upload halves it. The limit thus grows by about one per round trip on
+// a link with spare capacity, in particular on high-latency links where few
+// concurrent uploads leave the link mostly idle, and stops growing as soon as
+// uploads start queuing up.
+class UploadConcurrency {
+ public:
+  UploadConcurrency(size_t min_limit, size_t max_limit, size_t initial_limit);
+  ~UploadConcurrency();
+
+  // Returns the current maximal number of concurrent uploads.
+  size_t limit() const;
+
+  // Reports a successful upload of |size| bytes that took |latency|.
+  void OnUploadSucceeded(size_t size, fxl::TimeDelta latency);
+
+  // Reports a failed upload.
+  void OnUploadFailed();
+
+ private:
+  // The smallest latency of the uploads of a size class, over the current and
+  // the previous windows of samples. It approximates the latency of such an
+  // upload on an idle link, and follows the link when its conditions change.
+  struct LatencyFilter {
+    fxl::TimeDelta window_min = fxl::TimeDelta::Max();
+    fxl::TimeDelta previous_window_min = fxl::TimeDelta::Max();
+    size_t window_samples = 0u;
+  };
+
+  // Adds |latency| to |filter| and returns the updated minimal latency.
+  static fxl::TimeDelta UpdateMinLatency(LatencyFilter* filter,
+                                         fxl::TimeDelta latency);
+
+  const size_t min_limit_;
+  const size_t max_limit_;
+  size_t limit_;
+  // Number of successful uploads since the last increase of |limit_|.
+  size_t successes_ = 0u;
+  // Latency filters, indexed by the binary logarithm of the upload sizes.
+  std::map<size_t, LatencyFilter> min_latencies_;
+
+  FXL_DISALLOW_COPY_AND_ASSIGN(UploadConcurrency);
+};
+
+}  // namespace cloud_sync
+
+#endif  // PERIDOT_BIN_LEDGER_CLOUD_SYNC_IMPL_UPLOAD_CONCURRENCY_H_
@@ -0,0 +1,96 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "peridot/bin/ledger/cloud_sync/impl/upload_concurrency.h"
+
+#include "gtest/gtest.h"
+
+namespace cloud_sync {
+namespace {
+
+constexpr size_t kSize = 1024;
+
+TEST(UploadConcurrencyTest, GrowsOnSuccess) {
+  UploadConcurrency concurrency(1, 4, 1);
+  EXPECT_EQ(1u, concurrency.limit());
+
+  // The limit grows by one for each |limit| successful uploads.
+  concurrency.OnUploadSucceeded(kSize, fxl::TimeDelta::FromMilliseconds(100));
+  EXPECT_EQ(2u, concurrency.limit());
+  concurrency.OnUploadSucceeded(kSize, fxl::TimeDelta::FromMilliseconds(100));
+  EXPECT_EQ(2u, concurrency.limit());
+  concurrency.OnUploadSucceeded(kSize, fxl::TimeDelta::FromMilliseconds(100));
+  EXPECT_EQ(3u, concurrency.limit());
+
+  // The limit is bounded.
+  for (int i = 0; i < 100; ++i) {
+    concurrency.OnUploadSucceeded(kSize, fxl::TimeDelta::FromMilliseconds(100));
+  }
+  EXPECT_EQ(4u, concurrency.limit());
+}
+
+TEST(UploadConcurrencyTest, ShrinksOnFailure) {
+  UploadConcurrency concurrency(2, 64, 16);
+  concurrency.OnUploadFailed();
+  EXPECT_EQ(8u, concurrency.limit());
+  concurrency.OnUploadFailed();
+  concurrency.OnUploadFailed();
+  concurrency.OnUploadFailed();
+  EXPECT_EQ(2u, concurrency.limit());
+}
+
+TEST(UploadConcurrencyTest, DoesNotGrowWhenLatencyIncreases) {
+  UploadConcurrency concurrency(1, 64, 4);
+  concurrency.OnUploadSucceeded(kSize, fxl::TimeDelta::FromMilliseconds(100));
+  size_t limit = concurrency.limit();
+
+  // Uploads are queuing up: the limit stays the same.
+  for (int i = 0; i < 10; ++i) {
+    concurrency.OnUploadSucceeded(kSize, fxl::TimeDelta::FromMilliseconds(500));
+  }
+  EXPECT_EQ(limit, concurrency.limit());
+}
+
+TEST(UploadConcurrencyTest, ComparesLatencyOfUploadsOfSimilarSize) {
+  UploadConcurrency concurrency(1, 64, 1);
+  concurrency.OnUploadSucceeded(kSize, fxl::TimeDelta::FromMilliseconds(100));
+  EXPECT_EQ(2u, concurrency.limit());
+
+  // Larger uploads take longer without the link being congested.
+  for (int i = 0; i < 4; ++i) {
+    concurrency.OnUploadSucceeded(1024 * kSize,
+                                  fxl::TimeDelta::FromMilliseconds(1000));
+  }
+  EXPECT_EQ(3u, concurrency.limit());
+
+  // Small uploads taking longer still indicate a congested link.
+  for (int i = 0; i < 10; ++i) {
+    concurrency.OnUploadSucceeded(kSize,
+                                  fxl::TimeDelta::FromMilliseconds(1000));
+  }
+  EXPECT_EQ(3u, concurrency.limit());
+}
+
+TEST(UploadConcurrencyTest, FollowsLatencyChanges) {
+  UploadConcurrency concurrency(1, 1000, 1000);
+  concurrency.OnUploadSucceeded(kSize, fxl::TimeDelta::FromMilliseconds(100));
+  concurrency.OnUploadFailed();
+  EXPECT_EQ(500u, concurrency.limit());
+
+  // The latency of the link increases: the limit stops growing until the
+  // previous latency is forgotten.
+  for (int i = 0; i < 500; ++i) {
+    concurrency.OnUploadSucceeded(kSize,
+                                  fxl::TimeDelta::FromMilliseconds(300));
+  }
+  EXPECT_EQ(500u, concurrency.limit());
+  for (int i = 0; i < 500; ++i) {
+    concurrency.OnUploadSucceeded(kSize,
+                                  fxl::TimeDelta::FromMilliseconds(300));
+  }
+  EXPECT_EQ(501u, concurrency.limit());
+}
+
+}  // namespace
+}  // namespace cloud_sync
@@ -10,6 +10,7 @@
 #include "lib/fxl/functional/closure.h"
 #include "lib/fxl/macros.h"
 #include "peridot/bin/ledger/cloud_sync/public/sync_state_watcher.h"
+#include "peridot/bin/ledger/cloud_sync/public/upload_stats.h"
 
 namespace cloud_sync {
 
@@ -47,6 +48,9 @@ class PageSync {
   // Sets a watcher for the synchronization state of this page.
   virtual void SetSyncWatcher(SyncStateWatcher* watcher) = 0;
 
+  // Returns the statistics of the upload of this page to the cloud.
+  virtual UploadStats GetUploadStats() = 0;
+
  private:
   FXL_DISALLOW_COPY_AND_ASSIGN(PageSync);
 };
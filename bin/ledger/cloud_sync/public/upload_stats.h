@@ -0,0 +1,39 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef PERIDOT_BIN_LEDGER_CLOUD_SYNC_PUBLIC_UPLOAD_STATS_H_
+#define PERIDOT_BIN_LEDGER_CLOUD_SYNC_PUBLIC_UPLOAD_STATS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "lib/fxl/time/time_delta.h"
+
+namespace cloud_sync {
+
+// Counters describing the upload of a page to the cloud since the page sync
+// was started.
+struct UploadStats {
+  // Number of objects successfully uploaded, and their total size.
+  uint64_t objects_uploaded = 0u;
+  uint64_t object_bytes_uploaded = 0u;
+  // Number of commits successfully uploaded, and the number of requests used
+  // to upload them.
+  uint64_t commits_uploaded = 0u;
+  uint64_t commit_batches_uploaded = 0u;
+  // Number of object and commit upload requests that failed.
+  uint64_t failed_uploads = 0u;
+  // Total time during which at least one object upload was in progress. The
+  // object upload throughput is |object_bytes_uploaded| divided by this time.
+  fxl::TimeDelta object_upload_time;
+  // Sum of the latencies of the successful object and commit uploads.
+  fxl::TimeDelta total_object_upload_latency;
+  fxl::TimeDelta total_commit_upload_latency;
+  // Current maximal number of concurrent object uploads.
+  size_t concurrent_uploads_limit = 0u;
+};
+
+}  // namespace cloud_sync
+
+#endif  // PERIDOT_BIN_LEDGER_CLOUD_SYNC_PUBLIC_UPLOAD_STATS_H_
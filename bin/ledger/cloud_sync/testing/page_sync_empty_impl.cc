@@ -30,4 +30,9 @@ void PageSyncEmptyImpl::SetSyncWatcher(SyncStateWatcher* /*watcher*/) {
   FXL_NOTIMPLEMENTED();
 }
 
+UploadStats PageSyncEmptyImpl::GetUploadStats() {
+  FXL_NOTIMPLEMENTED();
+  return UploadStats();
+}
+
 }  // namespace cloud_sync
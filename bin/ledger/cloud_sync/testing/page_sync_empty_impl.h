@@ -18,6 +18,7 @@ class PageSyncEmptyImpl : public PageSync {
   void SetOnBacklogDownloaded(
       fxl::Closure on_backlog_downloaded_callback) override;
   void SetSyncWatcher(SyncStateWatcher* watcher) override;
+  UploadStats GetUploadStats() override;
 };
 
 }  // namespace cloud_sync
@@ -4,6 +4,7 @@
 
 #include "peridot/bin/ledger/encryption/fake/fake_encryption_service.h"
 
+#include "lib/fsl/vmo/strings.h"
 #include "lib/fxl/functional/make_copyable.h"
 #include "lib/fxl/strings/concatenate.h"
 
@@ -77,6 +78,46 @@ void FakeEncryptionService::DecryptObject(
       });
 }
 
+void FakeEncryptionService::EncryptObjectToVmo(
+    std::unique_ptr<const storage::Object> object,
+    std::function<void(Status, fsl::SizedVmo)> callback) {
+  fsl::SizedVmo vmo;
+  Status status = Status::OK;
+  if (!fsl::VmoFromString(EncryptObjectSynchronous(std::move(object)), &vmo)) {
+    status = Status::INTERNAL_ERROR;
+  }
+  task_runner_->PostTask(fxl::MakeCopyable(
+      [callback = std::move(callback), status, vmo = std::move(vmo)]() mutable {
+        callback(status, std::move(vmo));
+      }));
+}
+
+std::unique_ptr<storage::DataSource> FakeEncryptionService::DecryptObjectStream(
+    storage::ObjectIdentifier /*object_identifier*/,
+    std::unique_ptr<storage::DataSource> encrypted_data) {
+  uint64_t size = encrypted_data->GetSize();
+  // Removes the first and last characters of the data. The last character
+  // received so far is held back until the next chunk.
+  return storage::DataSource::Transform(
+      std::move(encrypted_data), size < 2 ? 0 : size - 2,
+      [first = true, held = std::string()](
+          fxl::StringView chunk, bool last, std::string* output) mutable {
+        std::string data = held + chunk.ToString();
+        held.clear();
+        if (first && !data.empty()) {
+          data.erase(0, 1);
+          first = false;
+        }
+        if (data.empty()) {
+          return !last;
+        }
+        held = data.substr(data.size() - 1);
+        data.resize(data.size() - 1);
+        output->append(data);
+        return true;
+      });
+}
+
 std::string FakeEncryptionService::EncryptCommitSynchronous(
     convert::ExtendedStringView commit_storage) {
   return Encode(commit_storage);
@@ -102,6 +143,11 @@ std::string FakeEncryptionService::EncryptObjectSynchronous(
   return Encode(data);
 }
 
+std::string FakeEncryptionService::EncryptObjectSynchronous(
+    convert::ExtendedStringView object_data) {
+  return Encode(object_data);
+}
+
 std::string FakeEncryptionService::DecryptObjectSynchronous(
     storage::ObjectIdentifier /*object_identifier*/,
     std::string encrypted_data) {
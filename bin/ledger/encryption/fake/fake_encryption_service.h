@@ -36,6 +36,12 @@ class FakeEncryptionService : public EncryptionService {
       storage::ObjectIdentifier object_identifier,
       std::string encrypted_data,
       std::function<void(Status, std::string)> callback) override;
+  void EncryptObjectToVmo(
+      std::unique_ptr<const storage::Object> object,
+      std::function<void(Status, fsl::SizedVmo)> callback) override;
+  std::unique_ptr<storage::DataSource> DecryptObjectStream(
+      storage::ObjectIdentifier object_identifier,
+      std::unique_ptr<storage::DataSource> encrypted_data) override;
 
   // Synchronously encrypts the given commit.
   std::string EncryptCommitSynchronous(
@@ -53,6 +59,9 @@ class FakeEncryptionService : public EncryptionService {
   std::string EncryptObjectSynchronous(
       std::unique_ptr<const storage::Object> object);
 
+  // Synchronously encrypts the given object data.
+  std::string EncryptObjectSynchronous(convert::ExtendedStringView object_data);
+
   // Synchronously decrypts the object.
   std::string DecryptObjectSynchronous(
       storage::ObjectIdentifier object_identifier,
@@ -8,6 +8,7 @@
 
 #include "lib/fxl/functional/make_copyable.h"
 #include "lib/fxl/logging.h"
+#include "zx/vmo.h"
 #include "peridot/bin/ledger/encryption/impl/encrypted_commit_generated.h"
 #include "peridot/bin/ledger/storage/public/constants.h"
 
@@ -23,6 +24,9 @@ bool CheckValidSerialization(fxl::StringView storage_bytes) {
   return VerifyEncryptedCommitStorageBuffer(verifier);
 }
 
+// Size of the blocks in which objects are encrypted.
+constexpr size_t kObjectBlockSize = 64 * 1024;
+
 Status ToEncryptionStatus(storage::Status status) {
   if (status == storage::Status::OK) {
     return Status::OK;
@@ -120,4 +124,45 @@ void EncryptionServiceImpl::DecryptObject(
   });
 }
 
+void EncryptionServiceImpl::EncryptObjectToVmo(
+    std::unique_ptr<const storage::Object> object,
+    std::function<void(Status, fsl::SizedVmo)> callback) {
+  // Ensures the callback is asynchronous.
+  task_runner_.PostTask(fxl::MakeCopyable(
+      [callback = std::move(callback), object = std::move(object)]() mutable {
+        fxl::StringView data;
+        Status status = ToEncryptionStatus(object->GetData(&data));
+        if (status != Status::OK) {
+          callback(status, fsl::SizedVmo());
+          return;
+        }
+        zx::vmo vmo;
+        if (zx::vmo::create(data.size(), 0, &vmo) != ZX_OK) {
+          callback(Status::INTERNAL_ERROR, fsl::SizedVmo());
+          return;
+        }
+        for (size_t offset = 0; offset < data.size();
+             offset += kObjectBlockSize) {
+          fxl::StringView block = data.substr(offset, kObjectBlockSize);
+          // TODO(qsr): Replace with real encryption of |block|.
+          size_t written_size;
+          if (vmo.write(block.data(), offset, block.size(), &written_size) !=
+                  ZX_OK ||
+              written_size != block.size()) {
+            callback(Status::INTERNAL_ERROR, fsl::SizedVmo());
+            return;
+          }
+        }
+        callback(Status::OK, fsl::SizedVmo(std::move(vmo), data.size()));
+      }));
+}
+
+std::unique_ptr<storage::DataSource> EncryptionServiceImpl::DecryptObjectStream(
+    storage::ObjectIdentifier /*object_identifier*/,
+    std::unique_ptr<storage::DataSource> encrypted_data) {
+  // TODO(qsr): Replace with real decryption, using
+  // storage::DataSource::Transform.
+  return encrypted_data;
+}
+
 }  // namespace encryption
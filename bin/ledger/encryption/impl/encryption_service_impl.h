@@ -37,6 +37,12 @@ class EncryptionServiceImpl : public EncryptionService {
       storage::ObjectIdentifier object_identifier,
       std::string encrypted_data,
       std::function<void(Status, std::string)> callback) override;
+  void EncryptObjectToVmo(
+      std::unique_ptr<const storage::Object> object,
+      std::function<void(Status, fsl::SizedVmo)> callback) override;
+  std::unique_ptr<storage::DataSource> DecryptObjectStream(
+      storage::ObjectIdentifier object_identifier,
+      std::unique_ptr<storage::DataSource> encrypted_data) override;
 
  private:
   callback::ScopedTaskRunner task_runner_;
@@ -5,6 +5,7 @@
 #include "peridot/bin/ledger/encryption/impl/encryption_service_impl.h"
 
 #include "gtest/gtest.h"
+#include "lib/fsl/vmo/strings.h"
 #include "peridot/bin/ledger/storage/fake/fake_object.h"
 #include "peridot/lib/callback/capture.h"
 #include "peridot/lib/gtest/test_with_message_loop.h"
@@ -61,6 +62,35 @@ class EncryptionServiceTest : public gtest::TestWithMessageLoop {
     EXPECT_FALSE(RunLoopWithTimeout());
   }
 
+  void EncryptObjectToVmo(std::unique_ptr<const storage::Object> object,
+                          Status* status,
+                          fsl::SizedVmo* result) {
+    encryption_service_.EncryptObjectToVmo(
+        std::move(object), callback::Capture(MakeQuitTask(), status, result));
+    EXPECT_FALSE(RunLoopWithTimeout());
+  }
+
+  // Reads all the data of |data_source|. Returns false on error.
+  bool ReadDataSource(storage::DataSource* data_source, std::string* result) {
+    bool success = false;
+    result->clear();
+    data_source->Get([this, &success, result](
+                         std::unique_ptr<storage::DataSource::DataChunk> chunk,
+                         storage::DataSource::Status status) {
+      if (status == storage::DataSource::Status::ERROR) {
+        message_loop_.PostQuitTask();
+        return;
+      }
+      result->append(chunk->Get().data(), chunk->Get().size());
+      if (status == storage::DataSource::Status::DONE) {
+        success = true;
+        message_loop_.PostQuitTask();
+      }
+    });
+    EXPECT_FALSE(RunLoopWithTimeout());
+    return success;
+  }
+
   EncryptionServiceImpl encryption_service_;
 };
 
@@ -110,5 +140,26 @@ TEST_F(EncryptionServiceTest, EncryptDecryptObject) {
   EXPECT_EQ(content, decrypted_bytes);
 }
 
+TEST_F(EncryptionServiceTest, EncryptDecryptObjectStream) {
+  storage::ObjectIdentifier identifier{42u, 42u, std::string(33u, '\0')};
+  // Spans several encryption blocks.
+  std::string content(200 * 1024u, 'a');
+
+  Status status;
+  fsl::SizedVmo encrypted_vmo;
+  EncryptObjectToVmo(
+      std::make_unique<storage::fake::FakeObject>(identifier, content), &status,
+      &encrypted_vmo);
+  ASSERT_EQ(Status::OK, status);
+
+  std::unique_ptr<storage::DataSource> decrypted_source =
+      encryption_service_.DecryptObjectStream(
+          identifier, storage::DataSource::Create(std::move(encrypted_vmo)));
+  EXPECT_EQ(content.size(), decrypted_source->GetSize());
+  std::string decrypted_bytes;
+  ASSERT_TRUE(ReadDataSource(decrypted_source.get(), &decrypted_bytes));
+  EXPECT_EQ(content, decrypted_bytes);
+}
+
 }  // namespace
 }  // namespace encryption
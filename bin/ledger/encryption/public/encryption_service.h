@@ -6,9 +6,12 @@
 #define PERIDOT_BIN_LEDGER_ENCRYPTION_PUBLIC_ENCRYPTION_SERVICE_H_
 
 #include <functional>
+#include <memory>
 #include <string>
 
+#include "lib/fsl/vmo/sized_vmo.h"
 #include "lib/fxl/macros.h"
+#include "peridot/bin/ledger/storage/public/data_source.h"
 #include "peridot/bin/ledger/storage/public/object.h"
 #include "peridot/bin/ledger/storage/public/types.h"
 #include "peridot/lib/convert/convert.h"
@@ -58,6 +61,19 @@ class EncryptionService {
       std::string encrypted_data,
       std::function<void(Status, std::string)> callback) = 0;
 
+  // Encrypts the given object into a vmo. The data is encrypted block by
+  // block, directly into the vmo, without intermediate copies of the object.
+  virtual void EncryptObjectToVmo(
+      std::unique_ptr<const storage::Object> object,
+      std::function<void(Status, fsl::SizedVmo)> callback) = 0;
+
+  // Returns a data source streaming the decryption of |encrypted_data|, the
+  // encrypted content of the object with the given identifier. The data is
+  // decrypted chunk by chunk, as it is received.
+  virtual std::unique_ptr<storage::DataSource> DecryptObjectStream(
+      storage::ObjectIdentifier object_identifier,
+      std::unique_ptr<storage::DataSource> encrypted_data) = 0;
+
  private:
   FXL_DISALLOW_COPY_AND_ASSIGN(EncryptionService);
 };
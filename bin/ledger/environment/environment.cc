@@ -11,14 +11,22 @@
 namespace ledger {
 
 Environment::Environment(fxl::RefPtr<fxl::TaskRunner> main_runner,
-                         fxl::RefPtr<fxl::TaskRunner> io_runner)
+                         fxl::RefPtr<fxl::TaskRunner> io_runner,
+                         fxl::RefPtr<fxl::TaskRunner> db_runner)
     : main_runner_(std::move(main_runner)),
       coroutine_service_(std::make_unique<coroutine::CoroutineServiceImpl>()),
-      io_runner_(std::move(io_runner)) {
+      io_runner_(std::move(io_runner)),
+      db_runner_(std::move(db_runner)) {
   FXL_DCHECK(main_runner_);
 }
 
 Environment::~Environment() {
+  // The tasks already posted to the database thread, such as the closing of
+  // the databases, run before it quits.
+  if (db_thread_.joinable()) {
+    db_runner_->PostTask([] { fsl::MessageLoop::GetCurrent()->QuitNow(); });
+    db_thread_.join();
+  }
   if (io_thread_.joinable()) {
     io_runner_->PostTask([] { fsl::MessageLoop::GetCurrent()->QuitNow(); });
     io_thread_.join();
@@ -32,4 +40,11 @@ const fxl::RefPtr<fxl::TaskRunner> Environment::GetIORunner() {
   return io_runner_;
 }
 
+const fxl::RefPtr<fxl::TaskRunner> Environment::GetDbRunner() {
+  if (!db_runner_) {
+    db_thread_ = fsl::CreateThread(&db_runner_, "db thread");
+  }
+  return db_runner_;
+}
+
 }  // namespace ledger
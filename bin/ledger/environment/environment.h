@@ -10,6 +10,7 @@
 #include "lib/fxl/macros.h"
 #include "lib/fxl/memory/weak_ptr.h"
 #include "lib/fxl/tasks/task_runner.h"
+#include "lib/fxl/time/time_delta.h"
 #include "peridot/bin/ledger/coroutine/coroutine.h"
 
 namespace ledger {
@@ -18,7 +19,8 @@ namespace ledger {
 class Environment {
  public:
   explicit Environment(fxl::RefPtr<fxl::TaskRunner> main_runner,
-                       fxl::RefPtr<fxl::TaskRunner> io_runner = nullptr);
+                       fxl::RefPtr<fxl::TaskRunner> io_runner = nullptr,
+                       fxl::RefPtr<fxl::TaskRunner> db_runner = nullptr);
   ~Environment();
 
   const fxl::RefPtr<fxl::TaskRunner> main_runner() { return main_runner_; }
@@ -31,6 +33,41 @@ class Environment {
   // should be used to access the file system.
   const fxl::RefPtr<fxl::TaskRunner> GetIORunner();
 
+  // Returns a TaskRunner allowing to access the database thread. All the
+  // accesses to the local databases run on this thread, in the order in which
+  // they are posted, so that they are neither blocked by nor block the other
+  // file system work of the I/O thread.
+  const fxl::RefPtr<fxl::TaskRunner> GetDbRunner();
+
+  // Delay during which the changes made on a page outside of any transaction
+  // are accumulated in a single commit. A zero delay commits every change on
+  // its own.
+  fxl::TimeDelta implicit_commit_window() const {
+    return implicit_commit_window_;
+  }
+  void set_implicit_commit_window(fxl::TimeDelta implicit_commit_window) {
+    implicit_commit_window_ = implicit_commit_window;
+  }
+
+  // Whether the content of the pieces of objects is compressed when stored by
+  // pages created from now on. Pieces are always sent to the cloud
+  // uncompressed.
+  bool compress_pieces() const { return compress_pieces_; }
+  void set_compress_pieces(bool compress_pieces) {
+    compress_pieces_ = compress_pieces;
+  }
+
+  // Whether all the pages of a ledger are stored in a single database.
+  bool shared_page_db() const { return shared_page_db_; }
+  void set_shared_page_db(bool shared_page_db) {
+    shared_page_db_ = shared_page_db;
+  }
+
+  // Whether large objects are stored in files, from which they are handed out
+  // without being copied.
+  bool blob_store() const { return blob_store_; }
+  void set_blob_store(bool blob_store) { blob_store_ = blob_store; }
+
  private:
   fxl::RefPtr<fxl::TaskRunner> main_runner_;
   std::unique_ptr<coroutine::CoroutineService> coroutine_service_;
@@ -38,6 +75,14 @@ class Environment {
   std::thread io_thread_;
   fxl::RefPtr<fxl::TaskRunner> io_runner_;
 
+  std::thread db_thread_;
+  fxl::RefPtr<fxl::TaskRunner> db_runner_;
+
+  fxl::TimeDelta implicit_commit_window_;
+  bool compress_pieces_ = false;
+  bool shared_page_db_ = false;
+  bool blob_store_ = false;
+
   FXL_DISALLOW_COPY_AND_ASSIGN(Environment);
 };
 
@@ -34,5 +34,17 @@ TEST(Environment, DefaultIOThread) {
   EXPECT_EQ(1, value);
 }
 
+TEST(Environment, DefaultDbThread) {
+  fsl::MessageLoop loop;
+  int value = 0;
+  {
+    Environment env(loop.task_runner());
+    auto db_runner = env.GetDbRunner();
+    EXPECT_NE(db_runner, env.GetIORunner());
+    db_runner->PostTask([&value] { value = 1; });
+  }
+  EXPECT_EQ(1, value);
+}
+
 }  // namespace
 }  // namespace ledger
@@ -19,6 +19,7 @@
 #include "peridot/bin/ledger/storage/fake/fake_object.h"
 #include "peridot/bin/ledger/storage/public/constants.h"
 #include "peridot/bin/ledger/storage/public/make_object_identifier.h"
+#include "peridot/lib/callback/waiter.h"
 
 namespace storage {
 namespace fake {
@@ -169,6 +170,17 @@ void FakePageStorage::AddObjectFromLocal(
       }));
 }
 
+void FakePageStorage::AddObjectsFromLocal(
+    std::vector<std::unique_ptr<DataSource>> data_sources,
+    std::function<void(Status, std::vector<ObjectIdentifier>)> callback) {
+  auto waiter =
+      callback::Waiter<Status, ObjectIdentifier>::Create(Status::OK);
+  for (auto& data_source : data_sources) {
+    AddObjectFromLocal(std::move(data_source), waiter->NewCallback());
+  }
+  waiter->Finalize(std::move(callback));
+}
+
 void FakePageStorage::GetObject(
     ObjectIdentifier object_identifier,
     Location /*location*/,
@@ -195,8 +207,15 @@ void FakePageStorage::GetPiece(
       [this] { SendNextObject(); }, fxl::TimeDelta::FromMilliseconds(5));
 }
 
+std::unique_ptr<PageStorage::CommitPin> FakePageStorage::PinCommit(
+    CommitIdView /*commit_id*/) {
+  // Objects are never garbage collected from the fake storage.
+  return std::make_unique<CommitPin>();
+}
+
 void FakePageStorage::GetCommitContents(const Commit& commit,
                                         std::string min_key,
+                                        std::string max_key,
                                         std::function<bool(Entry)> on_next,
                                         std::function<void(Status)> on_done) {
   FakeJournalDelegate* journal = journals_[commit.GetId()].get();
@@ -211,6 +230,7 @@ void FakePageStorage::GetCommitContents(const Commit& commit,
   while (journal) {
     for (const auto& entry : journal->GetData()) {
       if ((min_key.empty() || min_key <= entry.first) &&
+          (max_key.empty() || entry.first < max_key) &&
           data.find(entry.first) == data.end()) {
         data[entry.first] = entry.second;
       }
@@ -249,6 +269,29 @@ void FakePageStorage::GetEntryFromCommit(
   callback(Status::OK, Entry{key, entry.value, entry.priority});
 }
 
+void FakePageStorage::GetEntriesFromCommit(
+    const Commit& commit,
+    std::vector<std::string> keys,
+    std::function<void(Status, std::vector<Entry>)> callback) {
+  FakeJournalDelegate* journal = journals_[commit.GetId()].get();
+  if (!journal) {
+    callback(Status::NOT_FOUND, std::vector<Entry>());
+    return;
+  }
+  const std::map<std::string, fake::FakeJournalDelegate::Entry,
+                 convert::StringViewComparator>& data = journal->GetData();
+  std::vector<Entry> result;
+  for (auto& key : keys) {
+    auto it = data.find(key);
+    if (it == data.end() || it->second.deleted) {
+      continue;
+    }
+    result.push_back(Entry{std::move(key), it->second.value,
+                           it->second.priority});
+  }
+  callback(Status::OK, std::move(result));
+}
+
 const std::map<std::string, std::unique_ptr<FakeJournalDelegate>>&
 FakePageStorage::GetJournals() const {
   return journals_;
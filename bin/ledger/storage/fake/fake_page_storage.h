@@ -54,6 +54,10 @@ class FakePageStorage : public PageStorageEmptyImpl {
   void AddObjectFromLocal(
       std::unique_ptr<DataSource> data_source,
       std::function<void(Status, ObjectIdentifier)> callback) override;
+  void AddObjectsFromLocal(
+      std::vector<std::unique_ptr<DataSource>> data_sources,
+      std::function<void(Status, std::vector<ObjectIdentifier>)> callback)
+      override;
   void GetObject(ObjectIdentifier object_identifier,
                  Location location,
                  std::function<void(Status, std::unique_ptr<const Object>)>
@@ -61,13 +65,19 @@ class FakePageStorage : public PageStorageEmptyImpl {
   void GetPiece(ObjectIdentifier object_identifier,
                 std::function<void(Status, std::unique_ptr<const Object>)>
                     callback) override;
+  std::unique_ptr<CommitPin> PinCommit(CommitIdView commit_id) override;
   void GetCommitContents(const Commit& commit,
                          std::string min_key,
+                         std::string max_key,
                          std::function<bool(Entry)> on_next,
                          std::function<void(Status)> on_done) override;
   void GetEntryFromCommit(const Commit& commit,
                           std::string key,
                           std::function<void(Status, Entry)> callback) override;
+  void GetEntriesFromCommit(
+      const Commit& commit,
+      std::vector<std::string> keys,
+      std::function<void(Status, std::vector<Entry>)> callback) override;
 
   // For testing:
   void set_autocommit(bool autocommit) { autocommit_ = autocommit; }
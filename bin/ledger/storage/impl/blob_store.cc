@@ -0,0 +1,187 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "peridot/bin/ledger/storage/impl/blob_store.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+
+#include <trace/event.h>
+
+#include "lib/fsl/vmo/file.h"
+#include "lib/fxl/files/directory.h"
+#include "lib/fxl/files/eintr_wrapper.h"
+#include "lib/fxl/files/file.h"
+#include "lib/fxl/files/path.h"
+#include "lib/fxl/files/unique_fd.h"
+#include "lib/fxl/functional/make_copyable.h"
+#include "lib/fxl/logging.h"
+#include "peridot/lib/convert/convert.h"
+
+namespace storage {
+
+using coroutine::CoroutineHandler;
+
+namespace {
+
+// Suffix of the files being written, renamed once complete.
+constexpr char kTemporarySuffix[] = ".tmp";
+// Size of the chunks in which the content of a VMO is written to its file.
+constexpr size_t kWriteChunkSize = 64 * 1024;
+
+Status ReadFile(const std::string& path, fsl::SizedVmo* vmo) {
+  if (!files::IsFile(path)) {
+    return Status::NOT_FOUND;
+  }
+  if (!fsl::VmoFromFilename(path, vmo)) {
+    FXL_LOG(ERROR) << "Unable to read blob at " << path;
+    return Status::INTERNAL_IO_ERROR;
+  }
+  return Status::OK;
+}
+
+Status WriteFile(const std::string& dir,
+                 const std::string& path,
+                 const fsl::SizedVmo& vmo) {
+  if (!files::CreateDirectory(dir)) {
+    FXL_LOG(ERROR) << "Unable to create directory " << dir;
+    return Status::INTERNAL_IO_ERROR;
+  }
+  std::string temporary_path = path + kTemporarySuffix;
+  fxl::UniqueFD fd(
+      open(temporary_path.c_str(), O_CREAT | O_WRONLY | O_TRUNC, 0600));
+  if (!fd.is_valid()) {
+    FXL_LOG(ERROR) << "Unable to create blob at " << temporary_path;
+    return Status::INTERNAL_IO_ERROR;
+  }
+
+  auto buffer = std::make_unique<char[]>(kWriteChunkSize);
+  for (uint64_t offset = 0; offset < vmo.size();) {
+    size_t size = std::min<uint64_t>(kWriteChunkSize, vmo.size() - offset);
+    size_t actual;
+    zx_status_t zx_status = vmo.vmo().read(buffer.get(), offset, size, &actual);
+    if (zx_status != ZX_OK || actual != size) {
+      FXL_LOG(ERROR) << "Unable to read VMO. Status: " << zx_status;
+      files::DeletePath(temporary_path, false);
+      return Status::INTERNAL_IO_ERROR;
+    }
+    for (size_t written = 0; written < size;) {
+      ssize_t result =
+          HANDLE_EINTR(write(fd.get(), buffer.get() + written, size - written));
+      if (result < 0) {
+        FXL_LOG(ERROR) << "Unable to write blob at " << temporary_path;
+        files::DeletePath(temporary_path, false);
+        return Status::INTERNAL_IO_ERROR;
+      }
+      written += result;
+    }
+    offset += size;
+  }
+  // The content must be on disk before the file becomes visible under its
+  // final name, or a crash could leave a truncated blob behind.
+  if (HANDLE_EINTR(fsync(fd.get())) != 0) {
+    FXL_LOG(ERROR) << "Unable to sync blob at " << temporary_path;
+    files::DeletePath(temporary_path, false);
+    return Status::INTERNAL_IO_ERROR;
+  }
+  fd.reset();
+
+  if (rename(temporary_path.c_str(), path.c_str()) != 0) {
+    FXL_LOG(ERROR) << "Unable to rename blob to " << path;
+    files::DeletePath(temporary_path, false);
+    return Status::INTERNAL_IO_ERROR;
+  }
+  return Status::OK;
+}
+
+}  // namespace
+
+BlobStore::BlobStore(fxl::RefPtr<fxl::TaskRunner> task_runner,
+                     std::string dir,
+                     fxl::RefPtr<fxl::TaskRunner> io_runner)
+    : task_runner_(std::move(task_runner)),
+      dir_(std::move(dir)),
+      io_runner_(std::move(io_runner)) {}
+
+BlobStore::~BlobStore() {}
+
+Status BlobStore::Read(CoroutineHandler* handler,
+                       const ObjectDigest& object_digest,
+                       fsl::SizedVmo* vmo) {
+  TRACE_DURATION("ledger", "blob_store_read");
+  // Owned by the operation, as the coroutine can be interrupted while it runs.
+  auto result = std::make_shared<std::pair<Status, fsl::SizedVmo>>();
+  if (RunOnIORunnerAndCheck(handler,
+                            [result, path = GetPath(object_digest)] {
+                              result->first = ReadFile(path, &result->second);
+                            })) {
+    return Status::INTERRUPTED;
+  }
+  if (result->first == Status::OK) {
+    *vmo = std::move(result->second);
+  }
+  return result->first;
+}
+
+Status BlobStore::Write(CoroutineHandler* handler,
+                        const ObjectDigest& object_digest,
+                        fsl::SizedVmo vmo) {
+  TRACE_DURATION("ledger", "blob_store_write");
+  auto status = std::make_shared<Status>(Status::OK);
+  if (RunOnIORunnerAndCheck(
+          handler,
+          fxl::MakeCopyable([status, dir = dir_,
+                             path = GetPath(object_digest),
+                             vmo = std::move(vmo)]() mutable {
+            *status = WriteFile(dir, path, vmo);
+          }))) {
+    return Status::INTERRUPTED;
+  }
+  return *status;
+}
+
+Status BlobStore::Delete(CoroutineHandler* handler,
+                         const ObjectDigest& object_digest) {
+  auto status = std::make_shared<Status>(Status::OK);
+  if (RunOnIORunnerAndCheck(handler,
+                            [status, path = GetPath(object_digest)] {
+                              if (files::IsFile(path) &&
+                                  !files::DeletePath(path, false)) {
+                                FXL_LOG(ERROR)
+                                    << "Unable to delete blob at " << path;
+                                *status = Status::INTERNAL_IO_ERROR;
+                              }
+                            })) {
+    return Status::INTERRUPTED;
+  }
+  return *status;
+}
+
+std::string BlobStore::GetPath(const ObjectDigest& object_digest) const {
+  return dir_ + "/" + convert::ToHex(object_digest);
+}
+
+bool BlobStore::RunOnIORunnerAndCheck(CoroutineHandler* handler,
+                                      std::function<void()> operation) {
+  if (!io_runner_) {
+    operation();
+    return false;
+  }
+  return coroutine::SyncCall(
+      handler, [this, &operation](fxl::Closure on_done) {
+        io_runner_->PostTask([operation = std::move(operation),
+                              task_runner = task_runner_,
+                              on_done = std::move(on_done)] {
+          operation();
+          task_runner->PostTask(std::move(on_done));
+        });
+      });
+}
+
+}  // namespace storage
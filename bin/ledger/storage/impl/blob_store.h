@@ -0,0 +1,65 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef PERIDOT_BIN_LEDGER_STORAGE_IMPL_BLOB_STORE_H_
+#define PERIDOT_BIN_LEDGER_STORAGE_IMPL_BLOB_STORE_H_
+
+#include <functional>
+#include <string>
+
+#include "lib/fsl/vmo/sized_vmo.h"
+#include "lib/fxl/macros.h"
+#include "lib/fxl/tasks/task_runner.h"
+#include "peridot/bin/ledger/coroutine/coroutine.h"
+#include "peridot/bin/ledger/storage/public/types.h"
+
+namespace storage {
+
+// Stores the content of objects in files, one per object, named after the
+// digest of the object. The content of a stored object is returned as a VMO
+// backed by its file, so that it can be handed out without being copied.
+class BlobStore {
+ public:
+  // If |io_runner| is not null, files are read and written on it, and the
+  // calling coroutines are resumed on |task_runner| once they are done.
+  BlobStore(fxl::RefPtr<fxl::TaskRunner> task_runner,
+            std::string dir,
+            fxl::RefPtr<fxl::TaskRunner> io_runner = nullptr);
+  ~BlobStore();
+
+  // Returns in |vmo| the content of the object with the given digest. Returns
+  // |NOT_FOUND| if the object is not stored.
+  Status Read(coroutine::CoroutineHandler* handler,
+              const ObjectDigest& object_digest,
+              fsl::SizedVmo* vmo);
+
+  // Stores the content of |vmo| as the content of the object with the given
+  // digest. The file is only visible to |Read| once fully written.
+  Status Write(coroutine::CoroutineHandler* handler,
+               const ObjectDigest& object_digest,
+               fsl::SizedVmo vmo);
+
+  // Deletes the object with the given digest, if it is stored.
+  Status Delete(coroutine::CoroutineHandler* handler,
+                const ObjectDigest& object_digest);
+
+ private:
+  std::string GetPath(const ObjectDigest& object_digest) const;
+
+  // Runs |operation| on the I/O runner, or directly if there is none, and
+  // resumes |handler| on the main runner once it is done. |operation| must
+  // only access data it owns. Returns whether the coroutine was interrupted.
+  bool RunOnIORunnerAndCheck(coroutine::CoroutineHandler* handler,
+                             std::function<void()> operation);
+
+  fxl::RefPtr<fxl::TaskRunner> task_runner_;
+  const std::string dir_;
+  fxl::RefPtr<fxl::TaskRunner> io_runner_;
+
+  FXL_DISALLOW_COPY_AND_ASSIGN(BlobStore);
+};
+
+}  // namespace storage
+
+#endif  // PERIDOT_BIN_LEDGER_STORAGE_IMPL_BLOB_STORE_H_
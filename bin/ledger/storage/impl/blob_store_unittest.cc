@@ -0,0 +1,88 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "peridot/bin/ledger/storage/impl/blob_store.h"
+
+#include <string>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "lib/fsl/tasks/message_loop.h"
+#include "lib/fsl/threading/create_thread.h"
+#include "lib/fsl/vmo/strings.h"
+#include "lib/fxl/files/scoped_temp_dir.h"
+#include "lib/fxl/macros.h"
+#include "peridot/bin/ledger/testing/test_with_coroutines.h"
+
+namespace storage {
+namespace {
+
+using coroutine::CoroutineHandler;
+
+class BlobStoreTest : public ::test::TestWithCoroutines {
+ public:
+  BlobStoreTest() {}
+
+  ~BlobStoreTest() override {}
+
+ protected:
+  // Writes |content| to |blob_store| as the content of |object_digest|, reads
+  // it back and deletes it.
+  void WriteReadDelete(BlobStore* blob_store,
+                       const ObjectDigest& object_digest,
+                       const std::string& content) {
+    EXPECT_TRUE(RunInCoroutine([&](CoroutineHandler* handler) {
+      fsl::SizedVmo vmo;
+      EXPECT_EQ(Status::NOT_FOUND,
+                blob_store->Read(handler, object_digest, &vmo));
+
+      ASSERT_TRUE(fsl::VmoFromString(content, &vmo));
+      EXPECT_EQ(Status::OK,
+                blob_store->Write(handler, object_digest, std::move(vmo)));
+
+      fsl::SizedVmo read_vmo;
+      ASSERT_EQ(Status::OK,
+                blob_store->Read(handler, object_digest, &read_vmo));
+      std::string read_content;
+      ASSERT_TRUE(fsl::StringFromVmo(read_vmo, &read_content));
+      EXPECT_EQ(content, read_content);
+
+      EXPECT_EQ(Status::OK, blob_store->Delete(handler, object_digest));
+      EXPECT_EQ(Status::NOT_FOUND,
+                blob_store->Read(handler, object_digest, &read_vmo));
+      EXPECT_EQ(Status::OK, blob_store->Delete(handler, object_digest));
+    }));
+  }
+
+  files::ScopedTempDir tmp_dir_;
+
+ private:
+  FXL_DISALLOW_COPY_AND_ASSIGN(BlobStoreTest);
+};
+
+TEST_F(BlobStoreTest, WriteReadDelete) {
+  BlobStore blob_store(message_loop_.task_runner(), tmp_dir_.path() + "/blobs");
+  // Larger than the chunks in which blobs are written.
+  std::string content;
+  for (size_t i = 0; content.size() < 200 * 1024; ++i) {
+    content += std::to_string(i);
+  }
+  WriteReadDelete(&blob_store, "digest", content);
+  WriteReadDelete(&blob_store, std::string("\0\xff", 2), "x");
+}
+
+TEST_F(BlobStoreTest, IORunner) {
+  fxl::RefPtr<fxl::TaskRunner> io_runner;
+  std::thread io_thread = fsl::CreateThread(&io_runner);
+  {
+    BlobStore blob_store(message_loop_.task_runner(),
+                         tmp_dir_.path() + "/blobs", io_runner);
+    WriteReadDelete(&blob_store, "digest", "content");
+  }
+  io_runner->PostTask([] { fsl::MessageLoop::GetCurrent()->QuitNow(); });
+  io_thread.join();
+}
+
+}  // namespace
+}  // namespace storage
@@ -56,11 +56,13 @@ class TrackGetObjectFakePageStorage : public fake::FakePageStorage {
                  std::function<void(Status, std::unique_ptr<const Object>)>
                      callback) override {
     object_requests.insert(object_identifier);
+    ++object_request_count;
     fake::FakePageStorage::GetObject(std::move(object_identifier), location,
                                      callback);
   }
 
   std::set<ObjectIdentifier> object_requests;
+  size_t object_request_count = 0;
 };
 
 class BTreeUtilsTest : public StorageTest {
@@ -98,7 +100,7 @@ class BTreeUtilsTest : public StorageTest {
       EXPECT_EQ(Status::OK, status);
       message_loop_.PostQuitTask();
     };
-    ForEachEntry(&coroutine_service_, &fake_storage_, root_identifier, "",
+    ForEachEntry(&coroutine_service_, &fake_storage_, root_identifier, "", "",
                  std::move(on_next), std::move(on_done));
     EXPECT_FALSE(RunLoopWithTimeout());
     return entries;
@@ -634,6 +636,48 @@ TEST_F(BTreeUtilsTest, SplitMergeUpdate) {
   EXPECT_EQ(root_identifier, final_node_identifier);
 }
 
+TEST_F(BTreeUtilsTest, ApplyChangesFetchesEachNodeOnce) {
+  std::vector<size_t> values;
+  for (size_t i = 0; i < 100; ++i) {
+    values.push_back(i);
+  }
+  std::vector<EntryChange> golden_entries;
+  ASSERT_TRUE(CreateEntryChanges(values, &golden_entries));
+  ObjectIdentifier root_identifier = CreateTree(golden_entries);
+
+  // Delete entries in different subtrees, some of them sharing the same
+  // nodes.
+  std::vector<size_t> deleted_values({1, 2, 5, 55, 65, 99});
+  std::vector<EntryChange> delete_changes;
+  ASSERT_TRUE(CreateEntryChanges(deleted_values, &delete_changes, true));
+
+  fake_storage_.object_requests.clear();
+  fake_storage_.object_request_count = 0;
+  Status status;
+  ObjectIdentifier new_root_identifier;
+  std::set<ObjectIdentifier> new_nodes;
+  ApplyChanges(&coroutine_service_, &fake_storage_, root_identifier,
+               std::make_unique<EntryChangeIterator>(delete_changes.begin(),
+                                                     delete_changes.end()),
+               callback::Capture(MakeQuitTask(), &status, &new_root_identifier,
+                                 &new_nodes),
+               &kTestNodeLevelCalculator);
+  ASSERT_FALSE(RunLoopWithTimeout());
+  ASSERT_EQ(Status::OK, status);
+  EXPECT_FALSE(fake_storage_.object_requests.empty());
+  EXPECT_EQ(fake_storage_.object_requests.size(),
+            fake_storage_.object_request_count);
+
+  std::vector<Entry> expected_entries;
+  for (size_t i = 0; i < golden_entries.size(); ++i) {
+    if (std::find(deleted_values.begin(), deleted_values.end(), i) ==
+        deleted_values.end()) {
+      expected_entries.push_back(golden_entries[i].entry);
+    }
+  }
+  EXPECT_EQ(expected_entries, GetEntriesList(new_root_identifier));
+}
+
 TEST_F(BTreeUtilsTest, DeleteAll) {
   // Create an initial tree.
   std::vector<size_t> values({0, 1, 2, 3, 4, 5, 6, 7});
@@ -732,8 +776,10 @@ TEST_F(BTreeUtilsTest, GetObjectsFromSync) {
   //          [03]
   //       /        \
   // [00, 01, 02]  [04]
-  GetObjectsFromSync(&coroutine_service_, &fake_storage_, root_identifier,
-                     callback::Capture(MakeQuitTask(), &status));
+  std::set<ObjectIdentifier> sync_object_identifiers;
+  GetObjectsFromSync(
+      &coroutine_service_, &fake_storage_, {root_identifier},
+      callback::Capture(MakeQuitTask(), &status, &sync_object_identifiers));
   ASSERT_FALSE(RunLoopWithTimeout());
   ASSERT_EQ(Status::OK, status);
 
@@ -752,6 +798,8 @@ TEST_F(BTreeUtilsTest, GetObjectsFromSync) {
   ASSERT_FALSE(RunLoopWithTimeout());
   ASSERT_EQ(Status::OK, status);
   ASSERT_EQ(3 + 5u, object_identifiers.size());
+  // All the objects of the tree, including the lazy value, are returned.
+  EXPECT_EQ(object_identifiers, sync_object_identifiers);
   for (ObjectIdentifier& identifier : object_requests) {
     // entries[3] contains the lazy value.
     if (identifier != entries[3].entry.object_identifier) {
@@ -773,7 +821,7 @@ TEST_F(BTreeUtilsTest, ForEachEmptyTree) {
     EXPECT_EQ(Status::OK, status);
     message_loop_.PostQuitTask();
   };
-  ForEachEntry(&coroutine_service_, &fake_storage_, root_identifier, "",
+  ForEachEntry(&coroutine_service_, &fake_storage_, root_identifier, "", "",
                std::move(on_next), std::move(on_done));
   ASSERT_FALSE(RunLoopWithTimeout());
 }
@@ -794,11 +842,41 @@ TEST_F(BTreeUtilsTest, ForEachAllEntries) {
     EXPECT_EQ(Status::OK, status);
     message_loop_.PostQuitTask();
   };
-  ForEachEntry(&coroutine_service_, &fake_storage_, root_identifier, "",
+  ForEachEntry(&coroutine_service_, &fake_storage_, root_identifier, "", "",
                on_next, on_done);
   ASSERT_FALSE(RunLoopWithTimeout());
 }
 
+TEST_F(BTreeUtilsTest, ForEachAllEntriesWithReadAhead) {
+  // Create a tree from entries with keys from 00-99.
+  std::vector<EntryChange> entries;
+  ASSERT_TRUE(CreateEntryChanges(100, &entries));
+  ObjectIdentifier root_identifier = CreateTree(entries);
+
+  std::vector<Entry> expected_entries = GetEntriesList(root_identifier);
+  std::set<ObjectIdentifier> expected_requests = fake_storage_.object_requests;
+  ASSERT_GT(expected_requests.size(), 1u);
+
+  fake_storage_.object_requests.clear();
+  fake_storage_.object_request_count = 0;
+  std::vector<Entry> found_entries;
+  auto on_next = [&found_entries](EntryAndNodeIdentifier e) {
+    found_entries.push_back(e.entry);
+    return true;
+  };
+  Status status;
+  ForEachEntry(&coroutine_service_, &fake_storage_, root_identifier, "", "",
+               on_next, callback::Capture(MakeQuitTask(), &status), nullptr,
+               2);
+  ASSERT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(Status::OK, status);
+  EXPECT_EQ(expected_entries, found_entries);
+  // Reading ahead doesn't read any node twice, nor nodes that are not part of
+  // the iteration.
+  EXPECT_EQ(expected_requests, fake_storage_.object_requests);
+  EXPECT_EQ(expected_requests.size(), fake_storage_.object_request_count);
+}
+
 TEST_F(BTreeUtilsTest, ForEachEntryPrefix) {
   // Create a tree from entries with keys from 00-99.
   std::vector<EntryChange> entries;
@@ -821,8 +899,68 @@ TEST_F(BTreeUtilsTest, ForEachEntryPrefix) {
     message_loop_.PostQuitTask();
   };
   ForEachEntry(&coroutine_service_, &fake_storage_, root_identifier, prefix,
-               on_next, on_done);
+               "", on_next, on_done);
+  ASSERT_FALSE(RunLoopWithTimeout());
+}
+
+TEST_F(BTreeUtilsTest, ForEachEntryInRange) {
+  // Create a tree from entries with keys from 00-99.
+  std::vector<EntryChange> entries;
+  ASSERT_TRUE(CreateEntryChanges(100, &entries));
+  ObjectIdentifier root_identifier = CreateTree(entries);
+  fake_storage_.object_requests.clear();
+  GetEntriesList(root_identifier);
+  size_t all_nodes_count = fake_storage_.object_requests.size();
+
+  fake_storage_.object_requests.clear();
+  std::vector<std::string> found_keys;
+  auto on_next = [&found_keys](EntryAndNodeIdentifier e) {
+    found_keys.push_back(e.entry.key);
+    return true;
+  };
+  Status status;
+  ForEachEntry(&coroutine_service_, &fake_storage_, root_identifier, "key30",
+               "key40", on_next, callback::Capture(MakeQuitTask(), &status),
+               nullptr, 2);
+  ASSERT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(Status::OK, status);
+  ASSERT_EQ(10u, found_keys.size());
+  for (size_t i = 0; i < found_keys.size(); ++i) {
+    EXPECT_EQ(fxl::StringPrintf("key%02zu", 30 + i), found_keys[i]);
+  }
+  // Nodes outside of the range are neither visited nor read ahead.
+  EXPECT_LT(fake_storage_.object_requests.size(), all_nodes_count);
+}
+
+TEST_F(BTreeUtilsTest, GetEntriesForKeys) {
+  // Create a tree from entries with keys from 00-99.
+  std::vector<EntryChange> entries;
+  ASSERT_TRUE(CreateEntryChanges(100, &entries));
+  ObjectIdentifier root_identifier = CreateTree(entries);
+  fake_storage_.object_requests.clear();
+  std::vector<Entry> all_entries = GetEntriesList(root_identifier);
+  size_t all_nodes_count = fake_storage_.object_requests.size();
+  ASSERT_GT(all_nodes_count, 1u);
+
+  fake_storage_.object_requests.clear();
+  fake_storage_.object_request_count = 0;
+  Status status;
+  std::vector<Entry> found_entries;
+  GetEntriesForKeys(
+      &coroutine_service_, &fake_storage_, root_identifier,
+      {"a", "key00", "key05", "key050", "key06", "key51", "key99", "z"},
+      callback::Capture(MakeQuitTask(), &status, &found_entries));
   ASSERT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(Status::OK, status);
+  std::vector<Entry> expected_entries = {all_entries[0], all_entries[5],
+                                         all_entries[6], all_entries[51],
+                                         all_entries[99]};
+  EXPECT_EQ(expected_entries, found_entries);
+  // Nodes shared between lookups are only read once, and nodes that cannot
+  // contain any of the keys are not read.
+  EXPECT_EQ(fake_storage_.object_requests.size(),
+            fake_storage_.object_request_count);
+  EXPECT_LT(fake_storage_.object_requests.size(), all_nodes_count);
 }
 
 }  // namespace
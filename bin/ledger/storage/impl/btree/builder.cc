@@ -6,10 +6,10 @@
 
 #include "lib/fxl/functional/closure.h"
 #include "lib/fxl/functional/make_copyable.h"
+#include "peridot/bin/ledger/storage/impl/btree/encoding.h"
 #include "peridot/bin/ledger/storage/impl/btree/internal_helper.h"
 #include "peridot/bin/ledger/storage/impl/btree/synchronous_storage.h"
 #include "peridot/bin/ledger/storage/impl/object_digest.h"
-#include "peridot/lib/callback/waiter.h"
 #include "third_party/murmurhash/murmurhash.h"
 
 namespace storage {
@@ -18,6 +18,10 @@ namespace {
 
 constexpr uint32_t kMurmurHashSeed = 0xbeef;
 
+// Maximal number of changes whose paths in the tree are fetched together
+// before being applied.
+constexpr size_t kMaxChangesPerPrefetch = 1024;
+
 using HashResultType = decltype(murmurhash(nullptr, 0, 0));
 using HashSliceType = uint8_t;
 
@@ -83,6 +87,14 @@ class NodeBuilder {
                ObjectIdentifier* object_identifier,
                std::set<ObjectIdentifier>* new_identifiers);
 
+  // Loads the content of all the existing nodes on the paths from this builder
+  // to the given |keys|, so that applying changes on these keys does not need
+  // to read them one at a time. Nodes are fetched in parallel, one level of
+  // the tree at a time, and each node is fetched at most once. |keys| must be
+  // sorted.
+  Status Prefetch(SynchronousStorage* page_storage,
+                  const std::vector<std::string>& keys);
+
  private:
   enum class BuilderType {
     EXISTING_NODE,
@@ -311,9 +323,13 @@ Status NodeBuilder::Build(SynchronousStorage* page_storage,
     return Status::OK;
   }
 
+  // The new nodes are built one level at a time, as a node references the
+  // identifiers of its children. The nodes of a level are written to the
+  // storage in a single batch.
   std::vector<NodeBuilder*> to_build;
   while (CollectNodesToBuild(&to_build)) {
-    auto waiter = callback::StatusWaiter<Status>::Create(Status::OK);
+    std::vector<std::unique_ptr<DataSource>> encodings;
+    encodings.reserve(to_build.size());
     for (NodeBuilder* child : to_build) {
       std::map<size_t, ObjectIdentifier> children;
       for (size_t index = 0; index < child->children_.size(); ++index) {
@@ -323,30 +339,31 @@ Status NodeBuilder::Build(SynchronousStorage* page_storage,
           children[index] = sub_child.object_identifier_;
         }
       }
-      TreeNode::FromEntries(
-          page_storage->page_storage(), child->level_, child->entries_,
-          children,
-          [new_identifiers, child, callback = waiter->NewCallback()](
-              Status status, ObjectIdentifier object_identifier) {
-            if (status == Status::OK) {
-              child->type_ = BuilderType::EXISTING_NODE;
-              child->object_identifier_ = object_identifier;
-              new_identifiers->insert(child->object_identifier_);
-            }
-            callback(status);
-          });
+      encodings.push_back(DataSource::Create(
+          EncodeNode(child->level_, child->entries_, children)));
     }
     Status status;
-    if (coroutine::SyncCall(page_storage->handler(),
-                            [&waiter](std::function<void(Status)> callback) {
-                              waiter->Finalize(std::move(callback));
-                            },
-                            &status)) {
+    std::vector<ObjectIdentifier> object_identifiers;
+    if (coroutine::SyncCall(
+            page_storage->handler(),
+            [page_storage, &encodings](
+                std::function<void(Status, std::vector<ObjectIdentifier>)>
+                    callback) {
+              page_storage->page_storage()->AddObjectsFromLocal(
+                  std::move(encodings), std::move(callback));
+            },
+            &status, &object_identifiers)) {
       return Status::ILLEGAL_STATE;
     }
     if (status != Status::OK) {
       return status;
     }
+    FXL_DCHECK(object_identifiers.size() == to_build.size());
+    for (size_t i = 0; i < to_build.size(); ++i) {
+      to_build[i]->type_ = BuilderType::EXISTING_NODE;
+      to_build[i]->object_identifier_ = std::move(object_identifiers[i]);
+      new_identifiers->insert(to_build[i]->object_identifier_);
+    }
     to_build.clear();
   }
 
@@ -356,6 +373,74 @@ Status NodeBuilder::Build(SynchronousStorage* page_storage,
   return Status::OK;
 }
 
+Status NodeBuilder::Prefetch(SynchronousStorage* page_storage,
+                             const std::vector<std::string>& keys) {
+  // A builder to explore, and the range of |keys| that are in its subtree.
+  struct BuilderAndKeys {
+    NodeBuilder* builder;
+    size_t begin;
+    size_t end;
+  };
+
+  std::vector<BuilderAndKeys> current_level;
+  if (*this && !keys.empty()) {
+    current_level.push_back({this, 0, keys.size()});
+  }
+
+  while (!current_level.empty()) {
+    std::vector<ObjectIdentifier> identifiers;
+    std::vector<NodeBuilder*> builders_to_load;
+    for (const auto& builder_and_keys : current_level) {
+      NodeBuilder* builder = builder_and_keys.builder;
+      if (builder->children_.empty()) {
+        FXL_DCHECK(builder->type_ == BuilderType::EXISTING_NODE);
+        identifiers.push_back(builder->object_identifier_);
+        builders_to_load.push_back(builder);
+      }
+    }
+
+    if (!identifiers.empty()) {
+      std::vector<std::unique_ptr<const TreeNode>> nodes;
+      RETURN_ON_ERROR(page_storage->TreeNodesFromIdentifiers(
+          std::move(identifiers), &nodes));
+      FXL_DCHECK(nodes.size() == builders_to_load.size());
+      for (size_t i = 0; i < nodes.size(); ++i) {
+        ExtractContent(*nodes[i], &builders_to_load[i]->entries_,
+                       &builders_to_load[i]->children_);
+      }
+    }
+
+    std::vector<BuilderAndKeys> next_level;
+    for (const auto& builder_and_keys : current_level) {
+      NodeBuilder* builder = builder_and_keys.builder;
+      const std::vector<Entry>& entries = builder->entries_;
+      size_t begin = builder_and_keys.begin;
+      while (begin < builder_and_keys.end) {
+        size_t index = GetEntryOrChildIndex(entries, keys[begin]);
+        if (index < entries.size() && entries[index].key == keys[begin]) {
+          // The key is in this node.
+          ++begin;
+          continue;
+        }
+        // All the following keys smaller than the entry at |index| are in the
+        // same child.
+        size_t end = begin + 1;
+        while (end < builder_and_keys.end &&
+               (index == entries.size() || keys[end] < entries[index].key)) {
+          ++end;
+        }
+        NodeBuilder& child = builder->children_[index];
+        if (child) {
+          next_level.push_back({&child, begin, end});
+        }
+        begin = end;
+      }
+    }
+    current_level.swap(next_level);
+  }
+  return Status::OK;
+}
+
 Status NodeBuilder::ComputeContent(SynchronousStorage* page_storage) {
   FXL_DCHECK(*this);
 
@@ -612,15 +697,27 @@ Status ApplyChangesOnRoot(const NodeLevelCalculator* node_level_calculator,
                           std::set<ObjectIdentifier>* new_identifiers) {
   Status status;
   while (changes->Valid()) {
-    EntryChange change = **changes;
-    changes->Next();
+    std::vector<EntryChange> batch;
+    std::vector<std::string> keys;
+    while (changes->Valid() && batch.size() < kMaxChangesPerPrefetch) {
+      batch.push_back(**changes);
+      keys.push_back(batch.back().entry.key);
+      changes->Next();
+    }
 
-    bool did_mutate;
-    status = root.Apply(node_level_calculator, page_storage, std::move(change),
-                        &did_mutate);
+    status = root.Prefetch(page_storage, keys);
     if (status != Status::OK) {
       return status;
     }
+
+    for (auto& change : batch) {
+      bool did_mutate;
+      status = root.Apply(node_level_calculator, page_storage,
+                          std::move(change), &did_mutate);
+      if (status != Status::OK) {
+        return status;
+      }
+    }
   }
 
   if (changes->GetStatus() != Status::OK) {
@@ -642,13 +739,15 @@ void ApplyChanges(
     std::unique_ptr<Iterator<const EntryChange>> changes,
     std::function<void(Status, ObjectIdentifier, std::set<ObjectIdentifier>)>
         callback,
-    const NodeLevelCalculator* node_level_calculator) {
+    const NodeLevelCalculator* node_level_calculator,
+    TreeNodeCache* node_cache) {
   FXL_DCHECK(storage::IsDigestValid(root_identifier.object_digest));
   coroutine_service->StartCoroutine(fxl::MakeCopyable(
       [page_storage, root_identifier = std::move(root_identifier),
        changes = std::move(changes), callback = std::move(callback),
-       node_level_calculator](coroutine::CoroutineHandler* handler) mutable {
-        SynchronousStorage storage(page_storage, handler);
+       node_level_calculator,
+       node_cache](coroutine::CoroutineHandler* handler) mutable {
+        SynchronousStorage storage(page_storage, handler, node_cache);
 
         NodeBuilder root;
         Status status = NodeBuilder::FromIdentifier(
@@ -9,6 +9,7 @@
 #include <set>
 
 #include "peridot/bin/ledger/coroutine/coroutine.h"
+#include "peridot/bin/ledger/storage/impl/btree/tree_node_cache.h"
 #include "peridot/bin/ledger/storage/public/iterator.h"
 #include "peridot/bin/ledger/storage/public/page_storage.h"
 #include "peridot/bin/ledger/storage/public/types.h"
@@ -29,6 +30,7 @@ const NodeLevelCalculator* GetDefaultNodeLevelCalculator();
 // |root_identifier|. |changes| must provide |EntryChange| objects sorted by
 // their key. The callback will provide the status of the operation, the id of
 // the new root and the list of ids of all new nodes created after the changes.
+// If |node_cache| is not null, it is used to look up the existing tree nodes.
 void ApplyChanges(
     coroutine::CoroutineService* coroutine_service,
     PageStorage* page_storage,
@@ -37,7 +39,8 @@ void ApplyChanges(
     std::function<void(Status, ObjectIdentifier, std::set<ObjectIdentifier>)>
         callback,
     const NodeLevelCalculator* node_level_calculator =
-        GetDefaultNodeLevelCalculator());
+        GetDefaultNodeLevelCalculator(),
+    TreeNodeCache* node_cache = nullptr);
 
 }  // namespace btree
 }  // namespace storage
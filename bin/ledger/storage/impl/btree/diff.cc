@@ -15,18 +15,42 @@ namespace storage {
 namespace btree {
 namespace {
 // Aggregates 2 |BTreeIterator|s and allows to walk through these concurrently
-// to compute the diff. |on_next| will be called for each diff entry.
+// to compute the diff. |on_next| will be called for each diff entry. If
+// |read_ahead| is not 0, children are read ahead as in |BTreeIterator|, except
+// for the ones shared by the current nodes of both iterators, as these are
+// likely to be skipped.
 class IteratorPair {
  public:
   IteratorPair(SynchronousStorage* storage,
                std::function<bool(std::unique_ptr<Entry>,
-                                  std::unique_ptr<Entry>)> on_next)
-      : on_next_(std::move(on_next)), left_(storage), right_(storage) {}
+                                  std::unique_ptr<Entry>)> on_next,
+               size_t read_ahead = 0)
+      : on_next_(std::move(on_next)),
+        left_(storage, read_ahead),
+        right_(storage, read_ahead) {
+    if (read_ahead) {
+      // The iterators are swapped during the iteration, so the filter checks
+      // both of them: a child of the iterator reading ahead is shared iff it
+      // is also a child of the other one.
+      auto filter = [this](const ObjectIdentifier& node_identifier) {
+        return left_.Finished() || right_.Finished() ||
+               !left_.IsChildOfCurrentNode(node_identifier) ||
+               !right_.IsChildOfCurrentNode(node_identifier);
+      };
+      left_.SetReadAheadFilter(filter);
+      right_.SetReadAheadFilter(filter);
+    }
+  }
 
-  // Initialize the pair with the ids of both roots.
+  // Initialize the pair with the ids of both roots. Only differences for keys
+  // in [min_key, max_key) are found, or from |min_key| on if |max_key| is
+  // empty.
   Status Init(ObjectIdentifier left_node_identifier,
               ObjectIdentifier right_node_identifier,
-              fxl::StringView min_key) {
+              fxl::StringView min_key,
+              std::string max_key = "") {
+    left_.SetMaxKey(max_key);
+    right_.SetMaxKey(std::move(max_key));
     RETURN_ON_ERROR(left_.Init(left_node_identifier));
     RETURN_ON_ERROR(right_.Init(right_node_identifier));
     if (!min_key.empty()) {
@@ -291,6 +315,8 @@ class IteratorPair {
   // This allows to switch left and right during the algorithm to handle less
   // cases.
   bool diff_from_left_to_right_ = true;
+
+  FXL_DISALLOW_COPY_AND_ASSIGN(IteratorPair);
 };
 
 // Iterator that does a three-way diff by using two IteratorPair objects in
@@ -490,7 +516,9 @@ Status ForEachDiffInternal(SynchronousStorage* storage,
                            ObjectIdentifier left_node_identifier,
                            ObjectIdentifier right_node_identifier,
                            std::string min_key,
-                           const std::function<bool(EntryChange)>& on_next) {
+                           std::string max_key,
+                           const std::function<bool(EntryChange)>& on_next,
+                           size_t read_ahead) {
   FXL_DCHECK(storage::IsDigestValid(left_node_identifier.object_digest));
   FXL_DCHECK(storage::IsDigestValid(right_node_identifier.object_digest));
 
@@ -506,9 +534,9 @@ Status ForEachDiffInternal(SynchronousStorage* storage,
     return on_next({std::move(*base), true});
   };
 
-  IteratorPair iterators(storage, wrapped_next);
-  RETURN_ON_ERROR(
-      iterators.Init(left_node_identifier, right_node_identifier, min_key));
+  IteratorPair iterators(storage, wrapped_next, read_ahead);
+  RETURN_ON_ERROR(iterators.Init(left_node_identifier, right_node_identifier,
+                                 min_key, std::move(max_key)));
 
   while (!iterators.Finished()) {
     if (!iterators.SendDiff()) {
@@ -556,21 +584,26 @@ void ForEachDiff(coroutine::CoroutineService* coroutine_service,
                  ObjectIdentifier base_root_identifier,
                  ObjectIdentifier other_root_identifier,
                  std::string min_key,
+                 std::string max_key,
                  std::function<bool(EntryChange)> on_next,
-                 std::function<void(Status)> on_done) {
+                 std::function<void(Status)> on_done,
+                 TreeNodeCache* node_cache,
+                 size_t read_ahead) {
   FXL_DCHECK(storage::IsDigestValid(base_root_identifier.object_digest));
   FXL_DCHECK(storage::IsDigestValid(other_root_identifier.object_digest));
   coroutine_service->StartCoroutine(
-      [page_storage, base_root_identifier = std::move(base_root_identifier),
+      [page_storage, node_cache, read_ahead,
+       base_root_identifier = std::move(base_root_identifier),
        other_root_identifier = std::move(other_root_identifier),
        on_next = std::move(on_next), min_key = std::move(min_key),
+       max_key = std::move(max_key),
        on_done =
            std::move(on_done)](coroutine::CoroutineHandler* handler) mutable {
-        SynchronousStorage storage(page_storage, handler);
+        SynchronousStorage storage(page_storage, handler, node_cache);
 
-        on_done(ForEachDiffInternal(&storage, base_root_identifier,
-                                    other_root_identifier, std::move(min_key),
-                                    on_next));
+        on_done(ForEachDiffInternal(
+            &storage, base_root_identifier, other_root_identifier,
+            std::move(min_key), std::move(max_key), on_next, read_ahead));
       });
 }
 
@@ -581,18 +614,20 @@ void ForEachThreeWayDiff(coroutine::CoroutineService* coroutine_service,
                          ObjectIdentifier right_root_identifier,
                          std::string min_key,
                          std::function<bool(ThreeWayChange)> on_next,
-                         std::function<void(Status)> on_done) {
+                         std::function<void(Status)> on_done,
+                         TreeNodeCache* node_cache) {
   FXL_DCHECK(storage::IsDigestValid(base_root_identifier.object_digest));
   FXL_DCHECK(storage::IsDigestValid(left_root_identifier.object_digest));
   FXL_DCHECK(storage::IsDigestValid(right_root_identifier.object_digest));
   coroutine_service->StartCoroutine(
-      [page_storage, base_root_identifier = std::move(base_root_identifier),
+      [page_storage, node_cache,
+       base_root_identifier = std::move(base_root_identifier),
        left_root_identifier = std::move(left_root_identifier),
        right_root_identifier = std::move(right_root_identifier),
        on_next = std::move(on_next), min_key = std::move(min_key),
        on_done =
            std::move(on_done)](coroutine::CoroutineHandler* handler) mutable {
-        SynchronousStorage storage(page_storage, handler);
+        SynchronousStorage storage(page_storage, handler, node_cache);
 
         on_done(ForEachThreeWayDiffInternal(
             &storage, base_root_identifier, left_root_identifier,
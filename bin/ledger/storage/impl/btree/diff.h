@@ -9,29 +9,39 @@
 
 #include "peridot/bin/ledger/coroutine/coroutine.h"
 #include "peridot/bin/ledger/storage/impl/btree/tree_node.h"
+#include "peridot/bin/ledger/storage/impl/btree/tree_node_cache.h"
 #include "peridot/bin/ledger/storage/public/types.h"
 
 namespace storage {
 namespace btree {
 
 // Iterates through the differences between two trees given their root ids
-// |base_root_id| and |other_root_id| and calls |on_next| on found differences.
+// |base_root_id| and |other_root_id| and calls |on_next| on found differences
+// for keys equal to or greater than |min_key| and, unless |max_key| is empty,
+// strictly smaller than |max_key|. Subtrees outside of this range are not read.
 // Returning false from |on_next| will immediately stop the iteration. |on_done|
 // is called once, upon successfull completion, i.e. when there are no more
-// differences or iteration was interrupted, or if an error occurs.
+// differences or iteration was interrupted, or if an error occurs. If
+// |node_cache| is not null, it is used to look up and store decoded tree nodes.
+// |read_ahead| is the number of differing sibling nodes read concurrently
+// during the iteration, see |BTreeIterator|.
 void ForEachDiff(coroutine::CoroutineService* coroutine_service,
                  PageStorage* page_storage,
                  ObjectIdentifier base_root_identifier,
                  ObjectIdentifier other_root_identifier,
                  std::string min_key,
+                 std::string max_key,
                  std::function<bool(EntryChange)> on_next,
-                 std::function<void(Status)> on_done);
+                 std::function<void(Status)> on_done,
+                 TreeNodeCache* node_cache = nullptr,
+                 size_t read_ahead = 0);
 
 // Iterates through the differences between three trees given their root ids and
 // calls |on_next| if any difference is found between any pair.
 // Returning false from |on_next| will immediately stop the iteration. |on_done|
 // is called once, upon successful completion, i.e. when there are no more
-// differences or iteration was interrupted, or if an error occurs.
+// differences or iteration was interrupted, or if an error occurs. If
+// |node_cache| is not null, it is used to look up and store decoded tree nodes.
 void ForEachThreeWayDiff(coroutine::CoroutineService* coroutine_service,
                          PageStorage* page_storage,
                          ObjectIdentifier base_root_identifier,
@@ -39,7 +49,8 @@ void ForEachThreeWayDiff(coroutine::CoroutineService* coroutine_service,
                          ObjectIdentifier right_root_identifier,
                          std::string min_key,
                          std::function<bool(ThreeWayChange)> on_next,
-                         std::function<void(Status)> on_done);
+                         std::function<void(Status)> on_done,
+                         TreeNodeCache* node_cache = nullptr);
 
 }  // namespace btree
 }  // namespace storage
@@ -91,7 +91,7 @@ TEST_F(DiffTest, ForEachDiff) {
   Status status;
   size_t current_change = 0;
   ForEachDiff(&coroutine_service_, &fake_storage_, base_root_identifier,
-              other_root_identifier, "",
+              other_root_identifier, "", "",
               [&other_changes, &current_change](EntryChange e) {
                 EXPECT_EQ(other_changes[current_change].deleted, e.deleted);
                 if (e.deleted) {
@@ -109,6 +109,47 @@ TEST_F(DiffTest, ForEachDiff) {
   EXPECT_EQ(other_changes.size(), current_change);
 }
 
+TEST_F(DiffTest, ForEachDiffWithReadAhead) {
+  std::unique_ptr<const Object> object;
+  ASSERT_TRUE(AddObject("change1", &object));
+  ObjectIdentifier object_identifier = object->GetIdentifier();
+
+  std::vector<EntryChange> base_changes;
+  ASSERT_TRUE(CreateEntryChanges(100, &base_changes));
+  ObjectIdentifier base_root_identifier = CreateTree(base_changes);
+
+  // Update entries in different subtrees.
+  std::vector<EntryChange> other_changes;
+  for (size_t i : {3, 37, 52, 88}) {
+    other_changes.push_back(EntryChange{
+        Entry{base_changes[i].entry.key, object_identifier, KeyPriority::LAZY},
+        false});
+  }
+  ObjectIdentifier other_root_identifier;
+  ASSERT_TRUE(CreateTreeFromChanges(base_root_identifier, other_changes,
+                                    &other_root_identifier));
+
+  for (size_t read_ahead : {0, 1, 4, 16}) {
+    Status status;
+    std::vector<EntryChange> found_changes;
+    ForEachDiff(&coroutine_service_, &fake_storage_, base_root_identifier,
+                other_root_identifier, "", "",
+                [&found_changes](EntryChange e) {
+                  found_changes.push_back(std::move(e));
+                  return true;
+                },
+                callback::Capture(MakeQuitTask(), &status), nullptr,
+                read_ahead);
+    ASSERT_FALSE(RunLoopWithTimeout());
+    ASSERT_EQ(Status::OK, status);
+    ASSERT_EQ(other_changes.size(), found_changes.size());
+    for (size_t i = 0; i < other_changes.size(); ++i) {
+      EXPECT_FALSE(found_changes[i].deleted);
+      EXPECT_EQ(other_changes[i].entry, found_changes[i].entry);
+    }
+  }
+}
+
 TEST_F(DiffTest, ForEachDiffWithMinKey) {
   // Expected base tree layout (XX is key "keyXX"):
   //                     [50]
@@ -138,7 +179,7 @@ TEST_F(DiffTest, ForEachDiffWithMinKey) {
   // ForEachDiff with a "key0" as min_key should return both changes.
   size_t current_change = 0;
   ForEachDiff(&coroutine_service_, &fake_storage_, base_root_identifier,
-              other_root_identifier, "key0",
+              other_root_identifier, "key0", "",
               [&changes, &current_change](EntryChange e) {
                 EXPECT_EQ(changes[current_change++].entry, e.entry);
                 return true;
@@ -150,7 +191,7 @@ TEST_F(DiffTest, ForEachDiffWithMinKey) {
 
   // With "key60" as min_key, only key75 should be returned.
   ForEachDiff(&coroutine_service_, &fake_storage_, base_root_identifier,
-              other_root_identifier, "key60",
+              other_root_identifier, "key60", "",
               [&changes](EntryChange e) {
                 EXPECT_EQ(changes[1].entry, e.entry);
                 return true;
@@ -160,6 +201,48 @@ TEST_F(DiffTest, ForEachDiffWithMinKey) {
   ASSERT_EQ(Status::OK, status);
 }
 
+TEST_F(DiffTest, ForEachDiffWithMaxKey) {
+  // Same layouts as in ForEachDiffWithMinKey.
+  std::vector<EntryChange> base_entries;
+  ASSERT_TRUE(CreateEntryChanges(
+      std::vector<size_t>({1, 2, 3, 7, 30, 50, 65, 76}), &base_entries));
+  std::vector<EntryChange> changes;
+  ASSERT_TRUE(CreateEntryChanges(std::vector<size_t>({51, 75}), &changes));
+
+  Status status;
+  ObjectIdentifier base_root_identifier = CreateTree(base_entries);
+  ObjectIdentifier other_root_identifier;
+  ASSERT_TRUE(CreateTreeFromChanges(base_root_identifier, changes,
+                                    &other_root_identifier));
+
+  // With "key60" as max_key, only key51 should be returned.
+  size_t change_count = 0;
+  ForEachDiff(&coroutine_service_, &fake_storage_, base_root_identifier,
+              other_root_identifier, "", "key60",
+              [&changes, &change_count](EntryChange e) {
+                EXPECT_EQ(changes[0].entry, e.entry);
+                ++change_count;
+                return true;
+              },
+              callback::Capture(MakeQuitTask(), &status));
+  ASSERT_FALSE(RunLoopWithTimeout());
+  ASSERT_EQ(Status::OK, status);
+  EXPECT_EQ(1u, change_count);
+
+  // max_key is excluded from the range.
+  change_count = 0;
+  ForEachDiff(&coroutine_service_, &fake_storage_, base_root_identifier,
+              other_root_identifier, "key0", "key51",
+              [&change_count](EntryChange /*e*/) {
+                ++change_count;
+                return true;
+              },
+              callback::Capture(MakeQuitTask(), &status));
+  ASSERT_FALSE(RunLoopWithTimeout());
+  ASSERT_EQ(Status::OK, status);
+  EXPECT_EQ(0u, change_count);
+}
+
 TEST_F(DiffTest, ForEachDiffWithMinKeySkipNodes) {
   // Expected base tree layout (XX is key "keyXX"):
   //       [03, 07, 30]
@@ -184,7 +267,7 @@ TEST_F(DiffTest, ForEachDiffWithMinKeySkipNodes) {
                                     &other_root_identifier));
 
   ForEachDiff(&coroutine_service_, &fake_storage_, base_root_identifier,
-              other_root_identifier, "key01",
+              other_root_identifier, "key01", "",
               [&changes](EntryChange e) {
                 EXPECT_EQ(changes[0].entry, e.entry);
                 return true;
@@ -215,7 +298,7 @@ TEST_F(DiffTest, ForEachDiffPriorityChange) {
   size_t change_count = 0;
   EntryChange actual_change;
   ForEachDiff(&coroutine_service_, &fake_storage_, base_root_identifier,
-              other_root_identifier, "",
+              other_root_identifier, "", "",
               [&actual_change, &change_count](EntryChange e) {
                 actual_change = e;
                 ++change_count;
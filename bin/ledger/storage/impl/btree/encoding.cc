@@ -31,12 +31,6 @@ KeyPriorityStorage ToKeyPriorityStorage(KeyPriority priority) {
       return KeyPriorityStorage_LAZY;
   }
 }
-
-Entry ToEntry(const EntryStorage* entry_storage) {
-  return Entry{convert::ToString(entry_storage->key()),
-               ToObjectIdentifier(entry_storage->object_id()),
-               ToKeyPriority(entry_storage->priority())};
-}
 }  // namespace
 
 bool CheckValidTreeNodeSerialization(fxl::StringView data) {
@@ -141,5 +135,11 @@ bool DecodeNode(fxl::StringView data,
 
   return true;
 }
+
+Entry ToEntry(const EntryStorage* entry_storage) {
+  return Entry{convert::ToString(entry_storage->key()),
+               ToObjectIdentifier(entry_storage->object_id()),
+               ToKeyPriority(entry_storage->priority())};
+}
 }  // namespace btree
 }  // namespace storage
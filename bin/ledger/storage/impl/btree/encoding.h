@@ -9,6 +9,7 @@
 #include <string>
 
 #include "lib/fxl/strings/string_view.h"
+#include "peridot/bin/ledger/storage/impl/btree/tree_node_generated.h"
 #include "peridot/bin/ledger/storage/public/types.h"
 
 namespace storage {
@@ -25,6 +26,9 @@ bool DecodeNode(fxl::StringView data,
                 std::vector<Entry>* res_entries,
                 std::map<size_t, ObjectIdentifier>* res_children);
 
+// Converts an |EntryStorage| to an |Entry|.
+Entry ToEntry(const EntryStorage* entry_storage);
+
 }  // namespace btree
 }  // namespace storage
 
@@ -12,7 +12,7 @@ namespace btree {
 // Returns the index of |entries| that contains |key|, or the first entry that
 // has key greather than |key|. In the second case, the key, if present, will
 // be found in the children at the returned index.
-size_t GetEntryOrChildIndex(const std::vector<Entry> entries,
+size_t GetEntryOrChildIndex(const std::vector<Entry>& entries,
                             fxl::StringView key) {
   auto lower = std::lower_bound(
       entries.begin(), entries.end(), key,
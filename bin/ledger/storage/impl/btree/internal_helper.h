@@ -24,7 +24,8 @@ namespace btree {
 // Returns the index of |entries| that contains |key|, or the first entry that
 // has a key greather than |key|. In the second case, the key, if present, will
 // be found in the children at the returned index.
-size_t GetEntryOrChildIndex(std::vector<Entry> entries, fxl::StringView key);
+size_t GetEntryOrChildIndex(const std::vector<Entry>& entries,
+                            fxl::StringView key);
 
 }  // namespace btree
 }  // namespace storage
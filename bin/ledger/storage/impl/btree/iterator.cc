@@ -4,6 +4,9 @@
 
 #include "peridot/bin/ledger/storage/impl/btree/iterator.h"
 
+#include <algorithm>
+#include <set>
+
 #include "lib/fxl/functional/make_copyable.h"
 #include "peridot/bin/ledger/storage/impl/btree/internal_helper.h"
 #include "peridot/lib/callback/waiter.h"
@@ -17,8 +20,11 @@ Status ForEachEntryInternal(
     SynchronousStorage* storage,
     ObjectIdentifier root_identifier,
     fxl::StringView min_key,
-    const std::function<bool(EntryAndNodeIdentifier)>& on_next) {
-  BTreeIterator iterator(storage);
+    std::string max_key,
+    const std::function<bool(EntryAndNodeIdentifier)>& on_next,
+    size_t read_ahead) {
+  BTreeIterator iterator(storage, read_ahead);
+  iterator.SetMaxKey(std::move(max_key));
   RETURN_ON_ERROR(iterator.Init(root_identifier));
   RETURN_ON_ERROR(iterator.SkipTo(min_key));
   while (!iterator.Finished()) {
@@ -33,9 +39,76 @@ Status ForEachEntryInternal(
   return Status::OK;
 }
 
+// Looks up the keys in [|begin|, |end|) in the subtree rooted at |node| and
+// appends the entries found to |result|, in key order.
+Status GetEntriesForKeysInternal(SynchronousStorage* storage,
+                                 const TreeNode& node,
+                                 std::vector<std::string>::const_iterator begin,
+                                 std::vector<std::string>::const_iterator end,
+                                 std::vector<Entry>* result) {
+  // For each key, the index of the entry holding it, or of the child where it
+  // may be found.
+  std::vector<std::pair<Status, int>> positions;
+  positions.reserve(end - begin);
+  // The children that need to be explored, and their identifiers.
+  std::vector<int> child_indexes;
+  std::vector<ObjectIdentifier> child_identifiers;
+  for (auto it = begin; it != end; ++it) {
+    int index;
+    Status status = node.FindKeyOrChild(*it, &index);
+    if (status != Status::OK && status != Status::NOT_FOUND) {
+      return status;
+    }
+    positions.emplace_back(status, index);
+    if (status == Status::NOT_FOUND &&
+        (child_indexes.empty() || child_indexes.back() != index)) {
+      auto child = node.children_identifiers().find(index);
+      if (child != node.children_identifiers().end()) {
+        child_indexes.push_back(index);
+        child_identifiers.push_back(child->second);
+      }
+    }
+  }
+
+  std::vector<std::unique_ptr<const TreeNode>> children;
+  if (!child_identifiers.empty()) {
+    RETURN_ON_ERROR(storage->TreeNodesFromIdentifiers(
+        std::move(child_identifiers), &children));
+  }
+
+  size_t next_child = 0;
+  auto it = begin;
+  while (it != end) {
+    const auto& position = positions[it - begin];
+    if (position.first == Status::OK) {
+      Entry entry;
+      RETURN_ON_ERROR(node.GetEntry(position.second, &entry));
+      result->push_back(std::move(entry));
+      ++it;
+      continue;
+    }
+    // Keys mapping to the same child are contiguous, as |keys| is sorted.
+    auto run_end = it + 1;
+    while (run_end != end &&
+           positions[run_end - begin].first == Status::NOT_FOUND &&
+           positions[run_end - begin].second == position.second) {
+      ++run_end;
+    }
+    if (next_child < child_indexes.size() &&
+        child_indexes[next_child] == position.second) {
+      RETURN_ON_ERROR(GetEntriesForKeysInternal(
+          storage, *children[next_child], it, run_end, result));
+      ++next_child;
+    }
+    it = run_end;
+  }
+  return Status::OK;
+}
+
 }  // namespace
 
-BTreeIterator::BTreeIterator(SynchronousStorage* storage) : storage_(storage) {}
+BTreeIterator::BTreeIterator(SynchronousStorage* storage, size_t read_ahead)
+    : storage_(storage), read_ahead_(read_ahead) {}
 
 BTreeIterator::BTreeIterator(BTreeIterator&& other) noexcept = default;
 
@@ -46,6 +119,11 @@ Status BTreeIterator::Init(ObjectIdentifier node_identifier) {
   return Descend(node_identifier);
 }
 
+void BTreeIterator::SetMaxKey(std::string max_key) {
+  FXL_DCHECK(stack_.empty());
+  max_key_ = std::move(max_key);
+}
+
 Status BTreeIterator::SkipTo(fxl::StringView min_key) {
   descending_ = true;
   for (;;) {
@@ -56,19 +134,21 @@ Status BTreeIterator::SkipTo(fxl::StringView min_key) {
     if (!next_child) {
       return Status::OK;
     }
+    ReadAhead();
     RETURN_ON_ERROR(Descend(*next_child));
   }
 }
 
 bool BTreeIterator::SkipToIndex(fxl::StringView key) {
-  auto& entries = CurrentNode().entries();
-  size_t skip_count = GetEntryOrChildIndex(entries, key);
-  if (skip_count < CurrentIndex()) {
+  int skip_count;
+  Status key_status = CurrentNode().FindKeyOrChild(key, &skip_count);
+  if (static_cast<size_t>(skip_count) < CurrentIndex()) {
     return true;
   }
   CurrentIndex() = skip_count;
-  if (CurrentIndex() < entries.size() && entries[CurrentIndex()].key == key) {
+  if (key_status == Status::OK) {
     descending_ = false;
+    FinishIfPastMaxKey();
     return true;
   }
   return false;
@@ -84,7 +164,7 @@ const ObjectIdentifier* BTreeIterator::GetNextChild() const {
 
 bool BTreeIterator::HasValue() const {
   return !stack_.empty() && !descending_ &&
-         CurrentIndex() < CurrentNode().entries().size();
+         CurrentIndex() < static_cast<size_t>(CurrentNode().GetKeyCount());
 }
 
 bool BTreeIterator::Finished() const {
@@ -93,7 +173,14 @@ bool BTreeIterator::Finished() const {
 
 const Entry& BTreeIterator::CurrentEntry() const {
   FXL_DCHECK(HasValue());
-  return CurrentNode().entries()[CurrentIndex()];
+  // Only decode the entry the iterator is on.
+  if (!current_entry_) {
+    current_entry_ = std::make_unique<Entry>();
+    Status status =
+        CurrentNode().GetEntry(CurrentIndex(), current_entry_.get());
+    FXL_DCHECK(status == Status::OK);
+  }
+  return *current_entry_;
 }
 
 const ObjectIdentifier& BTreeIterator::GetIdentifier() const {
@@ -109,17 +196,21 @@ Status BTreeIterator::Advance() {
     auto child = GetNextChild();
     if (!child) {
       descending_ = false;
+      FinishIfPastMaxKey();
       return Status::OK;
     }
+    ReadAhead();
     return Descend(*child);
   }
 
   auto& index = CurrentIndex();
   ++index;
-  if (index <= CurrentNode().entries().size()) {
+  if (index <= static_cast<size_t>(CurrentNode().GetKeyCount())) {
     descending_ = true;
   } else {
     stack_.pop_back();
+    current_entry_.reset();
+    FinishIfPastMaxKey();
   }
 
   return Status::OK;
@@ -133,14 +224,38 @@ Status BTreeIterator::AdvanceToValue() {
 }
 
 void BTreeIterator::SkipNextSubTree() {
+  if (read_ahead_) {
+    auto child = GetNextChild();
+    if (child) {
+      storage_->DropPrefetchedTreeNode(*child);
+    }
+  }
   if (descending_) {
     descending_ = false;
   } else {
     ++CurrentIndex();
   }
+  FinishIfPastMaxKey();
+}
+
+bool BTreeIterator::IsChildOfCurrentNode(
+    const ObjectIdentifier& node_identifier) const {
+  for (const auto& child : CurrentNode().children_identifiers()) {
+    if (child.second == node_identifier) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void BTreeIterator::SetReadAheadFilter(
+    std::function<bool(const ObjectIdentifier&)> filter) {
+  read_ahead_filter_ = std::move(filter);
 }
 
 size_t& BTreeIterator::CurrentIndex() {
+  // The index might be updated by the caller.
+  current_entry_.reset();
   return stack_.back().second;
 }
 
@@ -157,14 +272,46 @@ Status BTreeIterator::Descend(const ObjectIdentifier& node_identifier) {
   std::unique_ptr<const TreeNode> node;
   RETURN_ON_ERROR(storage_->TreeNodeFromIdentifier(node_identifier, &node));
   stack_.emplace_back(std::move(node), 0);
+  current_entry_.reset();
   return Status::OK;
 }
 
+void BTreeIterator::ReadAhead() {
+  if (!read_ahead_) {
+    return;
+  }
+  FXL_DCHECK(descending_);
+  const auto& children_identifiers = CurrentNode().children_identifiers();
+  auto end = children_identifiers.end();
+  if (!max_key_.empty()) {
+    // Children after the entry at or past |max_key_| will not be visited.
+    int max_child_index;
+    CurrentNode().FindKeyOrChild(max_key_, &max_child_index);
+    end = children_identifiers.upper_bound(max_child_index);
+  }
+  std::vector<ObjectIdentifier> to_prefetch;
+  for (auto it = children_identifiers.lower_bound(CurrentIndex());
+       it != end && to_prefetch.size() < read_ahead_; ++it) {
+    if (!read_ahead_filter_ || read_ahead_filter_(it->second)) {
+      to_prefetch.push_back(it->second);
+    }
+  }
+  storage_->PrefetchTreeNodes(to_prefetch);
+}
+
+void BTreeIterator::FinishIfPastMaxKey() {
+  if (!max_key_.empty() && HasValue() && CurrentEntry().key >= max_key_) {
+    stack_.clear();
+    current_entry_.reset();
+  }
+}
+
 void GetObjectIdentifiers(
     coroutine::CoroutineService* coroutine_service,
     PageStorage* page_storage,
     ObjectIdentifier root_identifier,
-    std::function<void(Status, std::set<ObjectIdentifier>)> callback) {
+    std::function<void(Status, std::set<ObjectIdentifier>)> callback,
+    TreeNodeCache* node_cache) {
   FXL_DCHECK(!root_identifier.object_digest.empty());
   auto object_digests = std::make_unique<std::set<ObjectIdentifier>>();
   object_digests->insert(root_identifier);
@@ -184,56 +331,140 @@ void GetObjectIdentifiers(
         }
         callback(status, std::move(*object_digests));
       });
-  ForEachEntry(coroutine_service, page_storage, root_identifier, "",
-               std::move(on_next), std::move(on_done));
-}
-
-void GetObjectsFromSync(coroutine::CoroutineService* coroutine_service,
-                        PageStorage* page_storage,
-                        ObjectIdentifier root_identifier,
-                        std::function<void(Status)> callback) {
-  fxl::RefPtr<callback::Waiter<Status, std::unique_ptr<const Object>>> waiter_ =
-      callback::Waiter<Status, std::unique_ptr<const Object>>::Create(
-          Status::OK);
-  auto on_next = [page_storage, waiter_](EntryAndNodeIdentifier e) {
-    if (e.entry.priority == KeyPriority::EAGER) {
-      page_storage->GetObject(e.entry.object_identifier,
-                              PageStorage::Location::NETWORK,
-                              waiter_->NewCallback());
-    }
-    return true;
-  };
-  auto on_done = [callback = std::move(callback),
-                  waiter_](Status status) mutable {
-    if (status != Status::OK) {
-      callback(status);
-      return;
-    }
-    waiter_->Finalize(
-        [callback = std::move(callback)](
-            Status s, std::vector<std::unique_ptr<const Object>> objects) {
-          callback(s);
-        });
-  };
-  ForEachEntry(coroutine_service, page_storage, root_identifier, "",
-               std::move(on_next), std::move(on_done));
+  ForEachEntry(coroutine_service, page_storage, root_identifier, "", "",
+               std::move(on_next), std::move(on_done), node_cache);
+}
+
+void GetObjectsFromSync(
+    coroutine::CoroutineService* coroutine_service,
+    PageStorage* page_storage,
+    std::vector<ObjectIdentifier> root_identifiers,
+    std::function<void(Status, std::set<ObjectIdentifier>)> callback,
+    TreeNodeCache* node_cache) {
+  coroutine_service->StartCoroutine(
+      [page_storage, node_cache, root_identifiers = std::move(root_identifiers),
+       callback = std::move(callback)](coroutine::CoroutineHandler* handler) {
+        SynchronousStorage storage(page_storage, handler, node_cache);
+        auto waiter = callback::StatusWaiter<Status>::Create(Status::OK);
+
+        // Identifiers of the nodes and values already requested. Subtrees
+        // shared by several roots are only visited once.
+        std::set<ObjectIdentifier> requested;
+        // Identifiers of the |LAZY| values, which are not requested.
+        std::set<ObjectIdentifier> lazy_values;
+        std::vector<ObjectIdentifier> level;
+        for (const auto& root_identifier : root_identifiers) {
+          if (requested.insert(root_identifier).second) {
+            level.push_back(root_identifier);
+          }
+        }
+
+        // Reads the tree level by level, so that all the nodes of a level are
+        // downloaded concurrently. EAGER values are requested as soon as the
+        // node referencing them is available, without waiting for them.
+        while (!level.empty()) {
+          std::vector<std::unique_ptr<const TreeNode>> nodes;
+          Status status = storage.TreeNodesFromIdentifiers(level, &nodes);
+          if (status != Status::OK) {
+            callback(status, std::set<ObjectIdentifier>());
+            return;
+          }
+          std::vector<ObjectIdentifier> next_level;
+          for (const auto& node : nodes) {
+            for (const Entry& entry : node->entries()) {
+              if (entry.priority != KeyPriority::EAGER) {
+                lazy_values.insert(entry.object_identifier);
+                continue;
+              }
+              if (!requested.insert(entry.object_identifier).second) {
+                continue;
+              }
+              page_storage->GetObject(
+                  entry.object_identifier, PageStorage::Location::NETWORK,
+                  [callback = waiter->NewCallback()](
+                      Status status, std::unique_ptr<const Object> object) {
+                    callback(status);
+                  });
+            }
+            for (const auto& child : node->children_identifiers()) {
+              if (requested.insert(child.second).second) {
+                next_level.push_back(child.second);
+              }
+            }
+          }
+          level.swap(next_level);
+        }
+
+        Status status;
+        if (coroutine::SyncCall(
+                handler,
+                [waiter](std::function<void(Status)> callback) {
+                  waiter->Finalize(std::move(callback));
+                },
+                &status)) {
+          callback(Status::INTERRUPTED, std::set<ObjectIdentifier>());
+          return;
+        }
+        if (status != Status::OK) {
+          callback(status, std::set<ObjectIdentifier>());
+          return;
+        }
+        requested.insert(lazy_values.begin(), lazy_values.end());
+        callback(Status::OK, std::move(requested));
+      });
 }
 
 void ForEachEntry(coroutine::CoroutineService* coroutine_service,
                   PageStorage* page_storage,
                   ObjectIdentifier root_identifier,
                   std::string min_key,
+                  std::string max_key,
                   std::function<bool(EntryAndNodeIdentifier)> on_next,
-                  std::function<void(Status)> on_done) {
+                  std::function<void(Status)> on_done,
+                  TreeNodeCache* node_cache,
+                  size_t read_ahead) {
   FXL_DCHECK(!root_identifier.object_digest.empty());
   coroutine_service->StartCoroutine(
-      [page_storage, root_identifier = std::move(root_identifier),
-       min_key = std::move(min_key), on_next = std::move(on_next),
+      [page_storage, node_cache, read_ahead,
+       root_identifier = std::move(root_identifier),
+       min_key = std::move(min_key), max_key = std::move(max_key),
+       on_next = std::move(on_next),
        on_done = std::move(on_done)](coroutine::CoroutineHandler* handler) {
-        SynchronousStorage storage(page_storage, handler);
+        SynchronousStorage storage(page_storage, handler, node_cache);
 
-        on_done(
-            ForEachEntryInternal(&storage, root_identifier, min_key, on_next));
+        on_done(ForEachEntryInternal(&storage, root_identifier, min_key,
+                                     max_key, on_next, read_ahead));
+      });
+}
+
+void GetEntriesForKeys(coroutine::CoroutineService* coroutine_service,
+                       PageStorage* page_storage,
+                       ObjectIdentifier root_identifier,
+                       std::vector<std::string> keys,
+                       std::function<void(Status, std::vector<Entry>)> callback,
+                       TreeNodeCache* node_cache) {
+  FXL_DCHECK(!root_identifier.object_digest.empty());
+  FXL_DCHECK(std::adjacent_find(keys.begin(), keys.end(),
+                                std::greater_equal<std::string>()) ==
+             keys.end());
+  coroutine_service->StartCoroutine(
+      [page_storage, node_cache, root_identifier = std::move(root_identifier),
+       keys = std::move(keys),
+       callback = std::move(callback)](coroutine::CoroutineHandler* handler) {
+        SynchronousStorage storage(page_storage, handler, node_cache);
+
+        std::vector<Entry> result;
+        std::unique_ptr<const TreeNode> root;
+        Status status = storage.TreeNodeFromIdentifier(root_identifier, &root);
+        if (status == Status::OK) {
+          status = GetEntriesForKeysInternal(&storage, *root, keys.begin(),
+                                             keys.end(), &result);
+        }
+        if (status != Status::OK) {
+          callback(status, std::vector<Entry>());
+          return;
+        }
+        callback(Status::OK, std::move(result));
       });
 }
 
@@ -15,6 +15,7 @@
 #include "peridot/bin/ledger/coroutine/coroutine.h"
 #include "peridot/bin/ledger/storage/impl/btree/synchronous_storage.h"
 #include "peridot/bin/ledger/storage/impl/btree/tree_node.h"
+#include "peridot/bin/ledger/storage/impl/btree/tree_node_cache.h"
 #include "peridot/bin/ledger/storage/public/types.h"
 
 namespace storage {
@@ -28,9 +29,14 @@ struct EntryAndNodeIdentifier {
 
 // Iterator over a B-Tree. This iterator exposes the internal of the iteration
 // to allow to skip part of the tree.
+//
+// If |read_ahead| is not 0, each time the iterator is about to descend into a
+// child, it prefetches the next |read_ahead| children of the current node, so
+// that the following subtrees are read from storage concurrently while the
+// caller processes the current one.
 class BTreeIterator {
  public:
-  explicit BTreeIterator(SynchronousStorage* storage);
+  explicit BTreeIterator(SynchronousStorage* storage, size_t read_ahead = 0);
 
   BTreeIterator(BTreeIterator&& other) noexcept;
   BTreeIterator& operator=(BTreeIterator&& other) noexcept;
@@ -38,6 +44,12 @@ class BTreeIterator {
   // Initializes the iterator with the root node of the tree.
   Status Init(ObjectIdentifier node_identifier);
 
+  // Sets the upper bound of the iteration: the iterator finishes on the first
+  // entry with a key greater than or equal to |max_key|, and children past
+  // that entry are never read. An empty |max_key| means no upper bound. This
+  // must be called before |Init|.
+  void SetMaxKey(std::string max_key);
+
   // Skips the iteration until the first key that is greater than or equal to
   // |min_key|.
   Status SkipTo(fxl::StringView min_key);
@@ -78,52 +90,99 @@ class BTreeIterator {
   // Skips the next sub tree in the iteration.
   void SkipNextSubTree();
 
+  // Returns whether |node_identifier| is a child of the node at the top of the
+  // stack.
+  bool IsChildOfCurrentNode(const ObjectIdentifier& node_identifier) const;
+
+  // Sets a filter on the children that are read ahead: only children for which
+  // |filter| returns true are prefetched.
+  void SetReadAheadFilter(
+      std::function<bool(const ObjectIdentifier&)> filter);
+
  private:
   size_t& CurrentIndex();
   size_t CurrentIndex() const;
   const TreeNode& CurrentNode() const;
   Status Descend(const ObjectIdentifier& node_identifier);
+  void ReadAhead();
+  // Finishes the iteration if the iterator is on an entry past |max_key_|.
+  void FinishIfPastMaxKey();
 
   SynchronousStorage* storage_;
+  size_t read_ahead_;
+  std::string max_key_;
+  std::function<bool(const ObjectIdentifier&)> read_ahead_filter_;
   // Stack representing the current iteration state. Each level represents the
   // current node in the B-Tree, and the index currently looked at. If
   // |descending_| is |true|, the index is the child index, otherwise it is the
   // entry index.
   std::vector<std::pair<std::unique_ptr<const TreeNode>, size_t>> stack_;
   bool descending_ = true;
+  // The decoded entry at the current position, if |CurrentEntry| has been
+  // called since the last move of the iterator.
+  mutable std::unique_ptr<Entry> current_entry_;
 
   FXL_DISALLOW_COPY_AND_ASSIGN(BTreeIterator);
 };
 
 // Retrieves the ids of all objects in the B-Tree, i.e tree nodes and values of
 // entries in the tree. After a successfull call, |callback| will be called
-// with the set of results.
+// with the set of results. If |node_cache| is not null, it is used to avoid
+// reading and decoding tree nodes that have already been read.
 void GetObjectIdentifiers(
     coroutine::CoroutineService* coroutine_service,
     PageStorage* page_storage,
     ObjectIdentifier root_identifier,
-    std::function<void(Status, std::set<ObjectIdentifier>)> callback);
+    std::function<void(Status, std::set<ObjectIdentifier>)> callback,
+    TreeNodeCache* node_cache = nullptr);
 
 // Tries to download all tree nodes and values with |EAGER| priority that are
-// not locally available from sync. To do this |PageStorage::GetObject| is
-// called for all corresponding objects.
-void GetObjectsFromSync(coroutine::CoroutineService* coroutine_service,
-                        PageStorage* page_storage,
-                        ObjectIdentifier root_identifier,
-                        std::function<void(Status)> callback);
+// not locally available from sync, for the trees with the given roots. To do
+// this |PageStorage::GetObject| is called for all corresponding objects. The
+// trees are read level by level: the nodes of a level are requested
+// concurrently, and objects shared between the trees are only requested once.
+// Tree nodes found in |node_cache|, if not null, are already available locally
+// and are not requested again. After a successful call, |callback| is called
+// with the ids of all the objects of the trees, as in |GetObjectIdentifiers|.
+void GetObjectsFromSync(
+    coroutine::CoroutineService* coroutine_service,
+    PageStorage* page_storage,
+    std::vector<ObjectIdentifier> root_identifiers,
+    std::function<void(Status, std::set<ObjectIdentifier>)> callback,
+    TreeNodeCache* node_cache = nullptr);
 
 // Iterates through the nodes of the tree with the given root and calls
-// |on_next| on found entries with a key equal to or greater than |min_key|. The
-// return value of |on_next| can be used to stop the iteration: returning false
-// will interrupt the iteration in progress and no more |on_next| calls will be
-// made. |on_done| is called once, upon successfull completion, i.e. when there
-// are no more elements or iteration was interrupted, or if an error occurs.
+// |on_next| on found entries with a key equal to or greater than |min_key| and,
+// unless |max_key| is empty, strictly smaller than |max_key|. Subtrees outside
+// of this range are not read. The return value of |on_next| can be used to
+// stop the iteration: returning false will interrupt the iteration in progress
+// and no more |on_next| calls will be made. |on_done| is called once, upon
+// successfull completion, i.e. when there are no more elements or iteration was
+// interrupted, or if an error occurs. If |node_cache| is not null, it is used
+// to look up and store decoded tree nodes. |read_ahead| is the number of
+// sibling nodes read concurrently during the iteration, see |BTreeIterator|.
 void ForEachEntry(coroutine::CoroutineService* coroutine_service,
                   PageStorage* page_storage,
                   ObjectIdentifier root_identifier,
                   std::string min_key,
+                  std::string max_key,
                   std::function<bool(EntryAndNodeIdentifier)> on_next,
-                  std::function<void(Status)> on_done);
+                  std::function<void(Status)> on_done,
+                  TreeNodeCache* node_cache = nullptr,
+                  size_t read_ahead = 0);
+
+// Retrieves the entries of the tree with the given root for the given |keys|,
+// which must be sorted and unique, and calls |callback| with the entries found,
+// sorted by key. Keys that are not in the tree have no entry in the result.
+// The tree is walked once: the lookups of keys sharing a node are merged, and
+// the children needed at each node are read concurrently. If |node_cache| is
+// not null, it is used to look up and store decoded tree nodes.
+void GetEntriesForKeys(coroutine::CoroutineService* coroutine_service,
+                       PageStorage* page_storage,
+                       ObjectIdentifier root_identifier,
+                       std::vector<std::string> keys,
+                       std::function<void(Status, std::vector<Entry>)> callback,
+                       TreeNodeCache* node_cache = nullptr);
 
 }  // namespace btree
 }  // namespace storage
@@ -4,51 +4,162 @@
 
 #include "peridot/bin/ledger/storage/impl/btree/synchronous_storage.h"
 
+#include <utility>
+
+#include "lib/fxl/memory/ref_counted.h"
+
 namespace storage {
 namespace btree {
+namespace {
+// Maximal number of nodes that can be prefetched and not yet requested at any
+// given time.
+constexpr size_t kMaxPrefetchedNodes = 64;
+}  // namespace
+
+// The result of a prefetched read. The read callback and the coroutine waiting
+// for the node can come in any order.
+class SynchronousStorage::PrefetchedNode
+    : public fxl::RefCountedThreadSafe<PrefetchedNode> {
+ public:
+  void SetResult(Status status, std::unique_ptr<const TreeNode> node) {
+    FXL_DCHECK(!ready_);
+    if (on_ready_) {
+      auto on_ready = std::move(on_ready_);
+      on_ready(status, std::move(node));
+      return;
+    }
+    ready_ = true;
+    status_ = status;
+    node_ = std::move(node);
+  }
+
+  void GetResult(
+      std::function<void(Status, std::unique_ptr<const TreeNode>)> callback) {
+    FXL_DCHECK(!on_ready_);
+    if (ready_) {
+      callback(status_, std::move(node_));
+      return;
+    }
+    on_ready_ = std::move(callback);
+  }
+
+ private:
+  bool ready_ = false;
+  Status status_ = Status::OK;
+  std::unique_ptr<const TreeNode> node_;
+  std::function<void(Status, std::unique_ptr<const TreeNode>)> on_ready_;
+};
 
 SynchronousStorage::SynchronousStorage(PageStorage* page_storage,
-                                       coroutine::CoroutineHandler* handler)
-    : page_storage_(page_storage), handler_(handler) {}
+                                       coroutine::CoroutineHandler* handler,
+                                       TreeNodeCache* node_cache)
+    : page_storage_(page_storage), handler_(handler), node_cache_(node_cache) {}
+
+SynchronousStorage::~SynchronousStorage() {}
+
+void SynchronousStorage::PrefetchTreeNodes(
+    const std::vector<ObjectIdentifier>& object_identifiers) {
+  for (const auto& object_identifier : object_identifiers) {
+    if (prefetched_nodes_.size() >= kMaxPrefetchedNodes) {
+      return;
+    }
+    if (prefetched_nodes_.count(object_identifier) ||
+        (node_cache_ && node_cache_->Contains(object_identifier))) {
+      continue;
+    }
+    auto prefetched_node = fxl::AdoptRef(new PrefetchedNode());
+    prefetched_nodes_[object_identifier] = prefetched_node;
+    TreeNode::FromIdentifier(
+        page_storage_, object_identifier,
+        [prefetched_node](Status status, std::unique_ptr<const TreeNode> node) {
+          prefetched_node->SetResult(status, std::move(node));
+        });
+  }
+}
+
+void SynchronousStorage::DropPrefetchedTreeNode(
+    const ObjectIdentifier& object_identifier) {
+  prefetched_nodes_.erase(object_identifier);
+}
 
 Status SynchronousStorage::TreeNodeFromIdentifier(
     ObjectIdentifier object_identifier,
     std::unique_ptr<const TreeNode>* result) {
+  if (node_cache_ && node_cache_->Get(object_identifier, result)) {
+    return Status::OK;
+  }
+  fxl::RefPtr<PrefetchedNode> prefetched_node;
+  auto it = prefetched_nodes_.find(object_identifier);
+  if (it != prefetched_nodes_.end()) {
+    prefetched_node = std::move(it->second);
+    prefetched_nodes_.erase(it);
+  }
   Status status;
   if (coroutine::SyncCall(
           handler_,
-          [this, &object_identifier](
+          [this, &object_identifier, &prefetched_node](
               std::function<void(Status, std::unique_ptr<const TreeNode>)>
                   callback) {
+            if (prefetched_node) {
+              prefetched_node->GetResult(std::move(callback));
+              return;
+            }
             TreeNode::FromIdentifier(page_storage_, object_identifier,
                                      std::move(callback));
           },
           &status, result)) {
     return Status::INTERRUPTED;
   }
+  if (status == Status::OK && node_cache_) {
+    node_cache_->Insert(**result);
+  }
   return status;
 }
 
 Status SynchronousStorage::TreeNodesFromIdentifiers(
     std::vector<ObjectIdentifier> object_identifiers,
     std::vector<std::unique_ptr<const TreeNode>>* result) {
-  auto waiter =
-      callback::Waiter<Status, std::unique_ptr<const TreeNode>>::Create(
-          Status::OK);
-  for (const auto& object_identifier : object_identifiers) {
-    TreeNode::FromIdentifier(page_storage_, object_identifier,
-                             waiter->NewCallback());
+  std::vector<std::unique_ptr<const TreeNode>> nodes(object_identifiers.size());
+  // Indexes in |object_identifiers| of the nodes not found in the cache.
+  std::vector<size_t> missing_indexes;
+  for (size_t i = 0; i < object_identifiers.size(); ++i) {
+    if (!node_cache_ || !node_cache_->Get(object_identifiers[i], &nodes[i])) {
+      missing_indexes.push_back(i);
+    }
   }
-  Status status;
-  if (coroutine::SyncCall(
-          handler_,
-          [waiter](std::function<void(
-                       Status, std::vector<std::unique_ptr<const TreeNode>>)>
-                       callback) { waiter->Finalize(std::move(callback)); },
-          &status, result)) {
-    return Status::INTERRUPTED;
+
+  if (!missing_indexes.empty()) {
+    auto waiter =
+        callback::Waiter<Status, std::unique_ptr<const TreeNode>>::Create(
+            Status::OK);
+    for (size_t index : missing_indexes) {
+      TreeNode::FromIdentifier(page_storage_, object_identifiers[index],
+                               waiter->NewCallback());
+    }
+    Status status;
+    std::vector<std::unique_ptr<const TreeNode>> missing_nodes;
+    if (coroutine::SyncCall(
+            handler_,
+            [waiter](std::function<void(
+                         Status, std::vector<std::unique_ptr<const TreeNode>>)>
+                         callback) { waiter->Finalize(std::move(callback)); },
+            &status, &missing_nodes)) {
+      return Status::INTERRUPTED;
+    }
+    if (status != Status::OK) {
+      return status;
+    }
+    FXL_DCHECK(missing_nodes.size() == missing_indexes.size());
+    for (size_t i = 0; i < missing_indexes.size(); ++i) {
+      if (node_cache_) {
+        node_cache_->Insert(*missing_nodes[i]);
+      }
+      nodes[missing_indexes[i]] = std::move(missing_nodes[i]);
+    }
   }
-  return status;
+
+  result->swap(nodes);
+  return Status::OK;
 }
 
 Status SynchronousStorage::TreeNodeFromEntries(
@@ -5,11 +5,14 @@
 #ifndef PERIDOT_BIN_LEDGER_STORAGE_IMPL_BTREE_SYNCHRONOUS_STORAGE_H_
 #define PERIDOT_BIN_LEDGER_STORAGE_IMPL_BTREE_SYNCHRONOUS_STORAGE_H_
 
+#include <map>
 #include <memory>
 #include <vector>
 
+#include "lib/fxl/memory/ref_ptr.h"
 #include "peridot/bin/ledger/coroutine/coroutine.h"
 #include "peridot/bin/ledger/storage/impl/btree/tree_node.h"
+#include "peridot/bin/ledger/storage/impl/btree/tree_node_cache.h"
 #include "peridot/bin/ledger/storage/public/page_storage.h"
 #include "peridot/bin/ledger/storage/public/types.h"
 #include "peridot/lib/callback/waiter.h"
@@ -18,18 +21,37 @@ namespace storage {
 namespace btree {
 
 // Wrapper for TreeNode and PageStorage that uses coroutines to make
-// asynchronous calls look like synchronous ones.
+// asynchronous calls look like synchronous ones. If |node_cache| is not null,
+// tree nodes are first looked up in the cache, and nodes read from
+// |page_storage| are added to it.
+//
+// Tree nodes can also be read ahead of time with |PrefetchTreeNodes|: the
+// reads are started concurrently, and a later call to |TreeNodeFromIdentifier|
+// for one of these nodes only waits for the pending read.
 class SynchronousStorage {
  public:
   SynchronousStorage(PageStorage* page_storage,
-                     coroutine::CoroutineHandler* handler);
+                     coroutine::CoroutineHandler* handler,
+                     TreeNodeCache* node_cache = nullptr);
+  ~SynchronousStorage();
 
   PageStorage* page_storage() { return page_storage_; }
   coroutine::CoroutineHandler* handler() { return handler_; }
+  TreeNodeCache* node_cache() { return node_cache_; }
 
   Status TreeNodeFromIdentifier(ObjectIdentifier object_identifier,
                                 std::unique_ptr<const TreeNode>* result);
 
+  // Starts reading the nodes with the given identifiers without waiting for
+  // the result. Nodes that are in the cache or already being prefetched are
+  // ignored, as well as all nodes once |kMaxPrefetchedNodes| are pending.
+  void PrefetchTreeNodes(
+      const std::vector<ObjectIdentifier>& object_identifiers);
+
+  // Forgets about a node passed to |PrefetchTreeNodes| that is not going to be
+  // requested anymore.
+  void DropPrefetchedTreeNode(const ObjectIdentifier& object_identifier);
+
   Status TreeNodesFromIdentifiers(
       std::vector<ObjectIdentifier> object_identifiers,
       std::vector<std::unique_ptr<const TreeNode>>* result);
@@ -40,8 +62,14 @@ class SynchronousStorage {
                              ObjectIdentifier* result);
 
  private:
+  class PrefetchedNode;
+
   PageStorage* page_storage_;
   coroutine::CoroutineHandler* handler_;
+  TreeNodeCache* node_cache_;
+  // Nodes whose read was started by |PrefetchTreeNodes| and that have not been
+  // requested yet.
+  std::map<ObjectIdentifier, fxl::RefPtr<PrefetchedNode>> prefetched_nodes_;
 
   FXL_DISALLOW_COPY_AND_ASSIGN(SynchronousStorage);
 };
@@ -4,7 +4,6 @@
 
 #include "peridot/bin/ledger/storage/impl/btree/tree_node.h"
 
-#include <algorithm>
 #include <utility>
 
 #include "lib/fsl/socket/strings.h"
@@ -14,6 +13,7 @@
 #include "lib/fxl/strings/string_printf.h"
 #include "peridot/bin/ledger/storage/impl/btree/encoding.h"
 #include "peridot/bin/ledger/storage/impl/object_digest.h"
+#include "peridot/bin/ledger/storage/impl/object_identifier_encoding.h"
 #include "peridot/bin/ledger/storage/public/constants.h"
 #include "peridot/bin/ledger/storage/public/make_object_identifier.h"
 #include "peridot/lib/callback/waiter.h"
@@ -24,15 +24,15 @@ namespace btree {
 
 TreeNode::TreeNode(PageStorage* page_storage,
                    ObjectIdentifier identifier,
-                   uint8_t level,
-                   std::vector<Entry> entries,
-                   std::map<size_t, ObjectIdentifier> children)
+                   std::shared_ptr<const Content> content)
     : page_storage_(page_storage),
       identifier_(std::move(identifier)),
-      level_(level),
-      entries_(std::move(entries)),
-      children_(std::move(children)) {
-  FXL_DCHECK(children_.empty() || children_.cbegin()->first <= entries_.size());
+      content_(std::move(content)) {
+  FXL_DCHECK(content_);
+  FXL_DCHECK(content_->storage);
+  FXL_DCHECK(content_->children.empty() ||
+             content_->children.cbegin()->first <=
+                 content_->storage->entries()->size());
 }
 
 TreeNode::~TreeNode() {}
@@ -81,12 +81,16 @@ void TreeNode::FromEntries(
 }
 
 int TreeNode::GetKeyCount() const {
-  return entries_.size();
+  return content_->storage->entries()->size();
 }
 
 Status TreeNode::GetEntry(int index, Entry* entry) const {
   FXL_DCHECK(index >= 0 && index < GetKeyCount());
-  *entry = entries_[index];
+  if (content_->entries) {
+    *entry = (*content_->entries)[index];
+    return Status::OK;
+  }
+  *entry = ToEntry(content_->storage->entries()->Get(index));
   return Status::OK;
 }
 
@@ -95,8 +99,8 @@ void TreeNode::GetChild(
     std::function<void(Status, std::unique_ptr<const TreeNode>)> callback)
     const {
   FXL_DCHECK(index >= 0 && index <= GetKeyCount());
-  const auto it = children_.find(index);
-  if (it == children_.end()) {
+  const auto it = content_->children.find(index);
+  if (it == content_->children.end()) {
     callback(Status::NO_SUCH_CHILD, nullptr);
     return;
   }
@@ -105,22 +109,32 @@ void TreeNode::GetChild(
 
 Status TreeNode::FindKeyOrChild(convert::ExtendedStringView key,
                                 int* index) const {
+  // Binary search directly on the serialized entries, so that no entry needs
+  // to be decoded.
+  const auto* entries = content_->storage->entries();
   if (key.empty()) {
     *index = 0;
-    return !entries_.empty() && entries_[0].key.empty() ? Status::OK
-                                                        : Status::NOT_FOUND;
+    return entries->size() > 0 &&
+                   convert::ExtendedStringView(entries->Get(0)->key()).empty()
+               ? Status::OK
+               : Status::NOT_FOUND;
+  }
+  // Find the first entry whose key is greater than or equal to |key|.
+  size_t begin = 0;
+  size_t end = entries->size();
+  while (begin < end) {
+    size_t middle = begin + (end - begin) / 2;
+    if (convert::ExtendedStringView(entries->Get(middle)->key()) < key) {
+      begin = middle + 1;
+    } else {
+      end = middle;
+    }
   }
-  auto it =
-      std::lower_bound(entries_.begin(), entries_.end(), key,
-                       [](const Entry& entry, convert::ExtendedStringView key) {
-                         return entry.key < key;
-                       });
-  if (it == entries_.end()) {
-    *index = entries_.size();
+  *index = begin;
+  if (begin == entries->size()) {
     return Status::NOT_FOUND;
   }
-  *index = it - entries_.begin();
-  if (it->key == key) {
+  if (convert::ExtendedStringView(entries->Get(begin)->key()) == key) {
     return Status::OK;
   }
   return Status::NOT_FOUND;
@@ -130,6 +144,40 @@ const ObjectIdentifier& TreeNode::GetIdentifier() const {
   return identifier_;
 }
 
+std::unique_ptr<const TreeNode> TreeNode::Clone() const {
+  return std::unique_ptr<const TreeNode>(
+      new TreeNode(page_storage_, identifier_, content_));
+}
+
+const std::vector<Entry>& TreeNode::entries() const {
+  if (!content_->entries) {
+    auto entries = std::make_unique<std::vector<Entry>>();
+    entries->reserve(content_->storage->entries()->size());
+    for (const auto* entry_storage : *(content_->storage->entries())) {
+      entries->push_back(ToEntry(entry_storage));
+    }
+    content_->entries = std::move(entries);
+  }
+  return *content_->entries;
+}
+
+size_t TreeNode::EstimateMemoryUsage() const {
+  size_t usage = sizeof(TreeNode) + sizeof(Content) +
+                 identifier_.object_digest.size() + content_->data.size();
+  // Account for the decoded entries, even if they are not decoded yet, as they
+  // might be later on.
+  for (const auto* entry_storage : *(content_->storage->entries())) {
+    usage += sizeof(Entry) + entry_storage->key()->size() +
+             entry_storage->object_id()->object_digest()->size();
+  }
+  for (const auto& child : content_->children) {
+    // Account for the map node overhead as well as the value itself.
+    usage += sizeof(child) + 4 * sizeof(void*) +
+             child.second.object_digest.size();
+  }
+  return usage;
+}
+
 Status TreeNode::FromObject(PageStorage* page_storage,
                             ObjectIdentifier identifier,
                             std::unique_ptr<const Object> object,
@@ -139,14 +187,20 @@ Status TreeNode::FromObject(PageStorage* page_storage,
   if (status != Status::OK) {
     return status;
   }
-  uint8_t level;
-  std::vector<Entry> entries;
-  std::map<size_t, ObjectIdentifier> children;
-  if (!DecodeNode(data, &level, &entries, &children)) {
-    return Status::FORMAT_ERROR;
+  FXL_DCHECK(CheckValidTreeNodeSerialization(data));
+  // Keep a single copy of the serialized node, so that the node does not
+  // depend on the lifetime of |object|.
+  auto content = std::make_shared<Content>();
+  content->data = data.ToString();
+  content->storage = GetTreeNodeStorage(
+      reinterpret_cast<const unsigned char*>(content->data.data()));
+  content->level = content->storage->level();
+  for (const auto* child_storage : *(content->storage->children())) {
+    content->children[child_storage->index()] =
+        ToObjectIdentifier(child_storage->object_id());
   }
-  node->reset(new TreeNode(page_storage, std::move(identifier), level,
-                           std::move(entries), std::move(children)));
+  node->reset(
+      new TreeNode(page_storage, std::move(identifier), std::move(content)));
   return Status::OK;
 }
 
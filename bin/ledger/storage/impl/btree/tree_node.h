@@ -5,7 +5,9 @@
 #ifndef PERIDOT_BIN_LEDGER_STORAGE_IMPL_BTREE_TREE_NODE_H_
 #define PERIDOT_BIN_LEDGER_STORAGE_IMPL_BTREE_TREE_NODE_H_
 
+#include <map>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "peridot/bin/ledger/storage/public/object.h"
@@ -14,6 +16,8 @@
 #include "peridot/lib/convert/convert.h"
 
 namespace storage {
+struct TreeNodeStorage;
+
 namespace btree {
 
 // A node of the B-Tree holding the commit contents.
@@ -68,20 +72,43 @@ class TreeNode {
 
   const ObjectIdentifier& GetIdentifier() const;
 
-  uint8_t level() const { return level_; }
+  // Returns a new |TreeNode| for the same node. The content is immutable and
+  // is shared with this node, so this does not copy any entry.
+  std::unique_ptr<const TreeNode> Clone() const;
+
+  // Returns an estimate of the memory, in bytes, used by the content of this
+  // node, including the entries once they are all decoded.
+  size_t EstimateMemoryUsage() const;
 
-  const std::vector<Entry>& entries() const { return entries_; }
+  uint8_t level() const { return content_->level; }
+
+  // Returns all the entries of this node. The entries are decoded on the first
+  // call: prefer |GetKeyCount|, |GetEntry| and |FindKeyOrChild| when only a
+  // few entries are needed.
+  const std::vector<Entry>& entries() const;
 
   const std::map<size_t, ObjectIdentifier>& children_identifiers() const {
-    return children_;
+    return content_->children;
   }
 
  private:
+  // The content of a node. Nodes are content addressed, so this never changes
+  // once read. Entries are read directly from the serialized node, and are
+  // only decoded when needed.
+  struct Content {
+    // The serialized node.
+    std::string data;
+    // The root of the serialized node, pointing into |data|.
+    const TreeNodeStorage* storage;
+    uint8_t level;
+    std::map<size_t, ObjectIdentifier> children;
+    // All the decoded entries. Only set once |entries()| has been called.
+    mutable std::unique_ptr<const std::vector<Entry>> entries;
+  };
+
   TreeNode(PageStorage* page_storage,
            ObjectIdentifier identifier,
-           uint8_t level,
-           std::vector<Entry> entries,
-           std::map<size_t, ObjectIdentifier> children);
+           std::shared_ptr<const Content> content);
 
   // Creates a |TreeNode| object for an existing |object| and stores it in the
   // given |node|.
@@ -92,9 +119,7 @@ class TreeNode {
 
   PageStorage* page_storage_;
   ObjectIdentifier identifier_;
-  const uint8_t level_;
-  const std::vector<Entry> entries_;
-  const std::map<size_t, ObjectIdentifier> children_;
+  const std::shared_ptr<const Content> content_;
 };
 
 }  // namespace btree
@@ -0,0 +1,74 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "peridot/bin/ledger/storage/impl/btree/tree_node_cache.h"
+
+#include <iterator>
+#include <utility>
+
+#include "lib/fxl/logging.h"
+
+namespace storage {
+namespace btree {
+
+TreeNodeCache::TreeNodeCache(size_t memory_budget)
+    : memory_budget_(memory_budget) {}
+
+TreeNodeCache::~TreeNodeCache() {}
+
+bool TreeNodeCache::Get(const ObjectIdentifier& identifier,
+                        std::unique_ptr<const TreeNode>* node) {
+  auto it = index_.find(identifier);
+  if (it == index_.end()) {
+    ++miss_count_;
+    return false;
+  }
+  ++hit_count_;
+  // Move the node at the front of the list.
+  lru_.splice(lru_.begin(), lru_, it->second);
+  *node = it->second->node->Clone();
+  return true;
+}
+
+void TreeNodeCache::Insert(const TreeNode& node) {
+  auto it = index_.find(node.GetIdentifier());
+  if (it != index_.end()) {
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return;
+  }
+
+  size_t node_memory_usage = node.EstimateMemoryUsage();
+  if (node_memory_usage > memory_budget_) {
+    // The node would evict everything else, and still not fit.
+    return;
+  }
+
+  while (memory_usage_ + node_memory_usage > memory_budget_) {
+    FXL_DCHECK(!lru_.empty());
+    Evict(std::prev(lru_.end()));
+    ++eviction_count_;
+  }
+
+  lru_.push_front({node.Clone(), node_memory_usage});
+  index_[node.GetIdentifier()] = lru_.begin();
+  memory_usage_ += node_memory_usage;
+}
+
+void TreeNodeCache::Remove(const ObjectIdentifier& identifier) {
+  auto it = index_.find(identifier);
+  if (it == index_.end()) {
+    return;
+  }
+  Evict(it->second);
+}
+
+void TreeNodeCache::Evict(LruList::iterator it) {
+  FXL_DCHECK(memory_usage_ >= it->memory_usage);
+  memory_usage_ -= it->memory_usage;
+  index_.erase(it->node->GetIdentifier());
+  lru_.erase(it);
+}
+
+}  // namespace btree
+}  // namespace storage
@@ -0,0 +1,91 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef PERIDOT_BIN_LEDGER_STORAGE_IMPL_BTREE_TREE_NODE_CACHE_H_
+#define PERIDOT_BIN_LEDGER_STORAGE_IMPL_BTREE_TREE_NODE_CACHE_H_
+
+#include <list>
+#include <map>
+#include <memory>
+
+#include "lib/fxl/macros.h"
+#include "peridot/bin/ledger/storage/impl/btree/tree_node.h"
+#include "peridot/bin/ledger/storage/public/types.h"
+
+namespace storage {
+namespace btree {
+
+// A bounded cache of decoded |TreeNode|s, keyed by their |ObjectIdentifier|.
+//
+// Tree nodes are content addressed and immutable, so a cached node never needs
+// to be invalidated as long as the object stays in the storage it was read
+// from. A cache must only be used with a single |PageStorage|. When the
+// estimated memory used by the cached nodes exceeds |memory_budget|, the least
+// recently used nodes are evicted.
+class TreeNodeCache {
+ public:
+  explicit TreeNodeCache(size_t memory_budget);
+  ~TreeNodeCache();
+
+  // Looks up the node with the given |identifier|. Returns true and sets
+  // |node| if the node is in the cache, returns false otherwise.
+  bool Get(const ObjectIdentifier& identifier,
+           std::unique_ptr<const TreeNode>* node);
+
+  // Returns whether the node with the given |identifier| is in the cache. This
+  // doesn't count as a use of the node.
+  bool Contains(const ObjectIdentifier& identifier) const {
+    return index_.count(identifier) > 0;
+  }
+
+  // Adds |node| to the cache. The cache keeps a copy of the node, sharing its
+  // decoded content.
+  void Insert(const TreeNode& node);
+
+  // Removes the node with the given |identifier| from the cache, if present.
+  // This must be called when the corresponding object is deleted from the
+  // storage.
+  void Remove(const ObjectIdentifier& identifier);
+
+  // Returns the number of nodes currently in the cache.
+  size_t size() const { return lru_.size(); }
+
+  // Returns the estimated memory, in bytes, used by the cached nodes.
+  size_t memory_usage() const { return memory_usage_; }
+
+  size_t memory_budget() const { return memory_budget_; }
+
+  // Counters, for tuning the cache budget.
+  uint64_t hit_count() const { return hit_count_; }
+  uint64_t miss_count() const { return miss_count_; }
+  uint64_t eviction_count() const { return eviction_count_; }
+
+ private:
+  struct CachedNode {
+    std::unique_ptr<const TreeNode> node;
+    size_t memory_usage;
+  };
+
+  using LruList = std::list<CachedNode>;
+
+  void Evict(LruList::iterator it);
+
+  const size_t memory_budget_;
+  size_t memory_usage_ = 0;
+
+  // Most recently used nodes are at the front of the list.
+  LruList lru_;
+  std::map<ObjectIdentifier, LruList::iterator> index_;
+
+  uint64_t hit_count_ = 0;
+  uint64_t miss_count_ = 0;
+  uint64_t eviction_count_ = 0;
+
+  FXL_DISALLOW_COPY_AND_ASSIGN(TreeNodeCache);
+};
+
+}  // namespace btree
+}  // namespace storage
+
+#endif  // PERIDOT_BIN_LEDGER_STORAGE_IMPL_BTREE_TREE_NODE_CACHE_H_
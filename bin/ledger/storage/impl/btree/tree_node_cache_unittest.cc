@@ -0,0 +1,147 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "peridot/bin/ledger/storage/impl/btree/tree_node_cache.h"
+
+#include "gtest/gtest.h"
+#include "lib/fxl/logging.h"
+#include "peridot/bin/ledger/storage/fake/fake_page_storage.h"
+#include "peridot/bin/ledger/storage/impl/storage_test_utils.h"
+
+namespace storage {
+namespace btree {
+namespace {
+
+class TreeNodeCacheTest : public StorageTest {
+ public:
+  TreeNodeCacheTest() : fake_storage_("page_id") {}
+
+  ~TreeNodeCacheTest() override {}
+
+ protected:
+  PageStorage* GetStorage() override { return &fake_storage_; }
+
+  // Creates a node containing a single entry with key "keyXX", where XX is
+  // |key_index|.
+  std::unique_ptr<const TreeNode> CreateNode(size_t key_index) {
+    std::vector<Entry> entries;
+    EXPECT_TRUE(CreateEntries(std::vector<size_t>({key_index}), &entries));
+    std::unique_ptr<const TreeNode> node;
+    EXPECT_TRUE(CreateNodeFromEntries(entries, {}, &node));
+    return node;
+  }
+
+  fake::FakePageStorage fake_storage_;
+
+ private:
+  FXL_DISALLOW_COPY_AND_ASSIGN(TreeNodeCacheTest);
+};
+
+TEST_F(TreeNodeCacheTest, GetInsert) {
+  TreeNodeCache cache(1024 * 1024);
+  std::unique_ptr<const TreeNode> node = CreateNode(0);
+
+  std::unique_ptr<const TreeNode> found_node;
+  EXPECT_FALSE(cache.Get(node->GetIdentifier(), &found_node));
+  EXPECT_EQ(nullptr, found_node);
+  EXPECT_EQ(0u, cache.hit_count());
+  EXPECT_EQ(1u, cache.miss_count());
+
+  cache.Insert(*node);
+  EXPECT_EQ(1u, cache.size());
+  EXPECT_EQ(node->EstimateMemoryUsage(), cache.memory_usage());
+
+  ASSERT_TRUE(cache.Get(node->GetIdentifier(), &found_node));
+  ASSERT_NE(nullptr, found_node);
+  EXPECT_EQ(1u, cache.hit_count());
+  EXPECT_EQ(1u, cache.miss_count());
+  EXPECT_EQ(node->GetIdentifier(), found_node->GetIdentifier());
+  EXPECT_EQ(node->level(), found_node->level());
+  EXPECT_EQ(node->entries(), found_node->entries());
+  EXPECT_EQ(node->children_identifiers(), found_node->children_identifiers());
+
+  // Inserting the same node again doesn't change the cache.
+  cache.Insert(*found_node);
+  EXPECT_EQ(1u, cache.size());
+  EXPECT_EQ(node->EstimateMemoryUsage(), cache.memory_usage());
+}
+
+TEST_F(TreeNodeCacheTest, CloneSharesContent) {
+  std::unique_ptr<const TreeNode> node = CreateNode(0);
+  std::unique_ptr<const TreeNode> clone = node->Clone();
+
+  EXPECT_EQ(node->GetIdentifier(), clone->GetIdentifier());
+  EXPECT_EQ(&node->entries(), &clone->entries());
+  EXPECT_EQ(&node->children_identifiers(), &clone->children_identifiers());
+
+  // The clone stays valid after the original node is deleted.
+  Entry expected_entry = node->entries()[0];
+  node.reset();
+  Entry entry;
+  EXPECT_EQ(Status::OK, clone->GetEntry(0, &entry));
+  EXPECT_EQ(expected_entry, entry);
+}
+
+TEST_F(TreeNodeCacheTest, EvictLeastRecentlyUsed) {
+  std::vector<std::unique_ptr<const TreeNode>> nodes;
+  for (size_t i = 0; i < 3; ++i) {
+    nodes.push_back(CreateNode(i));
+  }
+  size_t node_memory_usage = nodes[0]->EstimateMemoryUsage();
+  for (const auto& node : nodes) {
+    ASSERT_EQ(node_memory_usage, node->EstimateMemoryUsage());
+  }
+
+  // The budget only allows 2 nodes.
+  TreeNodeCache cache(2 * node_memory_usage);
+  cache.Insert(*nodes[0]);
+  cache.Insert(*nodes[1]);
+  EXPECT_EQ(2u, cache.size());
+
+  // Use the first node, so that the second one becomes the least recently
+  // used.
+  std::unique_ptr<const TreeNode> found_node;
+  EXPECT_TRUE(cache.Get(nodes[0]->GetIdentifier(), &found_node));
+
+  cache.Insert(*nodes[2]);
+  EXPECT_EQ(2u, cache.size());
+  EXPECT_EQ(1u, cache.eviction_count());
+  EXPECT_LE(cache.memory_usage(), cache.memory_budget());
+  EXPECT_TRUE(cache.Get(nodes[0]->GetIdentifier(), &found_node));
+  EXPECT_FALSE(cache.Get(nodes[1]->GetIdentifier(), &found_node));
+  EXPECT_TRUE(cache.Get(nodes[2]->GetIdentifier(), &found_node));
+}
+
+TEST_F(TreeNodeCacheTest, NodeLargerThanBudget) {
+  std::unique_ptr<const TreeNode> node = CreateNode(0);
+  TreeNodeCache cache(node->EstimateMemoryUsage() - 1);
+
+  cache.Insert(*node);
+  EXPECT_EQ(0u, cache.size());
+  EXPECT_EQ(0u, cache.memory_usage());
+  EXPECT_EQ(0u, cache.eviction_count());
+}
+
+TEST_F(TreeNodeCacheTest, Remove) {
+  TreeNodeCache cache(1024 * 1024);
+  std::unique_ptr<const TreeNode> node0 = CreateNode(0);
+  std::unique_ptr<const TreeNode> node1 = CreateNode(1);
+  cache.Insert(*node0);
+  cache.Insert(*node1);
+
+  cache.Remove(node0->GetIdentifier());
+  EXPECT_EQ(1u, cache.size());
+  EXPECT_EQ(node1->EstimateMemoryUsage(), cache.memory_usage());
+  std::unique_ptr<const TreeNode> found_node;
+  EXPECT_FALSE(cache.Get(node0->GetIdentifier(), &found_node));
+  EXPECT_TRUE(cache.Get(node1->GetIdentifier(), &found_node));
+
+  // Removing a node not in the cache is a no-op.
+  cache.Remove(node0->GetIdentifier());
+  EXPECT_EQ(1u, cache.size());
+}
+
+}  // namespace
+}  // namespace btree
+}  // namespace storage
@@ -129,6 +129,38 @@ TEST_F(TreeNodeTest, FindKeyOrChild) {
 
   EXPECT_EQ(Status::NOT_FOUND, node->FindKeyOrChild("key999", &index));
   EXPECT_EQ(10, index);
+
+  EXPECT_EQ(Status::NOT_FOUND, node->FindKeyOrChild("", &index));
+  EXPECT_EQ(0, index);
+}
+
+TEST_F(TreeNodeTest, FindKeyOrChildEmptyNode) {
+  std::unique_ptr<const TreeNode> node = CreateEmptyNode();
+
+  int index;
+  EXPECT_EQ(Status::NOT_FOUND, node->FindKeyOrChild("key", &index));
+  EXPECT_EQ(0, index);
+
+  EXPECT_EQ(Status::NOT_FOUND, node->FindKeyOrChild("", &index));
+  EXPECT_EQ(0, index);
+}
+
+TEST_F(TreeNodeTest, EntriesAndGetEntry) {
+  int size = 10;
+  std::vector<Entry> entries;
+  ASSERT_TRUE(CreateEntries(size, &entries));
+  std::unique_ptr<const TreeNode> node;
+  ASSERT_TRUE(CreateNodeFromEntries(entries, {}, &node));
+
+  // Entries can be read one at a time before and after all of them are
+  // decoded.
+  EXPECT_EQ(entries[3], GetEntry(node.get(), 3));
+  EXPECT_EQ(entries, node->entries());
+  std::unique_ptr<const TreeNode> clone = node->Clone();
+  EXPECT_EQ(entries, clone->entries());
+  for (int i = 0; i < size; ++i) {
+    EXPECT_EQ(entries[i], GetEntry(clone.get(), i));
+  }
 }
 
 TEST_F(TreeNodeTest, Serialization) {
@@ -0,0 +1,55 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "peridot/bin/ledger/storage/impl/commit_cache.h"
+
+#include <iterator>
+
+#include "lib/fxl/logging.h"
+
+namespace storage {
+
+CommitCache::CommitCache(size_t capacity) : capacity_(capacity) {}
+
+CommitCache::~CommitCache() {}
+
+bool CommitCache::Get(CommitIdView commit_id,
+                      std::unique_ptr<const Commit>* commit) {
+  auto it = index_.find(commit_id);
+  if (it == index_.end()) {
+    ++miss_count_;
+    return false;
+  }
+  ++hit_count_;
+  // Move the commit at the front of the list.
+  lru_.splice(lru_.begin(), lru_, it->second);
+  *commit = (*it->second)->Clone();
+  return true;
+}
+
+bool CommitCache::Contains(CommitIdView commit_id) const {
+  return index_.count(commit_id) > 0;
+}
+
+void CommitCache::Insert(const Commit& commit) {
+  auto it = index_.find(commit.GetId());
+  if (it != index_.end()) {
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return;
+  }
+  if (capacity_ == 0) {
+    return;
+  }
+
+  if (lru_.size() >= capacity_) {
+    auto last = std::prev(lru_.end());
+    index_.erase((*last)->GetId());
+    lru_.erase(last);
+  }
+
+  lru_.push_front(commit.Clone());
+  index_[lru_.front()->GetId()] = lru_.begin();
+}
+
+}  // namespace storage
@@ -0,0 +1,69 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef PERIDOT_BIN_LEDGER_STORAGE_IMPL_COMMIT_CACHE_H_
+#define PERIDOT_BIN_LEDGER_STORAGE_IMPL_COMMIT_CACHE_H_
+
+#include <list>
+#include <map>
+#include <memory>
+
+#include "lib/fxl/macros.h"
+#include "lib/fxl/strings/string_view.h"
+#include "peridot/bin/ledger/storage/public/commit.h"
+#include "peridot/bin/ledger/storage/public/types.h"
+
+namespace storage {
+
+// A bounded cache of parsed |Commit|s, keyed by their id.
+//
+// Commits are immutable, so a cached commit never needs to be invalidated. A
+// commit must only be inserted once it has been written to the storage, so
+// that finding a commit in the cache guarantees that it is present in the
+// storage. When more than |capacity| commits are cached, the least recently
+// used ones are evicted.
+class CommitCache {
+ public:
+  explicit CommitCache(size_t capacity);
+  ~CommitCache();
+
+  // Looks up the commit with the given |commit_id|. Returns true and sets
+  // |commit| if the commit is in the cache, returns false otherwise.
+  bool Get(CommitIdView commit_id, std::unique_ptr<const Commit>* commit);
+
+  // Returns whether the commit with the given |commit_id| is in the cache.
+  // This doesn't count as a use of the commit.
+  bool Contains(CommitIdView commit_id) const;
+
+  // Adds |commit| to the cache. The cache keeps a copy of the commit.
+  void Insert(const Commit& commit);
+
+  // Returns the number of commits currently in the cache.
+  size_t size() const { return lru_.size(); }
+
+  size_t capacity() const { return capacity_; }
+
+  // Counters, for tuning the cache capacity.
+  uint64_t hit_count() const { return hit_count_; }
+  uint64_t miss_count() const { return miss_count_; }
+
+ private:
+  using LruList = std::list<std::unique_ptr<const Commit>>;
+
+  const size_t capacity_;
+
+  // Most recently used commits are at the front of the list.
+  LruList lru_;
+  // The keys point to the ids of the commits in |lru_|.
+  std::map<fxl::StringView, LruList::iterator> index_;
+
+  uint64_t hit_count_ = 0;
+  uint64_t miss_count_ = 0;
+
+  FXL_DISALLOW_COPY_AND_ASSIGN(CommitCache);
+};
+
+}  // namespace storage
+
+#endif  // PERIDOT_BIN_LEDGER_STORAGE_IMPL_COMMIT_CACHE_H_
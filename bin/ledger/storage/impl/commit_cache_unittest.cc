@@ -0,0 +1,72 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "peridot/bin/ledger/storage/impl/commit_cache.h"
+
+#include "gtest/gtest.h"
+#include "peridot/bin/ledger/storage/impl/commit_random_impl.h"
+
+namespace storage {
+namespace {
+
+TEST(CommitCacheTest, GetInsert) {
+  CommitCache cache(10);
+  test::CommitRandomImpl commit;
+
+  std::unique_ptr<const Commit> found_commit;
+  EXPECT_FALSE(cache.Contains(commit.GetId()));
+  EXPECT_FALSE(cache.Get(commit.GetId(), &found_commit));
+  EXPECT_EQ(nullptr, found_commit);
+  EXPECT_EQ(0u, cache.hit_count());
+  EXPECT_EQ(1u, cache.miss_count());
+
+  cache.Insert(commit);
+  EXPECT_EQ(1u, cache.size());
+  EXPECT_TRUE(cache.Contains(commit.GetId()));
+
+  ASSERT_TRUE(cache.Get(commit.GetId(), &found_commit));
+  ASSERT_NE(nullptr, found_commit);
+  EXPECT_EQ(1u, cache.hit_count());
+  EXPECT_EQ(commit.GetId(), found_commit->GetId());
+  EXPECT_EQ(commit.GetGeneration(), found_commit->GetGeneration());
+  EXPECT_EQ(commit.GetRootIdentifier(), found_commit->GetRootIdentifier());
+  EXPECT_EQ(commit.GetStorageBytes(), found_commit->GetStorageBytes());
+
+  // Inserting the same commit again doesn't change the cache.
+  cache.Insert(*found_commit);
+  EXPECT_EQ(1u, cache.size());
+}
+
+TEST(CommitCacheTest, EvictLeastRecentlyUsed) {
+  test::CommitRandomImpl commit0, commit1, commit2;
+  CommitCache cache(2);
+  cache.Insert(commit0);
+  cache.Insert(commit1);
+  EXPECT_EQ(2u, cache.size());
+
+  // Use the first commit, so that the second one becomes the least recently
+  // used.
+  std::unique_ptr<const Commit> found_commit;
+  EXPECT_TRUE(cache.Get(commit0.GetId(), &found_commit));
+
+  cache.Insert(commit2);
+  EXPECT_EQ(2u, cache.size());
+  EXPECT_TRUE(cache.Contains(commit0.GetId()));
+  EXPECT_FALSE(cache.Contains(commit1.GetId()));
+  EXPECT_TRUE(cache.Contains(commit2.GetId()));
+}
+
+TEST(CommitCacheTest, CommitOutlivesCache) {
+  test::CommitRandomImpl commit;
+  std::unique_ptr<const Commit> found_commit;
+  {
+    CommitCache cache(1);
+    cache.Insert(commit);
+    ASSERT_TRUE(cache.Get(commit.GetId(), &found_commit));
+  }
+  EXPECT_EQ(commit.GetId(), found_commit->GetId());
+}
+
+}  // namespace
+}  // namespace storage
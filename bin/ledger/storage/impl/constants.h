@@ -9,6 +9,14 @@ namespace storage {
 
 constexpr size_t kStorageHashSize = 32;
 
+// Name of the directory holding the database of a page, in the directory of
+// the page.
+constexpr char kLevelDbDir[] = "/leveldb";
+
+// Name of the directory holding the blob store of a page, in the directory of
+// the page.
+constexpr char kBlobStoreDir[] = "/blobs";
+
 }  // namespace storage
 
 #endif  // PERIDOT_BIN_LEDGER_STORAGE_IMPL_CONSTANTS_H_
@@ -92,7 +92,10 @@ class Db {
       std::vector<std::pair<std::string, std::string>>* entries) = 0;
 
   // Retrieves an entry iterator over the entries whose keys start with
-  // |prefix|.
+  // |prefix|. The entries may be read from the database before this returns,
+  // so that iterating over them does not access it: all the entries of the
+  // range are then held in memory until the iterator is deleted. Only use it
+  // for ranges known to be small.
   FXL_WARN_UNUSED_RESULT virtual Status GetIteratorAtPrefix(
       coroutine::CoroutineHandler* handler,
       convert::ExtendedStringView prefix,
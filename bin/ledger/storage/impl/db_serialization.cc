@@ -74,6 +74,11 @@ std::string SyncMetadataRow::GetKeyFor(fxl::StringView key) {
   return fxl::Concatenate({kPrefix, key});
 }
 
+// PieceFormatRow.
+
+constexpr fxl::StringView PieceFormatRow::kKey;
+constexpr fxl::StringView PieceFormatRow::kEncoded;
+
 // JournalEntryRow.
 
 constexpr fxl::StringView JournalEntryRow::kPrefix;
@@ -66,6 +66,15 @@ class SyncMetadataRow {
   static std::string GetKeyFor(fxl::StringView key);
 };
 
+class PieceFormatRow {
+ public:
+  // Key of the row holding the |PieceFormat| of the page. The row is absent
+  // for |PieceFormat::RAW|.
+  static constexpr fxl::StringView kKey = "piece-format";
+  // Value of the row for |PieceFormat::ENCODED|.
+  static constexpr fxl::StringView kEncoded = "encoded";
+};
+
 class JournalEntryRow {
  public:
   // Journal keys
@@ -27,6 +27,7 @@ JournalImpl::JournalImpl(JournalType type,
       page_storage_(page_storage),
       id_(std::move(id)),
       base_(std::move(base)),
+      base_pin_(page_storage_->PinCommit(base_)),
       valid_(true),
       failed_operation_(false) {}
 
@@ -56,6 +57,7 @@ std::unique_ptr<Journal> JournalImpl::Merge(
   JournalImpl* db_journal = new JournalImpl(
       JournalType::EXPLICIT, coroutine_service, page_storage, id, base);
   db_journal->other_ = std::make_unique<CommitId>(other);
+  db_journal->other_pin_ = page_storage->PinCommit(other);
   std::unique_ptr<Journal> journal(db_journal);
   return journal;
 }
@@ -239,7 +241,9 @@ void JournalImpl::CreateCommitFromChanges(
                     }));
               }));
         }));
-      }));
+      }),
+      btree::GetDefaultNodeLevelCalculator(),
+      page_storage_->GetTreeNodeCache());
 }
 
 void JournalImpl::GetObjectsToSync(
@@ -93,7 +93,11 @@ class JournalImpl : public Journal {
   PageStorageImpl* const page_storage_;
   const JournalId id_;
   CommitId base_;
+  // Keep the contents of the parents of the future commit from being garbage
+  // collected while the journal is pending.
+  std::unique_ptr<PageStorage::CommitPin> base_pin_;
   std::unique_ptr<CommitId> other_;
+  std::unique_ptr<PageStorage::CommitPin> other_pin_;
   // A journal is no longer valid if either commit or rollback have been
   // executed.
   bool valid_;
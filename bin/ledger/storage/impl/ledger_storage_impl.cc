@@ -8,14 +8,22 @@
 #include <iterator>
 
 #include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
 
 #include "lib/fxl/files/directory.h"
 #include "lib/fxl/files/path.h"
+#include "lib/fxl/files/scoped_temp_dir.h"
 #include "lib/fxl/functional/make_copyable.h"
 #include "lib/fxl/logging.h"
 #include "lib/fxl/strings/concatenate.h"
+#include "peridot/bin/ledger/storage/impl/blob_store.h"
+#include "peridot/bin/ledger/storage/impl/constants.h"
 #include "peridot/bin/ledger/storage/impl/directory_reader.h"
+#include "peridot/bin/ledger/storage/impl/page_db_impl.h"
 #include "peridot/bin/ledger/storage/impl/page_storage_impl.h"
+#include "peridot/bin/ledger/storage/impl/prefixed_db.h"
 #include "peridot/bin/ledger/storage/public/constants.h"
 #include "peridot/lib/base64url/base64url.h"
 
@@ -23,6 +31,22 @@ namespace storage {
 
 namespace {
 
+using coroutine::CoroutineHandler;
+
+// Name of the directory of the database shared by the pages of a ledger. It
+// cannot be mistaken for the directory of a page, as encoded page ids only
+// contain full groups of 4 characters.
+constexpr fxl::StringView kSharedDbDir = "shared_db";
+
+// Name of the directory to which the directories of deleted pages are moved
+// until they are deleted. As |kSharedDbDir|, it cannot be mistaken for the
+// directory of a page.
+constexpr fxl::StringView kStagingDir = "staging";
+
+// Maximal number of rows read and copied in a single batch when migrating a
+// page to the shared database.
+constexpr size_t kMigrationBatchSize = 1000;
+
 // Encodes opaque bytes in a way that is usable as a directory name.
 std::string GetDirectoryName(fxl::StringView bytes) {
   return base64url::Base64UrlEncode(bytes);
@@ -37,20 +61,51 @@ std::string GetId(fxl::StringView bytes) {
   return decoded;
 }
 
+// Returns the prefix of the rows of the given page in the shared database. As
+// encoded page ids do not contain '/', the prefix of a page is never a prefix
+// of the prefix of another page.
+std::string GetSharedDbPrefix(PageIdView page_id) {
+  return fxl::Concatenate({"page/", GetDirectoryName(page_id), "/"});
+}
+
 }  // namespace
 
 LedgerStorageImpl::LedgerStorageImpl(
     fxl::RefPtr<fxl::TaskRunner> task_runner,
     coroutine::CoroutineService* coroutine_service,
     const std::string& base_storage_dir,
-    const std::string& ledger_name)
+    const std::string& ledger_name,
+    fxl::RefPtr<fxl::TaskRunner> io_runner,
+    fxl::RefPtr<fxl::TaskRunner> db_runner)
     : task_runner_(std::move(task_runner)),
-      coroutine_service_(coroutine_service) {
+      coroutine_service_(coroutine_service),
+      io_runner_(std::move(io_runner)),
+      db_runner_(std::move(db_runner)),
+      weak_factory_(this) {
   storage_dir_ = fxl::Concatenate({base_storage_dir, "/", kSerializationVersion,
                                    "/", GetDirectoryName(ledger_name)});
+  // Ledgers whose pages have been moved to a shared database keep using it.
+  use_shared_db_ = files::IsDirectory(GetSharedDbPath());
+  // Finish the deletions of pages that were interrupted. Only the entries
+  // present now are deleted, as pages deleted from now on are moved next to
+  // them.
+  std::string staging_path = GetStagingPath();
+  if (files::IsDirectory(staging_path)) {
+    DirectoryReader::GetDirectoryEntries(
+        staging_path, [this, &staging_path](fxl::StringView entry) {
+          std::string path = fxl::Concatenate({staging_path, "/", entry});
+          RunOnDbRunner([path] { files::DeletePath(path, true); });
+          return true;
+        });
+  }
 }
 
-LedgerStorageImpl::~LedgerStorageImpl() {}
+LedgerStorageImpl::~LedgerStorageImpl() {
+  // Interrupt any active handlers.
+  while (!handlers_.empty()) {
+    (*handlers_.begin())->Continue(true);
+  }
+}
 
 void LedgerStorageImpl::CreatePageStorage(
     PageId page_id,
@@ -61,39 +116,65 @@ void LedgerStorageImpl::CreatePageStorage(
     callback(Status::INTERNAL_IO_ERROR, nullptr);
     return;
   }
-  auto result = std::make_unique<PageStorageImpl>(
-      task_runner_, coroutine_service_, path, std::move(page_id));
-  result->Init(
-      fxl::MakeCopyable([callback = std::move(callback),
-                         result = std::move(result)](Status status) mutable {
-        if (status != Status::OK) {
-          FXL_LOG(ERROR) << "Failed to initialize PageStorage. Status: "
-                         << status;
-          callback(status, nullptr);
-          return;
-        }
-        callback(Status::OK, std::move(result));
-      }));
+  if (use_shared_db_) {
+    // The directory of the page only marks its existence, and its rows are
+    // stored in the shared database. Clear rows that may be left from an
+    // interrupted deletion of a previous page with the same id.
+    RunWhenNotDeleted(
+        page_id,
+        fxl::MakeCopyable([this, page_id,
+                           callback = std::move(callback)]() mutable {
+          RunInCoroutine(fxl::MakeCopyable(
+              [this, page_id = std::move(page_id),
+               callback = std::move(callback)](
+                  CoroutineHandler* handler) mutable {
+                Status status = SynchronousClearSharedPage(handler, page_id);
+                if (status != Status::OK) {
+                  callback(status, nullptr);
+                  return;
+                }
+                OpenSharedPageStorage(handler, std::move(page_id),
+                                      std::move(callback));
+              }));
+        }));
+    return;
+  }
+  InitPageStorage(std::make_unique<PageDbImpl>(task_runner_,
+                                               path + kLevelDbDir, db_runner_,
+                                               leveldb_options_),
+                  std::move(page_id), std::move(callback));
 }
 
 void LedgerStorageImpl::GetPageStorage(
     PageId page_id,
     std::function<void(Status, std::unique_ptr<PageStorage>)> callback) {
   std::string path = GetPathFor(page_id);
-  if (files::IsDirectory(path)) {
-    auto result = std::make_unique<PageStorageImpl>(
-        task_runner_, coroutine_service_, path, std::move(page_id));
-    result->Init(
-        fxl::MakeCopyable([callback = std::move(callback),
-                           result = std::move(result)](Status status) mutable {
-          if (status != Status::OK) {
-            callback(status, nullptr);
-            return;
+  if (use_shared_db_ && files::IsDirectory(path)) {
+    bool migrate = files::IsDirectory(path + kLevelDbDir);
+    RunInCoroutine(fxl::MakeCopyable(
+        [this, migrate, page_id = std::move(page_id),
+         callback = std::move(callback)](CoroutineHandler* handler) mutable {
+          if (migrate) {
+            Status status = SynchronousMigrateToSharedDb(handler, page_id);
+            if (status != Status::OK) {
+              FXL_LOG(ERROR) << "Failed to migrate page to the shared "
+                             << "database. Status: " << status;
+              callback(status, nullptr);
+              return;
+            }
           }
-          callback(status, std::move(result));
+          OpenSharedPageStorage(handler, std::move(page_id),
+                                std::move(callback));
         }));
     return;
   }
+  if (files::IsDirectory(path)) {
+    InitPageStorage(std::make_unique<PageDbImpl>(task_runner_,
+                                                 path + kLevelDbDir,
+                                                 db_runner_, leveldb_options_),
+                    std::move(page_id), std::move(callback));
+    return;
+  }
   // TODO(nellyv): Maybe the page exists but is not synchronized, yet. We need
   // to check in the cloud.
   callback(Status::NOT_FOUND, nullptr);
@@ -105,10 +186,48 @@ bool LedgerStorageImpl::DeletePageStorage(PageIdView page_id) {
   if (!files::IsDirectory(path)) {
     return false;
   }
-  if (!files::DeletePath(path, true)) {
-    FXL_LOG(ERROR) << "Unable to delete: " << path;
+  // The directory is moved away, so that the page no longer exists, and only
+  // deleted on the database runner, once the database of the page, which may
+  // still be closing there, is closed.
+  auto staging_dir = std::make_unique<files::ScopedTempDir>(GetStagingPath());
+  std::string destination = staging_dir->path() + "/page";
+  if (rename(path.c_str(), destination.c_str()) != 0) {
+    FXL_LOG(ERROR) << "Unable to move page storage at " << path << " to "
+                   << destination << ". Error: " << strerror(errno);
     return false;
   }
+  RunOnDbRunner(fxl::MakeCopyable(
+      [staging_dir = std::move(staging_dir)]() mutable {
+        staging_dir.reset();
+      }));
+  if (!use_shared_db_) {
+    return true;
+  }
+  // The page no longer exists once its directory is deleted. Its rows are
+  // deleted from the shared database in the background, and the page cannot
+  // be created again until they are.
+  PageId id = page_id.ToString();
+  if (!pending_deletions_.emplace(id, std::vector<fxl::Closure>()).second) {
+    // A deletion of the page is already in progress.
+    return true;
+  }
+  RunInCoroutine([this, id = std::move(id)](CoroutineHandler* handler) {
+    Status status = SynchronousClearSharedPage(handler, id);
+    if (status == Status::INTERRUPTED) {
+      return;
+    }
+    if (status != Status::OK) {
+      FXL_LOG(ERROR) << "Failed to delete page from the shared database. "
+                     << "Status: " << status;
+    }
+    auto it = pending_deletions_.find(id);
+    FXL_DCHECK(it != pending_deletions_.end());
+    std::vector<fxl::Closure> callbacks = std::move(it->second);
+    pending_deletions_.erase(it);
+    for (auto& callback : callbacks) {
+      callback();
+    }
+  });
   return true;
 }
 
@@ -116,7 +235,10 @@ std::vector<PageId> LedgerStorageImpl::ListLocalPages() {
   std::vector<PageId> local_pages;
   DirectoryReader::GetDirectoryEntries(
       storage_dir_, [&local_pages](fxl::StringView encoded_page_id) {
-        local_pages.emplace_back(GetId(encoded_page_id));
+        if (encoded_page_id != kSharedDbDir &&
+            encoded_page_id != kStagingDir) {
+          local_pages.emplace_back(GetId(encoded_page_id));
+        }
         return true;
       });
   return local_pages;
@@ -127,4 +249,235 @@ std::string LedgerStorageImpl::GetPathFor(PageIdView page_id) {
   return fxl::Concatenate({storage_dir_, "/", GetDirectoryName(page_id)});
 }
 
+std::string LedgerStorageImpl::GetSharedDbPath() {
+  return fxl::Concatenate({storage_dir_, "/", kSharedDbDir});
+}
+
+std::string LedgerStorageImpl::GetStagingPath() {
+  return fxl::Concatenate({storage_dir_, "/", kStagingDir});
+}
+
+void LedgerStorageImpl::RunOnDbRunner(fxl::Closure task) {
+  if (!db_runner_) {
+    task();
+    return;
+  }
+  db_runner_->PostTask(std::move(task));
+}
+
+Status LedgerStorageImpl::SynchronousDeletePath(CoroutineHandler* handler,
+                                                std::string path) {
+  bool deleted;
+  if (coroutine::SyncCall(
+          handler,
+          [this, &path](std::function<void(bool)> callback) {
+            RunOnDbRunner([path, task_runner = task_runner_,
+                           callback = std::move(callback)] {
+              bool deleted = files::DeletePath(path, true);
+              task_runner->PostTask([deleted, callback] { callback(deleted); });
+            });
+          },
+          &deleted)) {
+    return Status::INTERRUPTED;
+  }
+  if (!deleted) {
+    FXL_LOG(ERROR) << "Unable to delete: " << path;
+    return Status::INTERNAL_IO_ERROR;
+  }
+  return Status::OK;
+}
+
+Status LedgerStorageImpl::SynchronousInitSharedDb(CoroutineHandler* handler) {
+  FXL_DCHECK(use_shared_db_);
+  if (shared_db_) {
+    return Status::OK;
+  }
+  Status status;
+  if (coroutine::SyncCall(
+          handler,
+          [this](std::function<void(Status)> callback) {
+            shared_db_serializer_.Serialize<Status>(
+                std::move(callback),
+                [this](std::function<void(Status)> callback) {
+                  if (shared_db_) {
+                    callback(Status::OK);
+                    return;
+                  }
+                  RunInCoroutine([this, callback = std::move(callback)](
+                                     CoroutineHandler* handler) {
+                    auto db = std::make_unique<LevelDb>(
+                        task_runner_, GetSharedDbPath(), db_runner_,
+                        leveldb_options_);
+                    // All the pages of the ledger write to this database:
+                    // group their batches to reduce the number of writes.
+                    if (leveldb_options_ &&
+                        leveldb_options_->shared_db_group_commit_window() >
+                            fxl::TimeDelta::Zero()) {
+                      db->EnableGroupCommit(
+                          leveldb_options_->shared_db_group_commit_window());
+                    }
+                    Status status = db->Init(handler);
+                    if (status == Status::INTERRUPTED) {
+                      return;
+                    }
+                    if (status == Status::OK) {
+                      shared_db_ = std::move(db);
+                    }
+                    // Resume the waiting coroutine from the main runner,
+                    // rather than from this coroutine.
+                    task_runner_->PostTask(
+                        [callback, status] { callback(status); });
+                  });
+                });
+          },
+          &status)) {
+    return Status::INTERRUPTED;
+  }
+  return status;
+}
+
+void LedgerStorageImpl::RunWhenNotDeleted(PageIdView page_id,
+                                          fxl::Closure callback) {
+  auto it = pending_deletions_.find(page_id);
+  if (it == pending_deletions_.end()) {
+    callback();
+    return;
+  }
+  it->second.push_back(std::move(callback));
+}
+
+void LedgerStorageImpl::RunInCoroutine(
+    std::function<void(CoroutineHandler*)> operation) {
+  coroutine_service_->StartCoroutine(
+      [weak_this = weak_factory_.GetWeakPtr(),
+       operation = std::move(operation)](CoroutineHandler* handler) {
+        weak_this->handlers_.insert(handler);
+        operation(handler);
+        if (weak_this) {
+          weak_this->handlers_.erase(handler);
+        }
+      });
+}
+
+void LedgerStorageImpl::OpenSharedPageStorage(
+    CoroutineHandler* handler,
+    PageId page_id,
+    std::function<void(Status, std::unique_ptr<PageStorage>)> callback) {
+  Status status = SynchronousInitSharedDb(handler);
+  if (status != Status::OK) {
+    callback(status, nullptr);
+    return;
+  }
+  auto page_db = std::make_unique<PageDbImpl>(std::make_unique<PrefixedDb>(
+      shared_db_.get(), GetSharedDbPrefix(page_id)));
+  InitPageStorage(std::move(page_db), std::move(page_id), std::move(callback));
+}
+
+void LedgerStorageImpl::InitPageStorage(
+    std::unique_ptr<PageDb> page_db,
+    PageId page_id,
+    std::function<void(Status, std::unique_ptr<PageStorage>)> callback) {
+  std::unique_ptr<BlobStore> blob_store;
+  if (use_blob_store_) {
+    blob_store = std::make_unique<BlobStore>(
+        task_runner_, GetPathFor(page_id) + kBlobStoreDir, io_runner_);
+  }
+  auto result = std::make_unique<PageStorageImpl>(
+      task_runner_, coroutine_service_, std::move(page_db), std::move(page_id),
+      io_runner_);
+  result->SetPieceCompression(piece_compression_);
+  if (blob_store) {
+    result->SetBlobStore(std::move(blob_store));
+  }
+  result->Init(
+      fxl::MakeCopyable([callback = std::move(callback),
+                         result = std::move(result)](Status status) mutable {
+        if (status != Status::OK) {
+          FXL_LOG(ERROR) << "Failed to initialize PageStorage. Status: "
+                         << status;
+          callback(status, nullptr);
+          return;
+        }
+        callback(Status::OK, std::move(result));
+      }));
+}
+
+Status LedgerStorageImpl::SynchronousClearSharedPage(CoroutineHandler* handler,
+                                                     PageIdView page_id) {
+  Status status = SynchronousInitSharedDb(handler);
+  if (status != Status::OK) {
+    return status;
+  }
+  std::unique_ptr<Db::Batch> batch;
+  status = shared_db_->StartBatch(handler, &batch);
+  if (status != Status::OK) {
+    return status;
+  }
+  status = batch->DeleteByPrefix(handler, GetSharedDbPrefix(page_id));
+  if (status != Status::OK) {
+    return status;
+  }
+  return batch->Execute(handler);
+}
+
+Status LedgerStorageImpl::SynchronousMigrateToSharedDb(
+    CoroutineHandler* handler,
+    PageIdView page_id) {
+  // Rows copied by a previous, interrupted, migration are cleared first. The
+  // database of the page is only deleted once all its rows are copied, so
+  // that the migration is restarted if it does not complete.
+  Status status = SynchronousClearSharedPage(handler, page_id);
+  if (status != Status::OK) {
+    return status;
+  }
+  std::string page_db_path = GetPathFor(page_id) + kLevelDbDir;
+  {
+    LevelDb page_db(task_runner_, page_db_path, db_runner_, leveldb_options_);
+    status = page_db.Init(handler);
+    if (status != Status::OK) {
+      return status;
+    }
+    PrefixedDb shared_page_db(shared_db_.get(), GetSharedDbPrefix(page_id));
+    // The rows are read by windows, so that they are never all in memory.
+    std::string start;
+    while (true) {
+      std::vector<std::pair<std::string, std::string>> entries;
+      status = page_db.GetEntriesFrom(handler, start, kMigrationBatchSize,
+                                      &entries);
+      if (status != Status::OK) {
+        return status;
+      }
+      if (entries.empty()) {
+        break;
+      }
+      std::unique_ptr<Db::Batch> batch;
+      status = shared_page_db.StartBatch(handler, &batch);
+      if (status != Status::OK) {
+        return status;
+      }
+      for (const auto& entry : entries) {
+        status = batch->Put(handler, entry.first, entry.second);
+        if (status != Status::OK) {
+          return status;
+        }
+      }
+      status = batch->Execute(handler);
+      if (status != Status::OK) {
+        return status;
+      }
+      // The smallest key following the last copied one.
+      start = entries.back().first;
+      start.push_back('\0');
+    }
+  }
+  // The copied rows must be on disk before their only other copy is deleted.
+  status = shared_db_->Sync(handler);
+  if (status != Status::OK) {
+    return status;
+  }
+  // The database of the page is closed on the database runner: it is deleted
+  // there once it is.
+  return SynchronousDeletePath(handler, std::move(page_db_path));
+}
+
 }  // namespace storage
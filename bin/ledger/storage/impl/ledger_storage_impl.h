@@ -5,20 +5,39 @@
 #ifndef PERIDOT_BIN_LEDGER_STORAGE_IMPL_LEDGER_STORAGE_IMPL_H_
 #define PERIDOT_BIN_LEDGER_STORAGE_IMPL_LEDGER_STORAGE_IMPL_H_
 
+#include <map>
+#include <memory>
+#include <set>
 #include <string>
+#include <vector>
 
+#include "lib/fxl/functional/closure.h"
+#include "lib/fxl/memory/weak_ptr.h"
 #include "lib/fxl/tasks/task_runner.h"
 #include "peridot/bin/ledger/coroutine/coroutine.h"
+#include "peridot/bin/ledger/storage/impl/leveldb.h"
+#include "peridot/bin/ledger/storage/impl/leveldb_options.h"
+#include "peridot/bin/ledger/storage/impl/page_db.h"
 #include "peridot/bin/ledger/storage/public/ledger_storage.h"
+#include "peridot/bin/ledger/storage/public/piece_compression.h"
+#include "peridot/lib/callback/operation_serializer.h"
+#include "peridot/lib/convert/convert.h"
 
 namespace storage {
 
 class LedgerStorageImpl : public LedgerStorage {
  public:
+  // If |io_runner| is not null, the digests of large objects are computed and
+  // the files of the blob stores are accessed on it. If |db_runner| is not
+  // null, the databases are opened, accessed and closed on it, and the
+  // directories of deleted pages are deleted on it once their databases are
+  // closed.
   LedgerStorageImpl(fxl::RefPtr<fxl::TaskRunner> task_runner,
                     coroutine::CoroutineService* coroutine_service,
                     const std::string& base_storage_dir,
-                    const std::string& ledger_name);
+                    const std::string& ledger_name,
+                    fxl::RefPtr<fxl::TaskRunner> io_runner = nullptr,
+                    fxl::RefPtr<fxl::TaskRunner> db_runner = nullptr);
   ~LedgerStorageImpl() override;
 
   void CreatePageStorage(
@@ -32,15 +51,107 @@ class LedgerStorageImpl : public LedgerStorage {
 
   bool DeletePageStorage(PageIdView page_id) override;
 
+  // Sets the compression applied to the pieces written by the page storages
+  // created or opened from now on. See |PageStorageImpl::SetPieceCompression|.
+  void SetPieceCompression(PieceCompression piece_compression) {
+    piece_compression_ = piece_compression;
+  }
+
+  // Sets the options of the databases opened from now on. See
+  // |LevelDbOptions|.
+  void SetLevelDbOptions(std::shared_ptr<const LevelDbOptions> options) {
+    leveldb_options_ = std::move(options);
+  }
+
+  // Stores the pages of this ledger in a single database, with the keys of
+  // each page prefixed by its id, instead of one database per page. This
+  // avoids paying for the file descriptors, caches, logs and compactions of a
+  // database for every page. Pages previously stored in their own database
+  // are migrated to the shared one when they are opened; the migration cannot
+  // be reverted: a ledger with a shared database always uses it. Must be
+  // called before any page is created or opened, and the page storages must
+  // then be deleted before this object.
+  void UseSharedPageDb() { use_shared_db_ = true; }
+
+  // Stores the content of large objects in files next to the database of
+  // their page, from which they are handed out without being copied. See
+  // |BlobStore|.
+  void UseBlobStore() { use_blob_store_ = true; }
+
   // For debugging only.
   std::vector<PageId> ListLocalPages();
 
  private:
   std::string GetPathFor(PageIdView page_id);
+  std::string GetSharedDbPath();
+  std::string GetStagingPath();
+
+  // Runs |task| on the database runner, after the database operations already
+  // issued, or directly if there is none.
+  void RunOnDbRunner(fxl::Closure task);
+
+  // Deletes |path| on the database runner, after the database operations
+  // already issued, such as the closing of a database stored in |path|.
+  Status SynchronousDeletePath(coroutine::CoroutineHandler* handler,
+                               std::string path);
+
+  // Opens the shared database, if it is not open yet.
+  Status SynchronousInitSharedDb(coroutine::CoroutineHandler* handler);
+
+  // Runs |callback| once no deletion of the page with the given id is in
+  // progress.
+  void RunWhenNotDeleted(PageIdView page_id, fxl::Closure callback);
+
+  // Runs |operation| in a coroutine that is interrupted if this object is
+  // deleted.
+  void RunInCoroutine(
+      std::function<void(coroutine::CoroutineHandler*)> operation);
+
+  // Creates and initializes the storage of the page with the given id, with
+  // its rows stored in |page_db|.
+  void InitPageStorage(
+      std::unique_ptr<PageDb> page_db,
+      PageId page_id,
+      std::function<void(Status, std::unique_ptr<PageStorage>)> callback);
+
+  // Creates and initializes the storage of the page with the given id, stored
+  // in the shared database.
+  void OpenSharedPageStorage(
+      coroutine::CoroutineHandler* handler,
+      PageId page_id,
+      std::function<void(Status, std::unique_ptr<PageStorage>)> callback);
+
+  // Deletes all the rows of the page with the given id from the shared
+  // database.
+  Status SynchronousClearSharedPage(coroutine::CoroutineHandler* handler,
+                                    PageIdView page_id);
+
+  // Copies the rows of the page with the given id from its own database to
+  // the shared one, and deletes its own database.
+  Status SynchronousMigrateToSharedDb(coroutine::CoroutineHandler* handler,
+                                      PageIdView page_id);
 
   fxl::RefPtr<fxl::TaskRunner> task_runner_;
   coroutine::CoroutineService* const coroutine_service_;
+  fxl::RefPtr<fxl::TaskRunner> io_runner_;
+  fxl::RefPtr<fxl::TaskRunner> db_runner_;
   std::string storage_dir_;
+  PieceCompression piece_compression_ = PieceCompression::NONE;
+  std::shared_ptr<const LevelDbOptions> leveldb_options_;
+
+  bool use_shared_db_ = false;
+  bool use_blob_store_ = false;
+  std::unique_ptr<LevelDb> shared_db_;
+  // Serializes the attempts to open the shared database, which must only be
+  // opened once.
+  callback::OperationSerializer shared_db_serializer_;
+  // Ids of the pages being deleted from the shared database, with the
+  // callbacks waiting for their deletion to complete.
+  std::map<PageId, std::vector<fxl::Closure>, convert::StringViewComparator>
+      pending_deletions_;
+  std::set<coroutine::CoroutineHandler*> handlers_;
+
+  fxl::WeakPtrFactory<LedgerStorageImpl> weak_factory_;
 };
 
 }  // namespace storage
@@ -5,9 +5,12 @@
 #include "peridot/bin/ledger/storage/impl/ledger_storage_impl.h"
 
 #include <memory>
+#include <string>
+#include <thread>
 
 #include "gtest/gtest.h"
 #include "lib/fsl/tasks/message_loop.h"
+#include "lib/fsl/threading/create_thread.h"
 #include "lib/fxl/files/scoped_temp_dir.h"
 #include "lib/fxl/macros.h"
 #include "peridot/bin/ledger/coroutine/coroutine_impl.h"
@@ -27,13 +30,53 @@ class LedgerStorageTest : public gtest::TestWithMessageLoop {
 
   ~LedgerStorageTest() override {}
 
- private:
+ protected:
+  // Creates the page with the given id in |storage|, and sets its sync
+  // metadata for |key| to |value|.
+  void CreatePageWithMetadata(LedgerStorageImpl* storage,
+                              const PageId& page_id,
+                              const std::string& key,
+                              const std::string& value) {
+    Status status;
+    std::unique_ptr<PageStorage> page_storage;
+    storage->CreatePageStorage(
+        page_id, callback::Capture(MakeQuitTask(), &status, &page_storage));
+    EXPECT_FALSE(RunLoopWithTimeout());
+    ASSERT_EQ(Status::OK, status);
+    ASSERT_NE(nullptr, page_storage);
+
+    page_storage->SetSyncMetadata(
+        key, value, callback::Capture(MakeQuitTask(), &status));
+    EXPECT_FALSE(RunLoopWithTimeout());
+    EXPECT_EQ(Status::OK, status);
+  }
+
+  // Opens the page with the given id in |storage|, and returns its sync
+  // metadata for |key| in |value|.
+  void GetPageMetadata(LedgerStorageImpl* storage,
+                       const PageId& page_id,
+                       const std::string& key,
+                       Status* metadata_status,
+                       std::string* value) {
+    Status status;
+    std::unique_ptr<PageStorage> page_storage;
+    storage->GetPageStorage(
+        page_id, callback::Capture(MakeQuitTask(), &status, &page_storage));
+    EXPECT_FALSE(RunLoopWithTimeout());
+    ASSERT_EQ(Status::OK, status);
+    ASSERT_NE(nullptr, page_storage);
+
+    page_storage->GetSyncMetadata(
+        key, callback::Capture(MakeQuitTask(), metadata_status, value));
+    EXPECT_FALSE(RunLoopWithTimeout());
+  }
+
   files::ScopedTempDir tmp_dir_;
   coroutine::CoroutineServiceImpl coroutine_service_;
-
- protected:
   LedgerStorageImpl storage_;
 
+ private:
+
   FXL_DISALLOW_COPY_AND_ASSIGN(LedgerStorageTest);
 };
 
@@ -89,5 +132,122 @@ TEST_F(LedgerStorageTest, CreateDeletePageStorage) {
   EXPECT_EQ(nullptr, page_storage);
 }
 
+TEST_F(LedgerStorageTest, SharedDbCreateDeletePageStorage) {
+  storage_.UseSharedPageDb();
+  PageId page_id = "1234";
+  CreatePageWithMetadata(&storage_, page_id, "key", "value");
+  CreatePageWithMetadata(&storage_, "5678", "key", "other_value");
+
+  Status status;
+  std::string value;
+  GetPageMetadata(&storage_, page_id, "key", &status, &value);
+  EXPECT_EQ(Status::OK, status);
+  EXPECT_EQ("value", value);
+  GetPageMetadata(&storage_, "5678", "key", &status, &value);
+  EXPECT_EQ(Status::OK, status);
+  EXPECT_EQ("other_value", value);
+
+  EXPECT_EQ(2u, storage_.ListLocalPages().size());
+
+  // Deleting the page deletes its rows, and a new page with the same id starts
+  // empty.
+  EXPECT_TRUE(storage_.DeletePageStorage(page_id));
+  std::unique_ptr<PageStorage> page_storage;
+  storage_.GetPageStorage(
+      page_id, callback::Capture(MakeQuitTask(), &status, &page_storage));
+  EXPECT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(Status::NOT_FOUND, status);
+  EXPECT_EQ(nullptr, page_storage);
+
+  storage_.CreatePageStorage(
+      page_id, callback::Capture(MakeQuitTask(), &status, &page_storage));
+  EXPECT_FALSE(RunLoopWithTimeout());
+  ASSERT_EQ(Status::OK, status);
+  ASSERT_NE(nullptr, page_storage);
+  page_storage->GetSyncMetadata(
+      "key", callback::Capture(MakeQuitTask(), &status, &value));
+  EXPECT_FALSE(RunLoopWithTimeout());
+  EXPECT_EQ(Status::NOT_FOUND, status);
+  page_storage.reset();
+
+  // Other pages are not affected.
+  GetPageMetadata(&storage_, "5678", "key", &status, &value);
+  EXPECT_EQ(Status::OK, status);
+  EXPECT_EQ("other_value", value);
+}
+
+TEST_F(LedgerStorageTest, SharedDbGroupCommit) {
+  StorageProfile profile;
+  profile.shared_db_group_commit_window = fxl::TimeDelta::FromMilliseconds(10);
+  storage_.SetLevelDbOptions(std::make_shared<LevelDbOptions>(profile));
+  storage_.UseSharedPageDb();
+  CreatePageWithMetadata(&storage_, "1234", "key", "value");
+  CreatePageWithMetadata(&storage_, "5678", "key", "other_value");
+
+  Status status;
+  std::string value;
+  GetPageMetadata(&storage_, "1234", "key", &status, &value);
+  EXPECT_EQ(Status::OK, status);
+  EXPECT_EQ("value", value);
+  GetPageMetadata(&storage_, "5678", "key", &status, &value);
+  EXPECT_EQ(Status::OK, status);
+  EXPECT_EQ("other_value", value);
+}
+
+TEST_F(LedgerStorageTest, MigrateToSharedDb) {
+  PageId page_id = "1234";
+  CreatePageWithMetadata(&storage_, page_id, "key", "value");
+
+  Status status;
+  std::string value;
+  {
+    LedgerStorageImpl shared_storage(message_loop_.task_runner(),
+                                     &coroutine_service_, tmp_dir_.path(),
+                                     "test_app");
+    shared_storage.UseSharedPageDb();
+    GetPageMetadata(&shared_storage, page_id, "key", &status, &value);
+    EXPECT_EQ(Status::OK, status);
+    EXPECT_EQ("value", value);
+  }
+
+  // A storage for the same ledger keeps using the shared database, where the
+  // page has been migrated.
+  LedgerStorageImpl reopened_storage(message_loop_.task_runner(),
+                                     &coroutine_service_, tmp_dir_.path(),
+                                     "test_app");
+  GetPageMetadata(&reopened_storage, page_id, "key", &status, &value);
+  EXPECT_EQ(Status::OK, status);
+  EXPECT_EQ("value", value);
+}
+
+TEST_F(LedgerStorageTest, DbRunnerDeleteAndCreatePageStorage) {
+  fxl::RefPtr<fxl::TaskRunner> db_runner;
+  std::thread db_thread = fsl::CreateThread(&db_runner);
+  {
+    LedgerStorageImpl storage(message_loop_.task_runner(), &coroutine_service_,
+                              tmp_dir_.path(), "db_runner_app", nullptr,
+                              db_runner);
+    PageId page_id = "1234";
+    CreatePageWithMetadata(&storage, page_id, "key", "value");
+
+    // The database of the deleted page may still be closing on the database
+    // runner: a new page with the same id is stored in a new database.
+    EXPECT_TRUE(storage.DeletePageStorage(page_id));
+    EXPECT_TRUE(storage.ListLocalPages().empty());
+    CreatePageWithMetadata(&storage, page_id, "other_key", "value");
+
+    Status status;
+    std::string value;
+    GetPageMetadata(&storage, page_id, "key", &status, &value);
+    EXPECT_EQ(Status::NOT_FOUND, status);
+    GetPageMetadata(&storage, page_id, "other_key", &status, &value);
+    EXPECT_EQ(Status::OK, status);
+    EXPECT_EQ("value", value);
+    EXPECT_EQ(1u, storage.ListLocalPages().size());
+  }
+  db_runner->PostTask([] { fsl::MessageLoop::GetCurrent()->QuitNow(); });
+  db_thread.join();
+}
+
 }  // namespace
 }  // namespace storage
@@ -10,6 +10,7 @@
 
 #include "lib/fxl/files/directory.h"
 #include "lib/fxl/files/path.h"
+#include "lib/fxl/functional/make_copyable.h"
 #include "peridot/bin/ledger/cobalt/cobalt.h"
 #include "peridot/bin/ledger/coroutine/coroutine.h"
 #include "peridot/bin/ledger/storage/impl/object_impl.h"
@@ -20,6 +21,11 @@ using coroutine::CoroutineHandler;
 
 namespace {
 
+// Maximum number of operations on a batch between two yields of the
+// coroutine. Operations on a batch are only buffered in memory until the batch
+// is executed, so there is no need to yield after each one of them.
+constexpr size_t kBatchOperationsBetweenYields = 100;
+
 Status ConvertStatus(leveldb::Status s) {
   if (s.IsNotFound()) {
     return Status::NOT_FOUND;
@@ -31,35 +37,95 @@ Status ConvertStatus(leveldb::Status s) {
   return Status::OK;
 }
 
+leveldb::WriteOptions MakeSyncWriteOptions() {
+  leveldb::WriteOptions write_options;
+  write_options.sync = true;
+  return write_options;
+}
+
+Status WriteToDb(leveldb::DB* db,
+                 const leveldb::WriteOptions& write_options,
+                 leveldb::WriteBatch* db_batch) {
+  leveldb::Status status = db->Write(write_options, db_batch);
+  if (!status.ok()) {
+    FXL_LOG(ERROR) << "Failed to execute batch with status: "
+                   << status.ToString();
+    return Status::INTERNAL_IO_ERROR;
+  }
+  return Status::OK;
+}
+
+// Opens the database at |db_path|, creating it if needed, and recovers from
+// a corrupted database by erasing it.
+Status OpenDb(const std::string& db_path,
+              const std::shared_ptr<const LevelDbOptions>& options,
+              leveldb::DB** db) {
+  if (!files::CreateDirectory(db_path)) {
+    FXL_LOG(ERROR) << "Failed to create directory under " << db_path;
+    return Status::INTERNAL_IO_ERROR;
+  }
+  leveldb::Options db_options =
+      options ? options->options() : leveldb::Options();
+  db_options.create_if_missing = true;
+  leveldb::Status status = leveldb::DB::Open(db_options, db_path, db);
+  if (status.IsCorruption()) {
+    FXL_LOG(ERROR) << "Ledger state corrupted at " << db_path
+                   << " with leveldb status: " << status.ToString();
+    FXL_LOG(WARNING) << "Trying to recover by erasing the local state.";
+    FXL_LOG(WARNING)
+        << "***** ALL LOCAL CHANGES IN THIS PAGE WILL BE LOST *****";
+    ledger::ReportEvent(ledger::CobaltEvent::LEDGER_LEVELDB_STATE_CORRUPTED);
+
+    if (!files::DeletePath(db_path, true)) {
+      FXL_LOG(ERROR) << "Failed to delete corrupted ledger at " << db_path;
+      return Status::INTERNAL_IO_ERROR;
+    }
+    leveldb::Status status = leveldb::DB::Open(db_options, db_path, db);
+    if (!status.ok()) {
+      FXL_LOG(ERROR) << "Failed to create a new LevelDB at " << db_path
+                     << " with leveldb status: " << status.ToString();
+      return Status::INTERNAL_IO_ERROR;
+    }
+  } else if (!status.ok()) {
+    FXL_LOG(ERROR) << "Failed to open ledger at " << db_path
+                   << " with leveldb status: " << status.ToString();
+    return Status::INTERNAL_IO_ERROR;
+  }
+  return Status::OK;
+}
+
 class BatchImpl : public Db::Batch {
  public:
   // Creates a new Batch based on a leveldb batch. Once |Execute| is called,
   // |callback| will be called with the same batch, ready to be written in
-  // leveldb. If the destructor is called without a previous execution of the
-  // batch, |callback| will be called with a |nullptr|.
-  BatchImpl(
-      fxl::RefPtr<fxl::TaskRunner> task_runner,
-      std::unique_ptr<leveldb::WriteBatch> batch,
-      leveldb::DB* db,
-      std::function<Status(std::unique_ptr<leveldb::WriteBatch>)> callback)
+  // leveldb, and a callback to be called with the status of the write. If the
+  // destructor is called without a previous execution of the batch,
+  // |callback| will be called with a |nullptr|. |run_on_db| runs a read of
+  // the database as |LevelDb::RunOnIORunnerAndCheck| does.
+  BatchImpl(fxl::RefPtr<fxl::TaskRunner> task_runner,
+            std::unique_ptr<leveldb::WriteBatch> batch,
+            std::function<bool(CoroutineHandler*,
+                               std::function<void(leveldb::DB*)>)> run_on_db,
+            std::function<void(std::unique_ptr<leveldb::WriteBatch>,
+                               std::function<void(Status)>)> callback)
       : task_runner_(std::move(task_runner)),
         batch_(std::move(batch)),
-        db_(db),
+        run_on_db_(std::move(run_on_db)),
         callback_(std::move(callback)) {}
 
   ~BatchImpl() override {
     if (batch_)
-      callback_(nullptr);
+      callback_(nullptr, [](Status status) {});
   }
 
   Status Put(CoroutineHandler* handler,
              convert::ExtendedStringView key,
              fxl::StringView value) override {
     FXL_DCHECK(batch_);
-    if (MakeEmptySyncCallAndCheck(handler)) {
+    batch_->Put(key, convert::ToSlice(value));
+    if (MaybeYieldAndCheck(handler)) {
       return Status::INTERRUPTED;
     }
-    batch_->Put(key, convert::ToSlice(value));
     return Status::OK;
   }
 
@@ -67,10 +133,7 @@ class BatchImpl : public Db::Batch {
                 convert::ExtendedStringView key) override {
     FXL_DCHECK(batch_);
     batch_->Delete(key);
-    if (coroutine::SyncCall(handler, [this](fxl::Closure on_done) {
-          task_runner_->PostTask(
-              [on_done = std::move(on_done)]() { on_done(); });
-        })) {
+    if (MaybeYieldAndCheck(handler)) {
       return Status::INTERRUPTED;
     }
     return Status::OK;
@@ -79,29 +142,46 @@ class BatchImpl : public Db::Batch {
   Status DeleteByPrefix(CoroutineHandler* handler,
                         convert::ExtendedStringView prefix) override {
     FXL_DCHECK(batch_);
-    std::unique_ptr<leveldb::Iterator> it(db_->NewIterator(read_options_));
-    for (it->Seek(prefix); it->Valid() && it->key().starts_with(prefix);
-         it->Next()) {
-      batch_->Delete(it->key());
-    }
-    if (coroutine::SyncCall(handler, [this](fxl::Closure on_done) {
-          task_runner_->PostTask(
-              [on_done = std::move(on_done)]() { on_done(); });
+    // The keys are read where the database is accessed, and only deleted from
+    // the batch, which this object owns, once they are.
+    auto result =
+        std::make_shared<std::pair<Status, std::vector<std::string>>>();
+    if (run_on_db_(handler, [read_options = read_options_,
+                             prefix = prefix.ToString(),
+                             result](leveldb::DB* db) {
+          std::unique_ptr<leveldb::Iterator> it(db->NewIterator(read_options));
+          for (it->Seek(prefix); it->Valid() && it->key().starts_with(prefix);
+               it->Next()) {
+            result->second.push_back(it->key().ToString());
+          }
+          result->first = ConvertStatus(it->status());
         })) {
       return Status::INTERRUPTED;
     }
-    return ConvertStatus(it->status());
+    if (result->first != Status::OK) {
+      return result->first;
+    }
+    for (const auto& key : result->second) {
+      batch_->Delete(key);
+    }
+    return Status::OK;
   }
 
   Status Execute(CoroutineHandler* handler) override {
     FXL_DCHECK(batch_);
-    if (coroutine::SyncCall(handler, [this](fxl::Closure on_done) {
-          task_runner_->PostTask(
-              [on_done = std::move(on_done)]() { on_done(); });
-        })) {
+    if (MakeEmptySyncCallAndCheck(handler)) {
       return Status::INTERRUPTED;
     }
-    return callback_(std::move(batch_));
+    Status status;
+    if (coroutine::SyncCall(
+            handler,
+            [this](std::function<void(Status)> callback) {
+              callback_(std::move(batch_), std::move(callback));
+            },
+            &status)) {
+      return Status::INTERRUPTED;
+    }
+    return status;
   }
 
   bool MakeEmptySyncCallAndCheck(coroutine::CoroutineHandler* handler) {
@@ -111,21 +191,39 @@ class BatchImpl : public Db::Batch {
   }
 
  private:
+  // Yields the coroutine once every |kBatchOperationsBetweenYields| calls, and
+  // returns whether the coroutine was interrupted. Interruption is always
+  // checked in |Execute|.
+  bool MaybeYieldAndCheck(coroutine::CoroutineHandler* handler) {
+    if (++operations_since_yield_ < kBatchOperationsBetweenYields) {
+      return false;
+    }
+    operations_since_yield_ = 0;
+    return MakeEmptySyncCallAndCheck(handler);
+  }
+
   fxl::RefPtr<fxl::TaskRunner> task_runner_;
   std::unique_ptr<leveldb::WriteBatch> batch_;
 
   const leveldb::ReadOptions read_options_;
-  leveldb::DB* db_;
+  std::function<bool(CoroutineHandler*, std::function<void(leveldb::DB*)>)>
+      run_on_db_;
+
+  std::function<void(std::unique_ptr<leveldb::WriteBatch>,
+                     std::function<void(Status)>)>
+      callback_;
 
-  std::function<Status(std::unique_ptr<leveldb::WriteBatch>)> callback_;
+  size_t operations_since_yield_ = 0;
 };
 
+// Iterates over rows read from the database beforehand, so that iterating
+// does not access the database.
 class RowIterator
     : public Iterator<const std::pair<convert::ExtendedStringView,
                                       convert::ExtendedStringView>> {
  public:
-  RowIterator(std::unique_ptr<leveldb::Iterator> it, std::string prefix)
-      : it_(std::move(it)), prefix_(std::move(prefix)) {
+  explicit RowIterator(std::vector<std::pair<std::string, std::string>> rows)
+      : rows_(std::move(rows)) {
     PrepareEntry();
   }
 
@@ -134,18 +232,14 @@ class RowIterator
   Iterator<const std::pair<convert::ExtendedStringView,
                            convert::ExtendedStringView>>&
   Next() override {
-    it_->Next();
+    ++index_;
     PrepareEntry();
     return *this;
   }
 
-  bool Valid() const final {
-    return it_->Valid() && it_->key().starts_with(prefix_);
-  }
+  bool Valid() const final { return index_ < rows_.size(); }
 
-  Status GetStatus() const override {
-    return it_->status().ok() ? Status::OK : Status::INTERNAL_IO_ERROR;
-  }
+  Status GetStatus() const override { return Status::OK; }
 
   const std::pair<convert::ExtendedStringView, convert::ExtendedStringView>&
   operator*() const override {
@@ -165,11 +259,11 @@ class RowIterator
     }
     row_ = std::make_unique<
         std::pair<convert::ExtendedStringView, convert::ExtendedStringView>>(
-        it_->key(), it_->value());
+        rows_[index_].first, rows_[index_].second);
   }
 
-  std::unique_ptr<leveldb::Iterator> it_;
-  const std::string prefix_;
+  const std::vector<std::pair<std::string, std::string>> rows_;
+  size_t index_ = 0;
 
   std::unique_ptr<
       std::pair<convert::ExtendedStringView, convert::ExtendedStringView>>
@@ -178,49 +272,74 @@ class RowIterator
 
 }  // namespace
 
-LevelDb::LevelDb(fxl::RefPtr<fxl::TaskRunner> task_runner, std::string db_path)
-    : task_runner_(std::move(task_runner)), db_path_(std::move(db_path)) {}
+LevelDb::LevelDb(fxl::RefPtr<fxl::TaskRunner> task_runner,
+                 std::string db_path,
+                 fxl::RefPtr<fxl::TaskRunner> io_runner,
+                 std::shared_ptr<const LevelDbOptions> options)
+    : task_runner_(task_runner),
+      db_path_(std::move(db_path)),
+      io_runner_(std::move(io_runner)),
+      options_(std::move(options)),
+      sync_write_options_(MakeSyncWriteOptions()),
+      scoped_task_runner_(std::move(task_runner)) {}
 
 LevelDb::~LevelDb() {
+  // Batches have been executed: write them before closing the database.
+  FlushPendingBatches();
   FXL_DCHECK(!active_batches_count_)
       << "Not all LevelDb batches have been executed or rolled back.";
+  if (io_runner_ && db_) {
+    // Close the database on the I/O runner once the operations in progress
+    // are done, without waiting for it: as operations run there in order, the
+    // database can already be opened again by a later |Init|.
+    io_runner_->PostTask([db = std::move(db_)]() mutable { db.reset(); });
+  }
 }
 
-Status LevelDb::Init() {
+Status LevelDb::Init(CoroutineHandler* handler) {
   TRACE_DURATION("ledger", "leveldb_init");
-  if (!files::CreateDirectory(db_path_)) {
-    FXL_LOG(ERROR) << "Failed to create directory under " << db_path_;
-    return Status::INTERNAL_IO_ERROR;
+  auto result =
+      std::make_shared<std::pair<Status, std::shared_ptr<leveldb::DB>>>();
+  if (RunOnIORunnerAndCheck(
+          handler, [db_path = db_path_, options = options_,
+                    result](leveldb::DB* /*db*/) {
+            leveldb::DB* db = nullptr;
+            result->first = OpenDb(db_path, options, &db);
+            if (result->first == Status::OK) {
+              // The options own the cache and filter policy used by the
+              // database: keep them until it is closed.
+              result->second.reset(db,
+                                   [options](leveldb::DB* db) { delete db; });
+            }
+          })) {
+    return Status::INTERRUPTED;
   }
-  leveldb::DB* db = nullptr;
-  leveldb::Options options;
-  options.create_if_missing = true;
-  leveldb::Status status = leveldb::DB::Open(options, db_path_, &db);
-  if (status.IsCorruption()) {
-    FXL_LOG(ERROR) << "Ledger state corrupted at " << db_path_
-                   << " with leveldb status: " << status.ToString();
-    FXL_LOG(WARNING) << "Trying to recover by erasing the local state.";
-    FXL_LOG(WARNING)
-        << "***** ALL LOCAL CHANGES IN THIS PAGE WILL BE LOST *****";
-    ledger::ReportEvent(ledger::CobaltEvent::LEDGER_LEVELDB_STATE_CORRUPTED);
+  if (result->first == Status::OK) {
+    db_ = std::move(result->second);
+  }
+  return result->first;
+}
 
-    if (!files::DeletePath(db_path_, true)) {
-      FXL_LOG(ERROR) << "Failed to delete corrupted ledger at " << db_path_;
-      return Status::INTERNAL_IO_ERROR;
-    }
-    leveldb::Status status = leveldb::DB::Open(options, db_path_, &db);
-    if (!status.ok()) {
-      FXL_LOG(ERROR) << "Failed to create a new LevelDB at " << db_path_
-                     << " with leveldb status: " << status.ToString();
-      return Status::INTERNAL_IO_ERROR;
-    }
-  } else if (!status.ok()) {
-    FXL_LOG(ERROR) << "Failed to open ledger at " << db_path_
-                   << " with leveldb status: " << status.ToString();
-    return Status::INTERNAL_IO_ERROR;
+void LevelDb::EnableGroupCommit(fxl::TimeDelta window) {
+  FXL_DCHECK(window > fxl::TimeDelta::Zero());
+  group_commit_window_ = window;
+}
+
+Status LevelDb::Sync(CoroutineHandler* handler) {
+  // Writes are done in order: the synced write that follows the pending
+  // batches, or the unsynced writes already issued, makes them durable too.
+  FlushPendingBatches();
+  Status status;
+  if (coroutine::SyncCall(
+          handler,
+          [this](std::function<void(Status)> callback) {
+            Write(std::make_unique<leveldb::WriteBatch>(), sync_write_options_,
+                  std::move(callback));
+          },
+          &status)) {
+    return Status::INTERRUPTED;
   }
-  db_.reset(db);
-  return Status::OK;
+  return status;
 }
 
 Status LevelDb::StartBatch(CoroutineHandler* handler,
@@ -228,18 +347,19 @@ Status LevelDb::StartBatch(CoroutineHandler* handler,
   auto db_batch = std::make_unique<leveldb::WriteBatch>();
   active_batches_count_++;
   *batch = std::make_unique<BatchImpl>(
-      task_runner_, std::move(db_batch), db_.get(),
-      [this](std::unique_ptr<leveldb::WriteBatch> db_batch) {
+      task_runner_, std::move(db_batch),
+      [this](CoroutineHandler* handler,
+             std::function<void(leveldb::DB*)> operation) {
+        return RunOnIORunnerAndCheck(handler, std::move(operation));
+      },
+      [this](std::unique_ptr<leveldb::WriteBatch> db_batch,
+             std::function<void(Status)> callback) {
         active_batches_count_--;
-        if (db_batch) {
-          leveldb::Status status = db_->Write(write_options_, db_batch.get());
-          if (!status.ok()) {
-            FXL_LOG(ERROR) << "Failed to execute batch with status: "
-                           << status.ToString();
-            return Status::INTERNAL_IO_ERROR;
-          }
+        if (!db_batch) {
+          callback(Status::OK);
+          return;
         }
-        return Status::OK;
+        ExecuteBatch(std::move(db_batch), std::move(callback));
       });
   if (MakeEmptySyncCallAndCheck(handler)) {
     return Status::INTERRUPTED;
@@ -250,22 +370,36 @@ Status LevelDb::StartBatch(CoroutineHandler* handler,
 Status LevelDb::Get(CoroutineHandler* handler,
                     convert::ExtendedStringView key,
                     std::string* value) {
-  if (MakeEmptySyncCallAndCheck(handler)) {
+  auto result = std::make_shared<std::pair<Status, std::string>>();
+  if (RunOnIORunnerAndCheck(
+          handler, [read_options = read_options_, key = key.ToString(),
+                    result](leveldb::DB* db) {
+            result->first =
+                ConvertStatus(db->Get(read_options, key, &result->second));
+          })) {
     return Status::INTERRUPTED;
   }
-  return ConvertStatus(db_->Get(read_options_, key, value));
+  if (result->first == Status::OK) {
+    value->swap(result->second);
+  }
+  return result->first;
 }
 
 Status LevelDb::HasKey(CoroutineHandler* handler,
                        convert::ExtendedStringView key,
                        bool* has_key) {
-  std::unique_ptr<leveldb::Iterator> iterator(db_->NewIterator(read_options_));
-  iterator->Seek(key);
-
-  *has_key = iterator->Valid() && iterator->key() == key;
-  if (MakeEmptySyncCallAndCheck(handler)) {
+  auto result = std::make_shared<bool>(false);
+  if (RunOnIORunnerAndCheck(
+          handler, [read_options = read_options_, key = key.ToString(),
+                    result](leveldb::DB* db) {
+            std::unique_ptr<leveldb::Iterator> iterator(
+                db->NewIterator(read_options));
+            iterator->Seek(key);
+            *result = iterator->Valid() && iterator->key() == key;
+          })) {
     return Status::INTERRUPTED;
   }
+  *has_key = *result;
   return Status::OK;
 }
 
@@ -273,19 +407,24 @@ Status LevelDb::GetObject(CoroutineHandler* handler,
                           convert::ExtendedStringView key,
                           ObjectIdentifier object_identifier,
                           std::unique_ptr<const Object>* object) {
-  std::unique_ptr<leveldb::Iterator> iterator(db_->NewIterator(read_options_));
-  iterator->Seek(key);
-
-  if (!iterator->Valid() || iterator->key() != key) {
-    return Status::NOT_FOUND;
+  // The value is copied on the I/O runner: the database can be closed there
+  // while the object is still in use.
+  auto result = std::make_shared<std::pair<Status, std::string>>();
+  if (RunOnIORunnerAndCheck(
+          handler, [read_options = read_options_, key = key.ToString(),
+                    result](leveldb::DB* db) {
+            result->first =
+                ConvertStatus(db->Get(read_options, key, &result->second));
+          })) {
+    return Status::INTERRUPTED;
+  }
+  if (result->first != Status::OK) {
+    return result->first;
   }
 
   if (object) {
     *object = std::make_unique<LevelDBObject>(std::move(object_identifier),
-                                              std::move(iterator));
-  }
-  if (MakeEmptySyncCallAndCheck(handler)) {
-    return Status::INTERRUPTED;
+                                              std::move(result->second));
   }
   return Status::OK;
 }
@@ -293,44 +432,55 @@ Status LevelDb::GetObject(CoroutineHandler* handler,
 Status LevelDb::GetByPrefix(CoroutineHandler* handler,
                             convert::ExtendedStringView prefix,
                             std::vector<std::string>* key_suffixes) {
-  std::vector<std::string> result;
-  std::unique_ptr<leveldb::Iterator> it(db_->NewIterator(read_options_));
-  for (it->Seek(prefix); it->Valid() && it->key().starts_with(prefix);
-       it->Next()) {
-    leveldb::Slice key = it->key();
-    key.remove_prefix(prefix.size());
-    result.push_back(key.ToString());
-  }
-  if (!it->status().ok()) {
-    return ConvertStatus(it->status());
-  }
-  key_suffixes->swap(result);
-  if (MakeEmptySyncCallAndCheck(handler)) {
+  auto result =
+      std::make_shared<std::pair<Status, std::vector<std::string>>>();
+  if (RunOnIORunnerAndCheck(
+          handler, [read_options = read_options_, prefix = prefix.ToString(),
+                    result](leveldb::DB* db) {
+            std::unique_ptr<leveldb::Iterator> it(
+                db->NewIterator(read_options));
+            for (it->Seek(prefix); it->Valid() && it->key().starts_with(prefix);
+                 it->Next()) {
+              leveldb::Slice key = it->key();
+              key.remove_prefix(prefix.size());
+              result->second.push_back(key.ToString());
+            }
+            result->first = ConvertStatus(it->status());
+          })) {
     return Status::INTERRUPTED;
   }
-  return Status::OK;
+  if (result->first == Status::OK) {
+    key_suffixes->swap(result->second);
+  }
+  return result->first;
 }
 
 Status LevelDb::GetEntriesByPrefix(
     CoroutineHandler* handler,
     convert::ExtendedStringView prefix,
     std::vector<std::pair<std::string, std::string>>* entries) {
-  std::vector<std::pair<std::string, std::string>> result;
-  std::unique_ptr<leveldb::Iterator> it(db_->NewIterator(read_options_));
-  for (it->Seek(prefix); it->Valid() && it->key().starts_with(prefix);
-       it->Next()) {
-    leveldb::Slice key = it->key();
-    key.remove_prefix(prefix.size());
-    result.emplace_back(key.ToString(), it->value().ToString());
-  }
-  if (!it->status().ok()) {
-    return ConvertStatus(it->status());
-  }
-  entries->swap(result);
-  if (MakeEmptySyncCallAndCheck(handler)) {
+  auto result = std::make_shared<
+      std::pair<Status, std::vector<std::pair<std::string, std::string>>>>();
+  if (RunOnIORunnerAndCheck(
+          handler, [read_options = read_options_, prefix = prefix.ToString(),
+                    result](leveldb::DB* db) {
+            std::unique_ptr<leveldb::Iterator> it(
+                db->NewIterator(read_options));
+            for (it->Seek(prefix); it->Valid() && it->key().starts_with(prefix);
+                 it->Next()) {
+              leveldb::Slice key = it->key();
+              key.remove_prefix(prefix.size());
+              result->second.emplace_back(key.ToString(),
+                                          it->value().ToString());
+            }
+            result->first = ConvertStatus(it->status());
+          })) {
     return Status::INTERRUPTED;
   }
-  return Status::OK;
+  if (result->first == Status::OK) {
+    entries->swap(result->second);
+  }
+  return result->first;
 }
 
 Status LevelDb::GetIteratorAtPrefix(
@@ -339,21 +489,129 @@ Status LevelDb::GetIteratorAtPrefix(
     std::unique_ptr<Iterator<const std::pair<convert::ExtendedStringView,
                                              convert::ExtendedStringView>>>*
         iterator) {
-  std::unique_ptr<leveldb::Iterator> local_iterator(
-      db_->NewIterator(read_options_));
-  local_iterator->Seek(prefix);
-
+  auto result = std::make_shared<
+      std::pair<Status, std::vector<std::pair<std::string, std::string>>>>();
+  if (RunOnIORunnerAndCheck(
+          handler, [read_options = read_options_, prefix = prefix.ToString(),
+                    result](leveldb::DB* db) {
+            std::unique_ptr<leveldb::Iterator> it(
+                db->NewIterator(read_options));
+            for (it->Seek(prefix); it->Valid() && it->key().starts_with(prefix);
+                 it->Next()) {
+              result->second.emplace_back(it->key().ToString(),
+                                          it->value().ToString());
+            }
+            result->first = ConvertStatus(it->status());
+          })) {
+    return Status::INTERRUPTED;
+  }
+  if (result->first != Status::OK) {
+    return result->first;
+  }
   if (iterator) {
-    std::unique_ptr<Iterator<const std::pair<convert::ExtendedStringView,
-                                             convert::ExtendedStringView>>>
-        row_iterator = std::make_unique<RowIterator>(std::move(local_iterator),
-                                                     prefix.ToString());
-    iterator->swap(row_iterator);
+    *iterator = std::make_unique<RowIterator>(std::move(result->second));
   }
-  if (MakeEmptySyncCallAndCheck(handler)) {
+  return Status::OK;
+}
+
+Status LevelDb::GetEntriesFrom(
+    CoroutineHandler* handler,
+    convert::ExtendedStringView start,
+    size_t max_count,
+    std::vector<std::pair<std::string, std::string>>* entries) {
+  auto result = std::make_shared<
+      std::pair<Status, std::vector<std::pair<std::string, std::string>>>>();
+  if (RunOnIORunnerAndCheck(
+          handler, [read_options = read_options_, start = start.ToString(),
+                    max_count, result](leveldb::DB* db) {
+            std::unique_ptr<leveldb::Iterator> it(
+                db->NewIterator(read_options));
+            for (it->Seek(start);
+                 it->Valid() && result->second.size() < max_count;
+                 it->Next()) {
+              result->second.emplace_back(it->key().ToString(),
+                                          it->value().ToString());
+            }
+            result->first = ConvertStatus(it->status());
+          })) {
     return Status::INTERRUPTED;
   }
-  return Status::OK;
+  if (result->first == Status::OK) {
+    entries->swap(result->second);
+  }
+  return result->first;
+}
+
+void LevelDb::ExecuteBatch(std::unique_ptr<leveldb::WriteBatch> db_batch,
+                           std::function<void(Status)> callback) {
+  if (group_commit_window_ <= fxl::TimeDelta::Zero()) {
+    Write(std::move(db_batch), write_options_, std::move(callback));
+    return;
+  }
+  if (pending_batch_) {
+    pending_batch_->Append(*db_batch);
+  } else {
+    pending_batch_ = std::move(db_batch);
+    scoped_task_runner_.PostDelayedTask([this] { FlushPendingBatches(); },
+                                        group_commit_window_);
+  }
+  pending_callbacks_.push_back(std::move(callback));
+}
+
+void LevelDb::FlushPendingBatches() {
+  if (!pending_batch_) {
+    return;
+  }
+  TRACE_DURATION("ledger", "leveldb_group_commit", "batch_count",
+                 pending_callbacks_.size());
+  std::unique_ptr<leveldb::WriteBatch> db_batch = std::move(pending_batch_);
+  std::vector<std::function<void(Status)>> callbacks;
+  callbacks.swap(pending_callbacks_);
+
+  Write(std::move(db_batch), sync_write_options_,
+        fxl::MakeCopyable([callbacks = std::move(callbacks)](Status status) {
+          for (auto& callback : callbacks) {
+            callback(status);
+          }
+        }));
+}
+
+void LevelDb::Write(std::unique_ptr<leveldb::WriteBatch> db_batch,
+                    const leveldb::WriteOptions& write_options,
+                    std::function<void(Status)> callback) {
+  if (!io_runner_) {
+    callback(WriteToDb(db_.get(), write_options, db_batch.get()));
+    return;
+  }
+  io_runner_->PostTask(fxl::MakeCopyable(
+      [db = db_, write_options,
+       db_batch = std::move(db_batch), task_runner = task_runner_,
+       callback = std::move(callback)]() mutable {
+        Status status = WriteToDb(db.get(), write_options, db_batch.get());
+        task_runner->PostTask(
+            [status, callback = std::move(callback)] { callback(status); });
+      }));
+}
+
+bool LevelDb::RunOnIORunnerAndCheck(
+    CoroutineHandler* handler,
+    std::function<void(leveldb::DB*)> operation) {
+  if (!io_runner_) {
+    operation(db_.get());
+    return MakeEmptySyncCallAndCheck(handler);
+  }
+  return coroutine::SyncCall(
+      handler, [this, &operation](fxl::Closure on_done) {
+        io_runner_->PostTask([db = db_, operation = std::move(operation),
+                              task_runner = task_runner_,
+                              on_done = std::move(on_done)]() mutable {
+          operation(db.get());
+          // Release the data owned by |operation|, such as iterators, while
+          // the database is still open.
+          operation = nullptr;
+          task_runner->PostTask(std::move(on_done));
+        });
+      });
 }
 
 bool LevelDb::MakeEmptySyncCallAndCheck(coroutine::CoroutineHandler* handler) {
@@ -7,22 +7,51 @@
 
 #include "peridot/bin/ledger/storage/impl/db.h"
 
+#include <memory>
 #include <utility>
+#include <vector>
 
 #include "leveldb/db.h"
 #include "leveldb/write_batch.h"
 #include "lib/fxl/tasks/task_runner.h"
+#include "lib/fxl/time/time_delta.h"
+#include "peridot/bin/ledger/storage/impl/leveldb_options.h"
+#include "peridot/lib/callback/scoped_task_runner.h"
 
 namespace storage {
 
 class LevelDb : public Db {
  public:
-  explicit LevelDb(fxl::RefPtr<fxl::TaskRunner> task_runner,
-                   std::string db_path);
-
+  // If |io_runner| is not null, the database is opened, read, written and
+  // closed on it, and the calling coroutines are resumed on |task_runner| once
+  // the operations are done, so that slow disk accesses do not block
+  // |task_runner|. Operations are run on |io_runner| in the order in which
+  // they are issued. If |options| is null, the database is opened with the
+  // default LevelDB options.
+  LevelDb(fxl::RefPtr<fxl::TaskRunner> task_runner,
+          std::string db_path,
+          fxl::RefPtr<fxl::TaskRunner> io_runner = nullptr,
+          std::shared_ptr<const LevelDbOptions> options = nullptr);
+
+  // Closes the database. If there is an I/O runner, the database is closed
+  // on it, after the operations already issued, and may still be open when
+  // this returns.
   ~LevelDb() override;
 
-  Status Init();
+  // Opens the database, creating it if needed.
+  Status Init(coroutine::CoroutineHandler* handler);
+
+  // Enables group commit: batches executed within |window| of the first
+  // pending batch are written to the database together, in a single write
+  // that is synced to disk, so that a single sync makes all of them durable.
+  // |Execute| returns once the write containing the batch is done, with the
+  // status of that write. By default, group commit is disabled and each batch
+  // is written, without being synced, as soon as it is executed.
+  void EnableGroupCommit(fxl::TimeDelta window);
+
+  // Makes the batches executed so far durable: the batches pending a group
+  // commit are written, and the database is synced to disk.
+  FXL_WARN_UNUSED_RESULT Status Sync(coroutine::CoroutineHandler* handler);
 
   // Db:
   Status StartBatch(coroutine::CoroutineHandler* handler,
@@ -51,18 +80,66 @@ class LevelDb : public Db {
                                                convert::ExtendedStringView>>>*
           iterator) override;
 
+  // Retrieves, in key order, at most |max_count| entries whose keys are
+  // greater than or equal to |start|.
+  FXL_WARN_UNUSED_RESULT Status GetEntriesFrom(
+      coroutine::CoroutineHandler* handler,
+      convert::ExtendedStringView start,
+      size_t max_count,
+      std::vector<std::pair<std::string, std::string>>* entries);
+
  private:
   bool MakeEmptySyncCallAndCheck(coroutine::CoroutineHandler* handler);
 
+  // Runs |operation| on the I/O runner, or directly if there is none, and
+  // resumes |handler| on the main runner once it is done. As the coroutine can
+  // be interrupted while |operation| runs, |operation| must only access data
+  // it owns. Returns whether the coroutine was interrupted.
+  bool RunOnIORunnerAndCheck(coroutine::CoroutineHandler* handler,
+                             std::function<void(leveldb::DB*)> operation);
+
+  // Writes |db_batch|, either immediately or as part of the next group commit,
+  // and calls |callback| with the status of the write.
+  void ExecuteBatch(std::unique_ptr<leveldb::WriteBatch> db_batch,
+                    std::function<void(Status)> callback);
+
+  // Writes all pending batches in a single write.
+  void FlushPendingBatches();
+
+  // Writes |db_batch| with |write_options| on the I/O runner, or directly if
+  // there is none, and calls |callback| on the main runner with the status of
+  // the write.
+  void Write(std::unique_ptr<leveldb::WriteBatch> db_batch,
+             const leveldb::WriteOptions& write_options,
+             std::function<void(Status)> callback);
+
   fxl::RefPtr<fxl::TaskRunner> task_runner_;
   const std::string db_path_;
-  std::unique_ptr<leveldb::DB> db_;
+  fxl::RefPtr<fxl::TaskRunner> io_runner_;
+  // The database keeps a reference to these options, as it uses the cache and
+  // filter policy they own.
+  std::shared_ptr<const LevelDbOptions> options_;
+  // Shared with the operations running on |io_runner_|, so that the database
+  // stays open until they are done.
+  std::shared_ptr<leveldb::DB> db_;
 
   const leveldb::WriteOptions write_options_;
+  // Used for the writes of group commits.
+  const leveldb::WriteOptions sync_write_options_;
   const leveldb::ReadOptions read_options_;
 
   uint64_t active_batches_count_ = 0;
 
+  // Group commit is disabled if the window is zero.
+  fxl::TimeDelta group_commit_window_ = fxl::TimeDelta::Zero();
+  // The batches executed since the last group commit, appended to each other,
+  // and the callbacks of the corresponding |Execute| calls.
+  std::unique_ptr<leveldb::WriteBatch> pending_batch_;
+  std::vector<std::function<void(Status)>> pending_callbacks_;
+
+  // Must be the last member: tasks are cancelled when this is deleted.
+  callback::ScopedTaskRunner scoped_task_runner_;
+
   FXL_DISALLOW_COPY_AND_ASSIGN(LevelDb);
 };
 
@@ -0,0 +1,29 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "peridot/bin/ledger/storage/impl/leveldb_options.h"
+
+namespace storage {
+
+LevelDbOptions::LevelDbOptions(const StorageProfile& profile)
+    : shared_db_group_commit_window_(profile.shared_db_group_commit_window) {
+  if (profile.block_cache_size > 0) {
+    block_cache_.reset(leveldb::NewLRUCache(profile.block_cache_size));
+    options_.block_cache = block_cache_.get();
+  }
+  if (profile.bloom_filter_bits_per_key > 0) {
+    filter_policy_.reset(
+        leveldb::NewBloomFilterPolicy(profile.bloom_filter_bits_per_key));
+    options_.filter_policy = filter_policy_.get();
+  }
+  if (profile.write_buffer_size > 0) {
+    options_.write_buffer_size = profile.write_buffer_size;
+  }
+  options_.compression = profile.compression ? leveldb::kSnappyCompression
+                                             : leveldb::kNoCompression;
+}
+
+LevelDbOptions::~LevelDbOptions() {}
+
+}  // namespace storage
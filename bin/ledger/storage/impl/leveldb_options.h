@@ -0,0 +1,66 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef PERIDOT_BIN_LEDGER_STORAGE_IMPL_LEVELDB_OPTIONS_H_
+#define PERIDOT_BIN_LEDGER_STORAGE_IMPL_LEVELDB_OPTIONS_H_
+
+#include <stddef.h>
+
+#include <memory>
+
+#include "leveldb/cache.h"
+#include "leveldb/filter_policy.h"
+#include "leveldb/options.h"
+#include "lib/fxl/macros.h"
+#include "lib/fxl/time/time_delta.h"
+
+namespace storage {
+
+// Tuning of the LevelDB databases of a repository.
+struct StorageProfile {
+  // Memory budget, in bytes, of the block cache shared by all the databases
+  // of the repository. If 0, every database has its own default cache.
+  size_t block_cache_size = 0;
+  // Number of bits per key of the bloom filters of the tables, allowing to
+  // skip reading tables that do not contain a key. If 0, no bloom filter is
+  // used.
+  int bloom_filter_bits_per_key = 0;
+  // Size, in bytes, of the in-memory write buffer of each database. If 0, the
+  // LevelDB default is used.
+  size_t write_buffer_size = 0;
+  // Whether the blocks of the tables are compressed.
+  bool compression = true;
+  // Group commit window of the database shared by the pages of a ledger: the
+  // batches executed by all the pages within this window are written together
+  // and synced to disk once. See |LevelDb::EnableGroupCommit|. If 0, the
+  // default, group commit is disabled and writes are not synced.
+  fxl::TimeDelta shared_db_group_commit_window = fxl::TimeDelta::Zero();
+};
+
+// Options of the LevelDB databases of a repository. Owns the block cache and
+// the filter policy shared by all the databases opened with these options, and
+// must thus outlive them.
+class LevelDbOptions {
+ public:
+  explicit LevelDbOptions(const StorageProfile& profile);
+  ~LevelDbOptions();
+
+  const leveldb::Options& options() const { return options_; }
+
+  fxl::TimeDelta shared_db_group_commit_window() const {
+    return shared_db_group_commit_window_;
+  }
+
+ private:
+  std::unique_ptr<leveldb::Cache> block_cache_;
+  std::unique_ptr<const leveldb::FilterPolicy> filter_policy_;
+  leveldb::Options options_;
+  const fxl::TimeDelta shared_db_group_commit_window_;
+
+  FXL_DISALLOW_COPY_AND_ASSIGN(LevelDbOptions);
+};
+
+}  // namespace storage
+
+#endif  // PERIDOT_BIN_LEDGER_STORAGE_IMPL_LEVELDB_OPTIONS_H_
@@ -0,0 +1,311 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "peridot/bin/ledger/storage/impl/leveldb.h"
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "lib/fsl/tasks/message_loop.h"
+#include "lib/fsl/threading/create_thread.h"
+#include "lib/fxl/files/scoped_temp_dir.h"
+#include "lib/fxl/macros.h"
+#include "lib/fxl/strings/string_printf.h"
+#include "peridot/bin/ledger/storage/impl/leveldb_options.h"
+#include "peridot/bin/ledger/storage/public/make_object_identifier.h"
+#include "peridot/bin/ledger/testing/test_with_coroutines.h"
+
+namespace storage {
+namespace {
+
+using coroutine::CoroutineHandler;
+
+class LevelDbTest : public ::test::TestWithCoroutines {
+ public:
+  LevelDbTest() : db_(message_loop_.task_runner(), tmp_dir_.path()) {}
+
+  ~LevelDbTest() override {}
+
+  // Test:
+  void SetUp() override {
+    EXPECT_TRUE(RunInCoroutine([this](CoroutineHandler* handler) {
+      ASSERT_EQ(Status::OK, db_.Init(handler));
+    }));
+  }
+
+ protected:
+  // Starts a coroutine that puts |key| with |value| in a new batch and
+  // executes it. |done| is set to true and |status| is updated once the batch
+  // is executed.
+  void PutInNewCoroutine(std::string key,
+                         std::string value,
+                         Status* status,
+                         bool* done) {
+    *done = false;
+    coroutine_service_.StartCoroutine(
+        [this, key = std::move(key), value = std::move(value), status,
+         done](CoroutineHandler* handler) {
+          std::unique_ptr<Db::Batch> batch;
+          *status = db_.StartBatch(handler, &batch);
+          if (*status == Status::OK) {
+            *status = batch->Put(handler, key, value);
+          }
+          if (*status == Status::OK) {
+            *status = batch->Execute(handler);
+          }
+          *done = true;
+        });
+  }
+
+  files::ScopedTempDir tmp_dir_;
+  LevelDb db_;
+
+ private:
+  FXL_DISALLOW_COPY_AND_ASSIGN(LevelDbTest);
+};
+
+TEST_F(LevelDbTest, PutGet) {
+  EXPECT_TRUE(RunInCoroutine([&](CoroutineHandler* handler) {
+    std::unique_ptr<Db::Batch> batch;
+    ASSERT_EQ(Status::OK, db_.StartBatch(handler, &batch));
+    EXPECT_EQ(Status::OK, batch->Put(handler, "key", "value"));
+    EXPECT_EQ(Status::OK, batch->Delete(handler, "other_key"));
+    EXPECT_EQ(Status::OK, batch->Execute(handler));
+
+    std::string value;
+    EXPECT_EQ(Status::OK, db_.Get(handler, "key", &value));
+    EXPECT_EQ("value", value);
+    EXPECT_EQ(Status::NOT_FOUND, db_.Get(handler, "other_key", &value));
+  }));
+}
+
+TEST_F(LevelDbTest, ManyOperationsInBatch) {
+  EXPECT_TRUE(RunInCoroutine([&](CoroutineHandler* handler) {
+    std::unique_ptr<Db::Batch> batch;
+    ASSERT_EQ(Status::OK, db_.StartBatch(handler, &batch));
+    for (size_t i = 0; i < 1000; ++i) {
+      EXPECT_EQ(Status::OK, batch->Put(handler, "key" + std::to_string(i),
+                                       "value" + std::to_string(i)));
+    }
+    EXPECT_EQ(Status::OK, batch->Execute(handler));
+
+    std::string value;
+    EXPECT_EQ(Status::OK, db_.Get(handler, "key999", &value));
+    EXPECT_EQ("value999", value);
+  }));
+}
+
+TEST_F(LevelDbTest, GetEntriesFrom) {
+  EXPECT_TRUE(RunInCoroutine([&](CoroutineHandler* handler) {
+    std::unique_ptr<Db::Batch> batch;
+    ASSERT_EQ(Status::OK, db_.StartBatch(handler, &batch));
+    for (const auto& key : {"a", "b", "c", "d"}) {
+      EXPECT_EQ(Status::OK, batch->Put(handler, key, key));
+    }
+    EXPECT_EQ(Status::OK, batch->Execute(handler));
+
+    std::vector<std::pair<std::string, std::string>> entries;
+    EXPECT_EQ(Status::OK, db_.GetEntriesFrom(handler, "b", 2, &entries));
+    EXPECT_EQ((std::vector<std::pair<std::string, std::string>>(
+                  {{"b", "b"}, {"c", "c"}})),
+              entries);
+    EXPECT_EQ(Status::OK, db_.GetEntriesFrom(handler, "c1", 2, &entries));
+    EXPECT_EQ((std::vector<std::pair<std::string, std::string>>({{"d", "d"}})),
+              entries);
+    EXPECT_EQ(Status::OK, db_.GetEntriesFrom(handler, "e", 2, &entries));
+    EXPECT_TRUE(entries.empty());
+  }));
+}
+
+TEST_F(LevelDbTest, GroupCommit) {
+  db_.EnableGroupCommit(fxl::TimeDelta::FromMilliseconds(500));
+
+  Status status1, status2;
+  bool done1, done2;
+  PutInNewCoroutine("key1", "value1", &status1, &done1);
+  PutInNewCoroutine("key2", "value2", &status2, &done2);
+
+  // Both batches wait for the group commit.
+  RunLoopUntilIdle();
+  EXPECT_FALSE(done1);
+  EXPECT_FALSE(done2);
+  EXPECT_TRUE(RunInCoroutine([&](CoroutineHandler* handler) {
+    std::string value;
+    EXPECT_EQ(Status::NOT_FOUND, db_.Get(handler, "key1", &value));
+    EXPECT_EQ(Status::NOT_FOUND, db_.Get(handler, "key2", &value));
+  }));
+
+  EXPECT_TRUE(RunLoopUntil([&] { return done1 && done2; },
+                           fxl::TimeDelta::FromSeconds(5)));
+  EXPECT_EQ(Status::OK, status1);
+  EXPECT_EQ(Status::OK, status2);
+  EXPECT_TRUE(RunInCoroutine([&](CoroutineHandler* handler) {
+    std::string value;
+    EXPECT_EQ(Status::OK, db_.Get(handler, "key1", &value));
+    EXPECT_EQ("value1", value);
+    EXPECT_EQ(Status::OK, db_.Get(handler, "key2", &value));
+    EXPECT_EQ("value2", value);
+  }));
+}
+
+TEST_F(LevelDbTest, SyncFlushesGroupCommit) {
+  db_.EnableGroupCommit(fxl::TimeDelta::FromSeconds(3600));
+
+  Status status;
+  bool done;
+  PutInNewCoroutine("key", "value", &status, &done);
+  RunLoopUntilIdle();
+  EXPECT_FALSE(done);
+
+  // Syncing writes the pending batch without waiting for the window to end.
+  EXPECT_TRUE(RunInCoroutine([&](CoroutineHandler* handler) {
+    EXPECT_EQ(Status::OK, db_.Sync(handler));
+    std::string value;
+    EXPECT_EQ(Status::OK, db_.Get(handler, "key", &value));
+    EXPECT_EQ("value", value);
+  }));
+  RunLoopUntilIdle();
+  EXPECT_TRUE(done);
+  EXPECT_EQ(Status::OK, status);
+}
+
+TEST_F(LevelDbTest, SharedOptions) {
+  StorageProfile profile;
+  profile.block_cache_size = 1024 * 1024;
+  profile.bloom_filter_bits_per_key = 10;
+  profile.write_buffer_size = 64 * 1024;
+  profile.compression = false;
+  auto options = std::make_shared<LevelDbOptions>(profile);
+
+  LevelDb db1(message_loop_.task_runner(), tmp_dir_.path() + "/db1", nullptr,
+              options);
+  LevelDb db2(message_loop_.task_runner(), tmp_dir_.path() + "/db2", nullptr,
+              options);
+
+  EXPECT_TRUE(RunInCoroutine([&](CoroutineHandler* handler) {
+    for (LevelDb* db : {&db1, &db2}) {
+      ASSERT_EQ(Status::OK, db->Init(handler));
+      std::unique_ptr<Db::Batch> batch;
+      ASSERT_EQ(Status::OK, db->StartBatch(handler, &batch));
+      for (size_t i = 0; i < 100; ++i) {
+        EXPECT_EQ(Status::OK,
+                  batch->Put(handler, fxl::StringPrintf("key%zu", i),
+                             std::string(1024, 'a')));
+      }
+      EXPECT_EQ(Status::OK, batch->Execute(handler));
+    }
+
+    for (LevelDb* db : {&db1, &db2}) {
+      std::string value;
+      EXPECT_EQ(Status::OK, db->Get(handler, "key42", &value));
+      EXPECT_EQ(std::string(1024, 'a'), value);
+      bool has_key;
+      EXPECT_EQ(Status::OK, db->HasKey(handler, "missing_key", &has_key));
+      EXPECT_FALSE(has_key);
+    }
+  }));
+}
+
+class LevelDbIORunnerTest : public ::test::TestWithCoroutines {
+ public:
+  LevelDbIORunnerTest() : io_thread_(fsl::CreateThread(&io_runner_)) {}
+
+  ~LevelDbIORunnerTest() override {
+    io_runner_->PostTask([] { fsl::MessageLoop::GetCurrent()->QuitNow(); });
+    io_thread_.join();
+  }
+
+ protected:
+  files::ScopedTempDir tmp_dir_;
+  fxl::RefPtr<fxl::TaskRunner> io_runner_;
+  std::thread io_thread_;
+
+ private:
+  FXL_DISALLOW_COPY_AND_ASSIGN(LevelDbIORunnerTest);
+};
+
+TEST_F(LevelDbIORunnerTest, ReadsAndWrites) {
+  {
+    LevelDb db(message_loop_.task_runner(), tmp_dir_.path(), io_runner_);
+
+    EXPECT_TRUE(RunInCoroutine([&](CoroutineHandler* handler) {
+      ASSERT_EQ(Status::OK, db.Init(handler));
+      std::unique_ptr<Db::Batch> batch;
+      ASSERT_EQ(Status::OK, db.StartBatch(handler, &batch));
+      EXPECT_EQ(Status::OK, batch->Put(handler, "prefix_key1", "value1"));
+      EXPECT_EQ(Status::OK, batch->Put(handler, "prefix_key2", "value2"));
+      EXPECT_EQ(Status::OK, batch->Put(handler, "other_key", "value3"));
+      EXPECT_EQ(Status::OK, batch->Execute(handler));
+
+      std::string value;
+      EXPECT_EQ(Status::OK, db.Get(handler, "prefix_key1", &value));
+      EXPECT_EQ("value1", value);
+      EXPECT_EQ(Status::NOT_FOUND, db.Get(handler, "missing_key", &value));
+
+      bool has_key;
+      EXPECT_EQ(Status::OK, db.HasKey(handler, "other_key", &has_key));
+      EXPECT_TRUE(has_key);
+      EXPECT_EQ(Status::OK, db.HasKey(handler, "missing_key", &has_key));
+      EXPECT_FALSE(has_key);
+
+      std::vector<std::string> key_suffixes;
+      EXPECT_EQ(Status::OK, db.GetByPrefix(handler, "prefix_", &key_suffixes));
+      EXPECT_EQ(std::vector<std::string>({"key1", "key2"}), key_suffixes);
+
+      std::vector<std::pair<std::string, std::string>> entries;
+      EXPECT_EQ(Status::OK,
+                db.GetEntriesByPrefix(handler, "prefix_", &entries));
+      EXPECT_EQ((std::vector<std::pair<std::string, std::string>>(
+                    {{"key1", "value1"}, {"key2", "value2"}})),
+                entries);
+
+      std::unique_ptr<const Object> object;
+      EXPECT_EQ(Status::OK,
+                db.GetObject(handler, "other_key",
+                             MakeDefaultObjectIdentifier("digest"), &object));
+      ASSERT_TRUE(object);
+      fxl::StringView data;
+      EXPECT_EQ(Status::OK, object->GetData(&data));
+      EXPECT_EQ("value3", data);
+
+      std::unique_ptr<Iterator<const std::pair<
+          convert::ExtendedStringView, convert::ExtendedStringView>>>
+          iterator;
+      EXPECT_EQ(Status::OK,
+                db.GetIteratorAtPrefix(handler, "prefix_", &iterator));
+      ASSERT_TRUE(iterator->Valid());
+      EXPECT_EQ("prefix_key1", (*iterator)->first.ToString());
+      EXPECT_EQ("value1", (*iterator)->second.ToString());
+      iterator->Next();
+      ASSERT_TRUE(iterator->Valid());
+      EXPECT_EQ("prefix_key2", (*iterator)->first.ToString());
+      iterator->Next();
+      EXPECT_FALSE(iterator->Valid());
+      EXPECT_EQ(Status::OK, iterator->GetStatus());
+
+      ASSERT_EQ(Status::OK, db.StartBatch(handler, &batch));
+      EXPECT_EQ(Status::OK, batch->DeleteByPrefix(handler, "other_"));
+      EXPECT_EQ(Status::OK, batch->Execute(handler));
+      EXPECT_EQ(Status::OK, db.HasKey(handler, "other_key", &has_key));
+      EXPECT_FALSE(has_key);
+    }));
+  }
+
+  // The database is closed on the I/O runner once |LevelDb| is deleted, and
+  // can be reopened right away.
+  LevelDb db(message_loop_.task_runner(), tmp_dir_.path(), io_runner_);
+  EXPECT_TRUE(RunInCoroutine([&](CoroutineHandler* handler) {
+    ASSERT_EQ(Status::OK, db.Init(handler));
+    std::string value;
+    EXPECT_EQ(Status::OK, db.Get(handler, "prefix_key2", &value));
+    EXPECT_EQ("value2", value);
+  }));
+}
+
+}  // namespace
+}  // namespace storage
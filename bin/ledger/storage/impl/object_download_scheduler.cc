@@ -0,0 +1,115 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "peridot/bin/ledger/storage/impl/object_download_scheduler.h"
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+
+#include <trace/event.h>
+
+#include "lib/fxl/logging.h"
+#include "peridot/lib/callback/scoped_callback.h"
+
+namespace storage {
+
+ObjectDownloadScheduler::ObjectDownloadScheduler(
+    size_t max_concurrent_downloads,
+    DownloadFunction download)
+    : max_concurrent_downloads_(max_concurrent_downloads),
+      download_(std::move(download)),
+      weak_ptr_factory_(this) {
+  FXL_DCHECK(max_concurrent_downloads_ > 0u);
+}
+
+ObjectDownloadScheduler::~ObjectDownloadScheduler() {}
+
+void ObjectDownloadScheduler::Download(ObjectIdentifier object_identifier,
+                                       std::function<void(Status)> callback) {
+  auto it = pending_downloads_.find(object_identifier);
+  if (it != pending_downloads_.end()) {
+    ++stats_.merged_requests;
+    it->second.push_back(std::move(callback));
+    return;
+  }
+  pending_downloads_[object_identifier].push_back(std::move(callback));
+  queue_.push_back(std::move(object_identifier));
+  StartDownloads();
+  stats_.max_queue_depth = std::max(stats_.max_queue_depth, queue_.size());
+}
+
+double ObjectDownloadScheduler::GetBytesPerSecond() const {
+  fxl::TimeDelta fetch_time = stats_.fetch_time;
+  if (active_fetches_ > 0u) {
+    fetch_time = fetch_time + (fxl::TimePoint::Now() - fetch_start_);
+  }
+  if (fetch_time <= fxl::TimeDelta::Zero()) {
+    return 0.;
+  }
+  return stats_.bytes_downloaded / fetch_time.ToSecondsF();
+}
+
+void ObjectDownloadScheduler::StartDownloads() {
+  while (active_fetches_ < max_concurrent_downloads_ && !queue_.empty()) {
+    ObjectIdentifier object_identifier = std::move(queue_.front());
+    queue_.pop_front();
+    if (active_fetches_ == 0u) {
+      fetch_start_ = fxl::TimePoint::Now();
+    }
+    ++active_fetches_;
+
+    // Whether OnFetchDone has been called for this download.
+    auto fetched = std::make_shared<bool>(false);
+    download_(object_identifier,
+              callback::MakeScoped(weak_ptr_factory_.GetWeakPtr(),
+                                   [this, fetched](uint64_t size) {
+                                     if (*fetched) {
+                                       return;
+                                     }
+                                     *fetched = true;
+                                     stats_.bytes_downloaded += size;
+                                     OnFetchDone();
+                                   }),
+              callback::MakeScoped(
+                  weak_ptr_factory_.GetWeakPtr(),
+                  [this, fetched, object_identifier](Status status) {
+                    if (!*fetched) {
+                      *fetched = true;
+                      OnFetchDone();
+                    }
+                    OnDownloadDone(object_identifier, status);
+                  }));
+  }
+  TRACE_COUNTER("ledger", "object_downloads",
+                reinterpret_cast<uintptr_t>(this), "queued", queue_.size(),
+                "active", active_fetches_);
+}
+
+void ObjectDownloadScheduler::OnFetchDone() {
+  FXL_DCHECK(active_fetches_ > 0u);
+  --active_fetches_;
+  if (active_fetches_ == 0u) {
+    stats_.fetch_time =
+        stats_.fetch_time + (fxl::TimePoint::Now() - fetch_start_);
+  }
+  StartDownloads();
+}
+
+void ObjectDownloadScheduler::OnDownloadDone(
+    const ObjectIdentifier& object_identifier,
+    Status status) {
+  auto it = pending_downloads_.find(object_identifier);
+  FXL_DCHECK(it != pending_downloads_.end());
+  std::vector<std::function<void(Status)>> callbacks = std::move(it->second);
+  pending_downloads_.erase(it);
+  if (status == Status::OK) {
+    ++stats_.objects_downloaded;
+  }
+  for (auto& callback : callbacks) {
+    callback(status);
+  }
+}
+
+}  // namespace storage
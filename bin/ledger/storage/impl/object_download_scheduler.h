@@ -0,0 +1,107 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef PERIDOT_BIN_LEDGER_STORAGE_IMPL_OBJECT_DOWNLOAD_SCHEDULER_H_
+#define PERIDOT_BIN_LEDGER_STORAGE_IMPL_OBJECT_DOWNLOAD_SCHEDULER_H_
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <vector>
+
+#include "lib/fxl/macros.h"
+#include "lib/fxl/memory/weak_ptr.h"
+#include "lib/fxl/time/time_delta.h"
+#include "lib/fxl/time/time_point.h"
+#include "peridot/bin/ledger/storage/public/types.h"
+
+namespace storage {
+
+// Statistics about the objects downloaded by an |ObjectDownloadScheduler|.
+struct ObjectDownloadStats {
+  // Number of objects successfully downloaded.
+  uint64_t objects_downloaded = 0u;
+  // Number of bytes received from the network.
+  uint64_t bytes_downloaded = 0u;
+  // Number of requests merged with a download already queued or in progress.
+  uint64_t merged_requests = 0u;
+  // Maximal number of downloads waiting for a free slot at any given time.
+  size_t max_queue_depth = 0u;
+  // Total time during which at least one object was being fetched.
+  fxl::TimeDelta fetch_time;
+};
+
+// Schedules the downloads of objects from the cloud.
+//
+// A request for an object that is already queued or being downloaded is
+// merged with the pending one. At most |max_concurrent_downloads| objects are
+// fetched from the network at the same time; the others wait in a queue, in
+// the order in which they were requested.
+class ObjectDownloadScheduler {
+ public:
+  // Downloads the object with the given identifier. |on_fetched| must be
+  // called with the number of bytes received once the data of the object has
+  // been received from the network, which frees the download slot of the
+  // object, and |callback| once the download is complete. If the download
+  // fails before the data is received, |on_fetched| doesn't need to be called.
+  using DownloadFunction =
+      std::function<void(ObjectIdentifier object_identifier,
+                         std::function<void(uint64_t)> on_fetched,
+                         std::function<void(Status)> callback)>;
+
+  ObjectDownloadScheduler(size_t max_concurrent_downloads,
+                          DownloadFunction download);
+  ~ObjectDownloadScheduler();
+
+  // Downloads the object with the given identifier, and calls |callback| once
+  // it is available locally.
+  void Download(ObjectIdentifier object_identifier,
+                std::function<void(Status)> callback);
+
+  // Returns the number of downloads waiting for a free slot.
+  size_t queue_depth() const { return queue_.size(); }
+
+  // Returns the number of objects being fetched from the network.
+  size_t active_fetches() const { return active_fetches_; }
+
+  const ObjectDownloadStats& stats() const { return stats_; }
+
+  // Returns the average download throughput, in bytes per second, over the
+  // time during which objects were being fetched.
+  double GetBytesPerSecond() const;
+
+ private:
+  // Starts downloading queued objects, as long as there are free slots.
+  void StartDownloads();
+
+  // Called once the data of an object has been received from the network, or
+  // the fetch has failed.
+  void OnFetchDone();
+
+  // Calls the callbacks of all requests for the given object.
+  void OnDownloadDone(const ObjectIdentifier& object_identifier,
+                      Status status);
+
+  const size_t max_concurrent_downloads_;
+  DownloadFunction download_;
+
+  // Callbacks of the requests for each queued or active download.
+  std::map<ObjectIdentifier, std::vector<std::function<void(Status)>>>
+      pending_downloads_;
+  std::deque<ObjectIdentifier> queue_;
+  size_t active_fetches_ = 0u;
+  // Time at which |active_fetches_| last became non-zero.
+  fxl::TimePoint fetch_start_;
+
+  ObjectDownloadStats stats_;
+
+  // This must be the last member of the class.
+  fxl::WeakPtrFactory<ObjectDownloadScheduler> weak_ptr_factory_;
+
+  FXL_DISALLOW_COPY_AND_ASSIGN(ObjectDownloadScheduler);
+};
+
+}  // namespace storage
+
+#endif  // PERIDOT_BIN_LEDGER_STORAGE_IMPL_OBJECT_DOWNLOAD_SCHEDULER_H_
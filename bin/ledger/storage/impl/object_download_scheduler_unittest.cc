@@ -0,0 +1,129 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "peridot/bin/ledger/storage/impl/object_download_scheduler.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "lib/fxl/macros.h"
+#include "peridot/bin/ledger/storage/public/make_object_identifier.h"
+
+namespace storage {
+namespace {
+
+// A download started by the scheduler, completed manually by the tests.
+struct PendingDownload {
+  ObjectIdentifier object_identifier;
+  std::function<void(uint64_t)> on_fetched;
+  std::function<void(Status)> callback;
+};
+
+class ObjectDownloadSchedulerTest : public ::testing::Test {
+ public:
+  ObjectDownloadSchedulerTest()
+      : scheduler_(2,
+                   [this](ObjectIdentifier object_identifier,
+                          std::function<void(uint64_t)> on_fetched,
+                          std::function<void(Status)> callback) {
+                     downloads_.push_back({std::move(object_identifier),
+                                           std::move(on_fetched),
+                                           std::move(callback)});
+                   }) {
+    // The callbacks of a download start new downloads: make sure they are not
+    // moved while running.
+    downloads_.reserve(16);
+  }
+
+  ~ObjectDownloadSchedulerTest() override {}
+
+ protected:
+  ObjectIdentifier MakeIdentifier(int index) {
+    return MakeDefaultObjectIdentifier("digest" + std::to_string(index));
+  }
+
+  std::vector<PendingDownload> downloads_;
+  ObjectDownloadScheduler scheduler_;
+
+ private:
+  FXL_DISALLOW_COPY_AND_ASSIGN(ObjectDownloadSchedulerTest);
+};
+
+TEST_F(ObjectDownloadSchedulerTest, BoundedConcurrency) {
+  std::vector<Status> statuses;
+  for (int i = 0; i < 4; ++i) {
+    scheduler_.Download(MakeIdentifier(i),
+                        [&statuses](Status status) {
+                          statuses.push_back(status);
+                        });
+  }
+  ASSERT_EQ(2u, downloads_.size());
+  EXPECT_EQ(MakeIdentifier(0), downloads_[0].object_identifier);
+  EXPECT_EQ(MakeIdentifier(1), downloads_[1].object_identifier);
+  EXPECT_EQ(2u, scheduler_.active_fetches());
+  EXPECT_EQ(2u, scheduler_.queue_depth());
+
+  // Receiving the data of an object frees its slot, even if the object is not
+  // yet stored.
+  downloads_[0].on_fetched(10);
+  ASSERT_EQ(3u, downloads_.size());
+  EXPECT_EQ(MakeIdentifier(2), downloads_[2].object_identifier);
+  EXPECT_EQ(1u, scheduler_.queue_depth());
+  EXPECT_TRUE(statuses.empty());
+
+  // A failure before the data is received also frees the slot.
+  downloads_[1].callback(Status::NOT_FOUND);
+  ASSERT_EQ(4u, downloads_.size());
+  EXPECT_EQ(MakeIdentifier(3), downloads_[3].object_identifier);
+  EXPECT_EQ(0u, scheduler_.queue_depth());
+  EXPECT_EQ(std::vector<Status>({Status::NOT_FOUND}), statuses);
+
+  downloads_[0].callback(Status::OK);
+  for (size_t i = 2; i < 4; ++i) {
+    downloads_[i].on_fetched(5);
+    downloads_[i].callback(Status::OK);
+  }
+  EXPECT_EQ(4u, statuses.size());
+  EXPECT_EQ(0u, scheduler_.active_fetches());
+
+  EXPECT_EQ(3u, scheduler_.stats().objects_downloaded);
+  EXPECT_EQ(20u, scheduler_.stats().bytes_downloaded);
+  EXPECT_EQ(2u, scheduler_.stats().max_queue_depth);
+  EXPECT_EQ(0u, scheduler_.stats().merged_requests);
+}
+
+TEST_F(ObjectDownloadSchedulerTest, MergeRequests) {
+  int calls = 0;
+  auto callback = [&calls](Status status) {
+    EXPECT_EQ(Status::OK, status);
+    ++calls;
+  };
+  // Requests for an active download.
+  scheduler_.Download(MakeIdentifier(0), callback);
+  scheduler_.Download(MakeIdentifier(0), callback);
+  // Requests for a queued download.
+  scheduler_.Download(MakeIdentifier(1), callback);
+  scheduler_.Download(MakeIdentifier(2), callback);
+  scheduler_.Download(MakeIdentifier(2), callback);
+  ASSERT_EQ(2u, downloads_.size());
+  EXPECT_EQ(1u, scheduler_.queue_depth());
+  EXPECT_EQ(2u, scheduler_.stats().merged_requests);
+
+  downloads_[0].on_fetched(1);
+  downloads_[0].callback(Status::OK);
+  EXPECT_EQ(2, calls);
+  ASSERT_EQ(3u, downloads_.size());
+  downloads_[1].callback(Status::OK);
+  downloads_[2].callback(Status::OK);
+  EXPECT_EQ(5, calls);
+
+  // Once the download is done, a new request starts a new download.
+  scheduler_.Download(MakeIdentifier(0), callback);
+  EXPECT_EQ(4u, downloads_.size());
+}
+
+}  // namespace
+}  // namespace storage
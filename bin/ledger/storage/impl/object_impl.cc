@@ -6,6 +6,9 @@
 
 #include <utility>
 
+#include "lib/fxl/logging.h"
+#include "peridot/bin/ledger/storage/public/piece_compression.h"
+
 namespace storage {
 
 namespace {
@@ -41,9 +44,8 @@ Status StringObject::GetData(fxl::StringView* data) const {
   return Status::OK;
 }
 
-LevelDBObject::LevelDBObject(ObjectIdentifier identifier,
-                             std::unique_ptr<leveldb::Iterator> iterator)
-    : identifier_(std::move(identifier)), iterator_(std::move(iterator)) {}
+LevelDBObject::LevelDBObject(ObjectIdentifier identifier, std::string value)
+    : identifier_(std::move(identifier)), value_(std::move(value)) {}
 
 LevelDBObject::~LevelDBObject() {}
 
@@ -52,7 +54,33 @@ ObjectIdentifier LevelDBObject::GetIdentifier() const {
 }
 
 Status LevelDBObject::GetData(fxl::StringView* data) const {
-  *data = convert::ExtendedStringView(iterator_->value());
+  *data = value_;
+  return Status::OK;
+}
+
+EncodedObject::EncodedObject(std::unique_ptr<const Object> encoded_object)
+    : encoded_object_(std::move(encoded_object)) {}
+
+EncodedObject::~EncodedObject() {}
+
+ObjectIdentifier EncodedObject::GetIdentifier() const {
+  return encoded_object_->GetIdentifier();
+}
+
+Status EncodedObject::GetData(fxl::StringView* data) const {
+  if (!decoded_) {
+    fxl::StringView encoded;
+    Status status = encoded_object_->GetData(&encoded);
+    if (status != Status::OK) {
+      return status;
+    }
+    if (!DecodePiece(encoded, &buffer_, &data_)) {
+      FXL_LOG(ERROR) << "Unable to decode a stored object.";
+      return Status::FORMAT_ERROR;
+    }
+    decoded_ = true;
+  }
+  *data = data_;
   return Status::OK;
 }
 
@@ -79,11 +107,7 @@ Status VmoObject::GetData(fxl::StringView* data) const {
 }
 
 Status VmoObject::GetVmo(fsl::SizedVmo* vmo) const {
-  Status status = Initialize();
-  if (status != Status::OK) {
-    return status;
-  }
-
+  // The VMO is shared as is, without being mapped nor copied.
   zx_status_t zx_status =
       vmo_.Duplicate(ZX_RIGHTS_BASIC | ZX_RIGHT_READ | ZX_RIGHT_MAP, vmo);
   if (zx_status != ZX_OK) {
@@ -101,19 +125,17 @@ Status VmoObject::Initialize() const {
   uintptr_t allocate_address;
   zx_status_t zx_status = zx::vmar::root_self().allocate(
       0, ToFullPages(vmo_.size()),
-      ZX_VM_FLAG_CAN_MAP_READ | ZX_VM_FLAG_CAN_MAP_WRITE |
-          ZX_VM_FLAG_CAN_MAP_SPECIFIC,
-      &vmar_, &allocate_address);
+      ZX_VM_FLAG_CAN_MAP_READ | ZX_VM_FLAG_CAN_MAP_SPECIFIC, &vmar_,
+      &allocate_address);
   if (zx_status != ZX_OK) {
     FXL_LOG(ERROR) << "Unable to allocate VMAR. Error: " << zx_status;
     return Status::INTERNAL_IO_ERROR;
   }
 
   char* mapped_address;
-  zx_status = vmar_.map(
-      0, vmo_.vmo(), 0, vmo_.size(),
-      ZX_VM_FLAG_PERM_READ | ZX_VM_FLAG_PERM_WRITE | ZX_VM_FLAG_SPECIFIC,
-      reinterpret_cast<uintptr_t*>(&mapped_address));
+  zx_status = vmar_.map(0, vmo_.vmo(), 0, vmo_.size(),
+                        ZX_VM_FLAG_PERM_READ | ZX_VM_FLAG_SPECIFIC,
+                        reinterpret_cast<uintptr_t*>(&mapped_address));
   if (zx_status != ZX_OK) {
     FXL_LOG(ERROR) << "Unable to map VMO. Error: " << zx_status;
     vmar_.reset();
@@ -9,10 +9,10 @@
 #include "peridot/bin/ledger/storage/public/page_storage.h"
 #include "peridot/bin/ledger/storage/public/types.h"
 #include "peridot/lib/convert/convert.h"
-#include "third_party/leveldb/include/leveldb/iterator.h"
 #include "zx/vmar.h"
 
 #include <memory>
+#include <string>
 
 namespace storage {
 
@@ -45,11 +45,11 @@ class StringObject : public Object {
   std::string content_;
 };
 
-// Object whose data is backed by a value in LevelDB.
+// Object whose data is backed by a value read from LevelDB. The value is
+// copied out of the database, so that the object can outlive it.
 class LevelDBObject : public Object {
  public:
-  LevelDBObject(ObjectIdentifier identifier,
-                std::unique_ptr<leveldb::Iterator> iterator);
+  LevelDBObject(ObjectIdentifier identifier, std::string value);
   ~LevelDBObject() override;
 
   // Object:
@@ -58,10 +58,30 @@ class LevelDBObject : public Object {
 
  private:
   const ObjectIdentifier identifier_;
-  std::unique_ptr<leveldb::Iterator> iterator_;
+  const std::string value_;
 };
 
-// Object whose data is backed by a VMO.
+// Object whose data is the decoding of the data of another object, a piece
+// encoded with |EncodePiece|. The data is decoded on first access.
+class EncodedObject : public Object {
+ public:
+  explicit EncodedObject(std::unique_ptr<const Object> encoded_object);
+  ~EncodedObject() override;
+
+  // Object:
+  ObjectIdentifier GetIdentifier() const override;
+  Status GetData(fxl::StringView* data) const override;
+
+ private:
+  const std::unique_ptr<const Object> encoded_object_;
+  mutable bool decoded_ = false;
+  // Holds the decoded data, if the piece is compressed.
+  mutable std::string buffer_;
+  mutable fxl::StringView data_;
+};
+
+// Object whose data is backed by a VMO. The VMO is mapped read-only on first
+// access to its data, and |GetVmo| returns a read-only handle to it.
 class VmoObject : public Object {
  public:
   VmoObject(ObjectIdentifier identifier, fsl::SizedVmo vmo);
@@ -106,13 +106,13 @@ TEST(ObjectImplTest, LevelDBObject) {
 
   status = db_ptr->Put(write_options_, "", data);
   ASSERT_TRUE(status.ok());
-  std::unique_ptr<leveldb::Iterator> iterator(
-      db_ptr->NewIterator(read_options_));
-  iterator->Seek("");
-  ASSERT_TRUE(iterator->Valid());
-  ASSERT_TRUE(iterator->key() == "");
+  std::string value;
+  status = db_ptr->Get(read_options_, "", &value);
+  ASSERT_TRUE(status.ok());
 
-  LevelDBObject object(identifier, std::move(iterator));
+  LevelDBObject object(identifier, std::move(value));
+  // The object remains valid once the database is closed.
+  db_ptr.reset();
   EXPECT_TRUE(CheckObjectValue(object, identifier, data));
 }
 
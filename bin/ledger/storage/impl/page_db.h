@@ -17,6 +17,7 @@
 #include "peridot/bin/ledger/storage/public/iterator.h"
 #include "peridot/bin/ledger/storage/public/journal.h"
 #include "peridot/bin/ledger/storage/public/object.h"
+#include "peridot/bin/ledger/storage/public/piece_compression.h"
 #include "peridot/bin/ledger/storage/public/types.h"
 
 namespace storage {
@@ -101,7 +102,8 @@ class PageDbMutator {
       convert::ExtendedStringView key) = 0;
 
   // Object data.
-  // Writes the content of the given object.
+  // Writes the content of the given object. If the piece format of the page is
+  // |PieceFormat::ENCODED|, |content| must be encoded with |EncodePiece|.
   FXL_WARN_UNUSED_RESULT virtual Status WriteObject(
       coroutine::CoroutineHandler* handler,
       ObjectDigestView object_digest,
@@ -168,7 +170,8 @@ class PageDb : public PageDbMutator {
   ~PageDb() override {}
 
   // Initializes PageDb or returns an |IO_ERROR| on failure.
-  FXL_WARN_UNUSED_RESULT virtual Status Init() = 0;
+  FXL_WARN_UNUSED_RESULT virtual Status Init(
+      coroutine::CoroutineHandler* handler) = 0;
 
   // Starts a new batch. The batch will be written when Execute is called on the
   // returned object. The PageDb object must outlive the batch object. If the
@@ -216,10 +219,17 @@ class PageDb : public PageDbMutator {
       const JournalId& journal_id,
       std::unique_ptr<Iterator<const EntryChange>>* entries) = 0;
 
+  // Finds the values added in all journals, implicit and explicit, and
+  // replaces the contents of |object_digests| with their digests.
+  FXL_WARN_UNUSED_RESULT virtual Status GetJournalValueDigests(
+      coroutine::CoroutineHandler* handler,
+      std::vector<ObjectDigest>* object_digests) = 0;
+
   // Object data.
   // Reads the content of the given object. To check whether an object is stored
   // in the PageDb without retrieving its value, |nullptr| can be given for the
-  // |object| argument.
+  // |object| argument. The returned object is decoded according to the piece
+  // format of the page.
   FXL_WARN_UNUSED_RESULT virtual Status ReadObject(
       coroutine::CoroutineHandler* handler,
       ObjectIdentifier object_identifier,
@@ -259,6 +269,12 @@ class PageDb : public PageDbMutator {
       coroutine::CoroutineHandler* handler,
       std::vector<ObjectIdentifier>* object_identifiers) = 0;
 
+  // Finds the set of synced pieces and replaces the contents of
+  // |object_digests| with their digests.
+  FXL_WARN_UNUSED_RESULT virtual Status GetSyncedPieceDigests(
+      coroutine::CoroutineHandler* handler,
+      std::vector<ObjectDigest>* object_digests) = 0;
+
   // Sync metadata.
   // Retrieves the opaque sync metadata associated with this page for the given
   // key.
@@ -267,6 +283,19 @@ class PageDb : public PageDbMutator {
       fxl::StringView key,
       std::string* value) = 0;
 
+  // Piece format.
+  // Retrieves the format of the pieces stored in this page. The format is read
+  // by |Init|.
+  FXL_WARN_UNUSED_RESULT virtual Status GetPieceFormat(
+      coroutine::CoroutineHandler* handler,
+      PieceFormat* piece_format) = 0;
+
+  // Sets the format of the pieces stored in this page. This must only be
+  // called before any piece is written.
+  FXL_WARN_UNUSED_RESULT virtual Status SetPieceFormat(
+      coroutine::CoroutineHandler* handler,
+      PieceFormat piece_format) = 0;
+
  private:
   FXL_DISALLOW_COPY_AND_ASSIGN(PageDb);
 };
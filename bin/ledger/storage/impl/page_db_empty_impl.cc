@@ -8,7 +8,7 @@ namespace storage {
 
 using coroutine::CoroutineHandler;
 
-Status PageDbEmptyImpl::Init() {
+Status PageDbEmptyImpl::Init(CoroutineHandler* /*handler*/) {
   return Status::NOT_IMPLEMENTED;
 }
 Status PageDbEmptyImpl::StartBatch(CoroutineHandler* /*handler*/,
@@ -40,6 +40,11 @@ Status PageDbEmptyImpl::GetJournalEntries(
     std::unique_ptr<Iterator<const EntryChange>>* /*entries*/) {
   return Status::NOT_IMPLEMENTED;
 }
+Status PageDbEmptyImpl::GetJournalValueDigests(
+    CoroutineHandler* /*handler*/,
+    std::vector<ObjectDigest>* /*object_digests*/) {
+  return Status::NOT_IMPLEMENTED;
+}
 Status PageDbEmptyImpl::ReadObject(CoroutineHandler* /*handler*/,
                                    ObjectIdentifier /*object_identifier*/,
                                    std::unique_ptr<const Object>* /*object*/) {
@@ -70,11 +75,24 @@ Status PageDbEmptyImpl::GetUnsyncedPieces(
     std::vector<ObjectIdentifier>* /*object_identifiers*/) {
   return Status::NOT_IMPLEMENTED;
 }
+Status PageDbEmptyImpl::GetSyncedPieceDigests(
+    CoroutineHandler* /*handler*/,
+    std::vector<ObjectDigest>* /*object_digests*/) {
+  return Status::NOT_IMPLEMENTED;
+}
 Status PageDbEmptyImpl::GetSyncMetadata(CoroutineHandler* /*handler*/,
                                         fxl::StringView /*key*/,
                                         std::string* /*value*/) {
   return Status::NOT_IMPLEMENTED;
 }
+Status PageDbEmptyImpl::GetPieceFormat(CoroutineHandler* /*handler*/,
+                                       PieceFormat* /*piece_format*/) {
+  return Status::NOT_IMPLEMENTED;
+}
+Status PageDbEmptyImpl::SetPieceFormat(CoroutineHandler* /*handler*/,
+                                       PieceFormat /*piece_format*/) {
+  return Status::NOT_IMPLEMENTED;
+}
 Status PageDbEmptyImpl::AddHead(CoroutineHandler* /*handler*/,
                                 CommitIdView /*head*/,
                                 int64_t /*timestamp*/) {
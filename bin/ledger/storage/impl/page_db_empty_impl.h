@@ -15,7 +15,7 @@ class PageDbEmptyImpl : public PageDb, public PageDb::Batch {
   ~PageDbEmptyImpl() override {}
 
   // PageDb:
-  Status Init() override;
+  Status Init(coroutine::CoroutineHandler* handler) override;
   Status StartBatch(coroutine::CoroutineHandler* handler,
                     std::unique_ptr<PageDb::Batch>* batch) override;
   Status GetHeads(coroutine::CoroutineHandler* handler,
@@ -32,6 +32,9 @@ class PageDbEmptyImpl : public PageDb, public PageDb::Batch {
       coroutine::CoroutineHandler* handler,
       const JournalId& journal_id,
       std::unique_ptr<Iterator<const EntryChange>>* entries) override;
+  Status GetJournalValueDigests(
+      coroutine::CoroutineHandler* handler,
+      std::vector<ObjectDigest>* object_digests) override;
 
   // PageDb and PageDb::Batch:
   Status ReadObject(coroutine::CoroutineHandler* handler,
@@ -48,12 +51,19 @@ class PageDbEmptyImpl : public PageDb, public PageDb::Batch {
   Status GetUnsyncedPieces(
       coroutine::CoroutineHandler* handler,
       std::vector<ObjectIdentifier>* object_identifiers) override;
+  Status GetSyncedPieceDigests(
+      coroutine::CoroutineHandler* handler,
+      std::vector<ObjectDigest>* object_digests) override;
   Status GetObjectStatus(coroutine::CoroutineHandler* handler,
                          ObjectDigestView object_digest,
                          PageDbObjectStatus* object_status) override;
   Status GetSyncMetadata(coroutine::CoroutineHandler* handler,
                          fxl::StringView key,
                          std::string* value) override;
+  Status GetPieceFormat(coroutine::CoroutineHandler* handler,
+                        PieceFormat* piece_format) override;
+  Status SetPieceFormat(coroutine::CoroutineHandler* handler,
+                        PieceFormat piece_format) override;
 
   Status AddHead(coroutine::CoroutineHandler* handler,
                  CommitIdView head,
@@ -5,8 +5,10 @@
 #include "peridot/bin/ledger/storage/impl/page_db_impl.h"
 
 #include <algorithm>
+#include <iterator>
 #include <string>
 
+#include "lib/fxl/logging.h"
 #include "lib/fxl/strings/concatenate.h"
 #include "peridot/bin/ledger/storage/impl/db_serialization.h"
 #include "peridot/bin/ledger/storage/impl/journal_impl.h"
@@ -112,19 +114,45 @@ class JournalEntryIterator final : public Iterator<const EntryChange> {
 }  // namespace
 
 PageDbImpl::PageDbImpl(fxl::RefPtr<fxl::TaskRunner> task_runner,
-                       std::string db_path)
-    : db_(std::move(task_runner), std::move(db_path)) {}
+                       std::string db_path,
+                       fxl::RefPtr<fxl::TaskRunner> io_runner,
+                       std::shared_ptr<const LevelDbOptions> options) {
+  auto level_db =
+      std::make_unique<LevelDb>(std::move(task_runner), std::move(db_path),
+                                std::move(io_runner), std::move(options));
+  level_db_ = level_db.get();
+  db_ = std::move(level_db);
+}
+
+PageDbImpl::PageDbImpl(std::unique_ptr<Db> db) : db_(std::move(db)) {}
 
 PageDbImpl::~PageDbImpl() {}
 
-Status PageDbImpl::Init() {
-  return db_.Init();
+Status PageDbImpl::Init(CoroutineHandler* handler) {
+  if (level_db_) {
+    RETURN_ON_ERROR(level_db_->Init(handler));
+  }
+  std::string piece_format;
+  Status status = db_->Get(handler, PieceFormatRow::kKey, &piece_format);
+  if (status == Status::NOT_FOUND) {
+    piece_format_ = PieceFormat::RAW;
+    return Status::OK;
+  }
+  if (status != Status::OK) {
+    return status;
+  }
+  if (piece_format != PieceFormatRow::kEncoded) {
+    FXL_LOG(ERROR) << "Unknown piece format: " << piece_format;
+    return Status::FORMAT_ERROR;
+  }
+  piece_format_ = PieceFormat::ENCODED;
+  return Status::OK;
 }
 
 Status PageDbImpl::StartBatch(coroutine::CoroutineHandler* handler,
                               std::unique_ptr<Batch>* batch) {
   std::unique_ptr<Db::Batch> db_batch;
-  RETURN_ON_ERROR(db_.StartBatch(handler, &db_batch));
+  RETURN_ON_ERROR(db_->StartBatch(handler, &db_batch));
   *batch = std::make_unique<PageDbBatchImpl>(std::move(db_batch), this);
   return Status::OK;
 }
@@ -132,7 +160,7 @@ Status PageDbImpl::StartBatch(coroutine::CoroutineHandler* handler,
 Status PageDbImpl::GetHeads(CoroutineHandler* handler,
                             std::vector<CommitId>* heads) {
   std::vector<std::pair<std::string, std::string>> entries;
-  RETURN_ON_ERROR(db_.GetEntriesByPrefix(
+  RETURN_ON_ERROR(db_->GetEntriesByPrefix(
       handler, convert::ToSlice(HeadRow::kPrefix), &entries));
   ExtractSortedCommitsIds(&entries, heads);
   return Status::OK;
@@ -141,12 +169,12 @@ Status PageDbImpl::GetHeads(CoroutineHandler* handler,
 Status PageDbImpl::GetCommitStorageBytes(CoroutineHandler* handler,
                                          CommitIdView commit_id,
                                          std::string* storage_bytes) {
-  return db_.Get(handler, CommitRow::GetKeyFor(commit_id), storage_bytes);
+  return db_->Get(handler, CommitRow::GetKeyFor(commit_id), storage_bytes);
 }
 
 Status PageDbImpl::GetImplicitJournalIds(CoroutineHandler* handler,
                                          std::vector<JournalId>* journal_ids) {
-  return db_.GetByPrefix(
+  return db_->GetByPrefix(
       handler, convert::ToSlice(ImplicitJournalMetaRow::kPrefix), journal_ids);
 }
 
@@ -155,7 +183,7 @@ Status PageDbImpl::GetBaseCommitForJournal(CoroutineHandler* handler,
                                            CommitId* base) {
   FXL_DCHECK(journal_id.size() == JournalEntryRow::kJournalIdSize);
   FXL_DCHECK(journal_id[0] == JournalEntryRow::kImplicitPrefix);
-  return db_.Get(handler, ImplicitJournalMetaRow::GetKeyFor(journal_id), base);
+  return db_->Get(handler, ImplicitJournalMetaRow::GetKeyFor(journal_id), base);
 }
 
 Status PageDbImpl::GetJournalEntries(
@@ -165,25 +193,59 @@ Status PageDbImpl::GetJournalEntries(
   std::unique_ptr<Iterator<const std::pair<convert::ExtendedStringView,
                                            convert::ExtendedStringView>>>
       it;
-  RETURN_ON_ERROR(db_.GetIteratorAtPrefix(
+  RETURN_ON_ERROR(db_->GetIteratorAtPrefix(
       handler, JournalEntryRow::GetPrefixFor(journal_id), &it));
 
   *entries = std::make_unique<JournalEntryIterator>(std::move(it));
   return Status::OK;
 }
 
+Status PageDbImpl::GetJournalValueDigests(
+    CoroutineHandler* handler,
+    std::vector<ObjectDigest>* object_digests) {
+  std::vector<std::pair<std::string, std::string>> entries;
+  RETURN_ON_ERROR(db_->GetEntriesByPrefix(
+      handler, convert::ToSlice(JournalEntryRow::kPrefix), &entries));
+
+  // Rows with the journal prefix also contain the implicit journal metadata:
+  // only keep the journal entries.
+  const size_t entry_marker_size = 1 + JournalEntryRow::kJournalEntry.size();
+  object_digests->clear();
+  for (const auto& entry : entries) {
+    fxl::StringView key = entry.first;
+    if (key.size() < JournalEntryRow::kJournalIdSize + entry_marker_size ||
+        key.substr(JournalEntryRow::kJournalIdSize, 1) != "/" ||
+        key.substr(JournalEntryRow::kJournalIdSize + 1,
+                   JournalEntryRow::kJournalEntry.size()) !=
+            JournalEntryRow::kJournalEntry) {
+      continue;
+    }
+    ObjectDigest object_digest;
+    if (JournalEntryRow::ExtractObjectDigest(entry.second, &object_digest) ==
+        Status::OK) {
+      object_digests->push_back(std::move(object_digest));
+    }
+  }
+  return Status::OK;
+}
+
 Status PageDbImpl::ReadObject(CoroutineHandler* handler,
                               ObjectIdentifier object_identifier,
                               std::unique_ptr<const Object>* object) {
-  return db_.GetObject(handler,
-                       ObjectRow::GetKeyFor(object_identifier.object_digest),
-                       object_identifier, object);
+  RETURN_ON_ERROR(
+      db_->GetObject(handler,
+                     ObjectRow::GetKeyFor(object_identifier.object_digest),
+                     object_identifier, object));
+  if (object && piece_format_ == PieceFormat::ENCODED) {
+    *object = std::make_unique<EncodedObject>(std::move(*object));
+  }
+  return Status::OK;
 }
 
 Status PageDbImpl::HasObject(CoroutineHandler* handler,
                              ObjectDigestView object_digest,
                              bool* has_object) {
-  return db_.HasKey(handler, ObjectRow::GetKeyFor(object_digest), has_object);
+  return db_->HasKey(handler, ObjectRow::GetKeyFor(object_digest), has_object);
 }
 
 Status PageDbImpl::GetObjectStatus(CoroutineHandler* handler,
@@ -192,13 +254,13 @@ Status PageDbImpl::GetObjectStatus(CoroutineHandler* handler,
   bool has_key;
 
   RETURN_ON_ERROR(
-      db_.HasKey(handler, LocalObjectRow::GetKeyFor(object_digest), &has_key));
+      db_->HasKey(handler, LocalObjectRow::GetKeyFor(object_digest), &has_key));
   if (has_key) {
     *object_status = PageDbObjectStatus::LOCAL;
     return Status::OK;
   }
 
-  RETURN_ON_ERROR(db_.HasKey(
+  RETURN_ON_ERROR(db_->HasKey(
       handler, TransientObjectRow::GetKeyFor(object_digest), &has_key));
   if (has_key) {
     *object_status = PageDbObjectStatus::TRANSIENT;
@@ -206,7 +268,7 @@ Status PageDbImpl::GetObjectStatus(CoroutineHandler* handler,
   }
 
   RETURN_ON_ERROR(
-      db_.HasKey(handler, ObjectRow::GetKeyFor(object_digest), &has_key));
+      db_->HasKey(handler, ObjectRow::GetKeyFor(object_digest), &has_key));
   if (!has_key) {
     *object_status = PageDbObjectStatus::UNKNOWN;
     return Status::OK;
@@ -219,7 +281,7 @@ Status PageDbImpl::GetObjectStatus(CoroutineHandler* handler,
 Status PageDbImpl::GetUnsyncedCommitIds(CoroutineHandler* handler,
                                         std::vector<CommitId>* commit_ids) {
   std::vector<std::pair<std::string, std::string>> entries;
-  RETURN_ON_ERROR(db_.GetEntriesByPrefix(
+  RETURN_ON_ERROR(db_->GetEntriesByPrefix(
       handler, convert::ToSlice(UnsyncedCommitRow::kPrefix), &entries));
   ExtractSortedCommitsIds(&entries, commit_ids);
   return Status::OK;
@@ -230,7 +292,7 @@ Status PageDbImpl::IsCommitSynced(CoroutineHandler* handler,
                                   bool* is_synced) {
   bool has_key;
   RETURN_ON_ERROR(
-      db_.HasKey(handler, UnsyncedCommitRow::GetKeyFor(commit_id), &has_key));
+      db_->HasKey(handler, UnsyncedCommitRow::GetKeyFor(commit_id), &has_key));
   *is_synced = !has_key;
   return Status::OK;
 }
@@ -239,7 +301,7 @@ Status PageDbImpl::GetUnsyncedPieces(
     CoroutineHandler* handler,
     std::vector<ObjectIdentifier>* object_identifiers) {
   std::vector<ObjectDigest> digests;
-  Status status = db_.GetByPrefix(
+  Status status = db_->GetByPrefix(
       handler, convert::ToSlice(LocalObjectRow::kPrefix), &digests);
   if (status != Status::OK) {
     return status;
@@ -257,10 +319,58 @@ Status PageDbImpl::GetUnsyncedPieces(
   return Status::OK;
 }
 
+Status PageDbImpl::GetSyncedPieceDigests(
+    CoroutineHandler* handler,
+    std::vector<ObjectDigest>* object_digests) {
+  std::vector<ObjectDigest> digests;
+  RETURN_ON_ERROR(db_->GetByPrefix(
+      handler, convert::ToSlice(ObjectRow::kPrefix), &digests));
+  std::vector<ObjectDigest> transient_digests;
+  RETURN_ON_ERROR(db_->GetByPrefix(
+      handler, convert::ToSlice(TransientObjectRow::kPrefix),
+      &transient_digests));
+  std::vector<ObjectDigest> local_digests;
+  RETURN_ON_ERROR(db_->GetByPrefix(
+      handler, convert::ToSlice(LocalObjectRow::kPrefix), &local_digests));
+
+  // All results are sorted by key, and objects that are neither transient nor
+  // local are synced.
+  std::vector<ObjectDigest> unsynced_digests;
+  std::merge(transient_digests.begin(), transient_digests.end(),
+             local_digests.begin(), local_digests.end(),
+             std::back_inserter(unsynced_digests));
+  object_digests->clear();
+  std::set_difference(digests.begin(), digests.end(),
+                      unsynced_digests.begin(), unsynced_digests.end(),
+                      std::back_inserter(*object_digests));
+  return Status::OK;
+}
+
 Status PageDbImpl::GetSyncMetadata(CoroutineHandler* handler,
                                    fxl::StringView key,
                                    std::string* value) {
-  return db_.Get(handler, SyncMetadataRow::GetKeyFor(key), value);
+  return db_->Get(handler, SyncMetadataRow::GetKeyFor(key), value);
+}
+
+Status PageDbImpl::GetPieceFormat(CoroutineHandler* /*handler*/,
+                                  PieceFormat* piece_format) {
+  *piece_format = piece_format_;
+  return Status::OK;
+}
+
+Status PageDbImpl::SetPieceFormat(CoroutineHandler* handler,
+                                  PieceFormat piece_format) {
+  std::unique_ptr<Db::Batch> batch;
+  RETURN_ON_ERROR(db_->StartBatch(handler, &batch));
+  if (piece_format == PieceFormat::ENCODED) {
+    RETURN_ON_ERROR(
+        batch->Put(handler, PieceFormatRow::kKey, PieceFormatRow::kEncoded));
+  } else {
+    RETURN_ON_ERROR(batch->Delete(handler, PieceFormatRow::kKey));
+  }
+  RETURN_ON_ERROR(batch->Execute(handler));
+  piece_format_ = piece_format;
+  return Status::OK;
 }
 
 Status PageDbImpl::AddHead(CoroutineHandler* handler,
@@ -23,10 +23,19 @@ class PageStorageImpl;
 // TRANSIENT objects.
 class PageDbImpl : public PageDb {
  public:
-  PageDbImpl(fxl::RefPtr<fxl::TaskRunner> task_runner, std::string db_path);
+  // If |io_runner| is not null, the database is opened, accessed and closed on
+  // it. If |options| is not null, the database is opened with them. See
+  // |LevelDb|.
+  PageDbImpl(fxl::RefPtr<fxl::TaskRunner> task_runner,
+             std::string db_path,
+             fxl::RefPtr<fxl::TaskRunner> io_runner = nullptr,
+             std::shared_ptr<const LevelDbOptions> options = nullptr);
+  // Creates a |PageDbImpl| storing its rows in |db|, which must already be
+  // initialized, such as a |PrefixedDb| on a database shared between pages.
+  explicit PageDbImpl(std::unique_ptr<Db> db);
   ~PageDbImpl() override;
 
-  Status Init() override;
+  Status Init(coroutine::CoroutineHandler* handler) override;
   Status StartBatch(coroutine::CoroutineHandler* handler,
                     std::unique_ptr<PageDb::Batch>* batch) override;
   Status GetHeads(coroutine::CoroutineHandler* handler,
@@ -43,6 +52,9 @@ class PageDbImpl : public PageDb {
       coroutine::CoroutineHandler* handler,
       const JournalId& journal_id,
       std::unique_ptr<Iterator<const EntryChange>>* entries) override;
+  Status GetJournalValueDigests(
+      coroutine::CoroutineHandler* handler,
+      std::vector<ObjectDigest>* object_digests) override;
   Status ReadObject(coroutine::CoroutineHandler* handler,
                     ObjectIdentifier object_identifier,
                     std::unique_ptr<const Object>* object) override;
@@ -57,12 +69,19 @@ class PageDbImpl : public PageDb {
   Status GetUnsyncedPieces(
       coroutine::CoroutineHandler* handler,
       std::vector<ObjectIdentifier>* object_identifiers) override;
+  Status GetSyncedPieceDigests(
+      coroutine::CoroutineHandler* handler,
+      std::vector<ObjectDigest>* object_digests) override;
   Status GetObjectStatus(coroutine::CoroutineHandler* handler,
                          ObjectDigestView object_digest,
                          PageDbObjectStatus* object_status) override;
   Status GetSyncMetadata(coroutine::CoroutineHandler* handler,
                          fxl::StringView key,
                          std::string* value) override;
+  Status GetPieceFormat(coroutine::CoroutineHandler* handler,
+                        PieceFormat* piece_format) override;
+  Status SetPieceFormat(coroutine::CoroutineHandler* handler,
+                        PieceFormat piece_format) override;
 
   Status AddHead(coroutine::CoroutineHandler* handler,
                  CommitIdView head,
@@ -108,7 +127,11 @@ class PageDbImpl : public PageDb {
                          fxl::StringView value) override;
 
  private:
-  LevelDb db_;
+  // The database owned by this page, if it is not stored in a shared
+  // database.
+  LevelDb* level_db_ = nullptr;
+  std::unique_ptr<Db> db_;
+  PieceFormat piece_format_ = PieceFormat::RAW;
 };
 
 }  // namespace storage
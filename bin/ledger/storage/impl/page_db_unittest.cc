@@ -59,7 +59,9 @@ class PageDbTest : public ::test::TestWithCoroutines {
     ASSERT_FALSE(RunLoopWithTimeout());
     ASSERT_EQ(Status::OK, status);
 
-    ASSERT_EQ(Status::OK, page_db_.Init());
+    EXPECT_TRUE(RunInCoroutine([this](CoroutineHandler* handler) {
+      ASSERT_EQ(Status::OK, page_db_.Init(handler));
+    }));
   }
 
  protected:
@@ -225,6 +227,39 @@ TEST_F(PageDbTest, JournalEntries) {
   }));
 }
 
+TEST_F(PageDbTest, JournalValueDigests) {
+  EXPECT_TRUE(RunInCoroutine([&](CoroutineHandler* handler) {
+    CommitId commit_id = RandomCommitId();
+
+    JournalId implicit_journal_id;
+    EXPECT_EQ(Status::OK,
+              page_db_.CreateJournalId(handler, JournalType::IMPLICIT,
+                                       commit_id, &implicit_journal_id));
+    JournalId explicit_journal_id;
+    EXPECT_EQ(Status::OK,
+              page_db_.CreateJournalId(handler, JournalType::EXPLICIT,
+                                       commit_id, &explicit_journal_id));
+    std::vector<ObjectDigest> object_digests;
+    EXPECT_EQ(Status::OK,
+              page_db_.GetJournalValueDigests(handler, &object_digests));
+    EXPECT_TRUE(object_digests.empty());
+
+    EXPECT_EQ(Status::OK, page_db_.AddJournalEntry(handler, implicit_journal_id,
+                                                   "key1", "value1",
+                                                   KeyPriority::LAZY));
+    EXPECT_EQ(Status::OK, page_db_.AddJournalEntry(handler, explicit_journal_id,
+                                                   "key2", "value2",
+                                                   KeyPriority::EAGER));
+    EXPECT_EQ(Status::OK, page_db_.RemoveJournalEntry(
+                              handler, explicit_journal_id, "key3"));
+
+    EXPECT_EQ(Status::OK,
+              page_db_.GetJournalValueDigests(handler, &object_digests));
+    std::sort(object_digests.begin(), object_digests.end());
+    EXPECT_EQ(std::vector<ObjectDigest>({"value1", "value2"}), object_digests);
+  }));
+}
+
 TEST_F(PageDbTest, ObjectStorage) {
   EXPECT_TRUE(RunInCoroutine([&](CoroutineHandler* handler) {
     ObjectIdentifier object_identifier = RandomObjectIdentifier();
@@ -334,6 +369,43 @@ TEST_F(PageDbTest, UnsyncedPieces) {
   }));
 }
 
+TEST_F(PageDbTest, SyncedPieces) {
+  EXPECT_TRUE(RunInCoroutine([&](CoroutineHandler* handler) {
+    std::vector<ObjectDigest> object_digests;
+    EXPECT_EQ(Status::OK,
+              page_db_.GetSyncedPieceDigests(handler, &object_digests));
+    EXPECT_TRUE(object_digests.empty());
+
+    ObjectDigest transient_digest = RandomObjectDigest();
+    ObjectDigest local_digest = RandomObjectDigest();
+    ObjectDigest synced_digest = RandomObjectDigest();
+    EXPECT_EQ(Status::OK,
+              page_db_.WriteObject(handler, transient_digest,
+                                   DataSource::DataChunk::Create(""),
+                                   PageDbObjectStatus::TRANSIENT));
+    EXPECT_EQ(Status::OK,
+              page_db_.WriteObject(handler, local_digest,
+                                   DataSource::DataChunk::Create(""),
+                                   PageDbObjectStatus::LOCAL));
+    EXPECT_EQ(Status::OK,
+              page_db_.WriteObject(handler, synced_digest,
+                                   DataSource::DataChunk::Create(""),
+                                   PageDbObjectStatus::SYNCED));
+    EXPECT_EQ(Status::OK,
+              page_db_.GetSyncedPieceDigests(handler, &object_digests));
+    EXPECT_EQ(std::vector<ObjectDigest>({synced_digest}), object_digests);
+
+    EXPECT_EQ(Status::OK, page_db_.SetObjectStatus(handler, local_digest,
+                                                   PageDbObjectStatus::SYNCED));
+    EXPECT_EQ(Status::OK,
+              page_db_.GetSyncedPieceDigests(handler, &object_digests));
+    std::sort(object_digests.begin(), object_digests.end());
+    std::vector<ObjectDigest> expected_digests({local_digest, synced_digest});
+    std::sort(expected_digests.begin(), expected_digests.end());
+    EXPECT_EQ(expected_digests, object_digests);
+  }));
+}
+
 TEST_F(PageDbTest, Batch) {
   EXPECT_TRUE(RunInCoroutine([&](CoroutineHandler* handler) {
     std::unique_ptr<PageDb::Batch> batch;
@@ -415,5 +487,34 @@ TEST_F(PageDbTest, SyncMetadata) {
   }));
 }
 
+TEST_F(PageDbTest, PieceFormat) {
+  EXPECT_TRUE(RunInCoroutine([&](CoroutineHandler* handler) {
+    PieceFormat piece_format;
+    EXPECT_EQ(Status::OK, page_db_.GetPieceFormat(handler, &piece_format));
+    EXPECT_EQ(PieceFormat::RAW, piece_format);
+
+    EXPECT_EQ(Status::OK,
+              page_db_.SetPieceFormat(handler, PieceFormat::ENCODED));
+    EXPECT_EQ(Status::OK, page_db_.GetPieceFormat(handler, &piece_format));
+    EXPECT_EQ(PieceFormat::ENCODED, piece_format);
+
+    // Objects are decoded when read.
+    ObjectIdentifier object_identifier = RandomObjectIdentifier();
+    std::string content = RandomString(1024);
+    std::string encoded;
+    EncodePiece(content, PieceCompression::NONE, &encoded);
+    ASSERT_EQ(Status::OK,
+              page_db_.WriteObject(handler, object_identifier.object_digest,
+                                   DataSource::DataChunk::Create(encoded),
+                                   PageDbObjectStatus::TRANSIENT));
+    std::unique_ptr<const Object> object;
+    ASSERT_EQ(Status::OK,
+              page_db_.ReadObject(handler, object_identifier, &object));
+    fxl::StringView object_content;
+    EXPECT_EQ(Status::OK, object->GetData(&object_content));
+    EXPECT_EQ(content, object_content);
+  }));
+}
+
 }  // namespace
 }  // namespace storage
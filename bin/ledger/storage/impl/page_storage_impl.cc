@@ -28,9 +28,11 @@
 #include "lib/fxl/logging.h"
 #include "lib/fxl/memory/weak_ptr.h"
 #include "lib/fxl/strings/concatenate.h"
+#include "lib/fxl/time/time_point.h"
 #include "peridot/bin/ledger/cobalt/cobalt.h"
 #include "peridot/bin/ledger/storage/impl/btree/diff.h"
 #include "peridot/bin/ledger/storage/impl/btree/iterator.h"
+#include "peridot/bin/ledger/storage/impl/btree/synchronous_storage.h"
 #include "peridot/bin/ledger/storage/impl/commit_impl.h"
 #include "peridot/bin/ledger/storage/impl/constants.h"
 #include "peridot/bin/ledger/storage/impl/file_index.h"
@@ -53,7 +55,38 @@ using coroutine::CoroutineHandler;
 
 namespace {
 
-const char kLevelDbDir[] = "/leveldb";
+// Maximal estimated memory, in bytes, used by the decoded tree nodes cached
+// for a single page.
+constexpr size_t kTreeNodeCacheMemoryBudget = 1024 * 1024;
+
+// Maximal number of parsed commits cached for a single page.
+constexpr size_t kCommitCacheCapacity = 1024;
+
+// Delay between a change of the commit graph and the garbage collection it
+// triggers. Changes happening in the meantime don't trigger another one.
+constexpr fxl::TimeDelta kGarbageCollectionDelay =
+    fxl::TimeDelta::FromSeconds(5 * 60);
+
+// The garbage collector deletes at most this many pieces at a time, and waits
+// |kGarbageCollectionBatchInterval| between two deletions, so that it doesn't
+// compete with the operations on the page.
+constexpr size_t kGarbageCollectionBatchSize = 64;
+constexpr fxl::TimeDelta kGarbageCollectionBatchInterval =
+    fxl::TimeDelta::FromMilliseconds(10);
+
+// Number of sibling tree nodes read concurrently when iterating over the
+// contents of a commit, or over the diff between two commits.
+constexpr size_t kTreeNodeReadAhead = 4;
+
+// Maximal number of objects fetched concurrently from the cloud.
+constexpr size_t kMaxConcurrentDownloads = 16;
+
+// Objects at least this large have the digests of their pieces computed on the
+// digest runner, if there is one.
+constexpr uint64_t kMinObjectSizeForPipelinedSplit = 256 * 1024;
+
+// Objects at least this large are added to the blob store, if there is one.
+constexpr uint64_t kMinBlobStoreObjectSize = 256 * 1024;
 
 struct StringPointerComparator {
   using is_transparent = std::true_type;
@@ -73,24 +106,61 @@ struct StringPointerComparator {
 
 }  // namespace
 
+class PageStorageImpl::CommitPinImpl : public PageStorage::CommitPin {
+ public:
+  CommitPinImpl(fxl::WeakPtr<PageStorageImpl> page_storage, CommitId commit_id)
+      : page_storage_(std::move(page_storage)),
+        commit_id_(std::move(commit_id)) {}
+
+  ~CommitPinImpl() override {
+    if (page_storage_) {
+      page_storage_->UnpinCommit(commit_id_);
+    }
+  }
+
+ private:
+  fxl::WeakPtr<PageStorageImpl> page_storage_;
+  const CommitId commit_id_;
+
+  FXL_DISALLOW_COPY_AND_ASSIGN(CommitPinImpl);
+};
+
 PageStorageImpl::PageStorageImpl(fxl::RefPtr<fxl::TaskRunner> task_runner,
                                  coroutine::CoroutineService* coroutine_service,
                                  std::string page_dir,
-                                 PageId page_id)
+                                 PageId page_id,
+                                 fxl::RefPtr<fxl::TaskRunner> io_runner,
+                                 fxl::RefPtr<fxl::TaskRunner> db_runner)
     : PageStorageImpl(task_runner,
                       coroutine_service,
-                      std::make_unique<PageDbImpl>(std::move(task_runner),
-                                                   page_dir + kLevelDbDir),
-                      std::move(page_id)) {}
+                      std::make_unique<PageDbImpl>(task_runner,
+                                                   page_dir + kLevelDbDir,
+                                                   std::move(db_runner)),
+                      std::move(page_id),
+                      std::move(io_runner)) {}
 
-PageStorageImpl::PageStorageImpl(fxl::RefPtr<fxl::TaskRunner> /*task_runner*/,
+PageStorageImpl::PageStorageImpl(fxl::RefPtr<fxl::TaskRunner> task_runner,
                                  coroutine::CoroutineService* coroutine_service,
                                  std::unique_ptr<PageDb> page_db,
-                                 PageId page_id)
-    : coroutine_service_(coroutine_service),
+                                 PageId page_id,
+                                 fxl::RefPtr<fxl::TaskRunner> digest_runner)
+    : task_runner_(std::move(task_runner)),
+      coroutine_service_(coroutine_service),
+      digest_runner_(std::move(digest_runner)),
       page_id_(std::move(page_id)),
       db_(std::move(page_db)),
-      page_sync_(nullptr) {}
+      page_sync_(nullptr),
+      download_scheduler_(
+          kMaxConcurrentDownloads,
+          [this](ObjectIdentifier object_identifier,
+                 std::function<void(uint64_t)> on_fetched,
+                 std::function<void(Status)> callback) {
+            FetchFullObject(std::move(object_identifier),
+                            std::move(on_fetched), std::move(callback));
+          }),
+      tree_node_cache_(kTreeNodeCacheMemoryBudget),
+      commit_cache_(kCommitCacheCapacity),
+      weak_factory_(this) {}
 
 PageStorageImpl::~PageStorageImpl() {
   // Interrupt any active handlers.
@@ -353,15 +423,28 @@ void PageStorageImpl::AddObjectFromLocal(
   auto traced_callback =
       TRACE_CALLBACK(std::move(callback), "ledger", "page_storage_add_object");
 
+  // The digests of the pieces of large objects are computed on
+  // |digest_runner_|, while the object is still being split.
+  fxl::RefPtr<fxl::TaskRunner> digest_runner;
+  if (data_source->GetSize() >= kMinObjectSizeForPipelinedSplit) {
+    digest_runner = digest_runner_;
+  }
+
   auto managed_data_source = managed_container_.Manage(std::move(data_source));
   auto waiter = callback::StatusWaiter<Status>::Create(Status::OK);
   SplitDataSource(
-      managed_data_source->get(),
+      managed_data_source->get(), task_runner_, std::move(digest_runner),
       fxl::MakeCopyable(
-          [this, waiter, managed_data_source = std::move(managed_data_source),
+          [this, weak_this = weak_factory_.GetWeakPtr(), waiter,
+           managed_data_source = std::move(managed_data_source),
            callback = std::move(traced_callback)](
               IterationStatus status, ObjectDigest object_digest,
               std::unique_ptr<DataSource::DataChunk> chunk) mutable {
+            // Pieces can still be sent after the source is done when their
+            // digests are computed on the digest runner.
+            if (!weak_this) {
+              return ObjectIdentifier();
+            }
             if (status == IterationStatus::ERROR) {
               callback(Status::IO_ERROR, ObjectIdentifier());
               return ObjectIdentifier();
@@ -392,11 +475,166 @@ void PageStorageImpl::AddObjectFromLocal(
           }));
 }
 
+void PageStorageImpl::AddObjectsFromLocal(
+    std::vector<std::unique_ptr<DataSource>> data_sources,
+    std::function<void(Status, std::vector<ObjectIdentifier>)> callback) {
+  auto traced_callback =
+      TRACE_CALLBACK(std::move(callback), "ledger", "page_storage_add_objects");
+
+  // The pieces of all the objects, written together once all the objects are
+  // split.
+  auto pieces = std::make_shared<std::vector<
+      std::pair<ObjectIdentifier, std::unique_ptr<DataSource::DataChunk>>>>();
+  auto waiter = callback::Waiter<Status, ObjectIdentifier>::Create(Status::OK);
+  for (auto& data_source : data_sources) {
+    auto managed_data_source =
+        managed_container_.Manage(std::move(data_source));
+    SplitDataSource(
+        managed_data_source->get(),
+        fxl::MakeCopyable(
+            [pieces, managed_data_source = std::move(managed_data_source),
+             callback = waiter->NewCallback()](
+                IterationStatus status, ObjectDigest object_digest,
+                std::unique_ptr<DataSource::DataChunk> chunk) mutable {
+              if (status == IterationStatus::ERROR) {
+                callback(Status::IO_ERROR, ObjectIdentifier());
+                return ObjectIdentifier();
+              }
+              FXL_DCHECK(IsDigestValid(object_digest));
+
+              ObjectIdentifier identifier =
+                  MakeDefaultObjectIdentifier(std::move(object_digest));
+              if (chunk) {
+                FXL_DCHECK(status == IterationStatus::IN_PROGRESS);
+                if (GetObjectDigestType(identifier.object_digest) !=
+                    ObjectDigestType::INLINE) {
+                  pieces->emplace_back(identifier, std::move(chunk));
+                }
+                return identifier;
+              }
+
+              FXL_DCHECK(status == IterationStatus::DONE);
+              callback(Status::OK, identifier);
+              return identifier;
+            }));
+  }
+
+  waiter->Finalize([this, weak_this = weak_factory_.GetWeakPtr(), pieces,
+                    callback = std::move(traced_callback)](
+                       Status status,
+                       std::vector<ObjectIdentifier> identifiers) mutable {
+    if (!weak_this) {
+      return;
+    }
+    if (status != Status::OK) {
+      callback(status, {});
+      return;
+    }
+    coroutine_service_->StartCoroutine(fxl::MakeCopyable(
+        [this, pieces, identifiers = std::move(identifiers),
+         final_callback = std::move(callback)](
+            CoroutineHandler* handler) mutable {
+          auto callback =
+              UpdateActiveHandlersCallback(handler, std::move(final_callback));
+          Status status = SynchronousAddPieces(handler, std::move(*pieces),
+                                               ChangeSource::LOCAL);
+          if (status != Status::OK) {
+            callback(status, {});
+            return;
+          }
+          callback(Status::OK, std::move(identifiers));
+        }));
+  });
+}
+
 void PageStorageImpl::GetObject(
     ObjectIdentifier object_identifier,
     Location location,
     std::function<void(Status, std::unique_ptr<const Object>)> callback) {
   FXL_DCHECK(IsDigestValid(object_identifier.object_digest));
+  // Only objects split into several pieces can be in the blob store.
+  if (!blob_store_ || GetObjectDigestType(object_identifier.object_digest) !=
+                          ObjectDigestType::INDEX_HASH) {
+    GetObjectFromPieces(std::move(object_identifier), location,
+                        std::move(callback));
+    return;
+  }
+
+  ObjectIdentifier index_identifier = object_identifier;
+  std::function<void(Status, fsl::SizedVmo)> on_read = fxl::MakeCopyable(
+      [this, object_identifier = std::move(object_identifier), location,
+       callback = std::move(callback)](Status status,
+                                       fsl::SizedVmo vmo) mutable {
+        if (status == Status::NOT_FOUND) {
+          GetObjectFromPieces(std::move(object_identifier), location,
+                              std::move(callback));
+          return;
+        }
+        if (status != Status::OK) {
+          callback(status, nullptr);
+          return;
+        }
+        callback(Status::OK, std::make_unique<VmoObject>(
+                                 std::move(object_identifier), std::move(vmo)));
+      });
+  coroutine_service_->StartCoroutine(
+      [this, index_identifier = std::move(index_identifier),
+       on_read = std::move(on_read)](CoroutineHandler* handler) mutable {
+        auto callback =
+            UpdateActiveHandlersCallback(handler, std::move(on_read));
+
+        fsl::SizedVmo vmo;
+        Status status =
+            blob_store_->Read(handler, index_identifier.object_digest, &vmo);
+        if (status != Status::OK) {
+          callback(status, std::move(vmo));
+          return;
+        }
+        // A blob that does not have the size of the object, such as one
+        // truncated by a crash, is dropped: the object is read from its
+        // pieces instead.
+        status = SynchronousCheckBlobSize(handler, index_identifier, vmo);
+        if (status == Status::NOT_FOUND) {
+          status = blob_store_->Delete(handler, index_identifier.object_digest);
+          if (status == Status::OK) {
+            status = Status::NOT_FOUND;
+          }
+        }
+        callback(status, std::move(vmo));
+      });
+}
+
+Status PageStorageImpl::SynchronousCheckBlobSize(
+    CoroutineHandler* handler,
+    const ObjectIdentifier& index_identifier,
+    const fsl::SizedVmo& vmo) {
+  std::unique_ptr<const Object> index;
+  Status status = db_->ReadObject(handler, index_identifier, &index);
+  if (status != Status::OK) {
+    return status;
+  }
+  fxl::StringView content;
+  status = index->GetData(&content);
+  if (status != Status::OK) {
+    return status;
+  }
+  const FileIndex* file_index;
+  status = FileIndexSerialization::ParseFileIndex(content, &file_index);
+  if (status != Status::OK) {
+    return Status::FORMAT_ERROR;
+  }
+  if (file_index->size() != vmo.size()) {
+    FXL_LOG(WARNING) << "Blob of size " << vmo.size() << " for an object of "
+                     << "size " << file_index->size() << ", ignoring it.";
+    return Status::NOT_FOUND;
+  }
+  return Status::OK;
+}
+
+void PageStorageImpl::GetObjectFromPieces(
+    ObjectIdentifier object_identifier,
+    Location location,
+    std::function<void(Status, std::unique_ptr<const Object>)> callback) {
   GetPiece(object_identifier, [this, object_identifier, location,
                                callback = std::move(callback)](
                                   Status status, std::unique_ptr<const Object>
@@ -447,7 +685,8 @@ void PageStorageImpl::GetObject(
       return;
     }
 
-    fsl::SizedVmo vmo(std::move(raw_vmo), file_index->size());
+    uint64_t file_index_size = file_index->size();
+    fsl::SizedVmo vmo(std::move(raw_vmo), file_index_size);
     size_t offset = 0;
     auto waiter = callback::StatusWaiter<Status>::Create(Status::OK);
     for (const auto* child : *file_index->children()) {
@@ -478,11 +717,37 @@ void PageStorageImpl::GetObject(
         std::move(object_identifier), std::move(vmo));
 
     waiter->Finalize(fxl::MakeCopyable(
-        [object = std::move(final_object), callback = std::move(callback)](
-            Status status) mutable { callback(status, std::move(object)); }));
+        [this, file_index_size, object = std::move(final_object),
+         callback = std::move(callback)](Status status) mutable {
+          if (status == Status::OK && blob_store_ &&
+              file_index_size >= kMinBlobStoreObjectSize) {
+            AddToBlobStore(*object);
+          }
+          callback(status, std::move(object));
+        }));
   });
 }
 
+void PageStorageImpl::AddToBlobStore(const Object& object) {
+  fsl::SizedVmo vmo;
+  if (object.GetVmo(&vmo) != Status::OK) {
+    return;
+  }
+  coroutine_service_->StartCoroutine(fxl::MakeCopyable(
+      [this, object_digest = object.GetIdentifier().object_digest,
+       vmo = std::move(vmo)](CoroutineHandler* handler) mutable {
+        auto callback = UpdateActiveHandlersCallback(
+            handler, std::function<void(Status)>([](Status status) {
+              if (status != Status::OK && status != Status::INTERRUPTED) {
+                FXL_LOG(WARNING)
+                    << "Unable to add an object to the blob store. Status: "
+                    << status;
+              }
+            }));
+        callback(blob_store_->Write(handler, object_digest, std::move(vmo)));
+      }));
+}
+
 void PageStorageImpl::GetPiece(
     ObjectIdentifier object_identifier,
     std::function<void(Status, std::unique_ptr<const Object>)> callback) {
@@ -537,16 +802,42 @@ void PageStorageImpl::GetSyncMetadata(
       });
 }
 
+void PageStorageImpl::CollectGarbage(
+    std::function<void(Status, GarbageCollectionStats)> callback) {
+  if (garbage_collection_in_progress_) {
+    callback(Status::ILLEGAL_STATE, GarbageCollectionStats());
+    return;
+  }
+  garbage_collection_in_progress_ = true;
+  coroutine_service_->StartCoroutine([this, final_callback =
+                                                std::move(callback)](
+                                         CoroutineHandler* handler) mutable {
+    auto callback =
+        UpdateActiveHandlersCallback(handler, std::move(final_callback));
+
+    GarbageCollectionStats stats;
+    Status status = SynchronousCollectGarbage(handler, &stats);
+    garbage_collection_in_progress_ = false;
+    journal_values_to_mark_.clear();
+    total_garbage_collection_stats_.deleted_piece_count +=
+        stats.deleted_piece_count;
+    total_garbage_collection_stats_.reclaimed_bytes += stats.reclaimed_bytes;
+    callback(status, stats);
+  });
+}
+
 void PageStorageImpl::GetCommitContents(const Commit& commit,
                                         std::string min_key,
+                                        std::string max_key,
                                         std::function<bool(Entry)> on_next,
                                         std::function<void(Status)> on_done) {
   btree::ForEachEntry(
-      coroutine_service_, this, commit.GetRootIdentifier(), min_key,
+      coroutine_service_, this, commit.GetRootIdentifier(), std::move(min_key),
+      std::move(max_key),
       [on_next = std::move(on_next)](btree::EntryAndNodeIdentifier next) {
         return on_next(next.entry);
       },
-      std::move(on_done));
+      std::move(on_done), &tree_node_cache_, kTreeNodeReadAhead);
 }
 
 void PageStorageImpl::GetEntryFromCommit(
@@ -576,18 +867,31 @@ void PageStorageImpl::GetEntryFromCommit(
         callback(s, Entry());
       });
   btree::ForEachEntry(coroutine_service_, this, commit.GetRootIdentifier(),
-                      std::move(key), std::move(on_next), std::move(on_done));
+                      std::move(key), "", std::move(on_next),
+                      std::move(on_done), &tree_node_cache_);
+}
+
+void PageStorageImpl::GetEntriesFromCommit(
+    const Commit& commit,
+    std::vector<std::string> keys,
+    std::function<void(Status, std::vector<Entry>)> callback) {
+  btree::GetEntriesForKeys(coroutine_service_, this,
+                           commit.GetRootIdentifier(), std::move(keys),
+                           std::move(callback), &tree_node_cache_);
 }
 
 void PageStorageImpl::GetCommitContentsDiff(
     const Commit& base_commit,
     const Commit& other_commit,
     std::string min_key,
+    std::string max_key,
     std::function<bool(EntryChange)> on_next_diff,
     std::function<void(Status)> on_done) {
   btree::ForEachDiff(coroutine_service_, this, base_commit.GetRootIdentifier(),
                      other_commit.GetRootIdentifier(), std::move(min_key),
-                     std::move(on_next_diff), std::move(on_done));
+                     std::move(max_key), std::move(on_next_diff),
+                     std::move(on_done), &tree_node_cache_,
+                     kTreeNodeReadAhead);
 }
 
 void PageStorageImpl::GetThreeWayContentsDiff(
@@ -600,7 +904,8 @@ void PageStorageImpl::GetThreeWayContentsDiff(
   btree::ForEachThreeWayDiff(
       coroutine_service_, this, base_commit.GetRootIdentifier(),
       left_commit.GetRootIdentifier(), right_commit.GetRootIdentifier(),
-      std::move(min_key), std::move(on_next_diff), std::move(on_done));
+      std::move(min_key), std::move(on_next_diff), std::move(on_done),
+      &tree_node_cache_);
 }
 
 void PageStorageImpl::GetJournalEntries(
@@ -624,6 +929,11 @@ void PageStorageImpl::AddJournalEntry(const JournalId& journal_id,
                                       ObjectIdentifier object_identifier,
                                       KeyPriority priority,
                                       std::function<void(Status)> callback) {
+  // A running garbage collection has read the journal values already: the new
+  // value must be kept as well.
+  if (garbage_collection_in_progress_) {
+    journal_values_to_mark_.push_back(object_identifier);
+  }
   coroutine_service_->StartCoroutine([this, journal_id, key = key.ToString(),
                                       object_identifier =
                                           std::move(object_identifier),
@@ -728,7 +1038,7 @@ Status PageStorageImpl::MarkAllPiecesLocal(
 
 Status PageStorageImpl::ContainsCommit(CoroutineHandler* handler,
                                        CommitIdView id) {
-  if (IsFirstCommit(id)) {
+  if (IsFirstCommit(id) || commit_cache_.Contains(id)) {
     return Status::OK;
   }
   std::string bytes;
@@ -760,9 +1070,18 @@ void PageStorageImpl::DownloadFullObject(ObjectIdentifier object_identifier,
   FXL_DCHECK(GetObjectDigestType(object_identifier.object_digest) !=
              ObjectDigestType::INLINE);
 
+  download_scheduler_.Download(std::move(object_identifier),
+                               std::move(callback));
+}
+
+void PageStorageImpl::FetchFullObject(
+    ObjectIdentifier object_identifier,
+    std::function<void(uint64_t)> on_fetched,
+    std::function<void(Status)> callback) {
   page_sync_->GetObject(
       object_identifier.object_digest,
-      [this, callback = std::move(callback),
+      [this, on_fetched = std::move(on_fetched),
+       callback = std::move(callback),
        object_identifier = std::move(object_identifier)](
           Status status, std::unique_ptr<DataSource> data_source) mutable {
         if (status != Status::OK) {
@@ -771,7 +1090,8 @@ void PageStorageImpl::DownloadFullObject(ObjectIdentifier object_identifier,
         }
         ReadDataSource(
             std::move(data_source),
-            [this, callback = std::move(callback),
+            [this, on_fetched = std::move(on_fetched),
+             callback = std::move(callback),
              object_identifier = std::move(object_identifier)](
                 Status status,
                 std::unique_ptr<DataSource::DataChunk> chunk) mutable {
@@ -779,6 +1099,7 @@ void PageStorageImpl::DownloadFullObject(ObjectIdentifier object_identifier,
                 callback(status);
                 return;
               }
+              on_fetched(chunk->Get().size());
               coroutine_service_->StartCoroutine(fxl::MakeCopyable(
                   [this, object_identifier = std::move(object_identifier),
                    chunk = std::move(chunk),
@@ -1042,7 +1363,7 @@ void PageStorageImpl::ReadDataSource(
 
 Status PageStorageImpl::SynchronousInit(CoroutineHandler* handler) {
   // Initialize PageDb.
-  Status s = db_->Init();
+  Status s = db_->Init(handler);
   if (s != Status::OK) {
     return s;
   }
@@ -1054,11 +1375,23 @@ Status PageStorageImpl::SynchronousInit(CoroutineHandler* handler) {
     return s;
   }
   if (heads.empty()) {
+    // The piece format of a page is chosen when it is created, before any
+    // piece is written, and never changes.
+    if (piece_compression_ != PieceCompression::NONE) {
+      s = db_->SetPieceFormat(handler, PieceFormat::ENCODED);
+      if (s != Status::OK) {
+        return s;
+      }
+    }
     s = db_->AddHead(handler, kFirstPageCommitId, 0);
     if (s != Status::OK) {
       return s;
     }
   }
+  s = db_->GetPieceFormat(handler, &piece_format_);
+  if (s != Status::OK) {
+    return s;
+  }
 
   // Remove uncommited explicit journals.
   if (db_->RemoveExplicitJournals(handler) == Status::INTERRUPTED) {
@@ -1125,13 +1458,19 @@ Status PageStorageImpl::SynchronousGetCommit(
     }
     return s;
   }
+  if (commit_cache_.Get(commit_id, commit)) {
+    return Status::OK;
+  }
   std::string bytes;
   Status s = db_->GetCommitStorageBytes(handler, commit_id, &bytes);
   if (s != Status::OK) {
     return s;
   }
-  return CommitImpl::FromStorageBytes(this, commit_id, std::move(bytes),
-                                      commit);
+  s = CommitImpl::FromStorageBytes(this, commit_id, std::move(bytes), commit);
+  if (s == Status::OK) {
+    commit_cache_.Insert(**commit);
+  }
+  return s;
 }
 
 Status PageStorageImpl::SynchronousAddCommitFromLocal(
@@ -1204,25 +1543,41 @@ Status PageStorageImpl::SynchronousAddCommitsFromSync(
     return Status::OK;
   }
 
-  auto waiter = callback::StatusWaiter<Status>::Create(Status::OK);
   // Get all objects from sync and then add the commit objects.
+  std::vector<ObjectIdentifier> root_identifiers;
+  root_identifiers.reserve(leaves.size());
   for (const auto& leaf : leaves) {
-    btree::GetObjectsFromSync(coroutine_service_, this,
-                              leaf.second->GetRootIdentifier(),
-                              waiter->NewCallback());
+    root_identifiers.push_back(leaf.second->GetRootIdentifier());
   }
 
-  Status waiter_status;
+  Status objects_status;
+  std::set<ObjectIdentifier> object_identifiers;
   if (coroutine::SyncCall(
           handler,
-          [waiter = std::move(waiter)](std::function<void(Status)> callback) {
-            waiter->Finalize(std::move(callback));
+          [this, &root_identifiers](
+              std::function<void(Status, std::set<ObjectIdentifier>)>
+                  callback) {
+            btree::GetObjectsFromSync(coroutine_service_, this,
+                                      root_identifiers, std::move(callback),
+                                      &tree_node_cache_);
           },
-          &waiter_status)) {
+          &objects_status, &object_identifiers)) {
     return Status::INTERRUPTED;
   }
-  if (waiter_status != Status::OK) {
-    return waiter_status;
+  if (objects_status != Status::OK) {
+    return objects_status;
+  }
+
+  // Marking the pieces as synced only saves uploads: the commits can be added
+  // even if it fails.
+  Status status =
+      SynchronousMarkPiecesSyncedFromCommits(handler, object_identifiers);
+  if (status == Status::INTERRUPTED) {
+    return status;
+  }
+  if (status != Status::OK) {
+    FXL_LOG(ERROR) << "Unable to mark the pieces of remote commits as synced: "
+                   << status;
   }
 
   return SynchronousAddCommits(handler, std::move(commits), ChangeSource::SYNC,
@@ -1415,6 +1770,12 @@ Status PageStorageImpl::SynchronousAddCommits(
   }
 
   s = batch->Execute(handler);
+  if (s == Status::OK) {
+    for (const auto& commit : commits_to_send) {
+      commit_cache_.Insert(*commit);
+    }
+    ScheduleGarbageCollection();
+  }
 
   // TODO(nellyv): we can probably remove commits_to_send_ and send
   // commits_to_send directly to NotifyWatchers(). See LE-320.
@@ -1425,11 +1786,438 @@ Status PageStorageImpl::SynchronousAddCommits(
   return s;
 }
 
+void PageStorageImpl::ScheduleGarbageCollection() {
+  if (garbage_collection_scheduled_) {
+    return;
+  }
+  garbage_collection_scheduled_ = true;
+  task_runner_->PostDelayedTask(
+      [weak_this = weak_factory_.GetWeakPtr()] {
+        if (!weak_this) {
+          return;
+        }
+        weak_this->garbage_collection_scheduled_ = false;
+        weak_this->CollectGarbage(
+            [](Status status, GarbageCollectionStats stats) {
+              if (status != Status::OK && status != Status::ILLEGAL_STATE &&
+                  status != Status::INTERRUPTED) {
+                FXL_LOG(ERROR) << "Garbage collection failed with status "
+                               << status;
+                return;
+              }
+              FXL_VLOG(1) << "Garbage collection deleted "
+                          << stats.deleted_piece_count << " pieces ("
+                          << stats.reclaimed_bytes << " bytes).";
+            });
+      },
+      kGarbageCollectionDelay);
+}
+
+std::unique_ptr<PageStorage::CommitPin> PageStorageImpl::PinCommit(
+    CommitIdView commit_id) {
+  CommitId id = commit_id.ToString();
+  ++pinned_commit_ids_[id];
+  return std::make_unique<CommitPinImpl>(weak_factory_.GetWeakPtr(),
+                                         std::move(id));
+}
+
+void PageStorageImpl::UnpinCommit(const CommitId& commit_id) {
+  auto it = pinned_commit_ids_.find(commit_id);
+  FXL_DCHECK(it != pinned_commit_ids_.end());
+  if (--it->second == 0) {
+    pinned_commit_ids_.erase(it);
+  }
+}
+
+Status PageStorageImpl::SynchronousCollectGarbage(
+    CoroutineHandler* handler,
+    GarbageCollectionStats* stats) {
+  // Mark: everything reachable from the heads, from the commits not yet
+  // uploaded, from the base of the pending journals and from the pinned
+  // commits is live, as well as the values referenced by the pending journals.
+  // The pieces added again locally since the previous completed collection are
+  // kept as well.
+  const std::set<ObjectDigest> readded_piece_digests = readded_piece_digests_;
+  journal_values_to_mark_.clear();
+  std::vector<CommitId> heads;
+  Status status = db_->GetHeads(handler, &heads);
+  if (status != Status::OK) {
+    return status;
+  }
+  std::vector<CommitId> unsynced_commit_ids;
+  status = db_->GetUnsyncedCommitIds(handler, &unsynced_commit_ids);
+  if (status != Status::OK) {
+    return status;
+  }
+  std::vector<JournalId> journal_ids;
+  status = db_->GetImplicitJournalIds(handler, &journal_ids);
+  if (status != Status::OK) {
+    return status;
+  }
+  // Values added to journals from now on are tracked by |AddJournalEntry|.
+  std::vector<ObjectDigest> journal_digests;
+  status = db_->GetJournalValueDigests(handler, &journal_digests);
+  if (status != Status::OK) {
+    return status;
+  }
+
+  std::set<CommitId> root_commit_ids(heads.begin(), heads.end());
+  root_commit_ids.insert(unsynced_commit_ids.begin(),
+                         unsynced_commit_ids.end());
+  for (const JournalId& journal_id : journal_ids) {
+    CommitId base;
+    status = db_->GetBaseCommitForJournal(handler, journal_id, &base);
+    if (status != Status::OK) {
+      return status;
+    }
+    root_commit_ids.insert(std::move(base));
+  }
+  // Pinned commits include the bases of the explicit journals, which are not
+  // stored.
+  for (const auto& pinned_commit : pinned_commit_ids_) {
+    root_commit_ids.insert(pinned_commit.first);
+  }
+
+  std::vector<ObjectIdentifier> root_identifiers;
+  for (const CommitId& commit_id : root_commit_ids) {
+    std::unique_ptr<const Commit> commit;
+    status = SynchronousGetCommit(handler, commit_id, &commit);
+    if (status != Status::OK) {
+      return status;
+    }
+    root_identifiers.push_back(commit->GetRootIdentifier());
+  }
+  std::vector<ObjectIdentifier> journal_values;
+  for (ObjectDigest& digest : journal_digests) {
+    journal_values.push_back(MakeDefaultObjectIdentifier(std::move(digest)));
+  }
+  std::set<ObjectDigest> live_digests;
+  status =
+      SynchronousMarkLivePieces(handler, std::move(root_identifiers),
+                                std::move(journal_values), &live_digests);
+  if (status != Status::OK) {
+    return status;
+  }
+
+  // Sweep: only pieces known to be on the cloud can be deleted, as they can be
+  // downloaded again if needed.
+  std::vector<ObjectDigest> synced_digests;
+  status = db_->GetSyncedPieceDigests(handler, &synced_digests);
+  if (status != Status::OK) {
+    return status;
+  }
+  std::vector<ObjectDigest> garbage;
+  status = SynchronousSortGarbage(handler, std::move(synced_digests),
+                                  live_digests, readded_piece_digests,
+                                  &garbage);
+  if (status != Status::OK) {
+    return status;
+  }
+
+  for (size_t start = 0; start < garbage.size();
+       start += kGarbageCollectionBatchSize) {
+    if (start > 0) {
+      if (coroutine::SyncCall(
+              handler, [this](std::function<void()> callback) {
+                task_runner_->PostDelayedTask(std::move(callback),
+                                              kGarbageCollectionBatchInterval);
+              })) {
+        return Status::INTERRUPTED;
+      }
+    }
+
+    // The page changed since the live pieces were marked: stop here, the next
+    // collection will take the new commits into account.
+    std::vector<CommitId> current_heads;
+    status = db_->GetHeads(handler, &current_heads);
+    if (status != Status::OK) {
+      return status;
+    }
+    if (std::set<CommitId>(current_heads.begin(), current_heads.end()) !=
+        std::set<CommitId>(heads.begin(), heads.end())) {
+      FXL_VLOG(1) << "Heads changed, interrupting garbage collection.";
+      return Status::OK;
+    }
+    for (const auto& pinned_commit : pinned_commit_ids_) {
+      if (!root_commit_ids.count(pinned_commit.first)) {
+        FXL_VLOG(1) << "Commit pinned, interrupting garbage collection.";
+        return Status::OK;
+      }
+    }
+
+    // Journals can reference existing values without changing the heads.
+    while (!journal_values_to_mark_.empty()) {
+      std::vector<ObjectIdentifier> values;
+      values.swap(journal_values_to_mark_);
+      status = SynchronousMarkLivePieces(handler, {}, std::move(values),
+                                         &live_digests);
+      if (status != Status::OK) {
+        return status;
+      }
+    }
+
+    std::unique_ptr<PageDb::Batch> batch;
+    status = db_->StartBatch(handler, &batch);
+    if (status != Status::OK) {
+      return status;
+    }
+    GarbageCollectionStats batch_stats;
+    std::vector<ObjectIdentifier> deleted_identifiers;
+    size_t end = std::min(start + kGarbageCollectionBatchSize, garbage.size());
+    for (size_t i = start; i < end; ++i) {
+      if (live_digests.count(garbage[i]) ||
+          readded_piece_digests_.count(garbage[i])) {
+        continue;
+      }
+      ObjectIdentifier object_identifier =
+          MakeDefaultObjectIdentifier(garbage[i]);
+      std::unique_ptr<const Object> object;
+      status = db_->ReadObject(handler, object_identifier, &object);
+      if (status == Status::NOT_FOUND) {
+        continue;
+      }
+      if (status != Status::OK) {
+        return status;
+      }
+      fxl::StringView data;
+      status = object->GetData(&data);
+      if (status != Status::OK) {
+        return status;
+      }
+      status = batch->DeleteObject(handler, garbage[i]);
+      if (status != Status::OK) {
+        return status;
+      }
+      ++batch_stats.deleted_piece_count;
+      batch_stats.reclaimed_bytes += data.size();
+      deleted_identifiers.push_back(std::move(object_identifier));
+    }
+    status = batch->Execute(handler);
+    if (status != Status::OK) {
+      return status;
+    }
+    for (const auto& object_identifier : deleted_identifiers) {
+      tree_node_cache_.Remove(object_identifier);
+      if (blob_store_ &&
+          GetObjectDigestType(object_identifier.object_digest) ==
+              ObjectDigestType::INDEX_HASH) {
+        status = blob_store_->Delete(handler, object_identifier.object_digest);
+        if (status != Status::OK) {
+          return status;
+        }
+      }
+    }
+    stats->deleted_piece_count += batch_stats.deleted_piece_count;
+    stats->reclaimed_bytes += batch_stats.reclaimed_bytes;
+  }
+  for (const ObjectDigest& digest : readded_piece_digests) {
+    readded_piece_digests_.erase(digest);
+  }
+  return Status::OK;
+}
+
+Status PageStorageImpl::SynchronousMarkLivePieces(
+    CoroutineHandler* handler,
+    std::vector<ObjectIdentifier> root_identifiers,
+    std::vector<ObjectIdentifier> value_identifiers,
+    std::set<ObjectDigest>* live_digests) {
+  btree::SynchronousStorage storage(this, handler, &tree_node_cache_);
+
+  // Reads the trees level by level. Nodes marked by a previous call, or
+  // already reached by this one, are skipped along with their subtree.
+  std::set<ObjectDigest> visited_digests;
+  auto should_visit = [live_digests,
+                       &visited_digests](const ObjectIdentifier& identifier) {
+    return !live_digests->count(identifier.object_digest) &&
+           visited_digests.insert(identifier.object_digest).second;
+  };
+  std::vector<ObjectIdentifier> to_mark = std::move(value_identifiers);
+  std::vector<ObjectIdentifier> level;
+  for (ObjectIdentifier& root_identifier : root_identifiers) {
+    if (should_visit(root_identifier)) {
+      level.push_back(std::move(root_identifier));
+    }
+  }
+  while (!level.empty()) {
+    std::vector<std::unique_ptr<const TreeNode>> nodes;
+    Status status = storage.TreeNodesFromIdentifiers(level, &nodes);
+    if (status != Status::OK) {
+      return status;
+    }
+    to_mark.insert(to_mark.end(), level.begin(), level.end());
+    std::vector<ObjectIdentifier> next_level;
+    for (const auto& node : nodes) {
+      for (const Entry& entry : node->entries()) {
+        to_mark.push_back(entry.object_identifier);
+      }
+      for (const auto& child : node->children_identifiers()) {
+        if (should_visit(child.second)) {
+          next_level.push_back(child.second);
+        }
+      }
+    }
+    level.swap(next_level);
+  }
+
+  // Nodes and values are expanded into their pieces. Pieces already marked
+  // are skipped.
+  while (!to_mark.empty()) {
+    ObjectIdentifier object_identifier = std::move(to_mark.back());
+    to_mark.pop_back();
+    ObjectDigestType digest_type =
+        GetObjectDigestType(object_identifier.object_digest);
+    if (digest_type == ObjectDigestType::INLINE ||
+        !live_digests->insert(object_identifier.object_digest).second) {
+      continue;
+    }
+    if (digest_type != ObjectDigestType::INDEX_HASH) {
+      continue;
+    }
+    // The pieces of a value that is not available locally don't need to be
+    // kept.
+    std::unique_ptr<const Object> object;
+    Status status = db_->ReadObject(handler, object_identifier, &object);
+    if (status == Status::NOT_FOUND) {
+      continue;
+    }
+    if (status != Status::OK) {
+      return status;
+    }
+    fxl::StringView content;
+    status = object->GetData(&content);
+    if (status != Status::OK) {
+      return status;
+    }
+    status = ForEachPiece(content, [&to_mark](ObjectIdentifier identifier) {
+      to_mark.push_back(std::move(identifier));
+      return Status::OK;
+    });
+    if (status != Status::OK) {
+      return status;
+    }
+  }
+  return Status::OK;
+}
+
+Status PageStorageImpl::SynchronousSortGarbage(
+    CoroutineHandler* handler,
+    std::vector<ObjectDigest> synced_digests,
+    const std::set<ObjectDigest>& live_digests,
+    const std::set<ObjectDigest>& kept_digests,
+    std::vector<ObjectDigest>* garbage) {
+  std::set<ObjectDigest> garbage_indexes;
+  std::vector<ObjectDigest> garbage_pieces;
+  for (ObjectDigest& digest : synced_digests) {
+    if (live_digests.count(digest) || kept_digests.count(digest)) {
+      continue;
+    }
+    if (GetObjectDigestType(digest) == ObjectDigestType::INDEX_HASH) {
+      garbage_indexes.insert(std::move(digest));
+    } else {
+      garbage_pieces.push_back(std::move(digest));
+    }
+  }
+
+  // An index piece must never remain without its pieces, even if the sweep
+  // stops halfway: index pieces are deleted first, each one before the index
+  // pieces it references.
+  std::map<ObjectDigest, std::vector<ObjectDigest>> child_indexes;
+  std::map<ObjectDigest, size_t> parent_counts;
+  for (const ObjectDigest& digest : garbage_indexes) {
+    parent_counts[digest];
+    std::unique_ptr<const Object> object;
+    Status status =
+        db_->ReadObject(handler, MakeDefaultObjectIdentifier(digest), &object);
+    if (status == Status::NOT_FOUND) {
+      continue;
+    }
+    if (status != Status::OK) {
+      return status;
+    }
+    fxl::StringView content;
+    status = object->GetData(&content);
+    if (status != Status::OK) {
+      return status;
+    }
+    std::vector<ObjectDigest>* children = &child_indexes[digest];
+    status = ForEachPiece(content, [&garbage_indexes, &parent_counts,
+                                    children](ObjectIdentifier identifier) {
+      if (garbage_indexes.count(identifier.object_digest)) {
+        ++parent_counts[identifier.object_digest];
+        children->push_back(std::move(identifier.object_digest));
+      }
+      return Status::OK;
+    });
+    if (status != Status::OK) {
+      return status;
+    }
+  }
+
+  garbage->clear();
+  for (const auto& parent_count : parent_counts) {
+    if (parent_count.second == 0) {
+      garbage->push_back(parent_count.first);
+    }
+  }
+  for (size_t i = 0; i < garbage->size(); ++i) {
+    for (const ObjectDigest& child : child_indexes[(*garbage)[i]]) {
+      if (--parent_counts[child] == 0) {
+        garbage->push_back(child);
+      }
+    }
+  }
+  garbage->insert(garbage->end(),
+                  std::make_move_iterator(garbage_pieces.begin()),
+                  std::make_move_iterator(garbage_pieces.end()));
+  return Status::OK;
+}
+
 Status PageStorageImpl::SynchronousAddPiece(
     CoroutineHandler* handler,
     ObjectIdentifier object_identifier,
     std::unique_ptr<DataSource::DataChunk> data,
     ChangeSource source) {
+  return SynchronousAddPieceWithMutator(handler, db_.get(),
+                                        std::move(object_identifier),
+                                        std::move(data), source);
+}
+
+Status PageStorageImpl::SynchronousAddPieces(
+    CoroutineHandler* handler,
+    std::vector<
+        std::pair<ObjectIdentifier, std::unique_ptr<DataSource::DataChunk>>>
+        pieces,
+    ChangeSource source) {
+  if (pieces.empty()) {
+    return Status::OK;
+  }
+  std::unique_ptr<PageDb::Batch> batch;
+  Status status = db_->StartBatch(handler, &batch);
+  if (status != Status::OK) {
+    return status;
+  }
+  // Objects can share pieces: only add each of them once.
+  std::set<ObjectIdentifier> added_pieces;
+  for (auto& piece : pieces) {
+    if (!added_pieces.insert(piece.first).second) {
+      continue;
+    }
+    status = SynchronousAddPieceWithMutator(handler, batch.get(),
+                                            std::move(piece.first),
+                                            std::move(piece.second), source);
+    if (status != Status::OK) {
+      return status;
+    }
+  }
+  return batch->Execute(handler);
+}
+
+Status PageStorageImpl::SynchronousAddPieceWithMutator(
+    CoroutineHandler* handler,
+    PageDbMutator* mutator,
+    ObjectIdentifier object_identifier,
+    std::unique_ptr<DataSource::DataChunk> data,
+    ChangeSource source) {
   FXL_DCHECK(GetObjectDigestType(object_identifier.object_digest) !=
              ObjectDigestType::INLINE);
   FXL_DCHECK(object_identifier.object_digest ==
@@ -1443,10 +2231,120 @@ Status PageStorageImpl::SynchronousAddPiece(
     PageDbObjectStatus object_status =
         (source == ChangeSource::LOCAL ? PageDbObjectStatus::TRANSIENT
                                        : PageDbObjectStatus::SYNCED);
-    return db_->WriteObject(handler, object_identifier.object_digest,
-                            std::move(data), object_status);
+    fxl::TimePoint start = fxl::TimePoint::Now();
+    size_t content_size = data->Get().size();
+    if (piece_format_ == PieceFormat::ENCODED) {
+      std::string encoded;
+      EncodePiece(data->Get(), piece_compression_, &encoded);
+      data = DataSource::DataChunk::Create(std::move(encoded));
+    }
+    piece_compression_stats_.encoding_time =
+        piece_compression_stats_.encoding_time +
+        (fxl::TimePoint::Now() - start);
+    ++piece_compression_stats_.pieces;
+    piece_compression_stats_.content_bytes += content_size;
+    piece_compression_stats_.stored_bytes += data->Get().size();
+    TRACE_COUNTER("ledger", "piece_compression",
+                  reinterpret_cast<uintptr_t>(this), "content_bytes",
+                  piece_compression_stats_.content_bytes, "stored_bytes",
+                  piece_compression_stats_.stored_bytes);
+    return mutator->WriteObject(handler, object_identifier.object_digest,
+                                std::move(data), object_status);
+  }
+  if (status != Status::OK || source != ChangeSource::LOCAL) {
+    return status;
+  }
+
+  // The piece is already present. If it is synced, it won't be uploaded
+  // again, but it may no longer be referenced: keep it through the next
+  // garbage collection, as it is about to be referenced again.
+  PageDbObjectStatus object_status;
+  status = db_->GetObjectStatus(handler, object_identifier.object_digest,
+                                &object_status);
+  if (status != Status::OK) {
+    return status;
+  }
+  if (object_status == PageDbObjectStatus::SYNCED) {
+    readded_piece_digests_.insert(object_identifier.object_digest);
+    ++upload_deduplication_stats_.pieces;
+    upload_deduplication_stats_.bytes += data->Get().size();
+  }
+  return Status::OK;
+}
+
+Status PageStorageImpl::SynchronousMarkPiecesSyncedFromCommits(
+    CoroutineHandler* handler,
+    const std::set<ObjectIdentifier>& object_identifiers) {
+  // Objects referenced by remote commits have been uploaded by the device
+  // that created them, with all their pieces, before the commits themselves.
+  // Only their status is looked up: the pieces synced or not stored locally
+  // are ignored.
+  std::unique_ptr<PageDb::Batch> batch;
+  Status status = db_->StartBatch(handler, &batch);
+  if (status != Status::OK) {
+    return status;
+  }
+  UploadDeduplicationStats stats;
+  std::set<ObjectIdentifier> checked;
+  std::vector<ObjectIdentifier> to_check(object_identifiers.begin(),
+                                         object_identifiers.end());
+  while (!to_check.empty()) {
+    ObjectIdentifier object_identifier = std::move(to_check.back());
+    to_check.pop_back();
+    if (GetObjectDigestType(object_identifier.object_digest) ==
+            ObjectDigestType::INLINE ||
+        !checked.insert(object_identifier).second) {
+      continue;
+    }
+    // Transient pieces are not yet referenced by a local commit: they must
+    // not become candidates for garbage collection.
+    PageDbObjectStatus object_status;
+    status = db_->GetObjectStatus(handler, object_identifier.object_digest,
+                                  &object_status);
+    if (status != Status::OK) {
+      return status;
+    }
+    if (object_status != PageDbObjectStatus::LOCAL) {
+      continue;
+    }
+    std::unique_ptr<const Object> object;
+    status = db_->ReadObject(handler, object_identifier, &object);
+    if (status != Status::OK) {
+      return status;
+    }
+    fxl::StringView content;
+    status = object->GetData(&content);
+    if (status != Status::OK) {
+      return status;
+    }
+    if (GetObjectDigestType(object_identifier.object_digest) ==
+        ObjectDigestType::INDEX_HASH) {
+      status = ForEachPiece(content, [&to_check](ObjectIdentifier identifier) {
+        to_check.push_back(std::move(identifier));
+        return Status::OK;
+      });
+      if (status != Status::OK) {
+        return status;
+      }
+    }
+    status = batch->SetObjectStatus(handler, object_identifier.object_digest,
+                                    PageDbObjectStatus::SYNCED);
+    if (status != Status::OK) {
+      return status;
+    }
+    ++stats.pieces;
+    stats.bytes += content.size();
   }
-  return status;
+  if (stats.pieces == 0) {
+    return Status::OK;
+  }
+  status = batch->Execute(handler);
+  if (status != Status::OK) {
+    return status;
+  }
+  upload_deduplication_stats_.pieces += stats.pieces;
+  upload_deduplication_stats_.bytes += stats.bytes;
+  return Status::OK;
 }
 
 }  // namespace storage
@@ -7,16 +7,24 @@
 
 #include "peridot/bin/ledger/storage/public/page_storage.h"
 
+#include <map>
 #include <queue>
 #include <set>
 
 #include "lib/fsl/vmo/sized_vmo.h"
 #include "lib/fxl/memory/ref_ptr.h"
+#include "lib/fxl/memory/weak_ptr.h"
 #include "lib/fxl/strings/string_view.h"
 #include "lib/fxl/tasks/task_runner.h"
+#include "lib/fxl/time/time_delta.h"
 #include "peridot/bin/ledger/coroutine/coroutine.h"
+#include "peridot/bin/ledger/storage/impl/blob_store.h"
+#include "peridot/bin/ledger/storage/impl/btree/tree_node_cache.h"
+#include "peridot/bin/ledger/storage/impl/commit_cache.h"
+#include "peridot/bin/ledger/storage/impl/object_download_scheduler.h"
 #include "peridot/bin/ledger/storage/impl/page_db_impl.h"
 #include "peridot/bin/ledger/storage/public/page_sync_delegate.h"
+#include "peridot/bin/ledger/storage/public/piece_compression.h"
 #include "peridot/lib/callback/managed_container.h"
 #include "peridot/lib/callback/operation_serializer.h"
 #include "peridot/lib/convert/convert.h"
@@ -28,10 +36,23 @@ namespace storage {
 
 class PageStorageImpl : public PageStorage {
  public:
+  // If |io_runner| is not null, the digests of the pieces of large objects
+  // added with |AddObjectFromLocal| are computed on it. If |db_runner| is not
+  // null, the database of the page is accessed on it.
   PageStorageImpl(fxl::RefPtr<fxl::TaskRunner> task_runner,
                   coroutine::CoroutineService* coroutine_service,
                   std::string page_dir,
-                  PageId page_id);
+                  PageId page_id,
+                  fxl::RefPtr<fxl::TaskRunner> io_runner = nullptr,
+                  fxl::RefPtr<fxl::TaskRunner> db_runner = nullptr);
+  // Creates a |PageStorageImpl| storing its data in |page_db|. If
+  // |digest_runner| is not null, the digests of the pieces of large objects
+  // added with |AddObjectFromLocal| are computed on it.
+  PageStorageImpl(fxl::RefPtr<fxl::TaskRunner> task_runner,
+                  coroutine::CoroutineService* coroutine_service,
+                  std::unique_ptr<PageDb> page_db,
+                  PageId page_id,
+                  fxl::RefPtr<fxl::TaskRunner> digest_runner = nullptr);
   ~PageStorageImpl() override;
 
   // Initializes this PageStorageImpl. This includes initializing the underlying
@@ -51,6 +72,10 @@ class PageStorageImpl : public PageStorage {
   void ObjectIsUntracked(ObjectIdentifier object_identifier,
                          std::function<void(Status, bool)> callback);
 
+  // Returns the cache of decoded tree nodes of this page. The cache must only
+  // be used for B-tree operations on this |PageStorageImpl|.
+  btree::TreeNodeCache* GetTreeNodeCache() { return &tree_node_cache_; }
+
   // PageStorage:
   PageId GetId() override;
   void SetSyncDelegate(PageSyncDelegate* page_sync) override;
@@ -89,6 +114,10 @@ class PageStorageImpl : public PageStorage {
   void AddObjectFromLocal(
       std::unique_ptr<DataSource> data_source,
       std::function<void(Status, ObjectIdentifier)> callback) override;
+  void AddObjectsFromLocal(
+      std::vector<std::unique_ptr<DataSource>> data_sources,
+      std::function<void(Status, std::vector<ObjectIdentifier>)> callback)
+      override;
   void GetObject(ObjectIdentifier object_identifier,
                  Location location,
                  std::function<void(Status, std::unique_ptr<const Object>)>
@@ -102,6 +131,61 @@ class PageStorageImpl : public PageStorage {
   void GetSyncMetadata(
       fxl::StringView key,
       std::function<void(Status, std::string)> callback) override;
+  void CollectGarbage(
+      std::function<void(Status, GarbageCollectionStats)> callback) override;
+  std::unique_ptr<CommitPin> PinCommit(CommitIdView commit_id) override;
+
+  // Returns the statistics accumulated over all the garbage collections run
+  // since this storage was opened.
+  const GarbageCollectionStats& total_garbage_collection_stats() const {
+    return total_garbage_collection_stats_;
+  }
+
+  // Pieces that did not need to be uploaded because they were already in the
+  // cloud.
+  struct UploadDeduplicationStats {
+    // Number of pieces.
+    uint64_t pieces = 0u;
+    // Total size of the pieces, in bytes.
+    uint64_t bytes = 0u;
+  };
+
+  const UploadDeduplicationStats& upload_deduplication_stats() const {
+    return upload_deduplication_stats_;
+  }
+
+  // Sets the compression applied to the pieces written from now on. This must
+  // be called before |Init|. Only the pieces of pages created with a
+  // compression are encoded: their piece format, recorded in the page
+  // database, is then |PieceFormat::ENCODED|. Pages created without
+  // compression keep storing their pieces as is.
+  void SetPieceCompression(PieceCompression piece_compression) {
+    piece_compression_ = piece_compression;
+  }
+
+  // Stores the content of large objects in |blob_store|, from which they are
+  // then read without being rebuilt from their pieces. Objects built from now
+  // on are added to the blob store, and deleted from it when their pieces are
+  // garbage collected.
+  void SetBlobStore(std::unique_ptr<BlobStore> blob_store) {
+    blob_store_ = std::move(blob_store);
+  }
+
+  // Pieces written to the database by this storage.
+  struct PieceCompressionStats {
+    // Number of pieces.
+    uint64_t pieces = 0u;
+    // Total size of the content of the pieces, in bytes.
+    uint64_t content_bytes = 0u;
+    // Total size of the pieces as written to the database, in bytes.
+    uint64_t stored_bytes = 0u;
+    // Time spent encoding the pieces.
+    fxl::TimeDelta encoding_time;
+  };
+
+  const PieceCompressionStats& piece_compression_stats() const {
+    return piece_compression_stats_;
+  }
 
   // Methods to be used by JournalImpl.
   void GetJournalEntries(
@@ -125,14 +209,20 @@ class PageStorageImpl : public PageStorage {
   // Commit contents.
   void GetCommitContents(const Commit& commit,
                          std::string min_key,
+                         std::string max_key,
                          std::function<bool(Entry)> on_next,
                          std::function<void(Status)> on_done) override;
   void GetEntryFromCommit(const Commit& commit,
                           std::string key,
                           std::function<void(Status, Entry)> callback) override;
+  void GetEntriesFromCommit(
+      const Commit& commit,
+      std::vector<std::string> keys,
+      std::function<void(Status, std::vector<Entry>)> callback) override;
   void GetCommitContentsDiff(const Commit& base_commit,
                              const Commit& other_commit,
                              std::string min_key,
+                             std::string max_key,
                              std::function<bool(EntryChange)> on_next_diff,
                              std::function<void(Status)> on_done) override;
   void GetThreeWayContentsDiff(const Commit& base_commit,
@@ -144,11 +234,10 @@ class PageStorageImpl : public PageStorage {
 
  private:
   friend class PageStorageImplAccessorForTest;
+  class CommitPinImpl;
 
-  PageStorageImpl(fxl::RefPtr<fxl::TaskRunner> task_runner,
-                  coroutine::CoroutineService* coroutine_service,
-                  std::unique_ptr<PageDb> page_db,
-                  PageId page_id);
+  // Releases one pin of the commit with the given |commit_id|.
+  void UnpinCommit(const CommitId& commit_id);
 
   // Marks all pieces needed for the given objects as local.
   FXL_WARN_UNUSED_RESULT Status
@@ -169,14 +258,32 @@ class PageStorageImpl : public PageStorage {
                 ChangeSource source,
                 std::function<void(Status)> callback);
 
-  // Download all the chunks of the object with the given id.
+  // Download all the chunks of the object with the given id. Downloads are
+  // scheduled by |download_scheduler_|.
   void DownloadFullObject(ObjectIdentifier object_identifier,
                           std::function<void(Status)> callback);
 
+  // Fetches the object with the given id from the cloud and adds it, and all
+  // its missing pieces, to the storage. |on_fetched| is called with the size
+  // of the data once it has been received.
+  void FetchFullObject(ObjectIdentifier object_identifier,
+                       std::function<void(uint64_t)> on_fetched,
+                       std::function<void(Status)> callback);
+
   void GetObjectFromSync(
       ObjectIdentifier object_identifier,
       std::function<void(Status, std::unique_ptr<const Object>)> callback);
 
+  // Builds the object with the given identifier from its pieces. Large objects
+  // are added to the blob store, if there is one, once built.
+  void GetObjectFromPieces(
+      ObjectIdentifier object_identifier,
+      Location location,
+      std::function<void(Status, std::unique_ptr<const Object>)> callback);
+
+  // Writes the content of |object| to the blob store in the background.
+  void AddToBlobStore(const Object& object);
+
   void FillBufferWithObjectContent(ObjectIdentifier object_identifier,
                                    fsl::SizedVmo vmo,
                                    size_t offset,
@@ -246,13 +353,77 @@ class PageStorageImpl : public PageStorage {
                       std::unique_ptr<DataSource::DataChunk> data,
                       ChangeSource source);
 
-  fxl::RefPtr<fxl::TaskRunner> task_runner;
+  // Adds the given pieces in a single batch.
+  FXL_WARN_UNUSED_RESULT Status SynchronousAddPieces(
+      coroutine::CoroutineHandler* handler,
+      std::vector<std::pair<ObjectIdentifier,
+                            std::unique_ptr<DataSource::DataChunk>>> pieces,
+      ChangeSource source);
+
+  // Adds the given piece using |mutator|, which is either |db_| or one of its
+  // batches.
+  FXL_WARN_UNUSED_RESULT Status
+  SynchronousAddPieceWithMutator(coroutine::CoroutineHandler* handler,
+                                 PageDbMutator* mutator,
+                                 ObjectIdentifier object_identifier,
+                                 std::unique_ptr<DataSource::DataChunk> data,
+                                 ChangeSource source);
+
+  // Checks that |vmo|, read from the blob store for the object whose index
+  // piece is |index_identifier|, has the size of the object. Returns
+  // |NOT_FOUND| if it does not, or if the index piece is not stored.
+  FXL_WARN_UNUSED_RESULT Status
+  SynchronousCheckBlobSize(coroutine::CoroutineHandler* handler,
+                           const ObjectIdentifier& index_identifier,
+                           const fsl::SizedVmo& vmo);
+
+  // Marks as synced the unsynced pieces among |object_identifiers|, the
+  // objects of the trees of commits received from the cloud, and their
+  // pieces: they are already uploaded.
+  FXL_WARN_UNUSED_RESULT Status SynchronousMarkPiecesSyncedFromCommits(
+      coroutine::CoroutineHandler* handler,
+      const std::set<ObjectIdentifier>& object_identifiers);
+
+  // Starts a garbage collection after a delay, unless one is already
+  // scheduled.
+  void ScheduleGarbageCollection();
+
+  FXL_WARN_UNUSED_RESULT Status
+  SynchronousCollectGarbage(coroutine::CoroutineHandler* handler,
+                            GarbageCollectionStats* stats);
+
+  // Adds to |live_digests| the digests of the nodes of the trees rooted at
+  // |root_identifiers|, of their values, and of the values
+  // |value_identifiers|, along with the pieces of those available locally.
+  // Subtrees whose root is already in |live_digests| are not visited again.
+  FXL_WARN_UNUSED_RESULT Status
+  SynchronousMarkLivePieces(coroutine::CoroutineHandler* handler,
+                            std::vector<ObjectIdentifier> root_identifiers,
+                            std::vector<ObjectIdentifier> value_identifiers,
+                            std::set<ObjectDigest>* live_digests);
+
+  // Sets |garbage| to the digests of |synced_digests| that are in neither
+  // |live_digests| nor |kept_digests|, in the order they can be deleted in:
+  // index pieces come before the pieces they reference.
+  FXL_WARN_UNUSED_RESULT Status
+  SynchronousSortGarbage(coroutine::CoroutineHandler* handler,
+                         std::vector<ObjectDigest> synced_digests,
+                         const std::set<ObjectDigest>& live_digests,
+                         const std::set<ObjectDigest>& kept_digests,
+                         std::vector<ObjectDigest>* garbage);
+
+  fxl::RefPtr<fxl::TaskRunner> task_runner_;
   coroutine::CoroutineService* const coroutine_service_;
+  // Runner used to compute the digests of the pieces of large objects, or null.
+  fxl::RefPtr<fxl::TaskRunner> digest_runner_;
   const PageId page_id_;
   std::unique_ptr<PageDb> db_;
   std::vector<CommitWatcher*> watchers_;
   callback::ManagedContainer managed_container_;
   PageSyncDelegate* page_sync_;
+  // Deduplicates and bounds the concurrent downloads of objects from
+  // |page_sync_|.
+  ObjectDownloadScheduler download_scheduler_;
   std::queue<
       std::pair<ChangeSource, std::vector<std::unique_ptr<const Commit>>>>
       commits_to_send_;
@@ -261,12 +432,37 @@ class PageStorageImpl : public PageStorage {
 
   callback::OperationSerializer commit_serializer_;
 
+  // Decoded tree nodes recently read from this page.
+  btree::TreeNodeCache tree_node_cache_;
+  // Parsed commits recently read from or written to this page.
+  CommitCache commit_cache_;
+
+  // Number of live pins of each pinned commit. See |PinCommit|.
+  std::map<CommitId, size_t> pinned_commit_ids_;
+  // Digests of the synced pieces added again locally. They are about to be
+  // referenced again, and are kept by the next completed garbage collection.
+  std::set<ObjectDigest> readded_piece_digests_;
+  // Values added to a journal while a garbage collection is in progress, not
+  // yet marked as live by it.
+  std::vector<ObjectIdentifier> journal_values_to_mark_;
+  bool garbage_collection_scheduled_ = false;
+  bool garbage_collection_in_progress_ = false;
+  GarbageCollectionStats total_garbage_collection_stats_;
+  UploadDeduplicationStats upload_deduplication_stats_;
+  PieceCompression piece_compression_ = PieceCompression::NONE;
+  PieceFormat piece_format_ = PieceFormat::RAW;
+  PieceCompressionStats piece_compression_stats_;
+  std::unique_ptr<BlobStore> blob_store_;
+
 #ifndef NDEBUG
   // Only one commit insertion should be in progress at a time in storage.
   // |commit_in_progress_| keeps track of whether such an insertion is in
   // progress.
   bool commit_in_progress_ = false;
 #endif
+
+  // This must be the last member of the class.
+  fxl::WeakPtrFactory<PageStorageImpl> weak_factory_;
 };
 
 }  // namespace storage
@@ -198,7 +198,7 @@ class FakePageDbImpl : public PageDbEmptyImpl {
  public:
   FakePageDbImpl() {}
 
-  Status Init() override { return Status::OK; }
+  Status Init(CoroutineHandler* /*handler*/) override { return Status::OK; }
   Status CreateJournalId(CoroutineHandler* /*handler*/,
                          JournalType /*journal_type*/,
                          const CommitId& /*base*/,
@@ -238,6 +238,24 @@ class PageStorageTest : public ::testing::Test {
 
   void RunTasks() { task_runner_->Run(); }
 
+  // Replaces |storage_| with a storage of the same page, stored in |path| and
+  // writing pieces with |piece_compression|.
+  void ResetStorage(const std::string& path,
+                    PieceCompression piece_compression) {
+    PageId id = storage_->GetId();
+    storage_.reset();
+    storage_ = std::make_unique<PageStorageImpl>(
+        task_runner_, &coroutine_service_, path, id);
+    storage_->SetPieceCompression(piece_compression);
+
+    bool called;
+    Status status;
+    storage_->Init(callback::Capture(ledger::SetWhenCalled(&called), &status));
+    RunTasks();
+    ASSERT_TRUE(called);
+    ASSERT_EQ(Status::OK, status);
+  }
+
   // Runs a function in a coroutine, using FakeTaskRunner.
   void RunInCoroutine(
       std::function<void(coroutine::CoroutineHandler*)> run_test) {
@@ -429,6 +447,31 @@ class PageStorageTest : public ::testing::Test {
     EXPECT_EQ(expected_identifier, object_identifier);
   }
 
+  // Adds |content| from local, and marks all the unsynced pieces of the page
+  // as synced. Returns the identifiers of these pieces.
+  std::vector<ObjectIdentifier> TryAddSyncedFromLocal(
+      std::string content,
+      const ObjectIdentifier& expected_identifier) {
+    TryAddFromLocal(std::move(content), expected_identifier);
+    bool called;
+    Status status;
+    std::vector<ObjectIdentifier> object_identifiers;
+    storage_->GetUnsyncedPieces(callback::Capture(
+        ledger::SetWhenCalled(&called), &status, &object_identifiers));
+    RunTasks();
+    EXPECT_TRUE(called);
+    EXPECT_EQ(Status::OK, status);
+    for (const auto& object_identifier : object_identifiers) {
+      storage_->MarkPieceSynced(
+          object_identifier,
+          callback::Capture(ledger::SetWhenCalled(&called), &status));
+      RunTasks();
+      EXPECT_TRUE(called);
+      EXPECT_EQ(Status::OK, status);
+    }
+    return object_identifiers;
+  }
+
   std::unique_ptr<const Object> TryGetObject(
       const ObjectIdentifier& object_identifier,
       PageStorage::Location location,
@@ -469,7 +512,7 @@ class PageStorageTest : public ::testing::Test {
       return true;
     };
     storage_->GetCommitContents(
-        commit, "", std::move(on_next),
+        commit, "", "", std::move(on_next),
         callback::Capture(ledger::SetWhenCalled(&called), &status));
     RunTasks();
     EXPECT_TRUE(called);
@@ -1143,6 +1186,70 @@ TEST_F(PageStorageTest, AddObjectFromLocal) {
   });
 }
 
+TEST_F(PageStorageTest, AddCompressedObjectFromLocal) {
+  std::string path = tmp_dir_.path() + "/compressed";
+  ResetStorage(path, PieceCompression::DEFLATE);
+  ObjectData data(std::string(1000, 'a'), InlineBehavior::PREVENT);
+
+  bool called;
+  Status status;
+  ObjectIdentifier object_identifier;
+  storage_->AddObjectFromLocal(
+      data.ToDataSource(),
+      callback::Capture(
+          ledger::SetWhenCalled(&called), &status, &object_identifier));
+  RunTasks();
+  ASSERT_TRUE(called);
+  EXPECT_EQ(Status::OK, status);
+  // The identifier does not depend on the compression.
+  EXPECT_EQ(data.object_identifier, object_identifier);
+
+  const PageStorageImpl::PieceCompressionStats& stats =
+      storage_->piece_compression_stats();
+  EXPECT_EQ(1u, stats.pieces);
+  EXPECT_EQ(data.value.size(), stats.content_bytes);
+  EXPECT_LT(stats.stored_bytes, stats.content_bytes / 10);
+
+  // The page keeps its format when reopened without compression.
+  ResetStorage(path, PieceCompression::NONE);
+  RunInCoroutine([this, &data, &object_identifier](CoroutineHandler* handler) {
+    std::unique_ptr<const Object> object;
+    ASSERT_EQ(Status::OK, ReadObject(handler, object_identifier, &object));
+    fxl::StringView content;
+    ASSERT_EQ(Status::OK, object->GetData(&content));
+    EXPECT_EQ(data.value, content);
+  });
+}
+
+TEST_F(PageStorageTest, CompressionIgnoredForExistingPage) {
+  // The page was created without compression: its pieces are stored as is,
+  // even those that look like encoded pieces.
+  ResetStorage(tmp_dir_.path(), PieceCompression::DEFLATE);
+  ObjectData data(std::string("\x01\x89LZP\x01", 6) + std::string(1000, 'a'),
+                  InlineBehavior::PREVENT);
+
+  bool called;
+  Status status;
+  ObjectIdentifier object_identifier;
+  storage_->AddObjectFromLocal(
+      data.ToDataSource(),
+      callback::Capture(
+          ledger::SetWhenCalled(&called), &status, &object_identifier));
+  RunTasks();
+  ASSERT_TRUE(called);
+  EXPECT_EQ(Status::OK, status);
+  EXPECT_EQ(data.value.size(),
+            storage_->piece_compression_stats().stored_bytes);
+
+  RunInCoroutine([this, &data, &object_identifier](CoroutineHandler* handler) {
+    std::unique_ptr<const Object> object;
+    ASSERT_EQ(Status::OK, ReadObject(handler, object_identifier, &object));
+    fxl::StringView content;
+    ASSERT_EQ(Status::OK, object->GetData(&content));
+    EXPECT_EQ(data.value, content);
+  });
+}
+
 TEST_F(PageStorageTest, AddSmallObjectFromLocal) {
   RunInCoroutine([this](CoroutineHandler* handler) {
     ObjectData data("Some data");
@@ -1195,6 +1302,43 @@ TEST_F(PageStorageTest, AddObjectFromLocalError) {
   EXPECT_TRUE(ObjectIsUntracked(object_identifier, false));
 }
 
+TEST_F(PageStorageTest, AddObjectsFromLocal) {
+  // The same object twice, a small one and one made of several pieces.
+  std::vector<ObjectData> data;
+  data.emplace_back("Some data", InlineBehavior::PREVENT);
+  data.emplace_back("Some data", InlineBehavior::PREVENT);
+  data.emplace_back("Other data");
+  data.emplace_back(RandomString(65536), InlineBehavior::PREVENT);
+  std::vector<std::unique_ptr<DataSource>> data_sources;
+  for (auto& object_data : data) {
+    data_sources.push_back(object_data.ToDataSource());
+  }
+
+  bool called;
+  Status status;
+  std::vector<ObjectIdentifier> object_identifiers;
+  storage_->AddObjectsFromLocal(
+      std::move(data_sources),
+      callback::Capture(
+          ledger::SetWhenCalled(&called), &status, &object_identifiers));
+  RunTasks();
+  ASSERT_TRUE(called);
+  EXPECT_EQ(Status::OK, status);
+  ASSERT_EQ(data.size(), object_identifiers.size());
+
+  for (size_t i = 0; i < data.size(); ++i) {
+    std::unique_ptr<const Object> object =
+        TryGetObject(object_identifiers[i], PageStorage::Location::LOCAL);
+    ASSERT_TRUE(object);
+    fxl::StringView content;
+    ASSERT_EQ(Status::OK, object->GetData(&content));
+    EXPECT_EQ(data[i].value, content);
+  }
+  EXPECT_EQ(data[0].object_identifier, object_identifiers[0]);
+  EXPECT_EQ(object_identifiers[0], object_identifiers[1]);
+  EXPECT_EQ(data[2].object_identifier, object_identifiers[2]);
+}
+
 TEST_F(PageStorageTest, AddLocalPiece) {
   RunInCoroutine([this](CoroutineHandler* handler) {
     ObjectData data("Some data", InlineBehavior::PREVENT);
@@ -1239,6 +1383,232 @@ TEST_F(PageStorageTest, AddSyncPiece) {
   });
 }
 
+TEST_F(PageStorageTest, CollectGarbage) {
+  RunInCoroutine([this](CoroutineHandler* handler) {
+    ObjectData live_data("Live data", InlineBehavior::PREVENT);
+    ObjectData garbage_data("Garbage data", InlineBehavior::PREVENT);
+    for (ObjectData* data : {&live_data, &garbage_data}) {
+      bool called;
+      Status status;
+      PageStorageImplAccessorForTest::AddPiece(
+          storage_, data->object_identifier, data->ToChunk(),
+          ChangeSource::SYNC,
+          callback::Capture(ledger::SetWhenCalled(&called), &status));
+      RunTasks();
+      ASSERT_TRUE(called);
+      ASSERT_EQ(Status::OK, status);
+    }
+
+    bool called;
+    Status status;
+    std::unique_ptr<Journal> journal;
+    storage_->StartCommit(
+        GetFirstHead()->GetId(), JournalType::EXPLICIT,
+        callback::Capture(ledger::SetWhenCalled(&called), &status, &journal));
+    RunTasks();
+    ASSERT_TRUE(called);
+    ASSERT_EQ(Status::OK, status);
+    EXPECT_TRUE(PutInJournal(journal.get(), "key", live_data.object_identifier,
+                             KeyPriority::EAGER));
+    ASSERT_TRUE(TryCommitJournal(std::move(journal), Status::OK));
+
+    PageStorage::GarbageCollectionStats stats;
+    storage_->CollectGarbage(
+        callback::Capture(ledger::SetWhenCalled(&called), &status, &stats));
+    RunTasks();
+    ASSERT_TRUE(called);
+    EXPECT_EQ(Status::OK, status);
+    EXPECT_EQ(1u, stats.deleted_piece_count);
+    EXPECT_EQ(garbage_data.value.size(), stats.reclaimed_bytes);
+
+    std::unique_ptr<const Object> object;
+    EXPECT_EQ(Status::OK,
+              ReadObject(handler, live_data.object_identifier, &object));
+    EXPECT_EQ(Status::NOT_FOUND,
+              ReadObject(handler, garbage_data.object_identifier, &object));
+  });
+}
+
+TEST_F(PageStorageTest, CollectGarbageKeepsPinnedCommits) {
+  // A snapshot taken before a new head is committed still reads its values
+  // locally after a garbage collection.
+  ObjectData data("Snapshot data", InlineBehavior::PREVENT);
+  bool called;
+  Status status;
+  PageStorageImplAccessorForTest::AddPiece(
+      storage_, data.object_identifier, data.ToChunk(), ChangeSource::SYNC,
+      callback::Capture(ledger::SetWhenCalled(&called), &status));
+  RunTasks();
+  ASSERT_TRUE(called);
+  ASSERT_EQ(Status::OK, status);
+
+  std::unique_ptr<Journal> journal;
+  storage_->StartCommit(
+      GetFirstHead()->GetId(), JournalType::EXPLICIT,
+      callback::Capture(ledger::SetWhenCalled(&called), &status, &journal));
+  RunTasks();
+  ASSERT_TRUE(called);
+  ASSERT_EQ(Status::OK, status);
+  EXPECT_TRUE(PutInJournal(journal.get(), "key", data.object_identifier,
+                           KeyPriority::EAGER));
+  std::unique_ptr<const Commit> snapshot_commit =
+      TryCommitJournal(std::move(journal), Status::OK);
+  ASSERT_TRUE(snapshot_commit);
+  std::unique_ptr<PageStorage::CommitPin> pin =
+      storage_->PinCommit(snapshot_commit->GetId());
+
+  storage_->StartCommit(
+      snapshot_commit->GetId(), JournalType::EXPLICIT,
+      callback::Capture(ledger::SetWhenCalled(&called), &status, &journal));
+  RunTasks();
+  ASSERT_TRUE(called);
+  ASSERT_EQ(Status::OK, status);
+  EXPECT_TRUE(DeleteFromJournal(journal.get(), "key"));
+  ASSERT_TRUE(TryCommitJournal(std::move(journal), Status::OK));
+  storage_->MarkCommitSynced(
+      snapshot_commit->GetId(),
+      callback::Capture(ledger::SetWhenCalled(&called), &status));
+  RunTasks();
+  ASSERT_TRUE(called);
+  ASSERT_EQ(Status::OK, status);
+
+  PageStorage::GarbageCollectionStats stats;
+  storage_->CollectGarbage(
+      callback::Capture(ledger::SetWhenCalled(&called), &status, &stats));
+  RunTasks();
+  ASSERT_TRUE(called);
+  EXPECT_EQ(Status::OK, status);
+  EXPECT_EQ(0u, stats.deleted_piece_count);
+  TryGetObject(data.object_identifier, PageStorage::Location::LOCAL);
+
+  // Once the snapshot is gone, the value is collected.
+  pin.reset();
+  storage_->CollectGarbage(
+      callback::Capture(ledger::SetWhenCalled(&called), &status, &stats));
+  RunTasks();
+  ASSERT_TRUE(called);
+  EXPECT_EQ(Status::OK, status);
+  EXPECT_EQ(1u, stats.deleted_piece_count);
+  TryGetObject(data.object_identifier, PageStorage::Location::LOCAL,
+               Status::NOT_FOUND);
+}
+
+TEST_F(PageStorageTest, CollectGarbageKeepsReaddedPieces) {
+  // A synced value that is no longer referenced, but is put again by a client,
+  // is not deleted before the commit referencing it is made.
+  ObjectData data(RandomString(64));
+  bool called;
+  Status status;
+  PageStorageImplAccessorForTest::AddPiece(
+      storage_, data.object_identifier, data.ToChunk(), ChangeSource::SYNC,
+      callback::Capture(ledger::SetWhenCalled(&called), &status));
+  RunTasks();
+  ASSERT_TRUE(called);
+  ASSERT_EQ(Status::OK, status);
+
+  ObjectIdentifier object_identifier;
+  storage_->AddObjectFromLocal(
+      data.ToDataSource(),
+      callback::Capture(ledger::SetWhenCalled(&called), &status,
+                        &object_identifier));
+  RunTasks();
+  ASSERT_TRUE(called);
+  ASSERT_EQ(Status::OK, status);
+  EXPECT_EQ(data.object_identifier, object_identifier);
+
+  PageStorage::GarbageCollectionStats stats;
+  storage_->CollectGarbage(
+      callback::Capture(ledger::SetWhenCalled(&called), &status, &stats));
+  RunTasks();
+  ASSERT_TRUE(called);
+  EXPECT_EQ(Status::OK, status);
+  EXPECT_EQ(0u, stats.deleted_piece_count);
+  TryGetObject(data.object_identifier, PageStorage::Location::LOCAL);
+}
+
+TEST_F(PageStorageTest, CollectGarbageInterruptedKeepsValuesComplete) {
+  // A sweep stopped halfway, here by a new commit, never leaves an index piece
+  // without the pieces it references.
+  ObjectData data(RandomString(2 * 1024 * 1024), InlineBehavior::PREVENT);
+  ASSERT_EQ(ObjectDigestType::INDEX_HASH,
+            GetObjectDigestType(data.object_identifier.object_digest));
+  std::vector<ObjectIdentifier> object_identifiers =
+      TryAddSyncedFromLocal(data.value, data.object_identifier);
+
+  bool called;
+  Status status;
+  PageStorage::GarbageCollectionStats stats;
+  storage_->CollectGarbage(
+      callback::Capture(ledger::SetWhenCalled(&called), &status, &stats));
+  ASSERT_TRUE(TryCommitFromLocal(JournalType::EXPLICIT, 1));
+  RunTasks();
+  ASSERT_TRUE(called);
+  EXPECT_EQ(Status::OK, status);
+
+  for (const auto& object_identifier : object_identifiers) {
+    if (GetObjectDigestType(object_identifier.object_digest) !=
+        ObjectDigestType::INDEX_HASH) {
+      continue;
+    }
+    std::unique_ptr<const Object> piece;
+    storage_->GetPiece(
+        object_identifier,
+        callback::Capture(ledger::SetWhenCalled(&called), &status, &piece));
+    RunTasks();
+    ASSERT_TRUE(called);
+    if (status == Status::NOT_FOUND) {
+      continue;
+    }
+    ASSERT_EQ(Status::OK, status);
+    TryGetObject(object_identifier, PageStorage::Location::LOCAL);
+  }
+
+  // The next collection deletes the rest of the value.
+  storage_->CollectGarbage(
+      callback::Capture(ledger::SetWhenCalled(&called), &status, &stats));
+  RunTasks();
+  ASSERT_TRUE(called);
+  EXPECT_EQ(Status::OK, status);
+  TryGetPiece(data.object_identifier, Status::NOT_FOUND);
+}
+
+TEST_F(PageStorageTest, CollectGarbageKeepsPendingJournalValues) {
+  // A synced value only referenced by a journal not yet committed keeps all its
+  // pieces.
+  ObjectData data(RandomString(256 * 1024), InlineBehavior::PREVENT);
+  ASSERT_EQ(ObjectDigestType::INDEX_HASH,
+            GetObjectDigestType(data.object_identifier.object_digest));
+  TryAddSyncedFromLocal(data.value, data.object_identifier);
+
+  bool called;
+  Status status;
+  std::unique_ptr<Journal> journal;
+  storage_->StartCommit(
+      GetFirstHead()->GetId(), JournalType::EXPLICIT,
+      callback::Capture(ledger::SetWhenCalled(&called), &status, &journal));
+  RunTasks();
+  ASSERT_TRUE(called);
+  ASSERT_EQ(Status::OK, status);
+  EXPECT_TRUE(PutInJournal(journal.get(), "key", data.object_identifier,
+                           KeyPriority::EAGER));
+
+  PageStorage::GarbageCollectionStats stats;
+  storage_->CollectGarbage(
+      callback::Capture(ledger::SetWhenCalled(&called), &status, &stats));
+  RunTasks();
+  ASSERT_TRUE(called);
+  EXPECT_EQ(Status::OK, status);
+  EXPECT_EQ(0u, stats.deleted_piece_count);
+
+  std::unique_ptr<const Object> object =
+      TryGetObject(data.object_identifier, PageStorage::Location::LOCAL);
+  ASSERT_TRUE(object);
+  fxl::StringView content;
+  ASSERT_EQ(Status::OK, object->GetData(&content));
+  EXPECT_EQ(data.value, content);
+  ASSERT_TRUE(TryCommitJournal(std::move(journal), Status::OK));
+}
+
 TEST_F(PageStorageTest, GetObject) {
   RunInCoroutine([this](CoroutineHandler* handler) {
     ObjectData data("Some data");
@@ -1321,6 +1691,71 @@ TEST_F(PageStorageTest, AddAndGetHugeObjectFromLocal) {
   EXPECT_NE(content, piece_content);
 }
 
+TEST_F(PageStorageTest, GetLargeObjectFromBlobStore) {
+  std::string blob_dir = tmp_dir_.path() + "/blobs";
+  storage_->SetBlobStore(std::make_unique<BlobStore>(task_runner_, blob_dir));
+
+  ObjectData data(RandomString(512 * 1024), InlineBehavior::PREVENT);
+  ASSERT_EQ(ObjectDigestType::INDEX_HASH,
+            GetObjectDigestType(data.object_identifier.object_digest));
+
+  bool called;
+  Status status;
+  ObjectIdentifier object_identifier;
+  storage_->AddObjectFromLocal(
+      data.ToDataSource(),
+      callback::Capture(
+          ledger::SetWhenCalled(&called), &status, &object_identifier));
+  RunTasks();
+  ASSERT_TRUE(called);
+  EXPECT_EQ(Status::OK, status);
+
+  // The first read builds the object from its pieces and adds it to the blob
+  // store.
+  std::string blob_path =
+      blob_dir + "/" + convert::ToHex(object_identifier.object_digest);
+  EXPECT_FALSE(files::IsFile(blob_path));
+  std::unique_ptr<const Object> object =
+      TryGetObject(object_identifier, PageStorage::Location::LOCAL);
+  fxl::StringView content;
+  ASSERT_EQ(Status::OK, object->GetData(&content));
+  EXPECT_EQ(data.value, content);
+  RunTasks();
+  EXPECT_TRUE(files::IsFile(blob_path));
+
+  // The next reads are served by the blob store.
+  object = TryGetObject(object_identifier, PageStorage::Location::LOCAL);
+  ASSERT_EQ(Status::OK, object->GetData(&content));
+  EXPECT_EQ(data.value, content);
+  fsl::SizedVmo vmo;
+  ASSERT_EQ(Status::OK, object->GetVmo(&vmo));
+  EXPECT_EQ(data.value.size(), vmo.size());
+}
+
+TEST_F(PageStorageTest, GetLargeObjectIgnoresTruncatedBlob) {
+  std::string blob_dir = tmp_dir_.path() + "/blobs";
+  storage_->SetBlobStore(std::make_unique<BlobStore>(task_runner_, blob_dir));
+
+  ObjectData data(RandomString(512 * 1024), InlineBehavior::PREVENT);
+  TryAddFromLocal(data.value, data.object_identifier);
+
+  // A blob left truncated by a crash is not returned: the object is read from
+  // its pieces, and the blob is written again.
+  std::string blob_path =
+      blob_dir + "/" + convert::ToHex(data.object_identifier.object_digest);
+  ASSERT_TRUE(files::CreateDirectory(blob_dir));
+  ASSERT_TRUE(files::WriteFile(blob_path, data.value.data(), 1024));
+  std::unique_ptr<const Object> object =
+      TryGetObject(data.object_identifier, PageStorage::Location::LOCAL);
+  fxl::StringView content;
+  ASSERT_EQ(Status::OK, object->GetData(&content));
+  EXPECT_EQ(data.value, content);
+  RunTasks();
+  std::string blob_content;
+  ASSERT_TRUE(files::ReadFileToString(blob_path, &blob_content));
+  EXPECT_EQ(data.value, blob_content);
+}
+
 TEST_F(PageStorageTest, UnsyncedPieces) {
   ObjectData data_array[] = {
       ObjectData("Some data", InlineBehavior::PREVENT),
@@ -1617,6 +2052,70 @@ TEST_F(PageStorageTest, AddMultipleCommitsFromSync) {
   });
 }
 
+TEST_F(PageStorageTest, AddCommitsFromSyncMarksPiecesSynced) {
+  FakeSyncDelegate sync;
+  storage_->SetSyncDelegate(&sync);
+
+  ObjectData value("Some data", InlineBehavior::PREVENT);
+  TryAddFromLocal(value.value, value.object_identifier);
+
+  bool called;
+  Status status;
+  std::unique_ptr<Journal> journal;
+  storage_->StartCommit(
+      GetFirstHead()->GetId(), JournalType::IMPLICIT,
+      callback::Capture(ledger::SetWhenCalled(&called), &status, &journal));
+  RunTasks();
+  ASSERT_TRUE(called);
+  EXPECT_EQ(Status::OK, status);
+  EXPECT_TRUE(PutInJournal(journal.get(), "key", value.object_identifier,
+                           KeyPriority::EAGER));
+  std::unique_ptr<const Commit> local_commit =
+      TryCommitJournal(std::move(journal), Status::OK);
+  ASSERT_TRUE(local_commit);
+
+  std::vector<ObjectIdentifier> object_identifiers;
+  storage_->GetUnsyncedPieces(callback::Capture(
+      ledger::SetWhenCalled(&called), &status, &object_identifiers));
+  RunTasks();
+  ASSERT_TRUE(called);
+  EXPECT_EQ(Status::OK, status);
+  // The value and the root node.
+  EXPECT_EQ(2u, object_identifiers.size());
+
+  // Another device wrote the same contents: the pieces referenced by its
+  // commit are already in the cloud.
+  std::vector<std::unique_ptr<const Commit>> parent;
+  parent.emplace_back(local_commit->Clone());
+  std::unique_ptr<const Commit> remote_commit =
+      CommitImpl::FromContentAndParents(storage_.get(),
+                                        local_commit->GetRootIdentifier(),
+                                        std::move(parent));
+  std::vector<PageStorage::CommitIdAndBytes> commits_and_bytes;
+  commits_and_bytes.emplace_back(remote_commit->GetId(),
+                                 remote_commit->GetStorageBytes().ToString());
+  storage_->AddCommitsFromSync(
+      std::move(commits_and_bytes),
+      callback::Capture(ledger::SetWhenCalled(&called), &status));
+  RunTasks();
+  ASSERT_TRUE(called);
+  EXPECT_EQ(Status::OK, status);
+  EXPECT_TRUE(sync.object_requests.empty());
+
+  storage_->GetUnsyncedPieces(callback::Capture(
+      ledger::SetWhenCalled(&called), &status, &object_identifiers));
+  RunTasks();
+  ASSERT_TRUE(called);
+  EXPECT_EQ(Status::OK, status);
+  EXPECT_TRUE(object_identifiers.empty());
+  EXPECT_EQ(2u, storage_->upload_deduplication_stats().pieces);
+
+  // Adding the value again doesn't make it unsynced, and is counted as a
+  // saved upload.
+  TryAddFromLocal(value.value, value.object_identifier);
+  EXPECT_EQ(3u, storage_->upload_deduplication_stats().pieces);
+}
+
 TEST_F(PageStorageTest, Generation) {
   std::unique_ptr<const Commit> commit1 =
       TryCommitFromLocal(JournalType::EXPLICIT, 3);
@@ -1684,6 +2183,28 @@ TEST_F(PageStorageTest, GetEntryFromCommit) {
   }
 }
 
+TEST_F(PageStorageTest, GetEntriesFromCommit) {
+  int size = 10;
+  std::unique_ptr<const Commit> commit =
+      TryCommitFromLocal(JournalType::EXPLICIT, size);
+  ASSERT_TRUE(commit);
+
+  bool called;
+  Status status;
+  std::vector<Entry> entries;
+  storage_->GetEntriesFromCommit(
+      *commit,
+      {"key not found", "key00001", "key00003", "key00003a", "key00009"},
+      callback::Capture(ledger::SetWhenCalled(&called), &status, &entries));
+  RunTasks();
+  ASSERT_TRUE(called);
+  ASSERT_EQ(Status::OK, status);
+  ASSERT_EQ(3u, entries.size());
+  EXPECT_EQ("key00001", entries[0].key);
+  EXPECT_EQ("key00003", entries[1].key);
+  EXPECT_EQ("key00009", entries[2].key);
+}
+
 TEST_F(PageStorageTest, WatcherForReEntrantCommits) {
   std::vector<std::unique_ptr<const Commit>> parent;
   parent.emplace_back(GetFirstHead());
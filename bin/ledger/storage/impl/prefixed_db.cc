@@ -0,0 +1,171 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "peridot/bin/ledger/storage/impl/prefixed_db.h"
+
+#include "lib/fxl/logging.h"
+#include "lib/fxl/strings/concatenate.h"
+
+namespace storage {
+
+namespace {
+
+using coroutine::CoroutineHandler;
+
+using Row =
+    std::pair<convert::ExtendedStringView, convert::ExtendedStringView>;
+
+class PrefixedBatch : public Db::Batch {
+ public:
+  PrefixedBatch(std::unique_ptr<Db::Batch> batch, std::string prefix)
+      : batch_(std::move(batch)), prefix_(std::move(prefix)) {}
+
+  ~PrefixedBatch() override {}
+
+  Status Put(CoroutineHandler* handler,
+             convert::ExtendedStringView key,
+             fxl::StringView value) override {
+    return batch_->Put(handler, fxl::Concatenate({prefix_, key}), value);
+  }
+
+  Status Delete(CoroutineHandler* handler,
+                convert::ExtendedStringView key) override {
+    return batch_->Delete(handler, fxl::Concatenate({prefix_, key}));
+  }
+
+  Status DeleteByPrefix(CoroutineHandler* handler,
+                        convert::ExtendedStringView prefix) override {
+    return batch_->DeleteByPrefix(handler, fxl::Concatenate({prefix_, prefix}));
+  }
+
+  Status Execute(CoroutineHandler* handler) override {
+    return batch_->Execute(handler);
+  }
+
+ private:
+  std::unique_ptr<Db::Batch> batch_;
+  const std::string prefix_;
+
+  FXL_DISALLOW_COPY_AND_ASSIGN(PrefixedBatch);
+};
+
+// Iterator removing a fixed number of bytes from the keys of the rows of
+// another iterator.
+class PrefixedRowIterator : public Iterator<const Row> {
+ public:
+  PrefixedRowIterator(std::unique_ptr<Iterator<const Row>> it,
+                      size_t prefix_size)
+      : it_(std::move(it)), prefix_size_(prefix_size) {
+    PrepareEntry();
+  }
+
+  ~PrefixedRowIterator() override {}
+
+  Iterator<const Row>& Next() override {
+    it_->Next();
+    PrepareEntry();
+    return *this;
+  }
+
+  bool Valid() const override { return it_->Valid(); }
+
+  Status GetStatus() const override { return it_->GetStatus(); }
+
+  const Row& operator*() const override { return *row_; }
+
+  const Row* operator->() const override { return row_.get(); }
+
+ private:
+  void PrepareEntry() {
+    if (!it_->Valid()) {
+      row_.reset();
+      return;
+    }
+    FXL_DCHECK((*it_)->first.size() >= prefix_size_);
+    row_ = std::make_unique<Row>((*it_)->first.substr(prefix_size_),
+                                 (*it_)->second);
+  }
+
+  std::unique_ptr<Iterator<const Row>> it_;
+  const size_t prefix_size_;
+  std::unique_ptr<Row> row_;
+
+  FXL_DISALLOW_COPY_AND_ASSIGN(PrefixedRowIterator);
+};
+
+}  // namespace
+
+PrefixedDb::PrefixedDb(Db* db, std::string prefix)
+    : db_(db), prefix_(std::move(prefix)) {
+  FXL_DCHECK(db_);
+}
+
+PrefixedDb::~PrefixedDb() {}
+
+Status PrefixedDb::StartBatch(CoroutineHandler* handler,
+                              std::unique_ptr<Batch>* batch) {
+  std::unique_ptr<Batch> db_batch;
+  Status status = db_->StartBatch(handler, &db_batch);
+  if (status != Status::OK) {
+    return status;
+  }
+  *batch = std::make_unique<PrefixedBatch>(std::move(db_batch), prefix_);
+  return Status::OK;
+}
+
+Status PrefixedDb::Get(CoroutineHandler* handler,
+                       convert::ExtendedStringView key,
+                       std::string* value) {
+  return db_->Get(handler, AddPrefix(key), value);
+}
+
+Status PrefixedDb::HasKey(CoroutineHandler* handler,
+                          convert::ExtendedStringView key,
+                          bool* has_key) {
+  return db_->HasKey(handler, AddPrefix(key), has_key);
+}
+
+Status PrefixedDb::GetObject(CoroutineHandler* handler,
+                             convert::ExtendedStringView key,
+                             ObjectIdentifier object_identifier,
+                             std::unique_ptr<const Object>* object) {
+  return db_->GetObject(handler, AddPrefix(key), std::move(object_identifier),
+                        object);
+}
+
+Status PrefixedDb::GetByPrefix(CoroutineHandler* handler,
+                               convert::ExtendedStringView prefix,
+                               std::vector<std::string>* key_suffixes) {
+  return db_->GetByPrefix(handler, AddPrefix(prefix), key_suffixes);
+}
+
+Status PrefixedDb::GetEntriesByPrefix(
+    CoroutineHandler* handler,
+    convert::ExtendedStringView prefix,
+    std::vector<std::pair<std::string, std::string>>* entries) {
+  return db_->GetEntriesByPrefix(handler, AddPrefix(prefix), entries);
+}
+
+Status PrefixedDb::GetIteratorAtPrefix(
+    CoroutineHandler* handler,
+    convert::ExtendedStringView prefix,
+    std::unique_ptr<Iterator<const Row>>* iterator) {
+  std::unique_ptr<Iterator<const Row>> db_iterator;
+  Status status = db_->GetIteratorAtPrefix(handler, AddPrefix(prefix),
+                                           iterator ? &db_iterator : nullptr);
+  if (status != Status::OK) {
+    return status;
+  }
+  if (iterator) {
+    *iterator = std::make_unique<PrefixedRowIterator>(std::move(db_iterator),
+                                                      prefix_.size());
+  }
+  return Status::OK;
+}
+
+std::string PrefixedDb::AddPrefix(convert::ExtendedStringView key) const {
+  return fxl::Concatenate({prefix_, key});
+}
+
+}  // namespace storage
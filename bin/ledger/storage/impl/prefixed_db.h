@@ -0,0 +1,65 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef PERIDOT_BIN_LEDGER_STORAGE_IMPL_PREFIXED_DB_H_
+#define PERIDOT_BIN_LEDGER_STORAGE_IMPL_PREFIXED_DB_H_
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "lib/fxl/macros.h"
+#include "peridot/bin/ledger/storage/impl/db.h"
+
+namespace storage {
+
+// A |Db| whose entries are stored in another |Db|, with all keys prefixed by
+// a fixed string. This allows several pages to share a single database. The
+// prefix must not be a prefix of the prefix of any other |PrefixedDb| sharing
+// the same database.
+class PrefixedDb : public Db {
+ public:
+  // |db| must outlive this object.
+  PrefixedDb(Db* db, std::string prefix);
+  ~PrefixedDb() override;
+
+  Status StartBatch(coroutine::CoroutineHandler* handler,
+                    std::unique_ptr<Batch>* batch) override;
+  Status Get(coroutine::CoroutineHandler* handler,
+             convert::ExtendedStringView key,
+             std::string* value) override;
+  Status HasKey(coroutine::CoroutineHandler* handler,
+                convert::ExtendedStringView key,
+                bool* has_key) override;
+  Status GetObject(coroutine::CoroutineHandler* handler,
+                   convert::ExtendedStringView key,
+                   ObjectIdentifier object_identifier,
+                   std::unique_ptr<const Object>* object) override;
+  Status GetByPrefix(coroutine::CoroutineHandler* handler,
+                     convert::ExtendedStringView prefix,
+                     std::vector<std::string>* key_suffixes) override;
+  Status GetEntriesByPrefix(
+      coroutine::CoroutineHandler* handler,
+      convert::ExtendedStringView prefix,
+      std::vector<std::pair<std::string, std::string>>* entries) override;
+  Status GetIteratorAtPrefix(
+      coroutine::CoroutineHandler* handler,
+      convert::ExtendedStringView prefix,
+      std::unique_ptr<Iterator<const std::pair<convert::ExtendedStringView,
+                                               convert::ExtendedStringView>>>*
+          iterator) override;
+
+ private:
+  std::string AddPrefix(convert::ExtendedStringView key) const;
+
+  Db* const db_;
+  const std::string prefix_;
+
+  FXL_DISALLOW_COPY_AND_ASSIGN(PrefixedDb);
+};
+
+}  // namespace storage
+
+#endif  // PERIDOT_BIN_LEDGER_STORAGE_IMPL_PREFIXED_DB_H_
@@ -0,0 +1,131 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "peridot/bin/ledger/storage/impl/prefixed_db.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "lib/fxl/files/scoped_temp_dir.h"
+#include "lib/fxl/macros.h"
+#include "peridot/bin/ledger/storage/impl/leveldb.h"
+#include "peridot/bin/ledger/testing/test_with_coroutines.h"
+
+namespace storage {
+namespace {
+
+using coroutine::CoroutineHandler;
+
+class PrefixedDbTest : public ::test::TestWithCoroutines {
+ public:
+  PrefixedDbTest()
+      : db_(message_loop_.task_runner(), tmp_dir_.path()),
+        page1_db_(&db_, "page/1/"),
+        page2_db_(&db_, "page/2/") {}
+
+  ~PrefixedDbTest() override {}
+
+  // Test:
+  void SetUp() override {
+    EXPECT_TRUE(RunInCoroutine([this](CoroutineHandler* handler) {
+      ASSERT_EQ(Status::OK, db_.Init(handler));
+    }));
+  }
+
+ protected:
+  void Put(CoroutineHandler* handler,
+           Db* db,
+           const std::string& key,
+           const std::string& value) {
+    std::unique_ptr<Db::Batch> batch;
+    ASSERT_EQ(Status::OK, db->StartBatch(handler, &batch));
+    EXPECT_EQ(Status::OK, batch->Put(handler, key, value));
+    EXPECT_EQ(Status::OK, batch->Execute(handler));
+  }
+
+  files::ScopedTempDir tmp_dir_;
+  LevelDb db_;
+  PrefixedDb page1_db_;
+  PrefixedDb page2_db_;
+
+ private:
+  FXL_DISALLOW_COPY_AND_ASSIGN(PrefixedDbTest);
+};
+
+TEST_F(PrefixedDbTest, PutGet) {
+  EXPECT_TRUE(RunInCoroutine([&](CoroutineHandler* handler) {
+    Put(handler, &page1_db_, "key", "value1");
+    Put(handler, &page2_db_, "key", "value2");
+
+    std::string value;
+    EXPECT_EQ(Status::OK, page1_db_.Get(handler, "key", &value));
+    EXPECT_EQ("value1", value);
+    EXPECT_EQ(Status::OK, page2_db_.Get(handler, "key", &value));
+    EXPECT_EQ("value2", value);
+    EXPECT_EQ(Status::OK, db_.Get(handler, "page/1/key", &value));
+    EXPECT_EQ("value1", value);
+
+    bool has_key;
+    EXPECT_EQ(Status::OK, page1_db_.HasKey(handler, "key", &has_key));
+    EXPECT_TRUE(has_key);
+    EXPECT_EQ(Status::OK, page1_db_.HasKey(handler, "page/1/key", &has_key));
+    EXPECT_FALSE(has_key);
+  }));
+}
+
+TEST_F(PrefixedDbTest, GetByPrefix) {
+  EXPECT_TRUE(RunInCoroutine([&](CoroutineHandler* handler) {
+    Put(handler, &page1_db_, "a/1", "value1");
+    Put(handler, &page1_db_, "a/2", "value2");
+    Put(handler, &page1_db_, "b/1", "value3");
+    Put(handler, &page2_db_, "a/3", "value4");
+
+    std::vector<std::string> key_suffixes;
+    EXPECT_EQ(Status::OK, page1_db_.GetByPrefix(handler, "a/", &key_suffixes));
+    EXPECT_EQ(std::vector<std::string>({"1", "2"}), key_suffixes);
+
+    std::vector<std::pair<std::string, std::string>> entries;
+    EXPECT_EQ(Status::OK, page1_db_.GetEntriesByPrefix(handler, "", &entries));
+    EXPECT_EQ((std::vector<std::pair<std::string, std::string>>(
+                  {{"a/1", "value1"}, {"a/2", "value2"}, {"b/1", "value3"}})),
+              entries);
+
+    std::unique_ptr<Iterator<const std::pair<convert::ExtendedStringView,
+                                             convert::ExtendedStringView>>>
+        it;
+    EXPECT_EQ(Status::OK, page1_db_.GetIteratorAtPrefix(handler, "a/", &it));
+    ASSERT_TRUE(it->Valid());
+    EXPECT_EQ("a/1", (*it)->first.ToString());
+    EXPECT_EQ("value1", (*it)->second.ToString());
+    it->Next();
+    ASSERT_TRUE(it->Valid());
+    EXPECT_EQ("a/2", (*it)->first.ToString());
+    it->Next();
+    EXPECT_FALSE(it->Valid());
+    EXPECT_EQ(Status::OK, it->GetStatus());
+  }));
+}
+
+TEST_F(PrefixedDbTest, DeleteByPrefix) {
+  EXPECT_TRUE(RunInCoroutine([&](CoroutineHandler* handler) {
+    Put(handler, &page1_db_, "key", "value1");
+    Put(handler, &page2_db_, "key", "value2");
+
+    std::unique_ptr<Db::Batch> batch;
+    ASSERT_EQ(Status::OK, page1_db_.StartBatch(handler, &batch));
+    EXPECT_EQ(Status::OK, batch->DeleteByPrefix(handler, ""));
+    EXPECT_EQ(Status::OK, batch->Execute(handler));
+
+    std::string value;
+    EXPECT_EQ(Status::NOT_FOUND, page1_db_.Get(handler, "key", &value));
+    EXPECT_EQ(Status::OK, page2_db_.Get(handler, "key", &value));
+    EXPECT_EQ("value2", value);
+  }));
+}
+
+}  // namespace
+}  // namespace storage
@@ -4,12 +4,15 @@
 
 #include "peridot/bin/ledger/storage/impl/split.h"
 
+#include <deque>
 #include <limits>
 #include <sstream>
 
+#include "lib/fxl/functional/auto_call.h"
 #include "lib/fxl/functional/closure.h"
 #include "lib/fxl/functional/make_copyable.h"
 #include "lib/fxl/macros.h"
+#include "lib/fxl/memory/ref_counted.h"
 #include "peridot/bin/ledger/storage/impl/constants.h"
 #include "peridot/bin/ledger/storage/impl/file_index.h"
 #include "peridot/bin/ledger/storage/impl/file_index_generated.h"
@@ -57,21 +60,35 @@ struct ChunkAndSize {
 //     continue.
 //   - Send the index file to the client.
 //   - Add the identifier of the index file at the next level.
-class SplitContext {
+//
+// If a |digest_runner| is given, the digests of the chunks cut by the rolling
+// hash are computed on it, while the rolling hash keeps consuming the source.
+// The digests are sent back to |task_runner|, where the chunks are then sent to
+// the client and the indexes built in the order in which the chunks were cut.
+class SplitContext : public fxl::RefCountedThreadSafe<SplitContext> {
  public:
-  explicit SplitContext(
+  SplitContext(
+      fxl::RefPtr<fxl::TaskRunner> task_runner,
+      fxl::RefPtr<fxl::TaskRunner> digest_runner,
       std::function<ObjectIdentifier(IterationStatus,
                                      ObjectDigest,
                                      std::unique_ptr<DataSource::DataChunk>)>
           callback)
-      : callback_(std::move(callback)),
+      : task_runner_(std::move(task_runner)),
+        digest_runner_(std::move(digest_runner)),
+        callback_(std::move(callback)),
         roll_sum_split_(kMinChunkSize, kMaxChunkSize) {}
-  SplitContext(SplitContext&& other) = default;
   ~SplitContext() {}
 
   void AddChunk(std::unique_ptr<DataSource::DataChunk> chunk,
                 DataSource::Status status) {
+    if (finished_) {
+      return;
+    }
+
     if (status == DataSource::Status::ERROR) {
+      finished_ = true;
+      pending_pieces_.clear();
       callback_(IterationStatus::ERROR, "", nullptr);
       return;
     }
@@ -89,41 +106,36 @@ class SplitContext {
     if (!current_chunks_.empty()) {
       // The remaining data needs to be sent even if it is not chunked at an
       // expected cut point.
-      BuildAndSendNextChunk(views_.back().size());
+      SendPiece(BuildNextChunk(views_.back().size()), 0);
     }
 
     // No data remains.
     FXL_DCHECK(current_chunks_.empty());
 
-    // The final id to send exists.
-    FXL_DCHECK(!current_identifiers_per_level_.back().empty());
-
-    // This traverses the stack of indices, sending each level until a single
-    // top level index is produced.
-    for (size_t i = 0; i < current_identifiers_per_level_.size(); ++i) {
-      if (current_identifiers_per_level_[i].empty()) {
-        continue;
-      }
-
-      // At the top of the stack with a single element, the algorithm is
-      // finished. The top-level object_identifier is the unique element.
-      if (i == current_identifiers_per_level_.size() - 1 &&
-          current_identifiers_per_level_[i].size() == 1) {
-        callback_(
-            IterationStatus::DONE,
-            std::move(
-                current_identifiers_per_level_[i][0].identifier.object_digest),
-            nullptr);
-        return;
-      }
+    source_done_ = true;
+    SendPiecesAndMaybeFinish();
+  }
 
-      BuildIndexAtLevel(i);
+  // Called when the source stops calling |AddChunk| before having sent all its
+  // data: |callback_| must not be called anymore.
+  void OnSourceDeleted() {
+    if (source_done_) {
+      return;
     }
-
-    FXL_NOTREACHED();
+    finished_ = true;
+    pending_pieces_.clear();
   }
 
  private:
+  // A piece cut by the rolling hash, waiting for its digest.
+  struct PendingPiece {
+    std::unique_ptr<DataSource::DataChunk> data;
+    ObjectDigest digest;
+    // The number of index levels to build once the piece has been sent.
+    size_t index_levels;
+    bool ready = false;
+  };
+
   std::vector<ObjectIdentifierAndSize>& GetCurrentIdentifiersAtLevel(
       size_t level) {
     if (level >= current_identifiers_per_level_.size()) {
@@ -148,25 +160,114 @@ class SplitContext {
         return;
       }
 
-      BuildAndSendNextChunk(split_index);
+      SendPiece(BuildNextChunk(split_index), GetLevel(bits));
+    }
+  }
 
-      size_t level = GetLevel(bits);
-      for (size_t i = 0; i < level; ++i) {
-        FXL_DCHECK(!current_identifiers_per_level_[i].empty());
-        BuildIndexAtLevel(i);
-      }
+  // Computes the digest of |data|, either synchronously or on
+  // |digest_runner_|, and sends it to the client.
+  void SendPiece(std::unique_ptr<DataSource::DataChunk> data,
+                 size_t index_levels) {
+    if (!digest_runner_) {
+      ObjectDigest object_digest =
+          ComputeObjectDigest(ObjectType::VALUE, data->Get());
+      SendPieceAndBuildIndexes(std::move(data), std::move(object_digest),
+                               index_levels);
+      return;
     }
+
+    uint64_t piece_id = first_pending_piece_id_ + pending_pieces_.size();
+    pending_pieces_.emplace_back();
+    pending_pieces_.back().index_levels = index_levels;
+    digest_runner_->PostTask(fxl::MakeCopyable(
+        [context = fxl::RefPtr<SplitContext>(this), task_runner = task_runner_,
+         data = std::move(data), piece_id]() mutable {
+          ObjectDigest object_digest =
+              ComputeObjectDigest(ObjectType::VALUE, data->Get());
+          task_runner->PostTask(fxl::MakeCopyable(
+              [context = std::move(context), data = std::move(data),
+               object_digest = std::move(object_digest), piece_id]() mutable {
+                context->OnPieceDigest(piece_id, std::move(data),
+                                       std::move(object_digest));
+              }));
+        }));
   }
 
-  void BuildAndSendNextChunk(size_t split_index) {
-    std::unique_ptr<DataSource::DataChunk> data = BuildNextChunk(split_index);
-    auto data_view = data->Get();
-    size_t size = data_view.size();
-    ObjectDigest object_digest =
-        ComputeObjectDigest(ObjectType::VALUE, data_view);
-    auto identifier =
-        callback_(IterationStatus::IN_PROGRESS, object_digest, std::move(data));
+  void OnPieceDigest(uint64_t piece_id,
+                     std::unique_ptr<DataSource::DataChunk> data,
+                     ObjectDigest object_digest) {
+    if (finished_) {
+      return;
+    }
+    FXL_DCHECK(piece_id >= first_pending_piece_id_);
+    FXL_DCHECK(piece_id < first_pending_piece_id_ + pending_pieces_.size());
+    PendingPiece& piece = pending_pieces_[piece_id - first_pending_piece_id_];
+    piece.data = std::move(data);
+    piece.digest = std::move(object_digest);
+    piece.ready = true;
+    SendPiecesAndMaybeFinish();
+  }
+
+  // Sends all pieces whose digest is known, in order, and sends the root
+  // identifier once the source is done and no piece is left.
+  void SendPiecesAndMaybeFinish() {
+    while (!pending_pieces_.empty() && pending_pieces_.front().ready) {
+      PendingPiece piece = std::move(pending_pieces_.front());
+      pending_pieces_.pop_front();
+      ++first_pending_piece_id_;
+      SendPieceAndBuildIndexes(std::move(piece.data), std::move(piece.digest),
+                               piece.index_levels);
+    }
+
+    if (source_done_ && pending_pieces_.empty()) {
+      Finish();
+    }
+  }
+
+  void SendPieceAndBuildIndexes(std::unique_ptr<DataSource::DataChunk> data,
+                                ObjectDigest object_digest,
+                                size_t index_levels) {
+    size_t size = data->Get().size();
+    auto identifier = callback_(IterationStatus::IN_PROGRESS,
+                                std::move(object_digest), std::move(data));
     AddIdentifierAtLevel(0, {std::move(identifier), size});
+
+    for (size_t i = 0; i < index_levels; ++i) {
+      FXL_DCHECK(!current_identifiers_per_level_[i].empty());
+      BuildIndexAtLevel(i);
+    }
+  }
+
+  void Finish() {
+    FXL_DCHECK(!finished_);
+    finished_ = true;
+
+    // The final id to send exists.
+    FXL_DCHECK(!current_identifiers_per_level_.back().empty());
+
+    // This traverses the stack of indices, sending each level until a single
+    // top level index is produced.
+    for (size_t i = 0; i < current_identifiers_per_level_.size(); ++i) {
+      if (current_identifiers_per_level_[i].empty()) {
+        continue;
+      }
+
+      // At the top of the stack with a single element, the algorithm is
+      // finished. The top-level object_identifier is the unique element.
+      if (i == current_identifiers_per_level_.size() - 1 &&
+          current_identifiers_per_level_[i].size() == 1) {
+        callback_(
+            IterationStatus::DONE,
+            std::move(
+                current_identifiers_per_level_[i][0].identifier.object_digest),
+            nullptr);
+        return;
+      }
+
+      BuildIndexAtLevel(i);
+    }
+
+    FXL_NOTREACHED();
   }
 
   void AddIdentifierAtLevel(size_t level, ObjectIdentifierAndSize data) {
@@ -270,6 +371,8 @@ class SplitContext {
     return DataSource::DataChunk::Create(std::move(data));
   }
 
+  fxl::RefPtr<fxl::TaskRunner> task_runner_;
+  fxl::RefPtr<fxl::TaskRunner> digest_runner_;
   std::function<ObjectIdentifier(IterationStatus,
                                  ObjectDigest,
                                  std::unique_ptr<DataSource::DataChunk>)>
@@ -284,6 +387,15 @@ class SplitContext {
   // List of unsent indices per level.
   std::vector<std::vector<ObjectIdentifierAndSize>>
       current_identifiers_per_level_;
+  // The pieces whose digest is being computed on |digest_runner_|, in the
+  // order in which they have been cut.
+  std::deque<PendingPiece> pending_pieces_;
+  // The id of the first piece in |pending_pieces_|.
+  uint64_t first_pending_piece_id_ = 0;
+  // Whether the source has sent all its data.
+  bool source_done_ = false;
+  // Whether the final call to |callback_| has been made.
+  bool finished_ = false;
 
   FXL_DISALLOW_COPY_AND_ASSIGN(SplitContext);
 };
@@ -350,12 +462,28 @@ void SplitDataSource(
                                    ObjectDigest,
                                    std::unique_ptr<DataSource::DataChunk>)>
         callback) {
-  SplitContext context(std::move(callback));
-  source->Get(
-      fxl::MakeCopyable([context = std::move(context)](
-                            std::unique_ptr<DataSource::DataChunk> chunk,
-                            DataSource::Status status) mutable {
-        context.AddChunk(std::move(chunk), status);
+  SplitDataSource(source, nullptr, nullptr, std::move(callback));
+}
+
+void SplitDataSource(
+    DataSource* source,
+    fxl::RefPtr<fxl::TaskRunner> task_runner,
+    fxl::RefPtr<fxl::TaskRunner> digest_runner,
+    std::function<ObjectIdentifier(IterationStatus,
+                                   ObjectDigest,
+                                   std::unique_ptr<DataSource::DataChunk>)>
+        callback) {
+  FXL_DCHECK(!digest_runner || task_runner);
+  auto context = fxl::AdoptRef(new SplitContext(
+      std::move(task_runner), std::move(digest_runner), std::move(callback)));
+  auto on_source_deleted = fxl::MakeAutoCall<fxl::Closure>(
+      [context] { context->OnSourceDeleted(); });
+  source->Get(fxl::MakeCopyable(
+      [context = std::move(context),
+       on_source_deleted = std::move(on_source_deleted)](
+          std::unique_ptr<DataSource::DataChunk> chunk,
+          DataSource::Status status) mutable {
+        context->AddChunk(std::move(chunk), status);
       }));
 }
 
@@ -5,6 +5,8 @@
 #ifndef PERIDOT_BIN_LEDGER_STORAGE_IMPL_SPLIT_H_
 #define PERIDOT_BIN_LEDGER_STORAGE_IMPL_SPLIT_H_
 
+#include "lib/fxl/memory/ref_ptr.h"
+#include "lib/fxl/tasks/task_runner.h"
 #include "peridot/bin/ledger/storage/public/data_source.h"
 #include "peridot/bin/ledger/storage/public/types.h"
 
@@ -32,6 +34,22 @@ void SplitDataSource(
                                    std::unique_ptr<DataSource::DataChunk>)>
         callback);
 
+// Same as above, but computes the digests of the chunks cut from |source| on
+// |digest_runner|, while |source| keeps being split. |callback| is always
+// called on |task_runner|, which must be the runner of the current thread, with
+// the pieces in the same order as the synchronous version. |callback| can be
+// called after |source| has delivered all its data, until all digests have
+// been computed. If |digest_runner| is null, this is equivalent to the
+// synchronous version.
+void SplitDataSource(
+    DataSource* source,
+    fxl::RefPtr<fxl::TaskRunner> task_runner,
+    fxl::RefPtr<fxl::TaskRunner> digest_runner,
+    std::function<ObjectIdentifier(IterationStatus,
+                                   ObjectDigest,
+                                   std::unique_ptr<DataSource::DataChunk>)>
+        callback);
+
 // Recurse over all pieces of an index object.
 Status ForEachPiece(fxl::StringView index_content,
                     std::function<Status(ObjectIdentifier)> callback);
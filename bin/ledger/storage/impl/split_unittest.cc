@@ -6,7 +6,11 @@
 
 #include <string.h>
 
+#include <thread>
+
 #include "gtest/gtest.h"
+#include "lib/fsl/tasks/message_loop.h"
+#include "lib/fsl/threading/create_thread.h"
 #include "lib/fxl/functional/make_copyable.h"
 #include "peridot/bin/ledger/encryption/primitives/hash.h"
 #include "peridot/bin/ledger/encryption/primitives/rand.h"
@@ -16,6 +20,7 @@
 #include "peridot/bin/ledger/storage/impl/object_digest.h"
 #include "peridot/bin/ledger/storage/public/data_source.h"
 #include "peridot/bin/ledger/storage/public/make_object_identifier.h"
+#include "peridot/lib/convert/convert.h"
 
 namespace storage {
 namespace {
@@ -78,30 +83,38 @@ struct SplitResult {
   std::map<ObjectDigest, std::unique_ptr<DataSource::DataChunk>> data;
 };
 
-void DoSplit(DataSource* source, std::function<void(SplitResult)> callback) {
+void DoSplit(DataSource* source,
+             fxl::RefPtr<fxl::TaskRunner> task_runner,
+             fxl::RefPtr<fxl::TaskRunner> digest_runner,
+             std::function<void(SplitResult)> callback) {
   auto result = std::make_unique<SplitResult>();
   SplitDataSource(
-      source, fxl::MakeCopyable(
-                  [result = std::move(result), callback = std::move(callback)](
-                      IterationStatus status, ObjectDigest digest,
-                      std::unique_ptr<DataSource::DataChunk> data) mutable {
-                    EXPECT_TRUE(result);
-                    if (status == IterationStatus::IN_PROGRESS) {
-                      EXPECT_LE(data->Get().size(), kMaxChunkSize);
-                      if (result->data.count(digest) != 0) {
-                        EXPECT_EQ(result->data[digest]->Get(), data->Get());
-                      } else {
-                        result->data[digest] = std::move(data);
-                      }
-                    }
-                    result->calls.push_back({status, digest});
-                    if (status != IterationStatus::IN_PROGRESS) {
-                      auto to_send = std::move(*result);
-                      result.reset();
-                      callback(std::move(to_send));
-                    }
-                    return MakeDefaultObjectIdentifier(std::move(digest));
-                  }));
+      source, std::move(task_runner), std::move(digest_runner),
+      fxl::MakeCopyable(
+          [result = std::move(result), callback = std::move(callback)](
+              IterationStatus status, ObjectDigest digest,
+              std::unique_ptr<DataSource::DataChunk> data) mutable {
+            EXPECT_TRUE(result);
+            if (status == IterationStatus::IN_PROGRESS) {
+              EXPECT_LE(data->Get().size(), kMaxChunkSize);
+              if (result->data.count(digest) != 0) {
+                EXPECT_EQ(result->data[digest]->Get(), data->Get());
+              } else {
+                result->data[digest] = std::move(data);
+              }
+            }
+            result->calls.push_back({status, digest});
+            if (status != IterationStatus::IN_PROGRESS) {
+              auto to_send = std::move(*result);
+              result.reset();
+              callback(std::move(to_send));
+            }
+            return MakeDefaultObjectIdentifier(std::move(digest));
+          }));
+}
+
+void DoSplit(DataSource* source, std::function<void(SplitResult)> callback) {
+  DoSplit(source, nullptr, nullptr, std::move(callback));
 }
 
 ::testing::AssertionResult ReadFile(
@@ -253,6 +266,75 @@ TEST(SplitTest, Error) {
   ASSERT_EQ(IterationStatus::ERROR, split_result.calls.back().status);
 }
 
+// The digests of the pieces of a value are persisted and exchanged with other
+// devices, so the cut points of the rolling hash must never change.
+TEST(SplitTest, GoldenValuePieces) {
+  std::string content = NewString(32 * kMaxChunkSize);
+  auto source = DataSource::Create(content);
+  SplitResult split_result;
+  DoSplit(source.get(),
+          [&split_result](SplitResult c) { split_result = std::move(c); });
+
+  std::vector<size_t> piece_sizes;
+  std::string value_digests;
+  for (const auto& call : split_result.calls) {
+    if (call.status == IterationStatus::IN_PROGRESS &&
+        GetObjectDigestType(call.digest) == ObjectDigestType::VALUE_HASH) {
+      piece_sizes.push_back(split_result.data[call.digest]->Get().size());
+      value_digests.append(call.digest);
+    }
+  }
+
+  ASSERT_EQ(47u, piece_sizes.size());
+  EXPECT_EQ(std::vector<size_t>({17700, 56832, 56832, 61668, 35328}),
+            std::vector<size_t>(piece_sizes.begin(), piece_sizes.begin() + 5));
+  EXPECT_EQ(55484u, piece_sizes.back());
+  EXPECT_EQ("094E3300EEBDC9E072B814E065719108018A95FCC740E2DEB973DCA453C01DB5",
+            convert::ToHex(encryption::SHA256WithLengthHash(value_digests)));
+}
+
+TEST(SplitTest, PipelinedDigests) {
+  fsl::MessageLoop message_loop;
+  fxl::RefPtr<fxl::TaskRunner> digest_runner;
+  std::thread digest_thread = fsl::CreateThread(&digest_runner);
+
+  std::string content = NewString(32 * kMaxChunkSize);
+  auto source = DataSource::Create(content);
+  SplitResult expected_result;
+  DoSplit(source.get(), [&expected_result](SplitResult c) {
+    expected_result = std::move(c);
+  });
+
+  source = DataSource::Create(content);
+  SplitResult split_result;
+  DoSplit(source.get(), message_loop.task_runner(), digest_runner,
+          [&split_result](SplitResult c) {
+            split_result = std::move(c);
+            fsl::MessageLoop::GetCurrent()->PostQuitTask();
+          });
+  // Digests are computed on |digest_runner|, so nothing can be sent before the
+  // message loop runs.
+  EXPECT_TRUE(split_result.calls.empty());
+  message_loop.Run();
+
+  // The pieces are sent in the same order as when digests are computed
+  // synchronously.
+  ASSERT_EQ(expected_result.calls.size(), split_result.calls.size());
+  for (size_t i = 0; i < expected_result.calls.size(); ++i) {
+    EXPECT_EQ(expected_result.calls[i].status, split_result.calls[i].status);
+    EXPECT_EQ(expected_result.calls[i].digest, split_result.calls[i].digest);
+  }
+  EXPECT_EQ(IterationStatus::DONE, split_result.calls.back().status);
+
+  std::string found_content;
+  ASSERT_TRUE(ReadFile(split_result.calls.back().digest, split_result.data,
+                       &found_content, content.size()));
+  EXPECT_EQ(content, found_content);
+
+  digest_runner->PostTask([] { fsl::MessageLoop::GetCurrent()->QuitNow(); });
+  digest_thread.join();
+}
+
 ObjectIdentifier MakeIndexId(size_t i) {
   std::string value;
   value.resize(sizeof(i));
@@ -172,6 +172,51 @@ class SocketDataSource : public DataSource, public fsl::SocketDrainer::Client {
   std::function<void(std::unique_ptr<DataChunk>, Status)> callback_;
 };
 
+class TransformedDataSource : public DataSource {
+ public:
+  TransformedDataSource(std::unique_ptr<DataSource> source,
+                        uint64_t size,
+                        ChunkTransform transform)
+      : source_(std::move(source)),
+        size_(size),
+        transform_(std::move(transform)) {
+    FXL_DCHECK(source_);
+  }
+
+ private:
+  uint64_t GetSize() override { return size_; }
+
+  void Get(std::function<void(std::unique_ptr<DataChunk>, Status)> callback)
+      override {
+    source_->Get([this, callback = std::move(callback)](
+                     std::unique_ptr<DataChunk> chunk, Status status) {
+      if (failed_) {
+        return;
+      }
+      if (status == Status::ERROR) {
+        failed_ = true;
+        callback(nullptr, Status::ERROR);
+        return;
+      }
+      std::string output;
+      if (!transform_(chunk ? chunk->Get() : fxl::StringView(),
+                      status == Status::DONE, &output)) {
+        failed_ = true;
+        callback(nullptr, Status::ERROR);
+        return;
+      }
+      callback(std::make_unique<StringLikeDataChunk<std::string>>(
+                   std::move(output)),
+               status);
+    });
+  }
+
+  std::unique_ptr<DataSource> source_;
+  uint64_t size_;
+  ChunkTransform transform_;
+  bool failed_ = false;
+};
+
 class FlatBufferDataChunk : public DataSource::DataChunk {
  public:
   explicit FlatBufferDataChunk(
@@ -217,4 +262,12 @@ std::unique_ptr<DataSource> DataSource::Create(zx::socket socket,
   return std::make_unique<SocketDataSource>(std::move(socket), size);
 }
 
+std::unique_ptr<DataSource> DataSource::Transform(
+    std::unique_ptr<DataSource> source,
+    uint64_t size,
+    ChunkTransform transform) {
+  return std::make_unique<TransformedDataSource>(std::move(source), size,
+                                                 std::move(transform));
+}
+
 }  // namespace storage
@@ -9,6 +9,7 @@
 
 #include <functional>
 #include <memory>
+#include <string>
 
 #include "lib/fidl/cpp/bindings/array.h"
 #include "lib/fsl/vmo/sized_vmo.h"
@@ -46,12 +47,26 @@ class DataSource {
     ERROR,
   };
 
+  // Transforms a chunk of data, appending the result to |output|. |last| is
+  // true for the final chunk of the data, which can be empty. Returns false if
+  // the data is invalid.
+  using ChunkTransform = std::function<
+      bool(fxl::StringView chunk, bool last, std::string* output)>;
+
   // Factory methods.
   static std::unique_ptr<DataSource> Create(std::string value);
   static std::unique_ptr<DataSource> Create(fidl::Array<uint8_t> value);
   static std::unique_ptr<DataSource> Create(fsl::SizedVmo vmo);
   static std::unique_ptr<DataSource> Create(zx::socket socket, uint64_t size);
 
+  // Returns a data source streaming the result of |transform| applied to each
+  // chunk of |source| as it is received, so that the data is never held in
+  // memory as a whole. |size| is the total size of the transformed data.
+  static std::unique_ptr<DataSource> Transform(
+      std::unique_ptr<DataSource> source,
+      uint64_t size,
+      ChunkTransform transform);
+
   DataSource() {}
   virtual ~DataSource() {}
 
@@ -4,6 +4,8 @@
 
 #include "peridot/bin/ledger/storage/public/data_source.h"
 
+#include <vector>
+
 #include "gtest/gtest.h"
 #include "lib/fsl/socket/strings.h"
 #include "lib/fsl/vmo/strings.h"
@@ -89,6 +91,48 @@ TEST_F(DataSourceTest, Socket) {
       DataSource::Create(fsl::WriteStringToSocket(value), value.size())));
 }
 
+TEST_F(DataSourceTest, Transform) {
+  std::string value = "Hello World";
+
+  std::vector<bool> last_values;
+  auto source = DataSource::Transform(
+      DataSource::Create(fsl::WriteStringToSocket(value), value.size()),
+      value.size() + 1,
+      [&last_values](fxl::StringView chunk, bool last, std::string* output) {
+        last_values.push_back(last);
+        output->append(chunk.data(), chunk.size());
+        if (last) {
+          output->append("!");
+        }
+        return true;
+      });
+  EXPECT_EQ(value.size() + 1, source->GetSize());
+  EXPECT_TRUE(TestDataSource(value + "!", std::move(source)));
+  ASSERT_FALSE(last_values.empty());
+  EXPECT_TRUE(last_values.back());
+}
+
+TEST_F(DataSourceTest, TransformError) {
+  std::string value = "Hello World";
+
+  EXPECT_FALSE(TestDataSource(
+      value,
+      DataSource::Transform(
+          DataSource::Create(value), value.size(),
+          [](fxl::StringView chunk, bool last, std::string* output) {
+            return false;
+          })));
+  EXPECT_FALSE(TestDataSource(
+      value,
+      DataSource::Transform(
+          DataSource::Create(fsl::WriteStringToSocket(value), value.size() + 1),
+          value.size(),
+          [](fxl::StringView chunk, bool last, std::string* output) {
+            output->append(chunk.data(), chunk.size());
+            return true;
+          })));
+}
+
 TEST_F(DataSourceTest, SocketWrongSize) {
   std::string value = "Hello World";
 
@@ -8,6 +8,7 @@
 #include <functional>
 #include <memory>
 #include <utility>
+#include <vector>
 
 #include "lib/fxl/macros.h"
 #include "lib/fxl/strings/string_view.h"
@@ -38,9 +39,28 @@ class PageStorage {
     FXL_DISALLOW_COPY_AND_ASSIGN(CommitIdAndBytes);
   };
 
+  // Statistics of a garbage collection run. See |CollectGarbage|.
+  struct GarbageCollectionStats {
+    // Number of pieces deleted.
+    uint64_t deleted_piece_count = 0;
+    // Total size, in bytes, of the deleted pieces.
+    uint64_t reclaimed_bytes = 0;
+  };
+
   // Location where to search an object. See |GetObject| call for usage.
   enum Location { LOCAL, NETWORK };
 
+  // Keeps the contents of a commit from being garbage collected for as long as
+  // it is alive. See |PinCommit|.
+  class CommitPin {
+   public:
+    CommitPin() {}
+    virtual ~CommitPin() {}
+
+   private:
+    FXL_DISALLOW_COPY_AND_ASSIGN(CommitPin);
+  };
+
   PageStorage() {}
   virtual ~PageStorage() {}
 
@@ -122,6 +142,11 @@ class PageStorage {
   virtual void AddObjectFromLocal(
       std::unique_ptr<DataSource> data_source,
       std::function<void(Status, ObjectIdentifier)> callback) = 0;
+  // Adds the given local objects, writing all their pieces together, and
+  // passes the ids of the new objects, in the same order, to the callback.
+  virtual void AddObjectsFromLocal(
+      std::vector<std::unique_ptr<DataSource>> data_sources,
+      std::function<void(Status, std::vector<ObjectIdentifier>)> callback) = 0;
   // Finds the Object associated with the given |object_identifier|. The result
   // or an an error will be returned through the given |callback|. If |location|
   // is LOCAL, only local storage will be checked. If |location| is NETWORK,
@@ -152,15 +177,29 @@ class PageStorage {
       fxl::StringView key,
       std::function<void(Status, std::string)> callback) = 0;
 
+  // Garbage collection.
+  // Deletes the local copy of the synced pieces that are not reachable from a
+  // head commit, an unsynced commit, the base commit of a journal or a pinned
+  // commit. These pieces can still be retrieved from the network. Commits
+  // themselves are never deleted.
+  virtual void CollectGarbage(
+      std::function<void(Status, GarbageCollectionStats)> callback) = 0;
+  // Marks the commit with the given |commit_id| as in use, e.g. by a snapshot
+  // or a watcher, so that |CollectGarbage| keeps its contents until the
+  // returned pin is deleted. The pin may outlive this storage.
+  virtual std::unique_ptr<CommitPin> PinCommit(CommitIdView commit_id) = 0;
+
   // Commit contents.
 
   // Iterates over the entries of the given |commit| and calls |on_next| on
-  // found entries with a key equal to or greater than |min_key|. Returning
-  // false from |on_next| will immediately stop the iteration. |on_done| is
-  // called once, upon successfull completion, i.e. when there are no more
-  // elements or iteration was interrupted, or if an error occurs.
+  // found entries with a key equal to or greater than |min_key| and, unless
+  // |max_key| is empty, strictly smaller than |max_key|. Returning false from
+  // |on_next| will immediately stop the iteration. |on_done| is called once,
+  // upon successfull completion, i.e. when there are no more elements or
+  // iteration was interrupted, or if an error occurs.
   virtual void GetCommitContents(const Commit& commit,
                                  std::string min_key,
+                                 std::string max_key,
                                  std::function<bool(Entry)> on_next,
                                  std::function<void(Status)> on_done) = 0;
 
@@ -172,8 +211,19 @@ class PageStorage {
       std::string key,
       std::function<void(Status, Entry)> on_done) = 0;
 
+  // Retrieves the entries with the given |keys|, which must be sorted and
+  // unique, and calls |callback| with the entries found, sorted by key. Keys
+  // not present in the given commit have no entry in the result. This is
+  // equivalent to calling |GetEntryFromCommit| for each key, but the tree of
+  // the commit is only walked once.
+  virtual void GetEntriesFromCommit(
+      const Commit& commit,
+      std::vector<std::string> keys,
+      std::function<void(Status, std::vector<Entry>)> callback) = 0;
+
   // Iterates over the difference between the contents of two commits and calls
-  // |on_next_diff| on found changed entries. Returning false from
+  // |on_next_diff| on found changed entries with a key in the range defined by
+  // |min_key| and |max_key|, as in |GetCommitContents|. Returning false from
   // |on_next_diff| will immediately stop the iteration. |on_done| is called
   // once, upon successfull completion, i.e. when there are no more differences
   // or iteration was interrupted, or if an error occurs.
@@ -181,6 +231,7 @@ class PageStorage {
       const Commit& base_commit,
       const Commit& other_commit,
       std::string min_key,
+      std::string max_key,
       std::function<bool(EntryChange)> on_next_diff,
       std::function<void(Status)> on_done) = 0;
 
@@ -0,0 +1,121 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "peridot/bin/ledger/storage/public/piece_compression.h"
+
+#include <limits>
+
+#include <zlib.h>
+
+#include "lib/fxl/logging.h"
+
+namespace storage {
+namespace {
+// An encoded piece starts with a format byte. Compressed pieces then contain
+// the size of the uncompressed content, as a little endian uint32_t, followed
+// by the zlib stream of the content. Stored pieces contain the content as is.
+constexpr size_t kHeaderSize = 1;
+constexpr size_t kSizeSize = sizeof(uint32_t);
+
+enum Format : uint8_t {
+  STORED = 0,
+  DEFLATE = 1,
+};
+
+// Pieces smaller than this are never compressed.
+constexpr size_t kMinCompressedPieceSize = 128;
+
+uint32_t ReadSize(const char* data) {
+  const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+  return static_cast<uint32_t>(bytes[0]) |
+         static_cast<uint32_t>(bytes[1]) << 8 |
+         static_cast<uint32_t>(bytes[2]) << 16 |
+         static_cast<uint32_t>(bytes[3]) << 24;
+}
+
+void WriteSize(uint32_t size, char* output) {
+  for (size_t i = 0; i < kSizeSize; ++i) {
+    output[i] = static_cast<char>((size >> (8 * i)) & 0xff);
+  }
+}
+
+// Compresses |data| into |encoded|. Returns false if the compressed piece
+// would not be significantly smaller than |data|.
+bool Compress(fxl::StringView data, std::string* encoded) {
+  if (data.size() < kMinCompressedPieceSize ||
+      data.size() > std::numeric_limits<uint32_t>::max()) {
+    return false;
+  }
+  std::string result;
+  uLongf compressed_size = compressBound(data.size());
+  result.resize(kHeaderSize + kSizeSize + compressed_size);
+  if (compress2(
+          reinterpret_cast<Bytef*>(&result[kHeaderSize + kSizeSize]),
+          &compressed_size, reinterpret_cast<const Bytef*>(data.data()),
+          data.size(), Z_BEST_SPEED) != Z_OK) {
+    return false;
+  }
+  size_t encoded_size = kHeaderSize + kSizeSize + compressed_size;
+  // Only keep compressed pieces that save at least an eighth of their size,
+  // as every read of a compressed piece pays for its decompression.
+  if (encoded_size > data.size() - data.size() / 8) {
+    return false;
+  }
+  result.resize(encoded_size);
+  result[0] = static_cast<char>(DEFLATE);
+  WriteSize(data.size(), &result[kHeaderSize]);
+  encoded->swap(result);
+  return true;
+}
+
+}  // namespace
+
+void EncodePiece(fxl::StringView data,
+                 PieceCompression compression,
+                 std::string* encoded) {
+  if (compression == PieceCompression::DEFLATE && Compress(data, encoded)) {
+    return;
+  }
+  std::string result;
+  result.reserve(kHeaderSize + data.size());
+  result.push_back(static_cast<char>(STORED));
+  result.append(data.data(), data.size());
+  encoded->swap(result);
+}
+
+bool DecodePiece(fxl::StringView encoded,
+                 std::string* buffer,
+                 fxl::StringView* data) {
+  if (encoded.size() < kHeaderSize) {
+    return false;
+  }
+  switch (static_cast<uint8_t>(encoded[0])) {
+    case STORED:
+      *data = encoded.substr(kHeaderSize);
+      return true;
+    case DEFLATE: {
+      if (encoded.size() < kHeaderSize + kSizeSize) {
+        return false;
+      }
+      uLongf size = ReadSize(encoded.data() + kHeaderSize);
+      std::string result;
+      result.resize(size);
+      fxl::StringView compressed = encoded.substr(kHeaderSize + kSizeSize);
+      if (uncompress(reinterpret_cast<Bytef*>(&result[0]), &size,
+                     reinterpret_cast<const Bytef*>(compressed.data()),
+                     compressed.size()) != Z_OK ||
+          size != result.size()) {
+        return false;
+      }
+      buffer->swap(result);
+      *data = *buffer;
+      return true;
+    }
+    default:
+      FXL_LOG(ERROR) << "Unknown piece format.";
+      return false;
+  }
+}
+
+}  // namespace storage
@@ -0,0 +1,50 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef PERIDOT_BIN_LEDGER_STORAGE_PUBLIC_PIECE_COMPRESSION_H_
+#define PERIDOT_BIN_LEDGER_STORAGE_PUBLIC_PIECE_COMPRESSION_H_
+
+#include <string>
+
+#include "lib/fxl/strings/string_view.h"
+
+namespace storage {
+
+// Compression applied to the content of object pieces at rest. The digest of a
+// piece is always computed on its uncompressed content, so that object
+// identifiers do not depend on the compression in use. Pieces are always sent
+// to the cloud uncompressed.
+enum class PieceCompression {
+  NONE,
+  DEFLATE,
+};
+
+// Format of the object pieces stored by a page. It is recorded in the page
+// database, apart from the pieces, and is set once for all, when the page is
+// created.
+enum class PieceFormat {
+  // Pieces are stored as is. This is the format of pages created without
+  // compression, including all pages created before compression existed.
+  RAW,
+  // Pieces are stored encoded with |EncodePiece|.
+  ENCODED,
+};
+
+// Encodes the content of a piece before it is stored in a page whose format is
+// |PieceFormat::ENCODED|. Compressed content is only kept when it is
+// significantly smaller than |data|.
+void EncodePiece(fxl::StringView data,
+                 PieceCompression compression,
+                 std::string* encoded);
+
+// Decodes a piece returned by |EncodePiece|. On success, |data| points either
+// into |encoded| or into |buffer|. Returns false if the encoded piece is
+// corrupted.
+bool DecodePiece(fxl::StringView encoded,
+                 std::string* buffer,
+                 fxl::StringView* data);
+
+}  // namespace storage
+
+#endif  // PERIDOT_BIN_LEDGER_STORAGE_PUBLIC_PIECE_COMPRESSION_H_
@@ -0,0 +1,88 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "peridot/bin/ledger/storage/public/piece_compression.h"
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "lib/fxl/strings/string_printf.h"
+
+namespace storage {
+namespace {
+
+// Returns a JSON-like value, which compresses well.
+std::string CompressibleValue() {
+  std::string value = "[";
+  for (size_t i = 0; i < 500; ++i) {
+    value += fxl::StringPrintf("{\"story_id\":\"story\",\"index\":%zu},", i);
+  }
+  value += "]";
+  return value;
+}
+
+TEST(PieceCompressionTest, RoundTrip) {
+  std::vector<std::string> values = {
+      "", "short", std::string(1000, 'a'), CompressibleValue(),
+      // Values that look like encoded pieces.
+      std::string("\0", 1), std::string("\x01garbage", 8)};
+
+  for (const auto& value : values) {
+    for (auto compression :
+         {PieceCompression::NONE, PieceCompression::DEFLATE}) {
+      std::string encoded;
+      EncodePiece(value, compression, &encoded);
+
+      std::string buffer;
+      fxl::StringView data;
+      ASSERT_TRUE(DecodePiece(encoded, &buffer, &data));
+      EXPECT_EQ(value, data.ToString());
+    }
+  }
+}
+
+TEST(PieceCompressionTest, CompressOnlyWhenUseful) {
+  std::string value = CompressibleValue();
+  std::string encoded;
+  EncodePiece(value, PieceCompression::NONE, &encoded);
+  EXPECT_GT(encoded.size(), value.size());
+  EncodePiece(value, PieceCompression::DEFLATE, &encoded);
+  EXPECT_LT(encoded.size(), value.size() / 5);
+
+  // Small values are not compressed.
+  EncodePiece("short", PieceCompression::DEFLATE, &encoded);
+  EXPECT_GT(encoded.size(), 5u);
+
+  // Values that do not compress are kept as is.
+  std::string incompressible;
+  uint64_t state = 1u;
+  for (size_t i = 0; i < 1024; ++i) {
+    state = state * 6364136223846793005u + 1442695040888963407u;
+    incompressible.push_back(static_cast<char>(state >> 56));
+  }
+  EncodePiece(incompressible, PieceCompression::DEFLATE, &encoded);
+  EXPECT_EQ(incompressible, encoded.substr(encoded.size() -
+                                           incompressible.size()));
+}
+
+TEST(PieceCompressionTest, Corruption) {
+  std::string encoded;
+  EncodePiece(CompressibleValue(), PieceCompression::DEFLATE, &encoded);
+  std::string buffer;
+  fxl::StringView data;
+
+  std::string corrupted = encoded;
+  corrupted[corrupted.size() / 2] ^= 0x55;
+  EXPECT_FALSE(DecodePiece(corrupted, &buffer, &data));
+
+  std::string truncated = encoded.substr(0, encoded.size() - 1);
+  EXPECT_FALSE(DecodePiece(truncated, &buffer, &data));
+
+  EXPECT_FALSE(DecodePiece("", &buffer, &data));
+  EXPECT_FALSE(DecodePiece(std::string("\x07", 1), &buffer, &data));
+}
+
+}  // namespace
+}  // namespace storage
@@ -112,6 +112,13 @@ void PageStorageEmptyImpl::AddObjectFromLocal(
   callback(Status::NOT_IMPLEMENTED, {});
 }
 
+void PageStorageEmptyImpl::AddObjectsFromLocal(
+    std::vector<std::unique_ptr<DataSource>> /*data_sources*/,
+    std::function<void(Status, std::vector<ObjectIdentifier>)> callback) {
+  FXL_NOTIMPLEMENTED();
+  callback(Status::NOT_IMPLEMENTED, {});
+}
+
 void PageStorageEmptyImpl::GetObject(
     ObjectIdentifier /*object_identifier*/,
     Location /*location*/,
@@ -141,9 +148,22 @@ void PageStorageEmptyImpl::GetSyncMetadata(
   callback(Status::NOT_IMPLEMENTED, "");
 }
 
+void PageStorageEmptyImpl::CollectGarbage(
+    std::function<void(Status, GarbageCollectionStats)> callback) {
+  FXL_NOTIMPLEMENTED();
+  callback(Status::NOT_IMPLEMENTED, GarbageCollectionStats());
+}
+
+std::unique_ptr<PageStorage::CommitPin> PageStorageEmptyImpl::PinCommit(
+    CommitIdView /*commit_id*/) {
+  FXL_NOTIMPLEMENTED();
+  return nullptr;
+}
+
 void PageStorageEmptyImpl::GetCommitContents(
     const Commit& /*commit*/,
     std::string /*min_key*/,
+    std::string /*max_key*/,
     std::function<bool(Entry)> /*on_next*/,
     std::function<void(Status)> on_done) {
   FXL_NOTIMPLEMENTED();
@@ -158,10 +178,19 @@ void PageStorageEmptyImpl::GetEntryFromCommit(
   callback(Status::NOT_IMPLEMENTED, Entry());
 }
 
+void PageStorageEmptyImpl::GetEntriesFromCommit(
+    const Commit& /*commit*/,
+    std::vector<std::string> /*keys*/,
+    std::function<void(Status, std::vector<Entry>)> callback) {
+  FXL_NOTIMPLEMENTED();
+  callback(Status::NOT_IMPLEMENTED, std::vector<Entry>());
+}
+
 void PageStorageEmptyImpl::GetCommitContentsDiff(
     const Commit& /*base_commit*/,
     const Commit& /*other_commit*/,
     std::string /*min_key*/,
+    std::string /*max_key*/,
     std::function<bool(EntryChange)> /*on_next_diff*/,
     std::function<void(Status)> on_done) {
   FXL_NOTIMPLEMENTED();
@@ -75,6 +75,11 @@ class PageStorageEmptyImpl : public PageStorage {
       std::unique_ptr<DataSource> data_source,
       std::function<void(Status, ObjectIdentifier)> callback) override;
 
+  void AddObjectsFromLocal(
+      std::vector<std::unique_ptr<DataSource>> data_sources,
+      std::function<void(Status, std::vector<ObjectIdentifier>)> callback)
+      override;
+
   void GetObject(ObjectIdentifier object_identifier,
                  Location location,
                  std::function<void(Status, std::unique_ptr<const Object>)>
@@ -92,18 +97,29 @@ class PageStorageEmptyImpl : public PageStorage {
       fxl::StringView key,
       std::function<void(Status, std::string)> callback) override;
 
+  void CollectGarbage(
+      std::function<void(Status, GarbageCollectionStats)> callback) override;
+
+  std::unique_ptr<CommitPin> PinCommit(CommitIdView commit_id) override;
+
   void GetCommitContents(const Commit& commit,
                          std::string min_key,
+                         std::string max_key,
                          std::function<bool(Entry)> on_next,
                          std::function<void(Status)> on_done) override;
 
   void GetEntryFromCommit(const Commit& commit,
                           std::string key,
                           std::function<void(Status, Entry)> callback) override;
+  void GetEntriesFromCommit(
+      const Commit& commit,
+      std::vector<std::string> keys,
+      std::function<void(Status, std::vector<Entry>)> callback) override;
 
   void GetCommitContentsDiff(const Commit& base_commit,
                              const Commit& other_commit,
                              std::string min_key,
+                             std::string max_key,
                              std::function<bool(EntryChange)> on_next_diff,
                              std::function<void(Status)> on_done) override;
 
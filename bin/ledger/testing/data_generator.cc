@@ -8,6 +8,7 @@
 #include <functional>
 #include <string>
 
+#include "lib/fxl/arraysize.h"
 #include "lib/fxl/logging.h"
 #include "lib/fxl/random/rand.h"
 #include "lib/fxl/strings/concatenate.h"
@@ -15,6 +16,12 @@
 
 namespace {
 constexpr size_t kPageIdSize = 16;
+
+constexpr fxl::StringView kWords[] = {
+    "{\"story_id\":", "\"link\":", "\"module\":", "\"url\":",
+    "\"name\":",      "true,",     "false,",      "null,",
+    "\"value\"},",    "[",         "],",          "42,",
+};
 }
 
 namespace test {
@@ -44,4 +51,14 @@ fidl::Array<uint8_t> DataGenerator::MakeValue(size_t size) {
   return data;
 }
 
+fidl::Array<uint8_t> DataGenerator::MakeCompressibleValue(size_t size) {
+  std::string value;
+  value.reserve(size);
+  while (value.size() < size) {
+    fxl::StringView word = kWords[generator_() % arraysize(kWords)];
+    value.append(word.data(), std::min(word.size(), size - value.size()));
+  }
+  return convert::ToArray(value);
+}
+
 }  // namespace test
@@ -31,6 +31,10 @@ class DataGenerator {
   // Builds a random value of the given length.
   fidl::Array<uint8_t> MakeValue(size_t size);
 
+  // Builds a value of the given length made of randomly chosen words from a
+  // small vocabulary, which compresses like the JSON data stored by clients.
+  fidl::Array<uint8_t> MakeCompressibleValue(size_t size);
+
  private:
   std::independent_bits_engine<std::default_random_engine, CHAR_BIT, uint8_t>
       generator_;
@@ -27,7 +27,8 @@ ledger::Status GetLedger(fsl::MessageLoop* loop,
                          cloud_provider::CloudProviderPtr cloud_provider,
                          std::string ledger_name,
                          std::string ledger_repository_path,
-                         ledger::LedgerPtr* ledger_ptr) {
+                         ledger::LedgerPtr* ledger_ptr,
+                         std::vector<std::string> ledger_args) {
   ledger::LedgerRepositoryFactoryPtr repository_factory;
   app::Services child_services;
   auto launch_info = app::ApplicationLaunchInfo::New();
@@ -35,6 +36,9 @@ ledger::Status GetLedger(fsl::MessageLoop* loop,
   launch_info->service_request = child_services.NewRequest();
   launch_info->arguments.push_back("--no_minfs_wait");
   launch_info->arguments.push_back("--no_statistics_reporting_for_testing");
+  for (auto& arg : ledger_args) {
+    launch_info->arguments.push_back(std::move(arg));
+  }
 
   context->launcher()->CreateApplication(std::move(launch_info),
                                          controller->NewRequest());
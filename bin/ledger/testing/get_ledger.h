@@ -7,6 +7,7 @@
 
 #include <functional>
 #include <string>
+#include <vector>
 
 #include "lib/app/cpp/application_context.h"
 #include "lib/auth/fidl/token_provider.fidl.h"
@@ -21,7 +22,7 @@
 namespace test {
 
 // Creates a new Ledger application instance and returns a LedgerPtr connection
-// to it.
+// to it. |ledger_args| are appended to the command line of the application.
 //
 // TODO(ppi): take the server_id as std::optional<std::string> and drop bool
 // sync once we're on C++17.
@@ -31,7 +32,8 @@ ledger::Status GetLedger(fsl::MessageLoop* loop,
                          cloud_provider::CloudProviderPtr cloud_provider,
                          std::string ledger_name,
                          std::string ledger_repository_path,
-                         ledger::LedgerPtr* ledger_ptr);
+                         ledger::LedgerPtr* ledger_ptr,
+                         std::vector<std::string> ledger_args = {});
 
 // Retrieves the requested page of the given Ledger instance and calls the
 // callback only after executing a GetId() call on the page, ensuring that it is
@@ -28,13 +28,15 @@ constexpr fxl::StringView kEntryCountFlag = "entry-count";
 constexpr fxl::StringView kValueSizeFlag = "value-size";
 constexpr fxl::StringView kPartSizeFlag = "part-size";
 constexpr fxl::StringView kServerIdFlag = "server-id";
+constexpr fxl::StringView kBlobStoreFlag = "blob-store";
 
 constexpr size_t kKeySize = 100;
 
 void PrintUsage(const char* executable_name) {
   std::cout << "Usage: " << executable_name << " --" << kEntryCountFlag
             << "=<int> --" << kValueSizeFlag << "=<int> --" << kPartSizeFlag
-            << "=<int> --" << kServerIdFlag << "=<string>" << std::endl;
+            << "=<int> --" << kServerIdFlag << "=<string> [--"
+            << kBlobStoreFlag << "]" << std::endl;
 }
 
 }  // namespace
@@ -45,7 +47,8 @@ namespace benchmark {
 FetchBenchmark::FetchBenchmark(size_t entry_count,
                                size_t value_size,
                                size_t part_size,
-                               std::string server_id)
+                               std::string server_id,
+                               bool blob_store)
     : application_context_(app::ApplicationContext::CreateFromStartupInfo()),
       cloud_provider_firebase_factory_(application_context_.get()),
       sync_watcher_binding_(this),
@@ -53,6 +56,7 @@ FetchBenchmark::FetchBenchmark(size_t entry_count,
       value_size_(value_size),
       part_size_(part_size),
       server_id_(std::move(server_id)),
+      blob_store_(blob_store),
       writer_tmp_dir_(kStoragePath),
       reader_tmp_dir_(kStoragePath) {
   FXL_DCHECK(entry_count > 0);
@@ -71,6 +75,14 @@ void FetchBenchmark::SyncStateChanged(
   callback();
 }
 
+std::vector<std::string> FetchBenchmark::GetLedgerArgs() const {
+  std::vector<std::string> ledger_args;
+  if (blob_store_) {
+    ledger_args.push_back("--blob_store");
+  }
+  return ledger_args;
+}
+
 void FetchBenchmark::Run() {
   // Name of the storage directory currently identifies the user. Ensure the
   // most nested directory has the same name to make the ledgers sync.
@@ -84,7 +96,7 @@ void FetchBenchmark::Run() {
   ledger::Status status = test::GetLedger(
       fsl::MessageLoop::GetCurrent(), application_context_.get(),
       &writer_controller_, std::move(cloud_provider_writer), "fetch",
-      writer_path, &writer_);
+      writer_path, &writer_, GetLedgerArgs());
   QuitOnError(status, "Get writer ledger");
 
   fidl::Array<uint8_t> id;
@@ -166,7 +178,7 @@ void FetchBenchmark::ConnectReader() {
   ledger::Status status = test::GetLedger(
       fsl::MessageLoop::GetCurrent(), application_context_.get(),
       &reader_controller_, std::move(cloud_provider_reader), "fetch",
-      reader_path, &reader_);
+      reader_path, &reader_, GetLedgerArgs());
   QuitOnError(status, "ConnectReader");
 
   fidl::Array<uint8_t> id;
@@ -204,7 +216,11 @@ void FetchBenchmark::WaitForReaderDownload() {
 
 void FetchBenchmark::FetchValues(ledger::PageSnapshotPtr snapshot, size_t i) {
   if (i >= entry_count_) {
-    ShutDown();
+    if (part_size_ > 0) {
+      ShutDown();
+      return;
+    }
+    RefetchValues(std::move(snapshot), 0);
     return;
   }
 
@@ -217,7 +233,7 @@ void FetchBenchmark::FetchValues(ledger::PageSnapshotPtr snapshot, size_t i) {
 
   TRACE_ASYNC_BEGIN("benchmark", "Fetch", i);
   snapshot_ptr->Fetch(
-      std::move(keys_[i]),
+      keys_[i].Clone(),
       fxl::MakeCopyable(
           [this, snapshot = std::move(snapshot), i](
               ledger::Status status, fsl::SizedVmoTransportPtr value) mutable {
@@ -258,6 +274,28 @@ void FetchBenchmark::FetchPart(ledger::PageSnapshotPtr snapshot,
           }));
 }
 
+void FetchBenchmark::RefetchValues(ledger::PageSnapshotPtr snapshot,
+                                   size_t i) {
+  if (i >= entry_count_) {
+    ShutDown();
+    return;
+  }
+  ledger::PageSnapshot* snapshot_ptr = snapshot.get();
+
+  TRACE_ASYNC_BEGIN("benchmark", "Refetch", i);
+  snapshot_ptr->Fetch(
+      keys_[i].Clone(),
+      fxl::MakeCopyable(
+          [this, snapshot = std::move(snapshot), i](
+              ledger::Status status, fsl::SizedVmoTransportPtr value) mutable {
+            if (benchmark::QuitOnError(status, "PageSnapshot::Fetch")) {
+              return;
+            }
+            TRACE_ASYNC_END("benchmark", "Refetch", i);
+            RefetchValues(std::move(snapshot), i + 1);
+          }));
+}
+
 void FetchBenchmark::ShutDown() {
   writer_controller_->Kill();
   writer_controller_.WaitForIncomingResponseWithTimeout(
@@ -298,8 +336,10 @@ int main(int argc, const char** argv) {
     return -1;
   }
 
+  bool blob_store = command_line.HasOption(kBlobStoreFlag);
+
   fsl::MessageLoop loop;
   test::benchmark::FetchBenchmark app(entry_count, value_size, part_size,
-                                      server_id);
+                                      server_id, blob_store);
   return test::benchmark::RunWithTracing(&loop, [&app] { app.Run(); });
 }
@@ -6,6 +6,7 @@
 #define PERIDOT_BIN_LEDGER_TESTS_BENCHMARK_FETCH_FETCH_H_
 
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "lib/app/cpp/application_context.h"
@@ -18,7 +19,9 @@
 namespace test {
 namespace benchmark {
 
-// Benchmark that measures time to fetch lazy values from server.
+// Benchmark that measures time to fetch lazy values from server. When whole
+// values are fetched, they are then fetched a second time, now from local
+// storage.
 // Parameters:
 //   --entry-count=<int> the number of entries to be put
 //   --value-size=<int> the size of a single value in bytes
@@ -26,12 +29,15 @@ namespace benchmark {
 //   call. If equal to zero, the whole value will be read.
 //   --server-id=<string> the ID of the Firebase instance to use for storing
 //   values.
+//   --blob-store - if this flag is specified, Ledger stores large values in
+//   files, from which they are handed out without being copied.
 class FetchBenchmark : public ledger::SyncWatcher {
  public:
   FetchBenchmark(size_t entry_count,
                  size_t value_size,
                  size_t part_size,
-                 std::string server_id);
+                 std::string server_id,
+                 bool blob_store);
 
   void Run();
 
@@ -41,6 +47,9 @@ class FetchBenchmark : public ledger::SyncWatcher {
                         const SyncStateChangedCallback& callback) override;
 
  private:
+  // Returns the command line arguments of the Ledger instances.
+  std::vector<std::string> GetLedgerArgs() const;
+
   void PutEntry(fidl::Array<uint8_t> key,
                 fidl::Array<uint8_t> value,
                 std::function<void(ledger::Status)> put_callback);
@@ -56,6 +65,7 @@ class FetchBenchmark : public ledger::SyncWatcher {
 
   void FetchValues(ledger::PageSnapshotPtr snapshot, size_t i);
   void FetchPart(ledger::PageSnapshotPtr snapshot, size_t i, size_t part);
+  void RefetchValues(ledger::PageSnapshotPtr snapshot, size_t i);
 
   void ShutDown();
 
@@ -67,6 +77,7 @@ class FetchBenchmark : public ledger::SyncWatcher {
   const size_t value_size_;
   const size_t part_size_;
   std::string server_id_;
+  const bool blob_store_;
   files::ScopedTempDir writer_tmp_dir_;
   files::ScopedTempDir reader_tmp_dir_;
   app::ApplicationControllerPtr writer_controller_;
@@ -0,0 +1,213 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "peridot/bin/ledger/tests/benchmark/get_entries/get_entries.h"
+
+#include <iostream>
+
+#include <trace/event.h>
+
+#include "lib/fsl/tasks/message_loop.h"
+#include "lib/fxl/command_line.h"
+#include "lib/fxl/files/directory.h"
+#include "lib/fxl/functional/make_copyable.h"
+#include "lib/fxl/logging.h"
+#include "lib/fxl/strings/string_number_conversions.h"
+#include "peridot/bin/ledger/testing/get_ledger.h"
+#include "peridot/bin/ledger/testing/quit_on_error.h"
+#include "peridot/bin/ledger/testing/run_with_tracing.h"
+
+namespace {
+constexpr fxl::StringView kStoragePath = "/data/benchmark/ledger/get_entries";
+constexpr fxl::StringView kEntryCountFlag = "entry-count";
+constexpr fxl::StringView kValueSizeFlag = "value-size";
+constexpr fxl::StringView kRequestsCountFlag = "requests-count";
+constexpr fxl::StringView kPackedFlag = "packed";
+
+constexpr size_t kKeySize = 64;
+
+void PrintUsage(const char* executable_name) {
+  std::cout << "Usage: " << executable_name << " --" << kEntryCountFlag
+            << "=<int> --" << kValueSizeFlag << "=<int> --"
+            << kRequestsCountFlag << "=<int> [--" << kPackedFlag << "]"
+            << std::endl;
+}
+
+bool GetPositiveIntValue(const fxl::CommandLine& command_line,
+                         fxl::StringView flag,
+                         size_t* value) {
+  std::string value_str;
+  return command_line.GetOptionValue(flag.ToString(), &value_str) &&
+         fxl::StringToNumberWithError(value_str, value) && *value > 0;
+}
+}  // namespace
+
+namespace test {
+namespace benchmark {
+
+GetEntriesBenchmark::GetEntriesBenchmark(size_t entry_count,
+                                         size_t value_size,
+                                         size_t requests_count,
+                                         bool packed)
+    : tmp_dir_(kStoragePath),
+      application_context_(app::ApplicationContext::CreateFromStartupInfo()),
+      entry_count_(entry_count),
+      value_size_(value_size),
+      requests_count_(requests_count),
+      packed_(packed) {
+  FXL_DCHECK(entry_count_ > 0);
+  FXL_DCHECK(value_size_ > 0);
+  FXL_DCHECK(requests_count_ > 0);
+}
+
+void GetEntriesBenchmark::Run() {
+  FXL_LOG(INFO) << "--entry-count=" << entry_count_
+                << " --value-size=" << value_size_
+                << " --requests-count=" << requests_count_
+                << (packed_ ? " --packed" : "");
+  ledger::Status status = test::GetLedger(
+      fsl::MessageLoop::GetCurrent(), application_context_.get(),
+      &application_controller_, nullptr, "get_entries", tmp_dir_.path(),
+      &ledger_);
+  QuitOnError(status, "GetLedger");
+
+  fidl::Array<uint8_t> id;
+  status = test::GetPageEnsureInitialized(fsl::MessageLoop::GetCurrent(),
+                                          &ledger_, nullptr, &page_, &id);
+  QuitOnError(status, "GetPageEnsureInitialized");
+
+  // Populate the page in a single transaction, so that the reads are not
+  // slowed down by the history of the page.
+  page_->StartTransaction([this](ledger::Status status) {
+    if (benchmark::QuitOnError(status, "Page::StartTransaction")) {
+      return;
+    }
+    PutEntry(0);
+  });
+}
+
+void GetEntriesBenchmark::PutEntry(size_t i) {
+  if (i == entry_count_) {
+    CommitAndRead();
+    return;
+  }
+  page_->Put(generator_.MakeKey(static_cast<int>(i), kKeySize),
+             generator_.MakeValue(value_size_),
+             [this, i](ledger::Status status) {
+               if (benchmark::QuitOnError(status, "Page::Put")) {
+                 return;
+               }
+               PutEntry(i + 1);
+             });
+}
+
+void GetEntriesBenchmark::CommitAndRead() {
+  page_->Commit([this](ledger::Status status) {
+    if (benchmark::QuitOnError(status, "Page::Commit")) {
+      return;
+    }
+    page_->GetSnapshot(snapshot_.NewRequest(), nullptr, nullptr,
+                       [this](ledger::Status status) {
+                         if (benchmark::QuitOnError(status,
+                                                    "Page::GetSnapshot")) {
+                           return;
+                         }
+                         RunSingle(0);
+                       });
+  });
+}
+
+void GetEntriesBenchmark::RunSingle(size_t request_number) {
+  if (request_number == requests_count_) {
+    ShutDown();
+    return;
+  }
+
+  TRACE_ASYNC_BEGIN("benchmark", "get all entries", request_number);
+  if (packed_) {
+    GetEntriesPackedPage(request_number, nullptr, 0);
+  } else {
+    GetEntriesPage(request_number, nullptr, 0);
+  }
+}
+
+void GetEntriesBenchmark::GetEntriesPage(size_t request_number,
+                                         fidl::Array<uint8_t> token,
+                                         size_t entries_read) {
+  snapshot_->GetEntries(
+      nullptr, std::move(token),
+      [this, request_number, entries_read](
+          ledger::Status status, fidl::Array<ledger::EntryPtr> entries,
+          fidl::Array<uint8_t> next_token) {
+        if (status != ledger::Status::PARTIAL_RESULT &&
+            benchmark::QuitOnError(status, "PageSnapshot::GetEntries")) {
+          return;
+        }
+        size_t total = entries_read + entries.size();
+        if (next_token) {
+          GetEntriesPage(request_number, std::move(next_token), total);
+          return;
+        }
+        FXL_DCHECK(total == entry_count_);
+        TRACE_ASYNC_END("benchmark", "get all entries", request_number);
+        RunSingle(request_number + 1);
+      });
+}
+
+void GetEntriesBenchmark::GetEntriesPackedPage(size_t request_number,
+                                               fidl::Array<uint8_t> token,
+                                               size_t buffers_read) {
+  snapshot_->GetEntriesPacked(
+      nullptr, std::move(token),
+      [this, request_number, buffers_read](ledger::Status status,
+                                           fsl::SizedVmoTransportPtr buffer,
+                                           fidl::Array<uint8_t> next_token) {
+        if (status != ledger::Status::PARTIAL_RESULT &&
+            benchmark::QuitOnError(status, "PageSnapshot::GetEntriesPacked")) {
+          return;
+        }
+        if (next_token) {
+          GetEntriesPackedPage(request_number, std::move(next_token),
+                               buffers_read + 1);
+          return;
+        }
+        TRACE_ASYNC_END("benchmark", "get all entries", request_number,
+                        "buffers", buffers_read + 1);
+        RunSingle(request_number + 1);
+      });
+}
+
+void GetEntriesBenchmark::ShutDown() {
+  // Shut down the Ledger process first as it relies on |tmp_dir_| storage.
+  application_controller_->Kill();
+  application_controller_.WaitForIncomingResponseWithTimeout(
+      fxl::TimeDelta::FromSeconds(5));
+
+  fsl::MessageLoop::GetCurrent()->PostQuitTask();
+}
+
+}  // namespace benchmark
+}  // namespace test
+
+int main(int argc, const char** argv) {
+  fxl::CommandLine command_line = fxl::CommandLineFromArgcArgv(argc, argv);
+
+  size_t entry_count;
+  size_t value_size;
+  size_t requests_count;
+  if (!GetPositiveIntValue(command_line, kEntryCountFlag, &entry_count) ||
+      !GetPositiveIntValue(command_line, kValueSizeFlag, &value_size) ||
+      !GetPositiveIntValue(command_line, kRequestsCountFlag,
+                           &requests_count)) {
+    PrintUsage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  bool packed = command_line.HasOption(kPackedFlag);
+
+  fsl::MessageLoop loop;
+  test::benchmark::GetEntriesBenchmark app(entry_count, value_size,
+                                           requests_count, packed);
+
+  return test::benchmark::RunWithTracing(&loop, [&app] { app.Run(); });
+}
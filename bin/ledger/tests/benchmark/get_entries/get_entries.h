@@ -0,0 +1,66 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef PERIDOT_BIN_LEDGER_TESTS_BENCHMARK_GET_ENTRIES_GET_ENTRIES_H_
+#define PERIDOT_BIN_LEDGER_TESTS_BENCHMARK_GET_ENTRIES_GET_ENTRIES_H_
+
+#include <memory>
+
+#include "lib/app/cpp/application_context.h"
+#include "lib/fxl/files/scoped_temp_dir.h"
+#include "lib/ledger/fidl/ledger.fidl.h"
+#include "peridot/bin/ledger/testing/data_generator.h"
+
+namespace test {
+namespace benchmark {
+
+// Benchmark that measures the time taken to read all the entries of a page
+// from a snapshot.
+//
+// Parameters:
+//   --entry-count=<int> the number of entries in the page.
+//   --value-size=<int> the size of a single value in bytes.
+//   --requests-count=<int> number of times all entries are read.
+//   --packed - if this flag is specified, the entries are read with
+//   GetEntriesPacked. Otherwise, the paginated GetEntries is used.
+class GetEntriesBenchmark {
+ public:
+  GetEntriesBenchmark(size_t entry_count,
+                      size_t value_size,
+                      size_t requests_count,
+                      bool packed);
+
+  void Run();
+
+ private:
+  void PutEntry(size_t i);
+  void CommitAndRead();
+  void RunSingle(size_t request_number);
+  void GetEntriesPage(size_t request_number,
+                      fidl::Array<uint8_t> token,
+                      size_t entries_read);
+  void GetEntriesPackedPage(size_t request_number,
+                            fidl::Array<uint8_t> token,
+                            size_t buffers_read);
+  void ShutDown();
+
+  files::ScopedTempDir tmp_dir_;
+  test::DataGenerator generator_;
+  std::unique_ptr<app::ApplicationContext> application_context_;
+  const size_t entry_count_;
+  const size_t value_size_;
+  const size_t requests_count_;
+  const bool packed_;
+  app::ApplicationControllerPtr application_controller_;
+  ledger::LedgerPtr ledger_;
+  ledger::PagePtr page_;
+  ledger::PageSnapshotPtr snapshot_;
+
+  FXL_DISALLOW_COPY_AND_ASSIGN(GetEntriesBenchmark);
+};
+
+}  // namespace benchmark
+}  // namespace test
+
+#endif  // PERIDOT_BIN_LEDGER_TESTS_BENCHMARK_GET_ENTRIES_GET_ENTRIES_H_
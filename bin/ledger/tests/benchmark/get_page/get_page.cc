@@ -5,6 +5,8 @@
 #include "peridot/bin/ledger/tests/benchmark/get_page/get_page.h"
 
 #include <iostream>
+#include <string>
+#include <vector>
 
 #include <trace/event.h>
 
@@ -21,28 +23,38 @@ namespace {
 constexpr fxl::StringView kStoragePath = "/data/benchmark/ledger/get_page";
 constexpr fxl::StringView kPageCountFlag = "requests-count";
 constexpr fxl::StringView kReuseFlag = "reuse";
+constexpr fxl::StringView kSharedPageDbFlag = "shared-page-db";
 
 void PrintUsage(const char* executable_name) {
   std::cout << "Usage: " << executable_name << " --" << kPageCountFlag
-            << "=<int> [--" << kReuseFlag << "]" << std::endl;
+            << "=<int> [--" << kReuseFlag << "] [--" << kSharedPageDbFlag
+            << "]" << std::endl;
 }
 }  // namespace
 
 namespace test {
 namespace benchmark {
 
-GetPageBenchmark::GetPageBenchmark(size_t requests_count, bool reuse)
+GetPageBenchmark::GetPageBenchmark(size_t requests_count,
+                                   bool reuse,
+                                   bool shared_page_db)
     : tmp_dir_(kStoragePath),
       application_context_(app::ApplicationContext::CreateFromStartupInfo()),
       requests_count_(requests_count),
-      reuse_(reuse) {
+      reuse_(reuse),
+      shared_page_db_(shared_page_db) {
   FXL_DCHECK(requests_count_ > 0);
 }
 
 void GetPageBenchmark::Run() {
+  std::vector<std::string> ledger_args;
+  if (shared_page_db_) {
+    ledger_args.push_back("--shared_page_db");
+  }
   ledger::Status status = test::GetLedger(
       fsl::MessageLoop::GetCurrent(), application_context_.get(),
-      &application_controller_, nullptr, "get_page", tmp_dir_.path(), &ledger_);
+      &application_controller_, nullptr, "get_page", tmp_dir_.path(), &ledger_,
+      std::move(ledger_args));
   QuitOnError(status, "GetLedger");
   if (reuse_) {
     page_id_ = generator_.MakePageId();
@@ -93,9 +105,11 @@ int main(int argc, const char** argv) {
     return EXIT_FAILURE;
   }
   bool reuse = command_line.HasOption(kReuseFlag);
+  bool shared_page_db = command_line.HasOption(kSharedPageDbFlag);
 
   fsl::MessageLoop loop;
-  test::benchmark::GetPageBenchmark app(requests_count, reuse);
+  test::benchmark::GetPageBenchmark app(requests_count, reuse,
+                                        shared_page_db);
 
   return test::benchmark::RunWithTracing(&loop, [&app] { app.Run(); });
 }
@@ -19,9 +19,11 @@ namespace benchmark {
 //   --requests-count=<int> number of requests made.
 //   --reuse - if this flag is specified, the same id will be used. Otherwise, a
 //   new page with a random id is requested every time.
+//   --shared-page-db - if this flag is specified, Ledger stores all the pages
+//   in a single database.
 class GetPageBenchmark {
  public:
-  GetPageBenchmark(size_t requests_count, bool reuse);
+  GetPageBenchmark(size_t requests_count, bool reuse, bool shared_page_db);
 
   void Run();
 
@@ -34,6 +36,7 @@ class GetPageBenchmark {
   std::unique_ptr<app::ApplicationContext> application_context_;
   const size_t requests_count_;
   const bool reuse_;
+  const bool shared_page_db_;
   app::ApplicationControllerPtr application_controller_;
   ledger::LedgerPtr ledger_;
   fidl::Array<uint8_t> page_id_;
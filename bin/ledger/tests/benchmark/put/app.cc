@@ -20,6 +20,10 @@ constexpr fxl::StringView kValueSizeFlag = "value-size";
 constexpr fxl::StringView kRefsFlag = "refs";
 constexpr fxl::StringView kUpdateFlag = "update";
 constexpr fxl::StringView kSeedFlag = "seed";
+constexpr fxl::StringView kImplicitCommitWindowFlag =
+    "implicit-commit-window-ms";
+constexpr fxl::StringView kCompressibleValuesFlag = "compressible-values";
+constexpr fxl::StringView kCompressPiecesFlag = "compress-pieces";
 
 constexpr fxl::StringView kRefsOnFlag = "on";
 constexpr fxl::StringView kRefsOffFlag = "off";
@@ -31,7 +35,9 @@ void PrintUsage(const char* executable_name) {
             << kKeySizeFlag << "=<int> --" << kValueSizeFlag << "=<int> --"
             << kRefsFlag << "=(" << kRefsOnFlag << "|" << kRefsOffFlag << "|"
             << kRefsAutoFlag << ") [" << kSeedFlag << "=<int>] [--"
-            << kUpdateFlag << "]" << std::endl;
+            << kUpdateFlag << "] [--" << kImplicitCommitWindowFlag
+            << "=<int>] [--" << kCompressibleValuesFlag << "] [--"
+            << kCompressPiecesFlag << "]" << std::endl;
 }
 
 bool GetPositiveIntValue(const fxl::CommandLine& command_line,
@@ -59,6 +65,9 @@ int main(int argc, const char** argv) {
   int key_size;
   int value_size;
   bool update = command_line.HasOption(kUpdateFlag.ToString());
+  bool compressible_values =
+      command_line.HasOption(kCompressibleValuesFlag.ToString());
+  bool compress_pieces = command_line.HasOption(kCompressPiecesFlag.ToString());
   if (!GetPositiveIntValue(command_line, kEntryCountFlag, &entry_count) ||
       !command_line.GetOptionValue(kTransactionSizeFlag.ToString(),
                                    &transaction_size_str) ||
@@ -100,9 +109,23 @@ int main(int argc, const char** argv) {
     seed = fxl::RandUint64();
   }
 
+  int implicit_commit_window_ms = -1;
+  std::string implicit_commit_window_str;
+  if (command_line.GetOptionValue(kImplicitCommitWindowFlag.ToString(),
+                                  &implicit_commit_window_str)) {
+    if (!fxl::StringToNumberWithError(implicit_commit_window_str,
+                                      &implicit_commit_window_ms) ||
+        implicit_commit_window_ms < 0) {
+      PrintUsage(argv[0]);
+      return -1;
+    }
+  }
+
   fsl::MessageLoop loop;
   test::benchmark::PutBenchmark app(entry_count, transaction_size, key_size,
-                                    value_size, update, ref_strategy, seed);
+                                    value_size, update, ref_strategy, seed,
+                                    implicit_commit_window_ms,
+                                    compressible_values, compress_pieces);
 
   return test::benchmark::RunWithTracing(&loop, [&app] { app.Run(); });
 }
@@ -31,7 +31,10 @@ PutBenchmark::PutBenchmark(int entry_count,
                            int value_size,
                            bool update,
                            ReferenceStrategy reference_strategy,
-                           uint64_t seed)
+                           uint64_t seed,
+                           int implicit_commit_window_ms,
+                           bool compressible_values,
+                           bool compress_pieces)
     : generator_(seed),
       tmp_dir_(kStoragePath),
       application_context_(app::ApplicationContext::CreateFromStartupInfo()),
@@ -40,6 +43,9 @@ PutBenchmark::PutBenchmark(int entry_count,
       key_size_(key_size),
       value_size_(value_size),
       update_(update),
+      implicit_commit_window_ms_(implicit_commit_window_ms),
+      compressible_values_(compressible_values),
+      compress_pieces_(compress_pieces),
       page_watcher_binding_(this) {
   FXL_DCHECK(entry_count > 0);
   FXL_DCHECK(transaction_size >= 0);
@@ -65,11 +71,24 @@ void PutBenchmark::Run() {
                 << " --transaction-size=" << transaction_size_
                 << " --key-size=" << key_size_
                 << " --value-size=" << value_size_
-                << (update_ ? " --update" : "");
+                << (update_ ? " --update" : "")
+                << (compressible_values_ ? " --compressible-values" : "");
+  std::vector<std::string> ledger_args;
+  if (implicit_commit_window_ms_ >= 0) {
+    FXL_LOG(INFO) << "--implicit-commit-window-ms="
+                  << implicit_commit_window_ms_;
+    ledger_args.push_back("--implicit_commit_window_ms=" +
+                          std::to_string(implicit_commit_window_ms_));
+  }
+  if (compress_pieces_) {
+    FXL_LOG(INFO) << "--compress-pieces";
+    ledger_args.push_back("--compress_pieces");
+  }
   ledger::LedgerPtr ledger;
   ledger::Status status = test::GetLedger(
       fsl::MessageLoop::GetCurrent(), application_context_.get(),
-      &application_controller_, nullptr, "put", tmp_dir_.path(), &ledger);
+      &application_controller_, nullptr, "put", tmp_dir_.path(), &ledger,
+      std::move(ledger_args));
   QuitOnError(status, "GetLedger");
 
   fidl::Array<uint8_t> id;
@@ -163,7 +182,7 @@ void PutBenchmark::AddInitialEntries(
     on_done(std::move(keys));
     return;
   }
-  fidl::Array<uint8_t> value = generator_.MakeValue(value_size_);
+  fidl::Array<uint8_t> value = MakeValue();
   PutEntry(keys[i].Clone(), std::move(value),
            fxl::MakeCopyable(
                [this, i, keys = std::move(keys),
@@ -184,17 +203,41 @@ void PutBenchmark::BindWatcher(std::vector<fidl::Array<uint8_t>> keys) {
             if (benchmark::QuitOnError(status, "GetSnapshot")) {
               return;
             }
+            if (transaction_size_ == 0 && implicit_commit_window_ms_ >= 0) {
+              RunPipelined(std::move(keys));
+              return;
+            }
             RunSingle(0, std::move(keys));
           }));
 }
 
+void PutBenchmark::RunPipelined(std::vector<fidl::Array<uint8_t>> keys) {
+  TRACE_ASYNC_BEGIN("benchmark", "all_puts", 0);
+  for (int i = 0; i < entry_count_; ++i) {
+    fidl::Array<uint8_t> value = MakeValue();
+    size_t key_number = std::stoul(convert::ToString(keys[i]));
+    TRACE_ASYNC_BEGIN("benchmark", "local_change_notification", key_number);
+    TRACE_ASYNC_BEGIN("benchmark", "put", i);
+    PutEntry(std::move(keys[i]), std::move(value),
+             [this, i](ledger::Status status) {
+               if (benchmark::QuitOnError(status, "Page::Put")) {
+                 return;
+               }
+               TRACE_ASYNC_END("benchmark", "put", i);
+               if (++completed_put_count_ == entry_count_) {
+                 TRACE_ASYNC_END("benchmark", "all_puts", 0);
+               }
+             });
+  }
+}
+
 void PutBenchmark::RunSingle(int i, std::vector<fidl::Array<uint8_t>> keys) {
   if (i == entry_count_) {
     // All sent, waiting for watcher notification before shutting down.
     return;
   }
 
-  fidl::Array<uint8_t> value = generator_.MakeValue(value_size_);
+  fidl::Array<uint8_t> value = MakeValue();
   size_t key_number = std::stoul(convert::ToString(keys[i]));
   if (transaction_size_ == 0) {
     TRACE_ASYNC_BEGIN("benchmark", "local_change_notification", key_number);
@@ -246,6 +289,13 @@ void PutBenchmark::CommitAndRunNext(int i,
   }));
 }
 
+fidl::Array<uint8_t> PutBenchmark::MakeValue() {
+  if (compressible_values_) {
+    return generator_.MakeCompressibleValue(value_size_);
+  }
+  return generator_.MakeValue(value_size_);
+}
+
 void PutBenchmark::ShutDown() {
   // Shut down the Ledger process first as it relies on |tmp_dir_| storage.
   application_controller_->Kill();
@@ -32,6 +32,15 @@ namespace benchmark {
 //   --update whether operations will update existing entries (put with existing
 //     keys and new values)
 //   --seed=<int> (optional) the seed for key and value generation
+//   --implicit-commit-window-ms=<int> (optional) the window during which
+//     Ledger coalesces the changes made outside of transactions; 0 disables
+//     coalescing. When set, and without transactions, all puts are sent without
+//     waiting for the previous ones to complete, and the "all_puts" event
+//     measures the time needed to complete all of them.
+//   --compressible-values (optional) whether the values are JSON-like data that
+//     compresses well, instead of random bytes
+//   --compress-pieces (optional) whether Ledger compresses the pieces of the
+//     values it stores
 class PutBenchmark : public ledger::PageWatcher {
  public:
   enum class ReferenceStrategy {
@@ -46,7 +55,10 @@ class PutBenchmark : public ledger::PageWatcher {
                int value_size,
                bool update,
                ReferenceStrategy reference_strategy,
-               uint64_t seed);
+               uint64_t seed,
+               int implicit_commit_window_ms = -1,
+               bool compressible_values = false,
+               bool compress_pieces = false);
 
   void Run();
 
@@ -75,10 +87,15 @@ class PutBenchmark : public ledger::PageWatcher {
 
   void BindWatcher(std::vector<fidl::Array<uint8_t>> keys);
   void RunSingle(int i, std::vector<fidl::Array<uint8_t>> keys);
+  // Sends all the puts without waiting for their results.
+  void RunPipelined(std::vector<fidl::Array<uint8_t>> keys);
   void CommitAndRunNext(int i,
                         size_t key_number,
                         std::vector<fidl::Array<uint8_t>> keys);
 
+  // Builds a value of |value_size_| bytes.
+  fidl::Array<uint8_t> MakeValue();
+
   void ShutDown();
 
   test::DataGenerator generator_;
@@ -90,6 +107,11 @@ class PutBenchmark : public ledger::PageWatcher {
   const int key_size_;
   const int value_size_;
   const bool update_;
+  // Negative if the Ledger default is used.
+  const int implicit_commit_window_ms_;
+  const bool compressible_values_;
+  const bool compress_pieces_;
+  int completed_put_count_ = 0;
 
   fidl::Binding<ledger::PageWatcher> page_watcher_binding_;
   std::function<bool(size_t)> should_put_as_reference_;
@@ -0,0 +1,183 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "peridot/bin/ledger/tests/benchmark/responsiveness/responsiveness.h"
+
+#include <iostream>
+
+#include <trace/event.h>
+
+#include "lib/fsl/tasks/message_loop.h"
+#include "lib/fsl/vmo/strings.h"
+#include "lib/fxl/command_line.h"
+#include "lib/fxl/functional/make_copyable.h"
+#include "lib/fxl/logging.h"
+#include "lib/fxl/strings/string_number_conversions.h"
+#include "peridot/bin/ledger/testing/get_ledger.h"
+#include "peridot/bin/ledger/testing/quit_on_error.h"
+#include "peridot/bin/ledger/testing/run_with_tracing.h"
+#include "peridot/lib/callback/waiter.h"
+#include "peridot/lib/convert/convert.h"
+
+namespace {
+constexpr fxl::StringView kStoragePath =
+    "/data/benchmark/ledger/responsiveness";
+constexpr fxl::StringView kEntryCountFlag = "entry-count";
+constexpr fxl::StringView kValueSizeFlag = "value-size";
+
+constexpr size_t kKeySize = 100;
+constexpr size_t kPingValueSize = 10;
+
+void PrintUsage(const char* executable_name) {
+  std::cout << "Usage: " << executable_name << " --" << kEntryCountFlag
+            << "=<int> --" << kValueSizeFlag << "=<int>" << std::endl;
+}
+
+}  // namespace
+
+namespace test {
+namespace benchmark {
+
+ResponsivenessBenchmark::ResponsivenessBenchmark(size_t entry_count,
+                                                 size_t value_size)
+    : tmp_dir_(kStoragePath),
+      application_context_(app::ApplicationContext::CreateFromStartupInfo()),
+      entry_count_(entry_count),
+      value_size_(value_size) {
+  FXL_DCHECK(entry_count_ > 0);
+  FXL_DCHECK(value_size_ > 0);
+}
+
+void ResponsivenessBenchmark::Run() {
+  ledger::LedgerPtr ledger;
+  ledger::Status status =
+      test::GetLedger(fsl::MessageLoop::GetCurrent(),
+                      application_context_.get(), &application_controller_,
+                      nullptr, "responsiveness", tmp_dir_.path(), &ledger);
+  QuitOnError(status, "GetLedger");
+
+  fidl::Array<uint8_t> id;
+  status = test::GetPageEnsureInitialized(fsl::MessageLoop::GetCurrent(),
+                                          &ledger, nullptr, &write_page_, &id);
+  QuitOnError(status, "Page initialization");
+  status = test::GetPageEnsureInitialized(fsl::MessageLoop::GetCurrent(),
+                                          &ledger, nullptr, &ping_page_, &id);
+  QuitOnError(status, "Page initialization");
+
+  RunBulkWrite();
+  Ping(0);
+}
+
+void ResponsivenessBenchmark::RunBulkWrite() {
+  TRACE_ASYNC_BEGIN("benchmark", "bulk_write", 0);
+  write_page_->StartTransaction([this](ledger::Status status) {
+    if (benchmark::QuitOnError(status, "Page::StartTransaction")) {
+      return;
+    }
+    auto waiter =
+        callback::StatusWaiter<ledger::Status>::Create(ledger::Status::OK);
+    for (size_t i = 0; i < entry_count_; i++) {
+      PutEntry(generator_.MakeKey(i, kKeySize),
+               generator_.MakeValue(value_size_), waiter->NewCallback());
+    }
+    waiter->Finalize([this](ledger::Status status) {
+      if (benchmark::QuitOnError(status, "Page::Put")) {
+        return;
+      }
+      write_page_->Commit([this](ledger::Status status) {
+        if (benchmark::QuitOnError(status, "Page::Commit")) {
+          return;
+        }
+        TRACE_ASYNC_END("benchmark", "bulk_write", 0);
+        bulk_write_done_ = true;
+      });
+    });
+  });
+}
+
+void ResponsivenessBenchmark::PutEntry(
+    fidl::Array<uint8_t> key,
+    fidl::Array<uint8_t> value,
+    std::function<void(ledger::Status)> put_callback) {
+  fsl::SizedVmo vmo;
+  FXL_CHECK(fsl::VmoFromString(convert::ToStringView(value), &vmo));
+  write_page_->CreateReferenceFromVmo(
+      std::move(vmo).ToTransport(),
+      fxl::MakeCopyable(
+          [this, key = std::move(key), put_callback = std::move(put_callback)](
+              ledger::Status status, ledger::ReferencePtr reference) mutable {
+            if (benchmark::QuitOnError(status,
+                                       "Page::CreateReferenceFromVmo")) {
+              return;
+            }
+            write_page_->PutReference(std::move(key), std::move(reference),
+                                      ledger::Priority::EAGER, put_callback);
+          }));
+}
+
+void ResponsivenessBenchmark::Ping(size_t i) {
+  if (bulk_write_done_) {
+    ShutDown();
+    return;
+  }
+
+  // |GetId| does not access storage: its latency is the time the request
+  // waits for the main loop of Ledger.
+  TRACE_ASYNC_BEGIN("benchmark", "main_loop_ping", i);
+  ping_page_->GetId([this, i](fidl::Array<uint8_t> id) {
+    TRACE_ASYNC_END("benchmark", "main_loop_ping", i);
+    StoragePing(i);
+  });
+}
+
+void ResponsivenessBenchmark::StoragePing(size_t i) {
+  // |Put| returns once the entry is written to the database of the page: its
+  // latency is the time a small write waits for storage.
+  TRACE_ASYNC_BEGIN("benchmark", "storage_ping", i);
+  ping_page_->Put(generator_.MakeKey(i, kKeySize),
+                  generator_.MakeValue(kPingValueSize),
+                  [this, i](ledger::Status status) {
+                    if (benchmark::QuitOnError(status, "Page::Put")) {
+                      return;
+                    }
+                    TRACE_ASYNC_END("benchmark", "storage_ping", i);
+                    Ping(i + 1);
+                  });
+}
+
+void ResponsivenessBenchmark::ShutDown() {
+  application_controller_->Kill();
+  application_controller_.WaitForIncomingResponseWithTimeout(
+      fxl::TimeDelta::FromSeconds(5));
+
+  fsl::MessageLoop::GetCurrent()->PostQuitTask();
+}
+
+}  // namespace benchmark
+}  // namespace test
+
+int main(int argc, const char** argv) {
+  fxl::CommandLine command_line = fxl::CommandLineFromArgcArgv(argc, argv);
+
+  std::string entry_count_str;
+  size_t entry_count;
+  std::string value_size_str;
+  size_t value_size;
+  if (!command_line.GetOptionValue(kEntryCountFlag.ToString(),
+                                   &entry_count_str) ||
+      !fxl::StringToNumberWithError(entry_count_str, &entry_count) ||
+      entry_count == 0 ||
+      !command_line.GetOptionValue(kValueSizeFlag.ToString(),
+                                   &value_size_str) ||
+      !fxl::StringToNumberWithError(value_size_str, &value_size) ||
+      value_size == 0) {
+    PrintUsage(argv[0]);
+    return -1;
+  }
+
+  fsl::MessageLoop loop;
+  test::benchmark::ResponsivenessBenchmark app(entry_count, value_size);
+
+  return test::benchmark::RunWithTracing(&loop, [&app] { app.Run(); });
+}
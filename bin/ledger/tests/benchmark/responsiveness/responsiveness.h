@@ -0,0 +1,61 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef PERIDOT_BIN_LEDGER_TESTS_BENCHMARK_RESPONSIVENESS_RESPONSIVENESS_H_
+#define PERIDOT_BIN_LEDGER_TESTS_BENCHMARK_RESPONSIVENESS_RESPONSIVENESS_H_
+
+#include <memory>
+
+#include "lib/app/cpp/application_context.h"
+#include "lib/fxl/files/scoped_temp_dir.h"
+#include "lib/ledger/fidl/ledger.fidl.h"
+#include "peridot/bin/ledger/testing/data_generator.h"
+
+namespace test {
+namespace benchmark {
+
+// Benchmark that measures how responsive Ledger stays while it writes a large
+// amount of data to disk.
+//
+// A single transaction putting |entry_count| entries is committed on a first
+// page, while a trivial request and a small put are repeatedly sent to a second
+// page until the commit is done. The latency of the trivial requests reflects
+// how long the main loop of Ledger is blocked by the writes, and the latency of
+// the puts how long the accesses to storage of other pages wait for them.
+//
+// Parameters:
+//   --entry-count=<int> the number of entries to be put in the transaction
+//   --value-size=<int> the size of a single value in bytes
+class ResponsivenessBenchmark {
+ public:
+  ResponsivenessBenchmark(size_t entry_count, size_t value_size);
+
+  void Run();
+
+ private:
+  void RunBulkWrite();
+  void PutEntry(fidl::Array<uint8_t> key,
+                fidl::Array<uint8_t> value,
+                std::function<void(ledger::Status)> put_callback);
+  void Ping(size_t i);
+  void StoragePing(size_t i);
+  void ShutDown();
+
+  files::ScopedTempDir tmp_dir_;
+  test::DataGenerator generator_;
+  std::unique_ptr<app::ApplicationContext> application_context_;
+  const size_t entry_count_;
+  const size_t value_size_;
+  app::ApplicationControllerPtr application_controller_;
+  ledger::PagePtr write_page_;
+  ledger::PagePtr ping_page_;
+  bool bulk_write_done_ = false;
+
+  FXL_DISALLOW_COPY_AND_ASSIGN(ResponsivenessBenchmark);
+};
+
+}  // namespace benchmark
+}  // namespace test
+
+#endif  // PERIDOT_BIN_LEDGER_TESTS_BENCHMARK_RESPONSIVENESS_RESPONSIVENESS_H_
@@ -10,4 +10,15 @@
 set -e
 
 /system/bin/trace record --spec-file=/system/data/ledger/benchmark/put.tspec
+/system/bin/trace record --spec-file=/system/data/ledger/benchmark/put_compressible.tspec
+/system/bin/trace record --spec-file=/system/data/ledger/benchmark/put_compressed.tspec
+/system/bin/trace record --spec-file=/system/data/ledger/benchmark/implicit_commit_window_off.tspec
+/system/bin/trace record --spec-file=/system/data/ledger/benchmark/implicit_commit_window.tspec
 /system/bin/trace record --spec-file=/system/data/ledger/benchmark/transaction.tspec
+/system/bin/trace record --spec-file=/system/data/ledger/benchmark/transaction_10k.tspec
+/system/bin/trace record --spec-file=/system/data/ledger/benchmark/split.tspec
+/system/bin/trace record --spec-file=/system/data/ledger/benchmark/split_pipelined.tspec
+/system/bin/trace record --spec-file=/system/data/ledger/benchmark/get_entries.tspec
+/system/bin/trace record --spec-file=/system/data/ledger/benchmark/get_entries_packed.tspec
+/system/bin/trace record --spec-file=/system/data/ledger/benchmark/responsiveness.tspec
+/system/bin/trace record --spec-file=/system/data/ledger/benchmark/add_new_page_shared_db.tspec
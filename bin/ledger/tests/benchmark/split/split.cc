@@ -0,0 +1,127 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "peridot/bin/ledger/tests/benchmark/split/split.h"
+
+#include <iostream>
+
+#include <trace/event.h>
+
+#include "lib/fsl/tasks/message_loop.h"
+#include "lib/fsl/threading/create_thread.h"
+#include "lib/fxl/command_line.h"
+#include "lib/fxl/logging.h"
+#include "lib/fxl/strings/string_number_conversions.h"
+#include "lib/fxl/time/time_point.h"
+#include "peridot/bin/ledger/storage/impl/split.h"
+#include "peridot/bin/ledger/storage/public/make_object_identifier.h"
+#include "peridot/bin/ledger/testing/run_with_tracing.h"
+#include "peridot/lib/convert/convert.h"
+
+namespace {
+constexpr fxl::StringView kValueSizeFlag = "value-size";
+constexpr fxl::StringView kCountFlag = "count";
+constexpr fxl::StringView kPipelinedFlag = "pipelined";
+
+void PrintUsage(const char* executable_name) {
+  std::cout << "Usage: " << executable_name << " --" << kValueSizeFlag
+            << "=<int> --" << kCountFlag << "=<int> [--" << kPipelinedFlag
+            << "]" << std::endl;
+}
+
+}  // namespace
+
+namespace test {
+namespace benchmark {
+
+SplitBenchmark::SplitBenchmark(size_t value_size, size_t count, bool pipelined)
+    : value_size_(value_size), count_(count) {
+  FXL_DCHECK(value_size_ > 0);
+  FXL_DCHECK(count_ > 0);
+  if (pipelined) {
+    digest_thread_ = fsl::CreateThread(&digest_runner_, "digest thread");
+  }
+}
+
+SplitBenchmark::~SplitBenchmark() {
+  if (digest_thread_.joinable()) {
+    digest_runner_->PostTask(
+        [] { fsl::MessageLoop::GetCurrent()->QuitNow(); });
+    digest_thread_.join();
+  }
+}
+
+void SplitBenchmark::Run() {
+  value_ = convert::ToString(generator_.MakeValue(value_size_));
+  RunSingle(0);
+}
+
+void SplitBenchmark::RunSingle(size_t i) {
+  if (i == count_) {
+    ShutDown();
+    return;
+  }
+
+  source_ = storage::DataSource::Create(value_);
+  fxl::TimePoint start = fxl::TimePoint::Now();
+  TRACE_ASYNC_BEGIN("benchmark", "split", i);
+  storage::SplitDataSource(
+      source_.get(), fsl::MessageLoop::GetCurrent()->task_runner(),
+      digest_runner_,
+      [this, i, start](storage::IterationStatus status,
+                       storage::ObjectDigest object_digest,
+                       std::unique_ptr<storage::DataSource::DataChunk> chunk) {
+        if (status == storage::IterationStatus::ERROR) {
+          FXL_LOG(ERROR) << "Unable to split the value.";
+          ShutDown();
+          return storage::ObjectIdentifier();
+        }
+        if (status == storage::IterationStatus::DONE) {
+          TRACE_ASYNC_END("benchmark", "split", i);
+          total_duration_ = total_duration_ + (fxl::TimePoint::Now() - start);
+          fsl::MessageLoop::GetCurrent()->task_runner()->PostTask(
+              [this, i] { RunSingle(i + 1); });
+        }
+        return storage::MakeDefaultObjectIdentifier(std::move(object_digest));
+      });
+}
+
+void SplitBenchmark::ShutDown() {
+  double seconds = total_duration_.ToSecondsF();
+  if (seconds > 0) {
+    double megabytes =
+        static_cast<double>(value_size_) * count_ / (1024 * 1024);
+    FXL_LOG(INFO) << "Split " << megabytes << " MB at " << megabytes / seconds
+                  << " MB/s (" << (digest_runner_ ? "pipelined" : "single")
+                  << ")";
+  }
+  fsl::MessageLoop::GetCurrent()->PostQuitTask();
+}
+
+}  // namespace benchmark
+}  // namespace test
+
+int main(int argc, const char** argv) {
+  fxl::CommandLine command_line = fxl::CommandLineFromArgcArgv(argc, argv);
+
+  std::string value_size_str;
+  size_t value_size;
+  std::string count_str;
+  size_t count;
+  if (!command_line.GetOptionValue(kValueSizeFlag.ToString(),
+                                   &value_size_str) ||
+      !fxl::StringToNumberWithError(value_size_str, &value_size) ||
+      value_size == 0 ||
+      !command_line.GetOptionValue(kCountFlag.ToString(), &count_str) ||
+      !fxl::StringToNumberWithError(count_str, &count) || count == 0) {
+    PrintUsage(argv[0]);
+    return -1;
+  }
+  bool pipelined = command_line.HasOption(kPipelinedFlag.ToString());
+
+  fsl::MessageLoop loop;
+  test::benchmark::SplitBenchmark app(value_size, count, pipelined);
+
+  return test::benchmark::RunWithTracing(&loop, [&app] { app.Run(); });
+}
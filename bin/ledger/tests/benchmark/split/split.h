@@ -0,0 +1,55 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef PERIDOT_BIN_LEDGER_TESTS_BENCHMARK_SPLIT_SPLIT_H_
+#define PERIDOT_BIN_LEDGER_TESTS_BENCHMARK_SPLIT_SPLIT_H_
+
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "lib/fxl/macros.h"
+#include "lib/fxl/memory/ref_ptr.h"
+#include "lib/fxl/tasks/task_runner.h"
+#include "lib/fxl/time/time_delta.h"
+#include "peridot/bin/ledger/storage/public/data_source.h"
+#include "peridot/bin/ledger/testing/data_generator.h"
+
+namespace test {
+namespace benchmark {
+
+// Benchmark that measures the time taken to split a value in pieces and to
+// compute the digests of the pieces.
+//
+// Parameters:
+//   --value-size=<int> the size of the value to split, in bytes
+//   --count=<int> the number of times the value is split
+//   --pipelined=<bool> whether the digests are computed on a separate thread
+class SplitBenchmark {
+ public:
+  SplitBenchmark(size_t value_size, size_t count, bool pipelined);
+  ~SplitBenchmark();
+
+  void Run();
+
+ private:
+  void RunSingle(size_t i);
+  void ShutDown();
+
+  test::DataGenerator generator_;
+  const size_t value_size_;
+  const size_t count_;
+  std::thread digest_thread_;
+  fxl::RefPtr<fxl::TaskRunner> digest_runner_;
+  std::string value_;
+  std::unique_ptr<storage::DataSource> source_;
+  fxl::TimeDelta total_duration_;
+
+  FXL_DISALLOW_COPY_AND_ASSIGN(SplitBenchmark);
+};
+
+}  // namespace benchmark
+}  // namespace test
+
+#endif  // PERIDOT_BIN_LEDGER_TESTS_BENCHMARK_SPLIT_SPLIT_H_
@@ -13,6 +13,7 @@
 #include "lib/fxl/macros.h"
 #include "lib/ledger/fidl/ledger.fidl.h"
 #include "peridot/bin/ledger/app/constants.h"
+#include "peridot/bin/ledger/app/fidl/packed_entries.h"
 #include "peridot/bin/ledger/app/fidl/serialization_size.h"
 #include "peridot/bin/ledger/tests/integration/integration_test.h"
 #include "peridot/bin/ledger/tests/integration/test_utils.h"
@@ -358,6 +359,202 @@ TEST_F(PageSnapshotIntegrationTest, PageSnapshotGetEntries) {
   EXPECT_EQ(0u, entries.size());
 }
 
+TEST_F(PageSnapshotIntegrationTest, PageSnapshotGetEntriesPacked) {
+  auto instance = NewLedgerAppInstance();
+  ledger::PagePtr page = instance->GetTestPage();
+
+  const size_t N = 4;
+  fidl::Array<uint8_t> keys[N] = {
+      RandomArray(20, {0, 0, 0}),
+      RandomArray(20, {0, 0, 1}),
+      RandomArray(20, {0, 1, 0}),
+      RandomArray(20, {0, 1, 1}),
+  };
+  fidl::Array<uint8_t> values[N] = {
+      RandomArray(50),
+      RandomArray(50),
+      RandomArray(50),
+      RandomArray(50),
+  };
+  for (size_t i = 0; i < N; ++i) {
+    page->Put(keys[i].Clone(), values[i].Clone(), [](ledger::Status status) {
+      EXPECT_EQ(status, ledger::Status::OK);
+    });
+    EXPECT_TRUE(page.WaitForIncomingResponse());
+  }
+  ledger::PageSnapshotPtr snapshot = PageGetSnapshot(&page);
+
+  ledger::Status status;
+  fsl::SizedVmoTransportPtr buffer;
+  fidl::Array<uint8_t> next_token;
+  snapshot->GetEntriesPacked(
+      fidl::Array<uint8_t>(), nullptr,
+      callback::Capture([] {}, &status, &buffer, &next_token));
+  EXPECT_TRUE(snapshot.WaitForIncomingResponse());
+  EXPECT_EQ(ledger::Status::OK, status);
+  EXPECT_TRUE(next_token.is_null());
+  ASSERT_TRUE(buffer);
+
+  std::string content;
+  ASSERT_TRUE(fsl::StringFromVmo(buffer, &content));
+  std::vector<ledger::packed_entries::PackedEntry> entries;
+  ASSERT_TRUE(ledger::packed_entries::Parse(content, &entries));
+  ASSERT_EQ(N, entries.size());
+  for (size_t i = 0; i < N; ++i) {
+    EXPECT_EQ(convert::ToString(keys[i]), entries[i].key.ToString());
+    EXPECT_EQ(convert::ToString(values[i]), entries[i].value.ToString());
+    EXPECT_EQ(ledger::Priority::EAGER, entries[i].priority);
+    EXPECT_FALSE(entries[i].value_missing);
+  }
+
+  // Start from the third key.
+  snapshot->GetEntriesPacked(
+      keys[2].Clone(), nullptr,
+      callback::Capture([] {}, &status, &buffer, &next_token));
+  EXPECT_TRUE(snapshot.WaitForIncomingResponse());
+  EXPECT_EQ(ledger::Status::OK, status);
+  ASSERT_TRUE(fsl::StringFromVmo(buffer, &content));
+  ASSERT_TRUE(ledger::packed_entries::Parse(content, &entries));
+  ASSERT_EQ(2u, entries.size());
+  EXPECT_EQ(convert::ToString(keys[2]), entries[0].key.ToString());
+  EXPECT_EQ(convert::ToString(keys[3]), entries[1].key.ToString());
+}
+
+TEST_F(PageSnapshotIntegrationTest, PageSnapshotGetEntriesPackedMultiPartSize) {
+  auto instance = NewLedgerAppInstance();
+  ledger::PagePtr page = instance->GetTestPage();
+
+  // Three values of 6 MiB: only two of them fit in a 16 MiB buffer.
+  const size_t N = 3;
+  const size_t value_size = 6 * 1024 * 1024;
+  fidl::Array<uint8_t> keys[N] = {
+      RandomArray(20, {0}),
+      RandomArray(20, {1}),
+      RandomArray(20, {2}),
+  };
+  const std::string values[N] = {
+      std::string(value_size, 'a'),
+      std::string(value_size, 'b'),
+      std::string(value_size, 'c'),
+  };
+  for (size_t i = 0; i < N; ++i) {
+    fsl::SizedVmo vmo;
+    ASSERT_TRUE(fsl::VmoFromString(values[i], &vmo));
+    ledger::ReferencePtr reference;
+    page->CreateReferenceFromVmo(
+        std::move(vmo).ToTransport(),
+        [&reference](ledger::Status status, ledger::ReferencePtr ref) {
+          EXPECT_EQ(ledger::Status::OK, status);
+          reference = std::move(ref);
+        });
+    ASSERT_TRUE(page.WaitForIncomingResponse());
+    page->PutReference(keys[i].Clone(), std::move(reference),
+                       ledger::Priority::EAGER, [](ledger::Status status) {
+                         EXPECT_EQ(ledger::Status::OK, status);
+                       });
+    ASSERT_TRUE(page.WaitForIncomingResponse());
+  }
+  ledger::PageSnapshotPtr snapshot = PageGetSnapshot(&page);
+
+  ledger::Status status;
+  fsl::SizedVmoTransportPtr buffer;
+  fidl::Array<uint8_t> next_token;
+  snapshot->GetEntriesPacked(
+      fidl::Array<uint8_t>(), nullptr,
+      callback::Capture([] {}, &status, &buffer, &next_token));
+  EXPECT_TRUE(snapshot.WaitForIncomingResponse());
+  EXPECT_EQ(ledger::Status::PARTIAL_RESULT, status);
+  EXPECT_EQ(convert::ToString(keys[2]), convert::ToString(next_token));
+
+  std::string content;
+  ASSERT_TRUE(fsl::StringFromVmo(buffer, &content));
+  std::vector<ledger::packed_entries::PackedEntry> entries;
+  ASSERT_TRUE(ledger::packed_entries::Parse(content, &entries));
+  ASSERT_EQ(2u, entries.size());
+  for (size_t i = 0; i < 2; ++i) {
+    EXPECT_EQ(convert::ToString(keys[i]), entries[i].key.ToString());
+    EXPECT_EQ(values[i], entries[i].value.ToString());
+  }
+
+  // Continue from the token.
+  snapshot->GetEntriesPacked(
+      fidl::Array<uint8_t>(), std::move(next_token),
+      callback::Capture([] {}, &status, &buffer, &next_token));
+  EXPECT_TRUE(snapshot.WaitForIncomingResponse());
+  EXPECT_EQ(ledger::Status::OK, status);
+  EXPECT_TRUE(next_token.is_null());
+  ASSERT_TRUE(fsl::StringFromVmo(buffer, &content));
+  ASSERT_TRUE(ledger::packed_entries::Parse(content, &entries));
+  ASSERT_EQ(1u, entries.size());
+  EXPECT_EQ(convert::ToString(keys[2]), entries[0].key.ToString());
+  EXPECT_EQ(values[2], entries[0].value.ToString());
+}
+
+TEST_F(PageSnapshotIntegrationTest, PageSnapshotGetMany) {
+  auto instance = NewLedgerAppInstance();
+  ledger::PagePtr page = instance->GetTestPage();
+
+  const size_t N = 4;
+  fidl::Array<uint8_t> keys[N] = {
+      RandomArray(20, {0, 0, 0}),
+      RandomArray(20, {0, 0, 1}),
+      RandomArray(20, {0, 1, 0}),
+      RandomArray(20, {1, 1, 1}),
+  };
+  fidl::Array<uint8_t> values[N] = {
+      RandomArray(50),
+      RandomArray(50),
+      RandomArray(50),
+      RandomArray(50),
+  };
+  for (size_t i = 0; i < N; ++i) {
+    page->Put(keys[i].Clone(), values[i].Clone(), [](ledger::Status status) {
+      EXPECT_EQ(status, ledger::Status::OK);
+    });
+    EXPECT_TRUE(page.WaitForIncomingResponse());
+  }
+  // Only the keys starting with "0" are visible in the snapshot.
+  ledger::PageSnapshotPtr snapshot = PageGetSnapshot(
+      &page, fidl::Array<uint8_t>::From(std::vector<uint8_t>{0}));
+
+  // Request keys out of order, with a duplicate, a key that is not in the page
+  // and a key outside of the snapshot prefix.
+  auto requested_keys = fidl::Array<fidl::Array<uint8_t>>::New(0);
+  requested_keys.push_back(keys[2].Clone());
+  requested_keys.push_back(keys[0].Clone());
+  requested_keys.push_back(keys[2].Clone());
+  requested_keys.push_back(RandomArray(20, {0, 2}));
+  requested_keys.push_back(keys[3].Clone());
+
+  ledger::Status status;
+  fidl::Array<ledger::InlinedEntryPtr> entries;
+  snapshot->GetManyInline(requested_keys.Clone(),
+                          callback::Capture([] {}, &status, &entries));
+  EXPECT_TRUE(snapshot.WaitForIncomingResponse());
+  EXPECT_EQ(ledger::Status::OK, status);
+  ASSERT_EQ(2u, entries.size());
+  EXPECT_TRUE(keys[0].Equals(entries[0]->key));
+  EXPECT_TRUE(values[0].Equals(entries[0]->value));
+  EXPECT_TRUE(keys[2].Equals(entries[1]->key));
+  EXPECT_TRUE(values[2].Equals(entries[1]->value));
+
+  fsl::SizedVmoTransportPtr buffer;
+  snapshot->GetMany(std::move(requested_keys),
+                    callback::Capture([] {}, &status, &buffer));
+  EXPECT_TRUE(snapshot.WaitForIncomingResponse());
+  EXPECT_EQ(ledger::Status::OK, status);
+  ASSERT_TRUE(buffer);
+  std::string content;
+  ASSERT_TRUE(fsl::StringFromVmo(buffer, &content));
+  std::vector<ledger::packed_entries::PackedEntry> packed_entries;
+  ASSERT_TRUE(ledger::packed_entries::Parse(content, &packed_entries));
+  ASSERT_EQ(2u, packed_entries.size());
+  EXPECT_EQ(convert::ToString(keys[0]), packed_entries[0].key.ToString());
+  EXPECT_EQ(convert::ToString(values[0]), packed_entries[0].value.ToString());
+  EXPECT_EQ(convert::ToString(keys[2]), packed_entries[1].key.ToString());
+  EXPECT_EQ(convert::ToString(values[2]), packed_entries[1].value.ToString());
+}
+
 TEST_F(PageSnapshotIntegrationTest, PageSnapshotGetEntriesMultiPartSize) {
   auto instance = NewLedgerAppInstance();
   ledger::PagePtr page = instance->GetTestPage();
@@ -2,6 +2,8 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <memory>
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -702,6 +704,126 @@ TEST_F(PageWatcherIntegrationTest, PageWatcherPrefixNoChange) {
   EXPECT_EQ(0u, watcher.changes_seen);
 }
 
+TEST_F(PageWatcherIntegrationTest, PageWatcherMultiplePrefixes) {
+  auto instance = NewLedgerAppInstance();
+  ledger::PagePtr page = instance->GetTestPage();
+  std::vector<std::string> prefixes = {"01", "02", "0"};
+  std::vector<std::unique_ptr<Watcher>> watchers;
+  std::vector<ledger::PageSnapshotPtr> snapshots(prefixes.size());
+  size_t changes_seen = 0;
+
+  auto callback_statusok = [](ledger::Status status) {
+    EXPECT_EQ(ledger::Status::OK, status);
+  };
+  for (size_t i = 0; i < prefixes.size(); ++i) {
+    ledger::PageWatcherPtr watcher_ptr;
+    watchers.push_back(
+        std::make_unique<Watcher>(watcher_ptr.NewRequest(), [&changes_seen] {
+          if (++changes_seen == 3) {
+            fsl::MessageLoop::GetCurrent()->PostQuitTask();
+          }
+        }));
+    page->GetSnapshot(snapshots[i].NewRequest(),
+                      convert::ToArray(prefixes[i]), std::move(watcher_ptr),
+                      callback_statusok);
+    EXPECT_TRUE(page.WaitForIncomingResponse());
+  }
+
+  page->StartTransaction(callback_statusok);
+  EXPECT_TRUE(page.WaitForIncomingResponse());
+  page->Put(convert::ToArray("01-key"), convert::ToArray("value-01"),
+            callback_statusok);
+  EXPECT_TRUE(page.WaitForIncomingResponse());
+  page->Put(convert::ToArray("02-key"), convert::ToArray("value-02"),
+            callback_statusok);
+  EXPECT_TRUE(page.WaitForIncomingResponse());
+  page->Put(convert::ToArray("1-key"), convert::ToArray("value-1"),
+            callback_statusok);
+  EXPECT_TRUE(page.WaitForIncomingResponse());
+  page->Commit(callback_statusok);
+  EXPECT_TRUE(page.WaitForIncomingResponse());
+
+  EXPECT_FALSE(RunLoopWithTimeout());
+
+  // Each watcher only receives the keys matching its own prefix, with its own
+  // copy of the values.
+  for (const auto& watcher : watchers) {
+    EXPECT_EQ(1u, watcher->changes_seen);
+    EXPECT_EQ(ledger::ResultState::COMPLETED, watcher->last_result_state_);
+  }
+  ledger::PageChangePtr change = std::move(watchers[0]->last_page_change_);
+  ASSERT_EQ(1u, change->changes.size());
+  EXPECT_EQ("01-key", convert::ToString(change->changes[0]->key));
+  EXPECT_EQ("value-01", ToString(change->changes[0]->value));
+
+  change = std::move(watchers[1]->last_page_change_);
+  ASSERT_EQ(1u, change->changes.size());
+  EXPECT_EQ("02-key", convert::ToString(change->changes[0]->key));
+  EXPECT_EQ("value-02", ToString(change->changes[0]->value));
+
+  change = std::move(watchers[2]->last_page_change_);
+  ASSERT_EQ(2u, change->changes.size());
+  EXPECT_EQ("01-key", convert::ToString(change->changes[0]->key));
+  EXPECT_EQ("value-01", ToString(change->changes[0]->value));
+  EXPECT_EQ("02-key", convert::ToString(change->changes[1]->key));
+  EXPECT_EQ("value-02", ToString(change->changes[1]->value));
+}
+
+TEST_F(PageWatcherIntegrationTest, PageWatcherDisjointPrefixes) {
+  auto instance = NewLedgerAppInstance();
+  ledger::PagePtr page = instance->GetTestPage();
+  std::vector<std::string> prefixes = {"01", "1", "02"};
+  std::vector<std::unique_ptr<Watcher>> watchers;
+  std::vector<ledger::PageSnapshotPtr> snapshots(prefixes.size());
+  size_t changes_seen = 0;
+
+  auto callback_statusok = [](ledger::Status status) {
+    EXPECT_EQ(ledger::Status::OK, status);
+  };
+  for (size_t i = 0; i < prefixes.size(); ++i) {
+    ledger::PageWatcherPtr watcher_ptr;
+    watchers.push_back(
+        std::make_unique<Watcher>(watcher_ptr.NewRequest(), [&changes_seen] {
+          if (++changes_seen == 2) {
+            fsl::MessageLoop::GetCurrent()->PostQuitTask();
+          }
+        }));
+    page->GetSnapshot(snapshots[i].NewRequest(),
+                      convert::ToArray(prefixes[i]), std::move(watcher_ptr),
+                      callback_statusok);
+    EXPECT_TRUE(page.WaitForIncomingResponse());
+  }
+
+  page->StartTransaction(callback_statusok);
+  EXPECT_TRUE(page.WaitForIncomingResponse());
+  page->Put(convert::ToArray("01-key"), convert::ToArray("value-01"),
+            callback_statusok);
+  EXPECT_TRUE(page.WaitForIncomingResponse());
+  page->Put(convert::ToArray("1-key"), convert::ToArray("value-1"),
+            callback_statusok);
+  EXPECT_TRUE(page.WaitForIncomingResponse());
+  page->Commit(callback_statusok);
+  EXPECT_TRUE(page.WaitForIncomingResponse());
+
+  EXPECT_FALSE(RunLoopWithTimeout());
+
+  // The watchers of disjoint prefixes don't share a change: each one only
+  // receives the keys in its own range.
+  EXPECT_EQ(1u, watchers[0]->changes_seen);
+  ledger::PageChangePtr change = std::move(watchers[0]->last_page_change_);
+  ASSERT_EQ(1u, change->changes.size());
+  EXPECT_EQ("01-key", convert::ToString(change->changes[0]->key));
+  EXPECT_EQ("value-01", ToString(change->changes[0]->value));
+
+  EXPECT_EQ(1u, watchers[1]->changes_seen);
+  change = std::move(watchers[1]->last_page_change_);
+  ASSERT_EQ(1u, change->changes.size());
+  EXPECT_EQ("1-key", convert::ToString(change->changes[0]->key));
+  EXPECT_EQ("value-1", ToString(change->changes[0]->value));
+
+  EXPECT_EQ(0u, watchers[2]->changes_seen);
+}
+
 }  // namespace
 }  // namespace integration
 }  // namespace test
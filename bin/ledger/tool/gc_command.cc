@@ -0,0 +1,84 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "peridot/bin/ledger/tool/gc_command.h"
+
+#include <iostream>
+#include <utility>
+
+#include "lib/fsl/tasks/message_loop.h"
+#include "lib/fxl/files/directory.h"
+#include "lib/fxl/logging.h"
+#include "peridot/bin/ledger/tool/convert.h"
+
+namespace tool {
+
+GcCommand::GcCommand(std::vector<std::string> args) : args_(std::move(args)) {}
+
+void GcCommand::Start(fxl::Closure on_done) {
+  if (args_.size() != 4) {
+    PrintHelp(std::move(on_done));
+    return;
+  }
+  const std::string& user_repository_path = args_[1];
+  if (!files::IsDirectory(user_repository_path)) {
+    std::cerr << user_repository_path << " is not a directory" << std::endl;
+    PrintHelp(std::move(on_done));
+    return;
+  }
+  storage::PageId page_id;
+  if (!FromHexString(args_[3], &page_id)) {
+    FXL_LOG(ERROR) << "Unable to parse page id " << args_[3];
+    on_done();
+    return;
+  }
+
+  ledger_storage_ = std::make_unique<storage::LedgerStorageImpl>(
+      fsl::MessageLoop::GetCurrent()->task_runner(), &coroutine_service_,
+      user_repository_path, args_[2]);
+  ledger_storage_->GetPageStorage(
+      page_id, [this, on_done = std::move(on_done)](
+                   storage::Status status,
+                   std::unique_ptr<storage::PageStorage> storage) mutable {
+        if (status != storage::Status::OK) {
+          FXL_LOG(ERROR) << "Unable to retrieve page due to error " << status;
+          on_done();
+          return;
+        }
+        storage_ = std::move(storage);
+        storage_->CollectGarbage(
+            [on_done = std::move(on_done)](
+                storage::Status status,
+                storage::PageStorage::GarbageCollectionStats stats) {
+              if (status != storage::Status::OK) {
+                FXL_LOG(ERROR) << "Garbage collection failed with error "
+                               << status;
+                on_done();
+                return;
+              }
+              std::cout << "Deleted " << stats.deleted_piece_count
+                        << " objects, reclaimed " << stats.reclaimed_bytes
+                        << " bytes." << std::endl;
+              on_done();
+            });
+      });
+}
+
+void GcCommand::PrintHelp(fxl::Closure on_done) {
+  std::cout
+      << "gc command: deletes the objects of a page that are not reachable "
+         "from its current state, and that can be downloaded again from the "
+         "cloud.\n"
+      << "Note: you must stop Ledger before running this tool.\n\n"
+      << "Syntax: ledger_tool gc <ledger repository path> <app_id> "
+         "<page_id>\n\n"
+      << "Parameters:\n"
+      << " - app_id: ID of the application owning the page\n"
+      << "           e.g.: modular_user_runner\n"
+      << " - page_id: ID of the page to clean up, in hexadecimal."
+      << std::endl;
+  on_done();
+}
+
+}  // namespace tool
@@ -0,0 +1,42 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef PERIDOT_BIN_LEDGER_TOOL_GC_COMMAND_H_
+#define PERIDOT_BIN_LEDGER_TOOL_GC_COMMAND_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "peridot/bin/ledger/coroutine/coroutine_impl.h"
+#include "peridot/bin/ledger/storage/impl/ledger_storage_impl.h"
+#include "peridot/bin/ledger/storage/public/page_storage.h"
+#include "peridot/bin/ledger/tool/command.h"
+
+namespace tool {
+
+// Command that deletes the objects of a page that are no longer reachable
+// from its current state.
+class GcCommand : public Command {
+ public:
+  explicit GcCommand(std::vector<std::string> args);
+  ~GcCommand() override {}
+
+  // Command:
+  void Start(fxl::Closure on_done) override;
+
+ private:
+  void PrintHelp(fxl::Closure on_done);
+
+  const std::vector<std::string> args_;
+  coroutine::CoroutineServiceImpl coroutine_service_;
+  std::unique_ptr<storage::LedgerStorageImpl> ledger_storage_;
+  std::unique_ptr<storage::PageStorage> storage_;
+
+  FXL_DISALLOW_COPY_AND_ASSIGN(GcCommand);
+};
+
+}  // namespace tool
+
+#endif  // PERIDOT_BIN_LEDGER_TOOL_GC_COMMAND_H_
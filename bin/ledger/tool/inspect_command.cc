@@ -199,7 +199,7 @@ void InspectCommand::PrintCommit(std::unique_ptr<const storage::Commit> commit,
       [this, commit = std::move(commit), on_done = std::move(on_done)](
           coroutine::CoroutineHandler* handler) mutable {
         storage_->GetCommitContents(
-            *commit, "",
+            *commit, "", "",
             [this, handler](storage::Entry entry) {
               storage::Status status;
               std::unique_ptr<const storage::Object> object;
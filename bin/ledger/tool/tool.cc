@@ -15,6 +15,7 @@
 #include "lib/network/fidl/network_service.fidl.h"
 #include "peridot/bin/ledger/app/constants.h"
 #include "peridot/bin/ledger/tool/convert.h"
+#include "peridot/bin/ledger/tool/gc_command.h"
 #include "peridot/bin/ledger/tool/inspect_command.h"
 
 namespace tool {
@@ -33,17 +34,22 @@ void ToolApp::PrintUsage() {
   std::cout << "Usage: ledger_tool <COMMAND>" << std::endl;
   std::cout << "Commands:" << std::endl;
   std::cout << " - `inspect` - inspects the state of a ledger" << std::endl;
+  std::cout << " - `gc` - deletes the unreachable objects of a page"
+            << std::endl;
 }
 
 std::unique_ptr<Command> ToolApp::CommandFromArgs(
     const std::vector<std::string>& args) {
-  if (args.empty() || args[0] != "inspect") {
-    std::cerr << "only the `inspect` command is currently supported"
-              << std::endl;
-    return nullptr;
+  if (!args.empty() && args[0] == "inspect") {
+    return std::make_unique<InspectCommand>(args);
+  }
+  if (!args.empty() && args[0] == "gc") {
+    return std::make_unique<GcCommand>(args);
   }
 
-  return std::make_unique<InspectCommand>(args);
+  std::cerr << "only the `inspect` and `gc` commands are currently supported"
+            << std::endl;
+  return nullptr;
 }
 
 bool ToolApp::Initialize() {
@@ -52,7 +58,7 @@ bool ToolApp::Initialize() {
               << "Please use 'ledger_tool' instead." << std::endl;
   }
 
-  std::set<std::string> valid_commands = {"inspect"};
+  std::set<std::string> valid_commands = {"inspect", "gc"};
   const std::vector<std::string>& args = command_line_.positional_args();
   if (!args.empty() && valid_commands.count(args[0]) == 0) {
     std::cerr << "Unknown command: " << args[0] << std::endl;
@@ -32,6 +32,8 @@
 #include <memory.h>
 #include <stdint.h>
 
+#include <algorithm>
+
 namespace bup {
 
 namespace {
@@ -43,6 +45,9 @@ namespace {
 // slightly worse than the librsync value of 31 for my arbitrary test data.
 constexpr uint8_t kRollsumCharOffset = 31;
 
+static_assert((kWindowSize & (kWindowSize - 1)) == 0,
+              "kWindowSize must be a power of 2");
+
 }  // namespace
 
 RollSumSplit::RollSumSplit(size_t min_length, size_t max_length)
@@ -61,36 +66,60 @@ void RollSumSplit::Reset() {
 }
 
 size_t RollSumSplit::Feed(fxl::StringView buffer, size_t* bits) {
-  for (size_t i = 0; i < buffer.size(); i++) {
-    Roll(buffer[i]);
-    ++current_length_;
-    if (current_length_ >= min_length_ &&
-        ((s2_ & (kBlobSize - 1)) == ((~0) & (kBlobSize - 1)) ||
-         current_length_ >= max_length_)) {
-      if (bits) {
-        uint32_t rsum = Digest();
-        *bits = kBlobBits;
-        rsum >>= kBlobBits;
-        while ((rsum >>= 1) & 1) {
-          (*bits)++;
-        }
-      }
-      current_length_ = 0;
-      return i + 1;
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(buffer.data());
+  const size_t size = buffer.size();
+  size_t i = 0;
+
+  // The hash only depends on the last |kWindowSize| bytes. The bytes at the
+  // start of a chunk that can neither be a cut point nor be in the window of a
+  // cut point do not need to be hashed: hashing the |kWindowSize| bytes before
+  // the first possible cut point is enough to compute the same hash.
+  if (current_length_ + kWindowSize < min_length_) {
+    i = std::min(size, min_length_ - kWindowSize - current_length_);
+    current_length_ += i;
+  }
+
+  // Roll the hash over the rest of the buffer using local copies of the state,
+  // so that it stays in registers.
+  uint64_t s1 = s1_;
+  uint64_t s2 = s2_;
+  size_t window_index = window_index_;
+  size_t current_length = current_length_;
+  size_t result = 0;
+  for (; i < size; ++i) {
+    uint8_t drop = window_[window_index];
+    uint8_t add = data[i];
+    s1 += add - drop;
+    s2 += s1 - (kWindowSize * (drop + kRollsumCharOffset));
+    window_[window_index] = add;
+    window_index = (window_index + 1) & (kWindowSize - 1);
+    ++current_length;
+    if (current_length >= min_length_ &&
+        ((s2 & (kBlobSize - 1)) == ((~0) & (kBlobSize - 1)) ||
+         current_length >= max_length_)) {
+      result = i + 1;
+      break;
     }
   }
-  return 0;
-}
+  s1_ = s1;
+  s2_ = s2;
+  window_index_ = window_index;
 
-void RollSumSplit::Add(uint8_t drop, uint8_t add) {
-  s1_ += add - drop;
-  s2_ += s1_ - (kWindowSize * (drop + kRollsumCharOffset));
-}
+  if (!result) {
+    current_length_ = current_length;
+    return 0;
+  }
 
-void RollSumSplit::Roll(uint8_t c) {
-  Add(window_[window_index_], c);
-  window_[window_index_] = c;
-  window_index_ = (window_index_ + 1) % kWindowSize;
+  if (bits) {
+    uint32_t rsum = Digest();
+    *bits = kBlobBits;
+    rsum >>= kBlobBits;
+    while ((rsum >>= 1) & 1) {
+      (*bits)++;
+    }
+  }
+  current_length_ = 0;
+  return result;
 }
 
 uint32_t RollSumSplit::Digest() {
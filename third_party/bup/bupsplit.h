@@ -67,11 +67,12 @@ class RollSumSplit {
   // If |bits| is not null, and a cut has been found, |*bits| will be the number
   // of trailing 1s in the current hash. It will always be greater of equals to
   // |kBlobBits|.
+  // The buffer is processed as a block: the bytes that cannot influence the
+  // next cut are skipped, and the cut points are the same as if the data was
+  // fed byte by byte.
   size_t Feed(fxl::StringView buffer, size_t* bits);
 
  private:
-  void Add(uint8_t drop, uint8_t add);
-  void Roll(uint8_t c);
   uint32_t Digest();
 
   const size_t min_length_;
@@ -95,6 +95,77 @@ TEST_F(RollSumSplitTest, CheckSameResult) {
   }
 }
 
+// Byte by byte implementation of the rolling hash, used as a reference for
+// |RollSumSplit|.
+class ReferenceRollSumSplit {
+ public:
+  ReferenceRollSumSplit(size_t min_length, size_t max_length)
+      : min_length_(min_length), max_length_(max_length) {}
+
+  size_t Feed(fxl::StringView buffer, size_t* bits) {
+    for (size_t i = 0; i < buffer.size(); i++) {
+      uint8_t drop = window_[window_index_];
+      uint8_t add = buffer[i];
+      s1_ += add - drop;
+      s2_ += s1_ - (kWindowSize * (drop + kRollsumCharOffset));
+      window_[window_index_] = add;
+      window_index_ = (window_index_ + 1) % kWindowSize;
+      ++current_length_;
+      if (current_length_ >= min_length_ &&
+          ((s2_ & (kBlobSize - 1)) == (kBlobSize - 1) ||
+           current_length_ >= max_length_)) {
+        uint32_t rsum = (s1_ << 16) | (s2_ & 0xffff);
+        *bits = kBlobBits;
+        rsum >>= kBlobBits;
+        while ((rsum >>= 1) & 1) {
+          (*bits)++;
+        }
+        current_length_ = 0;
+        return i + 1;
+      }
+    }
+    return 0;
+  }
+
+ private:
+  static constexpr uint8_t kRollsumCharOffset = 31;
+
+  const size_t min_length_;
+  const size_t max_length_;
+  size_t current_length_ = 0;
+  uint64_t s1_ = kWindowSize * kRollsumCharOffset;
+  uint64_t s2_ = kWindowSize * (kWindowSize - 1) * kRollsumCharOffset;
+  uint8_t window_[kWindowSize] = {};
+  size_t window_index_ = 0;
+};
+
+// Verifies that the cut points are the same as the ones of the byte by byte
+// implementation, whatever the minimal size and the size of the fed buffers.
+TEST_F(RollSumSplitTest, CheckSameResultAsReference) {
+  for (size_t min : {0u, 10u, 1024u, 4096u}) {
+    for (size_t feed_size : {1u, 100u, 5000u, 1024u * 1024u}) {
+      RollSumSplit rh(min, 64 * 1024 - 1);
+      ReferenceRollSumSplit reference(min, 64 * 1024 - 1);
+
+      std::string value = GetValue(1024 * 1024);
+      for (size_t i = 0; i < value.size(); i += feed_size) {
+        fxl::StringView view = fxl::StringView(value).substr(i, feed_size);
+        while (!view.empty()) {
+          size_t bits = 0;
+          size_t reference_bits = 0;
+          size_t cut = rh.Feed(view, &bits);
+          EXPECT_EQ(reference.Feed(view, &reference_bits), cut);
+          if (!cut) {
+            break;
+          }
+          EXPECT_EQ(reference_bits, bits);
+          view = view.substr(cut);
+        }
+      }
+    }
+  }
+}
+
 // Check that the roll sum hash only depends on the last |kWindowSize|
 // characters.
 TEST_F(RollSumSplitTest, CheckWindowed) {